@@ -32,13 +32,10 @@ macro(libmisc_build)
         )
     endif()
 
-    if (HAVE_OPENMP)
-        list(APPEND misc_src
-             ${PROJECT_SOURCE_DIR}/third_party/qsort_arg_mt.c)
-    else()
-        list(APPEND misc_src
-             ${PROJECT_SOURCE_DIR}/third_party/qsort_arg.c)
-    endif()
+    # qsort_arg_mt() falls back to a single thread without OpenMP
+    list(APPEND misc_src
+         ${PROJECT_SOURCE_DIR}/third_party/qsort_arg.c
+         ${PROJECT_SOURCE_DIR}/third_party/qsort_arg_mt.c)
 
     add_library(misc STATIC ${misc_src})
 
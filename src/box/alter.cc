@@ -325,6 +325,23 @@ key_opts_decode_distance(const char *str)
 	return RTREE_INDEX_DISTANCE_TYPE_EUCLID; /* unreachabe */
 }
 
+/**
+ * Support function for key_def_new_from_tuple(..)
+ * Decode vinyl compaction policy from a string.
+ * Throws an error if the value does not correspond to any policy.
+ */
+static enum compaction_policy
+key_opts_decode_compaction(const char *str)
+{
+	for (int i = 0; i < compaction_policy_MAX; i++) {
+		if (strcasecmp(str, compaction_policy_strs[i]) == 0)
+			return (enum compaction_policy) i;
+	}
+	tnt_raise(ClientError, ER_WRONG_INDEX_OPTIONS, INDEX_OPTS,
+		  "compaction must be 'leveled', 'tiered' or 'time_window'");
+	return COMPACTION_LEVELED; /* unreachable */
+}
+
 /**
  * Support function for key_def_new_from_tuple(..)
  * 1.6.6+
@@ -347,6 +364,21 @@ key_opts_create(struct key_opts *opts, const char *map)
 	if (opts->run_size_ratio <= 1)
 		tnt_raise(ClientError, ER_WRONG_SPACE_OPTIONS, INDEX_OPTS,
 			  "run_size_ratio must be > 1");
+	if (opts->compactionbuf[0] != '\0')
+		opts->compaction =
+			key_opts_decode_compaction(opts->compactionbuf);
+	if (opts->compaction_window <= 0)
+		tnt_raise(ClientError, ER_WRONG_INDEX_OPTIONS, INDEX_OPTS,
+			  "compaction_window must be > 0");
+	if (opts->bloom_prefix < 0)
+		tnt_raise(ClientError, ER_WRONG_INDEX_OPTIONS, INDEX_OPTS,
+			  "bloom_prefix must be >= 0");
+	if (opts->compression_level <= 0)
+		tnt_raise(ClientError, ER_WRONG_INDEX_OPTIONS, INDEX_OPTS,
+			  "compression_level must be > 0");
+	if (opts->compression_dictionary < 0)
+		tnt_raise(ClientError, ER_WRONG_INDEX_OPTIONS, INDEX_OPTS,
+			  "compression_dictionary must be >= 0");
 	return map;
 }
 
@@ -1000,6 +1032,13 @@ ModifySpace::prepare(struct alter_space *alter)
 			  space_name(alter->old_space),
 			  "can not switch temporary flag on a non-empty space");
 	}
+	if (def.opts.defer_deletes != alter->old_space->def.opts.defer_deletes &&
+	    space_index(alter->old_space, 0) != NULL) {
+		tnt_raise(ClientError, ER_ALTER_SPACE,
+			  space_name(alter->old_space),
+			  "can not switch defer_deletes flag on a space "
+			  "with indexes");
+	}
 }
 
 /** Amend the definition of the new space. */
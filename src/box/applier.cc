@@ -47,6 +47,7 @@
 #include "trigger.h"
 #include "xrow_io.h"
 #include "error.h"
+#include "errinj.h"
 
 /* TODO: add configuration options */
 static const int RECONNECT_DELAY = 1;
@@ -289,6 +290,21 @@ finish:
 	applier_set_state(applier, APPLIER_CONNECTED);
 }
 
+/**
+ * Return true if the input buffer contains a whole row, so that
+ * coio_read_xrow() can read it without reading from the socket.
+ */
+static bool
+applier_has_buffered_row(struct ibuf *in)
+{
+	const char *pos = in->rpos;
+	if (pos == in->wpos || mp_typeof(*pos) != MP_UINT ||
+	    mp_check_uint(pos, in->wpos) > 0)
+		return false;
+	uint64_t len = mp_decode_uint(&pos);
+	return (uint64_t)(in->wpos - pos) >= len;
+}
+
 /**
  * Execute and process SUBSCRIBE request (follow updates from a master).
  */
@@ -354,6 +370,15 @@ applier_subscribe(struct applier *applier)
 	/* Re-enable warnings after successful execution of SUBSCRIBE */
 	applier->last_logged_errcode = 0;
 
+	/*
+	 * The stream may keep a batch of rows open between
+	 * iterations. Discard it if we leave the loop with an
+	 * exception: the rows are about to be freed.
+	 */
+	auto batch_guard = make_scoped_guard([=] {
+		xstream_abort(applier->subscribe_stream);
+	});
+
 	/*
 	 * Process a stream of rows from the binary log.
 	 */
@@ -362,9 +387,24 @@ applier_subscribe(struct applier *applier)
 		applier->lag = ev_now(loop()) - row.tm;
 		applier->last_row_time = ev_now(loop());
 
-		if (iproto_type_is_error(row.type))
+		if (iproto_type_is_error(row.type)) {
+			/* Commit the rows received before the error. */
+			xstream_flush(applier->subscribe_stream);
 			xrow_decode_error(&row);  /* error */
+		}
 		xstream_write(applier->subscribe_stream, &row);
+		ERROR_INJECT_ONCE(ERRINJ_APPLIER_READ,
+			tnt_raise(SocketError, coio->fd, "applier read"));
+
+		/*
+		 * Let the stream batch rows which have already
+		 * been received. The rows point to the input
+		 * buffer, which is not reallocated as long as
+		 * we don't read from the socket.
+		 */
+		if (applier_has_buffered_row(&iobuf->in))
+			continue;
+		xstream_flush(applier->subscribe_stream);
 
 		iobuf_reset(iobuf);
 		fiber_gc();
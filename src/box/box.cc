@@ -67,6 +67,8 @@
 #include "xrow_io.h"
 #include "authentication.h"
 #include "path_lock.h"
+#include "latch.h"
+#include "io_limiter.h"
 
 static char status[64] = "unknown";
 
@@ -302,14 +304,110 @@ apply_initial_join_row(struct xstream *stream, struct xrow_header *row)
 	space->handler->applyInitialJoinRow(space, request);
 }
 
+/**
+ * Rows received from a master are applied in batches: the rows
+ * the applier has at hand are executed in a single transaction,
+ * which is committed on xstream_flush(), and so are written to
+ * WAL with one wal_write() instead of one per row.
+ *
+ * The applier which has an open batch holds this latch. Rows of
+ * a batch get into recovery->vclock only on commit, so if the
+ * batch yields, e.g. to read a vinyl page, another applier must
+ * not apply a row it received via another master, which may be
+ * already in the batch.
+ */
+static struct latch apply_batch_latch = LATCH_INITIALIZER(apply_batch_latch);
+
 static void
-apply_subscribe_row(struct xstream *stream, struct xrow_header *row)
+apply_subscribe_flush(struct xstream *stream)
+{
+	(void) stream;
+	struct txn *txn = in_txn();
+	if (txn == NULL)
+		return;
+	try {
+		txn_commit(txn);
+	} catch (Exception *e) {
+		txn_rollback();
+		latch_unlock(&apply_batch_latch);
+		throw;
+	}
+	latch_unlock(&apply_batch_latch);
+}
+
+/**
+ * Discard the current batch if the applier stops before
+ * flushing it, e.g. on a disconnect or a malformed row. The
+ * rows of the batch point to the applier input buffer, which
+ * is going to be reset.
+ */
+static void
+apply_subscribe_abort(struct xstream *stream)
+{
+	(void) stream;
+	if (in_txn() != NULL)
+		txn_rollback();
+	if (latch_owner(&apply_batch_latch) == fiber())
+		latch_unlock(&apply_batch_latch);
+}
+
+/**
+ * Add a row to the current batch. Rows of system spaces can't
+ * be a part of a multi-statement transaction, so they are
+ * applied on their own, as well as rows of another engine than
+ * the current batch.
+ */
+static void
+apply_subscribe_row_locked(struct xrow_header *row)
 {
 	/* Check lsn */
 	int64_t current_lsn = vclock_get(&recovery->vclock, row->replica_id);
 	if (row->lsn <= current_lsn)
 		return;
-	apply_row(stream, row);
+	assert(row->bodycnt == 1); /* always 1 for read */
+	struct request *request = xrow_decode_request(row);
+	struct space *space = space_cache_find(request->space_id);
+	bool is_batched = !space_is_system(space);
+	struct txn *txn = in_txn();
+	if (txn != NULL &&
+	    (!is_batched || txn->engine != space->handler->engine)) {
+		txn_commit(txn);
+		/* The commit has freed the request, decode it again. */
+		request = xrow_decode_request(row);
+	}
+	if (!is_batched) {
+		process_rw(request, space, NULL);
+		return;
+	}
+	/*
+	 * The row is referenced by the transaction until commit,
+	 * while the applier reuses it for the next one.
+	 */
+	struct xrow_header *header =
+		region_alloc_object_xc(&fiber()->gc, struct xrow_header);
+	*header = *row;
+	request->header = header;
+	if (in_txn() == NULL)
+		txn_begin(false);
+	process_rw(request, space, NULL);
+}
+
+static void
+apply_subscribe_row(struct xstream *stream, struct xrow_header *row)
+{
+	(void) stream;
+	if (in_txn() == NULL)
+		latch_lock(&apply_batch_latch);
+	assert(latch_owner(&apply_batch_latch) == fiber());
+	try {
+		apply_subscribe_row_locked(row);
+	} catch (Exception *e) {
+		txn_rollback();
+		latch_unlock(&apply_batch_latch);
+		throw;
+	}
+	if (in_txn() == NULL)
+		latch_unlock(&apply_batch_latch);
 }
 
 /* {{{ configuration bindings */
@@ -371,6 +469,38 @@ box_check_readahead(int readahead)
 	}
 }
 
+static int
+box_check_memtx_snap_threads(int threads)
+{
+	enum { SNAP_THREADS_MAX = 64 };
+	if (threads < 1 || threads > SNAP_THREADS_MAX) {
+		tnt_raise(ClientError, ER_CFG, "memtx_snap_threads",
+			  "specified value is out of bounds");
+	}
+	return threads;
+}
+
+static int
+box_check_iproto_threads(int threads)
+{
+	enum { IPROTO_THREADS_MAX = 64 };
+	if (threads < 1 || threads > IPROTO_THREADS_MAX) {
+		tnt_raise(ClientError, ER_CFG, "iproto_threads",
+			  "specified value is out of bounds");
+	}
+	return threads;
+}
+
+static double
+box_check_io_rate_limit(double limit)
+{
+	if (limit < 0) {
+		tnt_raise(ClientError, ER_CFG, "io_rate_limit",
+			  "the value must not be negative");
+	}
+	return limit;
+}
+
 static int64_t
 box_check_rows_per_wal(int64_t rows_per_wal)
 {
@@ -382,6 +512,38 @@ box_check_rows_per_wal(int64_t rows_per_wal)
 	return rows_per_wal;
 }
 
+static int64_t
+box_check_wal_tail_size(int64_t wal_tail_size)
+{
+	if (wal_tail_size < 0) {
+		tnt_raise(ClientError, ER_CFG, "wal_tail_size",
+			  "the value must not be negative");
+	}
+	return wal_tail_size;
+}
+
+static int64_t
+box_check_fiber_stack_size(int64_t stack_size)
+{
+	enum { FIBER_STACK_SIZE_MAX = 256 * 1024 * 1024 };
+	if (stack_size < FIBER_STACK_SIZE_MIN ||
+	    stack_size > FIBER_STACK_SIZE_MAX) {
+		tnt_raise(ClientError, ER_CFG, "fiber_stack_size",
+			  "specified value is out of bounds");
+	}
+	return stack_size;
+}
+
+static int64_t
+box_check_commit_async_max_bytes(int64_t max_bytes)
+{
+	if (max_bytes < 0) {
+		tnt_raise(ClientError, ER_CFG, "commit_async_max_bytes",
+			  "the value must not be negative");
+	}
+	return max_bytes;
+}
+
 void
 box_check_config()
 {
@@ -389,8 +551,14 @@ box_check_config()
 	box_check_uri(cfg_gets("listen"), "listen");
 	box_check_replication();
 	box_check_readahead(cfg_geti("readahead"));
+	box_check_iproto_threads(cfg_geti("iproto_threads"));
+	box_check_memtx_snap_threads(cfg_geti("memtx_snap_threads"));
+	box_check_io_rate_limit(cfg_getd("io_rate_limit"));
 	box_check_rows_per_wal(cfg_geti64("rows_per_wal"));
 	box_check_wal_mode(cfg_gets("wal_mode"));
+	box_check_wal_tail_size(cfg_geti64("wal_tail_size"));
+	box_check_commit_async_max_bytes(cfg_geti64("commit_async_max_bytes"));
+	box_check_fiber_stack_size(cfg_geti64("fiber_stack_size"));
 	box_check_memtx_min_tuple_size(cfg_geti64("memtx_min_tuple_size"));
 	if (cfg_geti64("vinyl_page_size") > cfg_geti64("vinyl_range_size"))
 		tnt_raise(ClientError, ER_CFG, "vinyl_page_size",
@@ -513,12 +681,36 @@ box_set_snap_io_rate_limit(void)
 		memtx->setSnapIoRateLimit(cfg_getd("snap_io_rate_limit"));
 }
 
+void
+box_set_io_rate_limit(void)
+{
+	double limit = box_check_io_rate_limit(cfg_getd("io_rate_limit"));
+	io_limiter_set_rate(&io_limiter, limit * 1024 * 1024);
+}
+
+void
+box_set_memtx_snap_threads(void)
+{
+	int threads = box_check_memtx_snap_threads(
+		cfg_geti("memtx_snap_threads"));
+	MemtxEngine *memtx = (MemtxEngine *) engine_find("memtx");
+	if (memtx)
+		memtx->setSnapThreads(threads);
+}
+
 void
 box_set_too_long_threshold(void)
 {
 	too_long_threshold = cfg_getd("too_long_threshold");
 }
 
+void
+box_set_commit_async_max_bytes(void)
+{
+	txn_async_max_bytes = box_check_commit_async_max_bytes(
+		cfg_geti64("commit_async_max_bytes"));
+}
+
 void
 box_set_readahead(void)
 {
@@ -667,6 +859,39 @@ box_process1(struct request *request, box_tuple_t **result)
 	}
 }
 
+int
+box_check_dml(struct request *request)
+{
+	assert(iproto_type_is_dml(request->type));
+	try {
+		struct space *space = space_cache_find(request->space_id);
+		if (!space->def.opts.temporary)
+			box_check_writable();
+		access_check_space(space, PRIV_W);
+		switch (request->type) {
+		case IPROTO_INSERT:
+		case IPROTO_REPLACE:
+			if (tuple_validate_raw(space->format, request->tuple))
+				diag_raise();
+			break;
+		case IPROTO_UPSERT:
+			if (tuple_validate_raw(space->format, request->tuple))
+				diag_raise();
+			index_find_unique(space, request->index_id);
+			break;
+		case IPROTO_UPDATE:
+		case IPROTO_DELETE:
+			index_find_unique(space, request->index_id);
+			break;
+		default:
+			break;
+		}
+		return 0;
+	} catch (Exception *e) {
+		return -1;
+	}
+}
+
 int
 box_select(struct port *port, uint32_t space_id, uint32_t index_id,
 	   int iterator, uint32_t offset, uint32_t limit,
@@ -1496,6 +1721,17 @@ box_cfg_xc(void)
 {
 	tuple_init();
 
+	fiber_set_stack_size(
+		box_check_fiber_stack_size(cfg_geti64("fiber_stack_size")));
+	fiber_set_stack_guard(cfg_geti("fiber_stack_guard"));
+	/*
+	 * Cache enough fibers to serve all requests that iproto
+	 * may have in flight, so that a burst of requests doesn't
+	 * have to allocate fiber stacks in tx thread.
+	 */
+	if (fiber_reserve(IPROTO_MSG_MAX) != 0)
+		diag_raise();
+
 	/* Join the cord interconnect as "tx" endpoint. */
 	fiber_pool_create(&tx_fiber_pool, "tx", FIBER_POOL_SIZE,
 			  FIBER_POOL_IDLE_TIMEOUT);
@@ -1505,23 +1741,29 @@ box_cfg_xc(void)
 	rmean_box = rmean_new(iproto_type_strs, IPROTO_TYPE_STAT_MAX);
 	rmean_error = rmean_new(rmean_error_strings, RMEAN_ERROR_LAST);
 
+	io_limiter_create(&io_limiter);
+	box_set_io_rate_limit();
+
 	engine_init();
 
 	schema_init();
 
 	replication_init();
 	port_init();
-	iproto_init();
+	iproto_init(box_check_iproto_threads(cfg_geti("iproto_threads")));
 	wal_thread_start();
 
 	title("loading");
 
 	box_set_too_long_threshold();
+	box_set_commit_async_max_bytes();
 	struct wal_stream wal_stream;
 	wal_stream_create(&wal_stream, cfg_geti64("rows_per_wal"));
 	xstream_create(&initial_join_stream, apply_initial_join_row);
 	xstream_create(&final_join_stream, apply_row);
 	xstream_create(&subscribe_stream, apply_subscribe_row);
+	subscribe_stream.flush = apply_subscribe_flush;
+	subscribe_stream.abort = apply_subscribe_abort;
 
 	struct vclock checkpoint_vclock;
 	vclock_create(&checkpoint_vclock);
@@ -1624,9 +1866,11 @@ box_cfg_xc(void)
 	/* Start WAL writer */
 	int64_t rows_per_wal = box_check_rows_per_wal(cfg_geti64("rows_per_wal"));
 	enum wal_mode wal_mode = box_check_wal_mode(cfg_gets("wal_mode"));
+	int64_t wal_tail_size =
+		box_check_wal_tail_size(cfg_geti64("wal_tail_size"));
 	if (wal_mode != WAL_NONE) {
 		wal_init(wal_mode, cfg_gets("wal_dir"), &INSTANCE_UUID,
-			 &recovery->vclock, rows_per_wal);
+			 &recovery->vclock, rows_per_wal, wal_tail_size);
 	}
 
 	rmean_cleanup(rmean_box);
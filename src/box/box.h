@@ -134,7 +134,10 @@ void box_set_replication(void);
 void box_set_log_level(void);
 void box_set_io_collect_interval(void);
 void box_set_snap_io_rate_limit(void);
+void box_set_io_rate_limit(void);
+void box_set_memtx_snap_threads(void);
 void box_set_too_long_threshold(void);
+void box_set_commit_async_max_bytes(void);
 void box_set_readahead(void);
 void box_set_force_recovery(void);
 
@@ -314,6 +317,16 @@ box_truncate(uint32_t space_id);
 int
 box_process1(struct request *request, box_tuple_t **result);
 
+/**
+ * Check a DML request without executing it: the space and
+ * the index exist, the instance is writable, the user may
+ * write to the space and the tuple matches the space format.
+ * Errors of the execution itself, such as a duplicate key,
+ * can't be detected here.
+ */
+int
+box_check_dml(struct request *request);
+
 int
 boxk(int type, uint32_t space_id, const char *format, ...);
 
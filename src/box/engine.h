@@ -40,6 +40,12 @@ struct relay;
 
 enum engine_flags {
 	ENGINE_CAN_BE_TEMPORARY = 1,
+	ENGINE_CAN_DEFER_DELETES = 2,
+	/**
+	 * Changes are visible before commit, so a transaction
+	 * can be completed after its fiber has moved on.
+	 */
+	ENGINE_CAN_COMMIT_ASYNC = 4,
 };
 
 extern struct rlist engines;
@@ -246,6 +252,18 @@ engine_can_be_temporary(uint32_t flags)
 	return flags & ENGINE_CAN_BE_TEMPORARY;
 }
 
+static inline bool
+engine_can_defer_deletes(uint32_t flags)
+{
+	return flags & ENGINE_CAN_DEFER_DELETES;
+}
+
+static inline bool
+engine_can_commit_async(uint32_t flags)
+{
+	return flags & ENGINE_CAN_COMMIT_ASYNC;
+}
+
 static inline uint32_t
 engine_id(Handler *space)
 {
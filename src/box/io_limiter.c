@@ -0,0 +1,160 @@
+/*
+ * Copyright 2010-2017, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "io_limiter.h"
+
+#include <assert.h>
+
+#include "trivia/util.h"
+#include "tt_pthread.h"
+#include "clock.h"
+
+enum {
+	/**
+	 * Max time a bucket can be refilled for or be in debt
+	 * for, in seconds. Also, a class that hasn't written
+	 * for that long doesn't take its share.
+	 */
+	IO_LIMITER_BURST = 1,
+};
+
+struct io_limiter io_limiter;
+
+/** Empty all buckets. */
+static void
+io_limiter_reset(struct io_limiter *limiter)
+{
+	double now = clock_monotonic();
+	for (int i = 0; i < io_class_MAX; i++) {
+		struct io_limiter_bucket *bucket = &limiter->bucket[i];
+		bucket->tokens = 0;
+		bucket->refill_time = now;
+		bucket->write_time = now - IO_LIMITER_BURST;
+	}
+}
+
+void
+io_limiter_create(struct io_limiter *limiter)
+{
+	tt_pthread_mutex_init(&limiter->mutex, NULL);
+	limiter->rate = 0;
+	io_limiter_reset(limiter);
+	for (int i = 0; i < io_class_MAX; i++) {
+		limiter->weight[i] = 1;
+		limiter->is_urgent[i] = false;
+	}
+}
+
+void
+io_limiter_destroy(struct io_limiter *limiter)
+{
+	tt_pthread_mutex_destroy(&limiter->mutex);
+}
+
+void
+io_limiter_set_rate(struct io_limiter *limiter, double rate)
+{
+	assert(rate >= 0);
+	tt_pthread_mutex_lock(&limiter->mutex);
+	limiter->rate = rate;
+	io_limiter_reset(limiter);
+	tt_pthread_mutex_unlock(&limiter->mutex);
+}
+
+void
+io_limiter_set_weight(struct io_limiter *limiter, enum io_class io_class,
+		      double weight)
+{
+	assert(weight > 0 && weight <= 1);
+	tt_pthread_mutex_lock(&limiter->mutex);
+	limiter->weight[io_class] = weight;
+	tt_pthread_mutex_unlock(&limiter->mutex);
+}
+
+double
+io_limiter_weight(struct io_limiter *limiter, enum io_class io_class)
+{
+	tt_pthread_mutex_lock(&limiter->mutex);
+	double weight = limiter->weight[io_class];
+	tt_pthread_mutex_unlock(&limiter->mutex);
+	return weight;
+}
+
+void
+io_limiter_set_urgent(struct io_limiter *limiter, enum io_class io_class,
+		      bool is_urgent)
+{
+	tt_pthread_mutex_lock(&limiter->mutex);
+	limiter->is_urgent[io_class] = is_urgent;
+	tt_pthread_mutex_unlock(&limiter->mutex);
+}
+
+/**
+ * The bandwidth share of a class: the limit divided among
+ * the classes that have written recently by their weight.
+ */
+static double
+io_limiter_class_rate(struct io_limiter *limiter, enum io_class io_class,
+		      double now)
+{
+	double total_weight = 0;
+	for (int i = 0; i < io_class_MAX; i++) {
+		if (i == (int)io_class ||
+		    now - limiter->bucket[i].write_time < IO_LIMITER_BURST)
+			total_weight += limiter->weight[i];
+	}
+	return limiter->rate * limiter->weight[io_class] / total_weight;
+}
+
+double
+io_limiter_write(struct io_limiter *limiter, enum io_class io_class,
+		 size_t size)
+{
+	double delay = 0;
+	tt_pthread_mutex_lock(&limiter->mutex);
+	if (limiter->rate > 0) {
+		struct io_limiter_bucket *bucket = &limiter->bucket[io_class];
+		double now = clock_monotonic();
+		double rate = io_limiter_class_rate(limiter, io_class, now);
+		bucket->tokens += (now - bucket->refill_time) * rate;
+		bucket->tokens = MIN(bucket->tokens, rate * IO_LIMITER_BURST);
+		bucket->refill_time = now;
+		bucket->write_time = now;
+		bucket->tokens -= size;
+		if (limiter->is_urgent[io_class]) {
+			bucket->tokens = MAX(bucket->tokens,
+					     -rate * IO_LIMITER_BURST);
+		} else if (bucket->tokens < 0) {
+			delay = -bucket->tokens / rate;
+		}
+	}
+	tt_pthread_mutex_unlock(&limiter->mutex);
+	return delay;
+}
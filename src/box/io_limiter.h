@@ -0,0 +1,132 @@
+#ifndef INCLUDES_TARANTOOL_BOX_IO_LIMITER_H
+#define INCLUDES_TARANTOOL_BOX_IO_LIMITER_H
+/*
+ * Copyright 2010-2017, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/** Kinds of background disk writes sharing the I/O budget. */
+enum io_class {
+	/** Vinyl dump of in-memory indexes. */
+	IO_CLASS_DUMP,
+	/** Vinyl compaction and range split. */
+	IO_CLASS_COMPACTION,
+	/** Memtx snapshot. */
+	IO_CLASS_SNAPSHOT,
+	io_class_MAX
+};
+
+/** Token bucket of one class of writes. */
+struct io_limiter_bucket {
+	/** Available tokens, negative if the bucket is in debt. */
+	double tokens;
+	/** Time of the last refill of the bucket. */
+	double refill_time;
+	/** Time of the last write of the class. */
+	double write_time;
+};
+
+/**
+ * Token buckets limiting the total disk write bandwidth of
+ * background tasks: vinyl dump and compaction and memtx
+ * snapshot, so they don't compete with WAL writes and
+ * foreground reads for the disk.
+ *
+ * Each class draws tokens from its own bucket, refilled with
+ * a share of the bandwidth proportional to the class weight
+ * among the classes that have written recently. So a class
+ * with a lower weight gets a smaller share while the others
+ * are busy, but idle classes don't waste the bandwidth, and
+ * the debt of one class never slows down another. An urgent
+ * class is charged for its writes, but never waits; its debt
+ * is capped, so that it can go on at its share as soon as it
+ * is not urgent any more. Thread-safe.
+ */
+struct io_limiter {
+	pthread_mutex_t mutex;
+	/** Bandwidth in bytes per second, 0 if unlimited. */
+	double rate;
+	/** Bucket of each class. */
+	struct io_limiter_bucket bucket[io_class_MAX];
+	/** Share weight of each class, in (0, 1]. */
+	double weight[io_class_MAX];
+	/** Set for classes that are not to be throttled. */
+	bool is_urgent[io_class_MAX];
+};
+
+/** The limiter shared by all background writers. */
+extern struct io_limiter io_limiter;
+
+void
+io_limiter_create(struct io_limiter *limiter);
+
+void
+io_limiter_destroy(struct io_limiter *limiter);
+
+/** Set the bandwidth in bytes per second, 0 for no limit. */
+void
+io_limiter_set_rate(struct io_limiter *limiter, double rate);
+
+/** Set the share weight of a class, in (0, 1]. */
+void
+io_limiter_set_weight(struct io_limiter *limiter, enum io_class io_class,
+		      double weight);
+
+/** Get the share weight of a class. */
+double
+io_limiter_weight(struct io_limiter *limiter, enum io_class io_class);
+
+/** Mark a class as urgent or not. */
+void
+io_limiter_set_urgent(struct io_limiter *limiter, enum io_class io_class,
+		      bool is_urgent);
+
+/**
+ * Account @size bytes written by a writer of the given class.
+ * Return the time in seconds the writer must sleep to stay
+ * within the limit.
+ */
+double
+io_limiter_write(struct io_limiter *limiter, enum io_class io_class,
+		 size_t size);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* INCLUDES_TARANTOOL_BOX_IO_LIMITER_H */
@@ -46,11 +46,13 @@
 #include "coio.h"
 #include "scoped_guard.h"
 #include "memory.h"
+#include "assoc.h"
 
 #include "port.h"
 #include "iproto_port.h"
 #include "iobuf.h"
 #include "box.h"
+#include "txn.h"
 #include "tuple.h"
 #include "session.h"
 #include "xrow.h"
@@ -59,8 +61,98 @@
 #include "iproto_constants.h"
 #include "rmean.h"
 
-/* The number of iproto messages in flight */
-enum { IPROTO_MSG_MAX = 768 };
+enum {
+	/**
+	 * SELECT replies with at least this many bytes of tuple
+	 * data are written to the socket right from the tuples,
+	 * without copying them to the output buffer.
+	 */
+	IPROTO_ZEROCOPY_MIN = 64 * 1024,
+	/** Max number of tuples written by one writev(). */
+	IPROTO_ZEROCOPY_IOV_MAX = 64,
+	/** Max number of streams with an open transaction. */
+	IPROTO_STREAM_MAX = 64,
+	/** Max number of requests queued in a stream. */
+	IPROTO_STREAM_REQUEST_MAX = 1000,
+	/** Max size of request bodies queued in a stream. */
+	IPROTO_STREAM_SIZE_MAX = 16 * 1024 * 1024,
+};
+
+/* {{{ iproto_thread - declaration */
+
+/**
+ * A network thread. Client connections are spread among the
+ * threads: the first thread accepts all of them and hands them
+ * off to the threads in turn, and a connection is served by
+ * the thread it has been handed to till it is closed. Each
+ * thread has its own event loop, memory pools and pipe to tx,
+ * so the threads don't share anything but the tx thread.
+ */
+struct iproto_thread
+{
+	struct cord cord;
+	/** Thread number, used in cord and endpoint names. */
+	int id;
+	/**
+	 * A queue for all requests in all connections of
+	 * the thread. All requests from all connections are
+	 * processed concurrently. Is also used as a queue for
+	 * just established connections and to execute
+	 * disconnect triggers. A few notes about these triggers:
+	 * - they need to be run in a fiber
+	 * - unlike an ordinary request failure, on_connect trigger
+	 *   failure must lead to connection close.
+	 * - on_connect trigger must be processed before any other
+	 *   request on this connection.
+	 */
+	struct cpipe tx_pipe;
+	/** A pipe from tx to the thread, for replies. */
+	struct cpipe net_pipe;
+	/**
+	 * A pipe from the first thread to this one, to hand
+	 * off accepted connections. Unused in the first thread.
+	 */
+	struct cpipe accept_pipe;
+	/**
+	 * The number of messages in flight the thread may
+	 * have, a share of IPROTO_MSG_MAX.
+	 */
+	size_t msg_max;
+	struct mempool msg_pool;
+	struct mempool connection_pool;
+	/** Connections with input throttled, see iproto_resume(). */
+	struct rlist stopped_connections;
+	/** Binary protocol listener. Bound in the first thread only. */
+	struct evio_service binary;
+	/** Network statistics of the thread. */
+	struct rmean *rmean;
+	/*
+	 * Message routes. The return hop of every route
+	 * leads to net_pipe of the thread, so each thread
+	 * has its own copy.
+	 */
+	struct cmsg_hop disconnect_route[2];
+	struct cmsg_hop misc_route[2];
+	struct cmsg_hop select_route[2];
+	struct cmsg_hop process1_route[2];
+	struct cmsg_hop sync_route[2];
+	struct cmsg_hop connect_route[2];
+	struct cmsg_hop zerocopy_route[2];
+	struct cmsg_hop accept_route[1];
+	const struct cmsg_hop *dml_route[IPROTO_TYPE_STAT_MAX];
+};
+
+static struct iproto_thread *iproto_threads;
+static int iproto_thread_count;
+/**
+ * The thread to hand the next accepted connection to.
+ * Accessed by the first thread only.
+ */
+static int iproto_accept_next;
+/** Set once accept pipes to all threads are created. */
+static bool iproto_has_accept_pipes;
+
+/* }}} */
 
 /* {{{ iproto_msg - declaration */
 
@@ -72,6 +164,8 @@ enum { IPROTO_MSG_MAX = 768 };
 struct iproto_msg: public cmsg
 {
 	struct iproto_connection *connection;
+	/** The network thread of the connection. */
+	struct iproto_thread *thread;
 
 	/* --- Box msgs - actual requests for the transaction processor --- */
 	/* Request message code and sync. */
@@ -98,31 +192,41 @@ struct iproto_msg: public cmsg
 	 * and the connection must be closed.
 	 */
 	bool close_connection;
+	/**
+	 * True if this is a large SELECT reply, which tuples
+	 * are written to the socket right after write_end
+	 * directly from the tuple memory, see
+	 * IPROTO_ZEROCOPY_MIN. The tuples are referenced by
+	 * the port until the reply is sent, then the msg goes
+	 * to tx once again to unreference them.
+	 */
+	bool is_zerocopy;
+	/** SELECT result. */
+	struct port port;
+	/** The first tuple in port which is not sent yet. */
+	struct port_entry *send_entry;
+	/** The number of bytes of send_entry already sent. */
+	uint32_t send_offset;
+	/** Link in iproto_connection::zerocopy_queue. */
+	struct rlist in_zerocopy;
 };
 
-static struct mempool iproto_msg_pool;
-
 static struct iproto_msg *
-iproto_msg_new(struct iproto_connection *con)
-{
-	struct iproto_msg *msg =
-		(struct iproto_msg *) mempool_alloc_xc(&iproto_msg_pool);
-	msg->connection = con;
-	return msg;
-}
+iproto_msg_new(struct iproto_connection *con);
 
 /**
  * Resume stopped connections, if any.
  */
 static void
-iproto_resume();
-
+iproto_resume(struct iproto_thread *thread);
 
 static inline void
-iproto_msg_delete(struct cmsg *msg)
+iproto_msg_delete(struct cmsg *m)
 {
-	mempool_free(&iproto_msg_pool, msg);
-	iproto_resume();
+	struct iproto_msg *msg = (struct iproto_msg *) m;
+	struct iproto_thread *thread = msg->thread;
+	mempool_free(&thread->msg_pool, msg);
+	iproto_resume(thread);
 }
 
 struct IprotoMsgGuard {
@@ -138,24 +242,9 @@ struct IprotoMsgGuard {
 
 /* {{{ iproto connection and requests */
 
-/**
- * A single global queue for all requests in all connections. All
- * requests from all connections are processed concurrently.
- * Is also used as a queue for just established connections and to
- * execute disconnect triggers. A few notes about these triggers:
- * - they need to be run in a fiber
- * - unlike an ordinary request failure, on_connect trigger
- *   failure must lead to connection close.
- * - on_connect trigger must be processed before any other
- *   request on this connection.
- */
-static struct cpipe tx_pipe;
-static struct cpipe net_pipe;
 /* A pointer to the transaction processor cord. */
 struct cord *tx_cord;
 
-struct rmean *rmean_net;
-
 enum rmean_net_name {
 	IPROTO_SENT,
 	IPROTO_RECEIVED,
@@ -191,14 +280,82 @@ struct iproto_connection
 	struct ev_io output;
 	/** Logical session. */
 	struct session *session;
+	/** The network thread serving the connection. */
+	struct iproto_thread *thread;
 	ev_loop *loop;
 	/* Pre-allocated disconnect msg. */
 	struct iproto_msg *disconnect;
 	struct rlist in_stop_list;
+	/**
+	 * Zero-copy SELECT replies which tuples are not sent
+	 * yet, in the order of their position in the output.
+	 * Requests of these msgs are kept in the input buffer
+	 * until the tuples are sent, so that neither the iobuf
+	 * nor the connection is recycled meanwhile.
+	 */
+	struct rlist zerocopy_queue;
+	/**
+	 * Streams with an open transaction, by stream id.
+	 * Created on demand and only accessed in tx thread.
+	 */
+	struct mh_i64ptr_t *streams;
 };
 
-static struct mempool iproto_connection_pool;
-static RLIST_HEAD(stopped_connections);
+static struct iproto_msg *
+iproto_msg_new(struct iproto_connection *con)
+{
+	struct iproto_thread *thread = con->thread;
+	struct iproto_msg *msg =
+		(struct iproto_msg *) mempool_alloc_xc(&thread->msg_pool);
+	msg->connection = con;
+	msg->thread = thread;
+	msg->is_zerocopy = false;
+	return msg;
+}
+
+/**
+ * Send a zero-copy msg to tx to unreference its tuples.
+ * The msg is deleted when it gets back.
+ */
+static inline void
+iproto_msg_release_zerocopy(struct iproto_msg *msg)
+{
+	assert(msg->is_zerocopy);
+	cmsg_init(msg, msg->thread->zerocopy_route);
+	cpipe_push(&msg->thread->tx_pipe, msg);
+}
+
+/**
+ * Find the first zero-copy reply which is not sent yet
+ * in the output of the given iobuf.
+ */
+static inline struct iproto_msg *
+iproto_connection_first_zerocopy(struct iproto_connection *con,
+				 struct iobuf *iobuf)
+{
+	struct iproto_msg *msg;
+	rlist_foreach_entry(msg, &con->zerocopy_queue, in_zerocopy) {
+		if (msg->iobuf == iobuf)
+			return msg;
+	}
+	return NULL;
+}
+
+/**
+ * Drop all zero-copy replies which are not sent yet,
+ * the connection is being closed.
+ */
+static void
+iproto_connection_drop_zerocopy(struct iproto_connection *con)
+{
+	struct iproto_msg *msg, *tmp;
+	rlist_foreach_entry_safe(msg, &con->zerocopy_queue, in_zerocopy, tmp) {
+		rlist_del_entry(msg, in_zerocopy);
+		/* Discard request (see iproto_enqueue_batch()) */
+		msg->iobuf->in.rpos += msg->len;
+		iproto_msg_release_zerocopy(msg);
+	}
+}
 
 /**
  * Returns true if we have enough spare messages
@@ -206,11 +363,11 @@ static RLIST_HEAD(stopped_connections);
  * discounted: they are mostly reserved and idle.
  */
 static inline bool
-iproto_stop_input()
+iproto_stop_input(struct iproto_thread *thread)
 {
-	size_t connection_count = mempool_count(&iproto_connection_pool);
-	size_t request_count = mempool_count(&iproto_msg_pool);
-	return request_count > connection_count + IPROTO_MSG_MAX;
+	size_t connection_count = mempool_count(&thread->connection_pool);
+	size_t request_count = mempool_count(&thread->msg_pool);
+	return request_count > connection_count + thread->msg_max;
 }
 
 /**
@@ -220,20 +377,20 @@ iproto_stop_input()
  * object in the message pool.
  */
 static void
-iproto_resume()
+iproto_resume(struct iproto_thread *thread)
 {
 	/*
 	 * Most of the time we have nothing to do here: throttling
 	 * is not active.
 	 */
-	if (rlist_empty(&stopped_connections))
+	if (rlist_empty(&thread->stopped_connections))
 		return;
-	if (iproto_stop_input())
+	if (iproto_stop_input(thread))
 		return;
 
 	struct iproto_connection *con;
-	con = rlist_first_entry(&stopped_connections, struct iproto_connection,
-				in_stop_list);
+	con = rlist_first_entry(&thread->stopped_connections,
+				struct iproto_connection, in_stop_list);
 	ev_feed_event(con->loop, &con->input, EV_READ);
 }
 
@@ -264,7 +421,7 @@ iproto_connection_stop(struct iproto_connection *con)
 {
 	assert(rlist_empty(&con->in_stop_list));
 	ev_io_stop(con->loop, &con->input);
-	rlist_add_tail(&stopped_connections, &con->in_stop_list);
+	rlist_add_tail(&con->thread->stopped_connections, &con->in_stop_list);
 }
 
 static void
@@ -290,7 +447,7 @@ iproto_connection_delete(struct iproto_connection *con)
 	iobuf_delete_mt(con->iobuf[1]);
 	if (con->disconnect)
 		iproto_msg_delete(con->disconnect);
-	mempool_free(&iproto_connection_pool, con);
+	mempool_free(&con->thread->connection_pool, con);
 }
 
 static void
@@ -314,6 +471,215 @@ tx_fiber_init(struct session *session, uint64_t sync)
 	fiber_set_session(fiber(), session);
 }
 
+/* {{{ iproto_stream - interactive transactions */
+
+/**
+ * A stream of a connection with an open transaction.
+ *
+ * DML requests of the stream which arrive between BEGIN and
+ * COMMIT are not executed right away: a memtx transaction
+ * must not yield, while the stream would have to wait for its
+ * next request. Instead, the requests are copied to the stream
+ * and replied to with an empty result. COMMIT executes them in
+ * order in a single transaction in the fiber of the COMMIT
+ * request, so the whole transaction takes one WAL write.
+ *
+ * A request is checked before it is queued: a missing space or
+ * index, a lack of access rights or a malformed tuple fail the
+ * request itself, which is not queued then. Errors that depend
+ * on the data, such as a duplicate key, are returned by COMMIT,
+ * which rolls back the whole transaction.
+ *
+ * Vinyl transactions could stay open between the requests, but
+ * a transaction is allocated on the region of its fiber and is
+ * bound to it, while each request of a stream is processed in
+ * a fiber of its own. So vinyl streams are queued too.
+ *
+ * The queue is bounded by IPROTO_STREAM_REQUEST_MAX requests
+ * and IPROTO_STREAM_SIZE_MAX bytes. A request beyond the limit
+ * aborts the transaction: the queue is dropped, and the rest
+ * of the requests of the stream, including COMMIT, fail until
+ * the stream is closed with COMMIT or ROLLBACK.
+ */
+struct iproto_stream {
+	/** Stream id, unique within the connection. */
+	uint64_t id;
+	/** Queued requests, in the order of arrival. */
+	struct stailq requests;
+	/** Number of queued requests. */
+	uint32_t request_count;
+	/** Set if the queue has overflowed. */
+	bool is_aborted;
+	/** Memory for the queued requests. */
+	struct region gc;
+};
+
+/** A DML request queued in a stream. */
+struct iproto_stream_request {
+	/** Link in iproto_stream::requests. */
+	struct stailq_entry in_stream;
+	/** The request header, the body is copied to the stream. */
+	struct xrow_header header;
+};
+
+static void
+tx_stream_delete(struct iproto_stream *stream)
+{
+	region_destroy(&stream->gc);
+	free(stream);
+}
+
+static struct iproto_stream *
+tx_stream_find(struct iproto_connection *con, uint64_t id)
+{
+	if (con->streams == NULL)
+		return NULL;
+	mh_int_t k = mh_i64ptr_find(con->streams, id, NULL);
+	if (k == mh_end(con->streams))
+		return NULL;
+	return (struct iproto_stream *) mh_i64ptr_node(con->streams, k)->val;
+}
+
+/** Open a transaction in a stream. */
+static void
+tx_stream_begin(struct iproto_connection *con, uint64_t id)
+{
+	if (tx_stream_find(con, id) != NULL)
+		tnt_raise(ClientError, ER_ACTIVE_TRANSACTION);
+	if (con->streams != NULL &&
+	    mh_size(con->streams) >= IPROTO_STREAM_MAX) {
+		tnt_raise(ClientError, ER_STREAM_LIMIT,
+			  "too many open streams");
+	}
+	if (con->streams == NULL) {
+		con->streams = mh_i64ptr_new();
+		if (con->streams == NULL) {
+			tnt_raise(OutOfMemory, sizeof(*con->streams),
+				  "malloc", "struct mh_i64ptr_t");
+		}
+	}
+	struct iproto_stream *stream =
+		(struct iproto_stream *) malloc(sizeof(*stream));
+	if (stream == NULL) {
+		tnt_raise(OutOfMemory, sizeof(*stream),
+			  "malloc", "struct iproto_stream");
+	}
+	stream->id = id;
+	stailq_create(&stream->requests);
+	stream->request_count = 0;
+	stream->is_aborted = false;
+	region_create(&stream->gc, &cord()->slabc);
+	struct mh_i64ptr_node_t node = { id, stream };
+	if (mh_i64ptr_put(con->streams, &node, NULL, NULL) ==
+	    mh_end(con->streams)) {
+		tx_stream_delete(stream);
+		tnt_raise(OutOfMemory, 0, "mh_i64ptr_put", "stream");
+	}
+}
+
+/**
+ * Remove a stream from its connection and pass it to
+ * the caller, which must delete it.
+ * @retval NULL the stream has no open transaction
+ */
+static struct iproto_stream *
+tx_stream_detach(struct iproto_connection *con, uint64_t id)
+{
+	if (con->streams == NULL)
+		return NULL;
+	mh_int_t k = mh_i64ptr_find(con->streams, id, NULL);
+	if (k == mh_end(con->streams))
+		return NULL;
+	struct iproto_stream *stream =
+		(struct iproto_stream *) mh_i64ptr_node(con->streams, k)->val;
+	mh_i64ptr_del(con->streams, k, NULL);
+	return stream;
+}
+
+/** Roll back open transactions of a closed connection. */
+static void
+tx_stream_delete_all(struct iproto_connection *con)
+{
+	if (con->streams == NULL)
+		return;
+	mh_int_t k;
+	mh_foreach(con->streams, k) {
+		tx_stream_delete((struct iproto_stream *)
+				 mh_i64ptr_node(con->streams, k)->val);
+	}
+	mh_i64ptr_delete(con->streams);
+	con->streams = NULL;
+}
+
+/** Queue a DML request to a stream, till COMMIT. */
+static int
+tx_stream_add(struct iproto_stream *stream, struct xrow_header *header)
+{
+	assert(header->bodycnt == 1);
+	size_t len = header->body[0].iov_len;
+	if (stream->is_aborted)
+		goto abort;
+	if (stream->request_count >= IPROTO_STREAM_REQUEST_MAX ||
+	    region_used(&stream->gc) + len > IPROTO_STREAM_SIZE_MAX) {
+		stailq_create(&stream->requests);
+		stream->request_count = 0;
+		stream->is_aborted = true;
+		region_free(&stream->gc);
+		goto abort;
+	}
+	struct iproto_stream_request *req;
+	req = (struct iproto_stream_request *)
+		region_aligned_alloc(&stream->gc, sizeof(*req) + len,
+				     alignof(struct iproto_stream_request));
+	if (req == NULL) {
+		diag_set(OutOfMemory, sizeof(*req) + len,
+			 "region", "stream request");
+		return -1;
+	}
+	req->header = *header;
+	req->header.body[0].iov_base = memcpy(req + 1,
+					      header->body[0].iov_base, len);
+	stailq_add_tail_entry(&stream->requests, req, in_stream);
+	stream->request_count++;
+	return 0;
+abort:
+	diag_set(ClientError, ER_STREAM_LIMIT, "transaction is too large");
+	return -1;
+}
+
+/**
+ * Execute the requests queued in a stream in a single
+ * transaction. The transaction is rolled back if any of
+ * them fails.
+ */
+static void
+tx_stream_commit(struct iproto_stream *stream)
+{
+	if (stream->is_aborted) {
+		tnt_raise(ClientError, ER_STREAM_LIMIT,
+			  "transaction is too large");
+	}
+	if (box_txn_begin() != 0)
+		diag_raise();
+	struct iproto_stream_request *req;
+	stailq_foreach_entry(req, &stream->requests, in_stream) {
+		struct request request;
+		request_create(&request, req->header.type);
+		request.header = &req->header;
+		if (request_decode(&request,
+				   (const char *) req->header.body[0].iov_base,
+				   req->header.body[0].iov_len) != 0 ||
+		    box_process1(&request, NULL) != 0) {
+			box_txn_rollback();
+			diag_raise();
+		}
+	}
+	if (box_txn_commit() != 0)
+		diag_raise();
+}
+
+/* }}} */
+
 /**
  * Fire on_disconnect triggers in the tx
  * thread and destroy the session object,
@@ -325,6 +691,7 @@ tx_process_disconnect(struct cmsg *m)
 	struct iproto_msg *msg = (struct iproto_msg *) m;
 	struct iproto_connection *con = msg->connection;
 	tx_fiber_init(con->session, 0);
+	tx_stream_delete_all(con);
 	if (con->session) {
 		if (! rlist_empty(&session_on_disconnect))
 			session_run_on_disconnect_triggers(con->session);
@@ -352,51 +719,13 @@ net_finish_disconnect(struct cmsg *m)
 	iproto_msg_delete(msg);
 }
 
-static const struct cmsg_hop disconnect_route[] = {
-	{ tx_process_disconnect, &net_pipe },
-	{ net_finish_disconnect, NULL },
-};
-
-static const struct cmsg_hop misc_route[] = {
-	{ tx_process_misc, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop select_route[] = {
-	{ tx_process_select, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop process1_route[] = {
-	{ tx_process1, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop *dml_route[IPROTO_TYPE_STAT_MAX] = {
-	NULL,                                   /* IPROTO_OK */
-	select_route,                           /* IPROTO_SELECT */
-	process1_route,                         /* IPROTO_INSERT */
-	process1_route,                         /* IPROTO_REPLACE */
-	process1_route,                         /* IPROTO_UPDATE */
-	process1_route,                         /* IPROTO_DELETE */
-	misc_route,                             /* IPROTO_CALL_16 */
-	misc_route,                             /* IPROTO_AUTH */
-	misc_route,                             /* IPROTO_EVAL */
-	process1_route,                         /* IPROTO_UPSERT */
-	misc_route                              /* IPROTO_CALL */
-};
-
-static const struct cmsg_hop sync_route[] = {
-	{ tx_process_join_subscribe, &net_pipe },
-	{ net_end_join_subscribe, NULL },
-};
-
 static struct iproto_connection *
-iproto_connection_new(const char *name, int fd)
+iproto_connection_new(struct iproto_thread *thread, const char *name, int fd)
 {
 	(void) name;
 	struct iproto_connection *con = (struct iproto_connection *)
-		mempool_alloc_xc(&iproto_connection_pool);
+		mempool_alloc_xc(&thread->connection_pool);
+	con->thread = thread;
 	con->input.data = con->output.data = con;
 	con->loop = loop();
 	ev_io_init(&con->input, iproto_connection_on_input, fd, EV_READ);
@@ -406,9 +735,11 @@ iproto_connection_new(const char *name, int fd)
 	con->parse_size = 0;
 	con->session = NULL;
 	rlist_create(&con->in_stop_list);
+	rlist_create(&con->zerocopy_queue);
+	con->streams = NULL;
 	/* It may be very awkward to allocate at close. */
 	con->disconnect = iproto_msg_new(con);
-	cmsg_init(con->disconnect, disconnect_route);
+	cmsg_init(con->disconnect, thread->disconnect_route);
 	return con;
 }
 
@@ -437,6 +768,8 @@ iproto_connection_close(struct iproto_connection *con)
 		 */
 		con->iobuf[0]->in.wpos -= con->parse_size;
 	}
+	/* Tuples of zero-copy replies can't be sent any more. */
+	iproto_connection_drop_zerocopy(con);
 	/*
 	 * If the connection has no outstanding requests in the
 	 * input buffer, then no one (e.g. tx thread) is referring
@@ -453,7 +786,7 @@ iproto_connection_close(struct iproto_connection *con)
 		assert(con->disconnect != NULL);
 		struct iproto_msg *msg = con->disconnect;
 		con->disconnect = NULL;
-		cpipe_push(&tx_pipe, msg);
+		cpipe_push(&con->thread->tx_pipe, msg);
 	}
 	rlist_del(&con->in_stop_list);
 }
@@ -585,15 +918,24 @@ iproto_decode_msg(struct iproto_msg *msg, const char **pos, const char *reqend,
 		request_decode_xc(&msg->request,
 				 (const char *) msg->header.body[0].iov_base,
 				 msg->header.body[0].iov_len);
-		assert(msg->header.type < sizeof(dml_route)/sizeof(*dml_route));
-		cmsg_init(msg, dml_route[msg->header.type]);
+		assert(msg->header.type < IPROTO_TYPE_STAT_MAX);
+		cmsg_init(msg, msg->thread->dml_route[msg->header.type]);
 		break;
 	case IPROTO_PING:
-		cmsg_init(msg, misc_route);
+		cmsg_init(msg, msg->thread->misc_route);
+		break;
+	case IPROTO_BEGIN:
+	case IPROTO_COMMIT:
+	case IPROTO_ROLLBACK:
+		if (msg->header.stream_id == 0) {
+			tnt_raise(ClientError, ER_ILLEGAL_PARAMS,
+				  "missing stream id");
+		}
+		cmsg_init(msg, msg->thread->misc_route);
 		break;
 	case IPROTO_JOIN:
 	case IPROTO_SUBSCRIBE:
-		cmsg_init(msg, sync_route);
+		cmsg_init(msg, msg->thread->sync_route);
 		*stop_input = true;
 		break;
 	default:
@@ -631,7 +973,8 @@ iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 
 		try {
 			iproto_decode_msg(msg, &pos, reqend, &stop_input);
-			cpipe_push_input(&tx_pipe, guard.release());
+			cpipe_push_input(&con->thread->tx_pipe,
+					 guard.release());
 			n_requests++;
 		} catch (Exception *e) {
 			/*
@@ -689,7 +1032,7 @@ iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 		 */
 		ev_feed_event(con->loop, &con->input, EV_READ);
 	}
-	cpipe_flush_input(&tx_pipe);
+	cpipe_flush_input(&con->thread->tx_pipe);
 }
 
 static void
@@ -708,7 +1051,7 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 		 * resume one more connection which might have
 		 * input.
 		 */
-		iproto_resume();
+		iproto_resume(con->thread);
 	}
 	/*
 	 * Throttle if there are too many pending requests,
@@ -717,7 +1060,7 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 	 * another fiber waiting for write to complete).
 	 * Ignore iproto_connection->disconnect messages.
 	 */
-	if (iproto_stop_input()) {
+	if (iproto_stop_input(con->thread)) {
 		iproto_connection_stop(con);
 		return;
 	}
@@ -742,7 +1085,7 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 			return;
 		}
 		/* Count statistics */
-		rmean_collect(rmean_net, IPROTO_RECEIVED, nrd);
+		rmean_collect(con->thread->rmean, IPROTO_RECEIVED, nrd);
 
 		/* Update the read position and connection state. */
 		in->wpos += nrd;
@@ -757,11 +1100,20 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 	}
 }
 
+/** True if there is output in the iobuf not sent yet. */
+static inline bool
+iproto_connection_has_output(struct iproto_connection *con,
+			     struct iobuf *iobuf)
+{
+	return obuf_used(&iobuf->out) > 0 ||
+	       iproto_connection_first_zerocopy(con, iobuf) != NULL;
+}
+
 /** Get the iobuf which is currently being flushed. */
 static inline struct iobuf *
 iproto_connection_output_iobuf(struct iproto_connection *con)
 {
-	if (obuf_used(&con->iobuf[1]->out) > 0)
+	if (iproto_connection_has_output(con, con->iobuf[1]))
 		return con->iobuf[1];
 	/*
 	 * Don't try to write from a newer buffer if an older one
@@ -770,11 +1122,76 @@ iproto_connection_output_iobuf(struct iproto_connection *con)
 	 * pieces of replies from both buffers.
 	 */
 	if (ibuf_used(&con->iobuf[1]->in) == 0 &&
-	    obuf_used(&con->iobuf[0]->out) > 0)
+	    iproto_connection_has_output(con, con->iobuf[0]))
 		return con->iobuf[0];
 	return NULL;
 }
 
+/**
+ * writev() tuples of a zero-copy reply to the socket.
+ * When all of them are sent, the msg is released.
+ *
+ * @retval  0 all tuples are sent
+ * @retval -1 the socket is not ready
+ */
+static int
+iproto_flush_zerocopy(struct iproto_msg *msg, struct iproto_connection *con)
+{
+	int fd = con->output.fd;
+	struct iovec iov[IPROTO_ZEROCOPY_IOV_MAX];
+	while (msg->send_entry != NULL) {
+		int iovcnt = 0;
+		size_t size = 0;
+		uint32_t offset = msg->send_offset;
+		for (struct port_entry *e = msg->send_entry;
+		     e != NULL && iovcnt < IPROTO_ZEROCOPY_IOV_MAX;
+		     e = e->next) {
+			uint32_t bsize;
+			const char *data = tuple_data_range(e->tuple, &bsize);
+			iov[iovcnt].iov_base = (void *) (data + offset);
+			iov[iovcnt].iov_len = bsize - offset;
+			size += bsize - offset;
+			iovcnt++;
+			offset = 0;
+		}
+		ssize_t nwr = sio_writev(fd, iov, iovcnt);
+		if (nwr <= 0)
+			return -1;
+		/* Count statistics */
+		rmean_collect(con->thread->rmean, IPROTO_SENT, nwr);
+		/* Advance the send position. */
+		size_t left = nwr;
+		while (left > 0) {
+			uint32_t bsize;
+			tuple_data_range(msg->send_entry->tuple, &bsize);
+			uint32_t rest = bsize - msg->send_offset;
+			if (left < rest) {
+				msg->send_offset += left;
+				break;
+			}
+			left -= rest;
+			msg->send_entry = msg->send_entry->next;
+			msg->send_offset = 0;
+		}
+		if ((size_t) nwr < size)
+			return -1;
+	}
+	rlist_del_entry(msg, in_zerocopy);
+	struct iobuf *iobuf = msg->iobuf;
+	/* Discard request (see iproto_enqueue_batch()) */
+	iobuf->in.rpos += msg->len;
+	iproto_msg_release_zerocopy(msg);
+	/*
+	 * iproto_flush() doesn't recycle the buffer while a
+	 * zero-copy reply is pending, since the reply output
+	 * ends at its write_end. Recycle it here if it is idle
+	 * now, otherwise the next fully written reply does it.
+	 */
+	if (iobuf_is_idle(iobuf))
+		iobuf_reset_mt(iobuf);
+	return 0;
+}
+
 /** writev() to the socket and handle the result. */
 
 static int
@@ -783,6 +1200,17 @@ iproto_flush(struct iobuf *iobuf, struct iproto_connection *con)
 	int fd = con->output.fd;
 	struct obuf_svp *begin = &iobuf->out.wpos;
 	struct obuf_svp *end = &iobuf->out.wend;
+	struct iproto_msg *zerocopy =
+		iproto_connection_first_zerocopy(con, iobuf);
+	if (zerocopy != NULL) {
+		/*
+		 * Tuples of a zero-copy reply go right after
+		 * its part in the output buffer.
+		 */
+		if (begin->used == zerocopy->write_end.used)
+			return iproto_flush_zerocopy(zerocopy, con);
+		end = &zerocopy->write_end;
+	}
 	assert(begin->used < end->used);
 	struct iovec iov[SMALL_OBUF_IOV_MAX+1];
 	struct iovec *src = iobuf->out.iov;
@@ -799,10 +1227,10 @@ iproto_flush(struct iobuf *iobuf, struct iproto_connection *con)
 	ssize_t nwr = sio_writev(fd, iov, iovcnt);
 
 	/* Count statistics */
-	rmean_collect(rmean_net, IPROTO_SENT, nwr);
+	rmean_collect(con->thread->rmean, IPROTO_SENT, nwr);
 	if (nwr > 0) {
 		if (begin->used + nwr == end->used) {
-			if (ibuf_used(&iobuf->in) == 0) {
+			if (zerocopy == NULL && ibuf_used(&iobuf->in) == 0) {
 				/* Quickly recycle the buffer if it's idle. */
 				assert(end->used == obuf_size(&iobuf->out));
 				/* resets wpos and wpend to zero pos */
@@ -873,6 +1301,25 @@ tx_process1(struct cmsg *m)
 
 	struct tuple *tuple;
 	struct obuf_svp svp;
+	if (msg->header.stream_id != 0) {
+		struct iproto_stream *stream =
+			tx_stream_find(msg->connection, msg->header.stream_id);
+		if (stream != NULL) {
+			/*
+			 * Executed on COMMIT, see struct iproto_stream.
+			 * Check what can be checked now, so that such
+			 * an error is returned for the request that
+			 * caused it and doesn't abort the transaction.
+			 */
+			if (box_check_dml(&msg->request) != 0 ||
+			    tx_stream_add(stream, &msg->header) != 0 ||
+			    iproto_prepare_select(out, &svp) != 0)
+				goto error;
+			iproto_reply_select(out, &svp, msg->header.sync, 0);
+			msg->write_end = obuf_create_svp(out);
+			return;
+		}
+	}
 	if (box_process1(&msg->request, &tuple) ||
 	    iproto_prepare_select(out, &svp))
 		goto error;
@@ -894,26 +1341,40 @@ tx_process_select(struct cmsg *m)
 	struct iproto_msg *msg = (struct iproto_msg *) m;
 	struct obuf *out = &msg->iobuf->out;
 	struct obuf_svp svp;
-	struct port port;
+	struct port *port = &msg->port;
 	int rc;
 	struct request *req = &msg->request;
+	size_t tail_size = 0;
 
 	tx_fiber_init(msg->connection->session, msg->header.sync);
 
 	if (tx_check_schema(msg->header.schema_id))
 		goto error;
 
-	port_create(&port);
-	rc = box_select((struct port *) &port,
-			req->space_id, req->index_id,
+	port_create(port);
+	rc = box_select(port, req->space_id, req->index_id,
 			req->iterator, req->offset, req->limit,
 			req->key, req->key_end);
 	if (rc < 0 || iproto_prepare_select(out, &svp) != 0) {
-		port_destroy(&port);
+		port_destroy(port);
 		goto error;
 	}
-	port_dump(&port, out);
-	iproto_reply_select(out, &svp, msg->header.sync, port.size);
+	for (struct port_entry *e = port->first; e != NULL; e = e->next)
+		tail_size += e->tuple->bsize;
+	if (tail_size >= IPROTO_ZEROCOPY_MIN && tail_size <= UINT32_MAX) {
+		/*
+		 * Keep the tuples referenced and let the network
+		 * thread send them without copying.
+		 */
+		iproto_reply_select_tail(out, &svp, msg->header.sync,
+					 port->size, tail_size);
+		msg->is_zerocopy = true;
+		msg->send_entry = port->first;
+		msg->send_offset = 0;
+	} else {
+		port_dump(port, out);
+		iproto_reply_select(out, &svp, msg->header.sync, port->size);
+	}
 	msg->write_end = obuf_create_svp(out);
 	return;
 error:
@@ -951,6 +1412,26 @@ tx_process_misc(struct cmsg *m)
 		case IPROTO_PING:
 			iproto_reply_ok(out, msg->header.sync);
 			break;
+		case IPROTO_BEGIN:
+			tx_stream_begin(msg->connection, msg->header.stream_id);
+			iproto_reply_ok(out, msg->header.sync);
+			break;
+		case IPROTO_COMMIT:
+		case IPROTO_ROLLBACK: {
+			struct iproto_stream *stream =
+				tx_stream_detach(msg->connection,
+						 msg->header.stream_id);
+			/* Like box.commit(), do nothing if not in txn. */
+			if (stream != NULL) {
+				auto stream_guard = make_scoped_guard([=] {
+					tx_stream_delete(stream);
+				});
+				if (msg->header.type == IPROTO_COMMIT)
+					tx_stream_commit(stream);
+			}
+			iproto_reply_ok(out, msg->header.sync);
+			break;
+		}
 		default:
 			unreachable();
 		}
@@ -1003,15 +1484,34 @@ tx_process_join_subscribe(struct cmsg *m)
 	}
 }
 
+/** Unreference tuples of a sent zero-copy reply. */
+static void
+tx_release_zerocopy(struct cmsg *m)
+{
+	struct iproto_msg *msg = (struct iproto_msg *) m;
+	port_destroy(&msg->port);
+}
+
 static void
 net_send_msg(struct cmsg *m)
 {
 	struct iproto_msg *msg = (struct iproto_msg *) m;
 	struct iproto_connection *con = msg->connection;
 	struct iobuf *iobuf = msg->iobuf;
+	iobuf->out.wend = msg->write_end;
+
+	if (msg->is_zerocopy && evio_has_fd(&con->output)) {
+		/*
+		 * The request is discarded when the tuples are
+		 * sent, see iproto_flush_zerocopy().
+		 */
+		rlist_add_tail_entry(&con->zerocopy_queue, msg, in_zerocopy);
+		if (! ev_is_active(&con->output))
+			ev_feed_event(con->loop, &con->output, EV_WRITE);
+		return;
+	}
 	/* Discard request (see iproto_enqueue_batch()) */
 	iobuf->in.rpos += msg->len;
-	iobuf->out.wend = msg->write_end;
 
 	if (evio_has_fd(&con->output)) {
 		if (! ev_is_active(&con->output))
@@ -1019,7 +1519,10 @@ net_send_msg(struct cmsg *m)
 	} else if (iproto_connection_is_idle(con)) {
 		iproto_connection_close(con);
 	}
-	iproto_msg_delete(msg);
+	if (msg->is_zerocopy)
+		iproto_msg_release_zerocopy(msg);
+	else
+		iproto_msg_delete(msg);
 }
 
 static void
@@ -1089,7 +1592,7 @@ net_send_greeting(struct cmsg *m)
 						 obuf_iovcnt(out));
 
 			/* Count statistics */
-			rmean_collect(rmean_net, IPROTO_SENT, nwr);
+			rmean_collect(con->thread->rmean, IPROTO_SENT, nwr);
 		} catch (Exception *e) {
 			e->log();
 		}
@@ -1110,19 +1613,14 @@ net_send_greeting(struct cmsg *m)
 	iproto_msg_delete(msg);
 }
 
-static const struct cmsg_hop connect_route[] = {
-	{ tx_process_connect, &net_pipe },
-	{ net_send_greeting, NULL },
-};
-
 /** }}} */
 
 /**
  * Create a connection and start input.
  */
 static void
-iproto_on_accept(struct evio_service * /* service */, int fd,
-		 struct sockaddr *addr, socklen_t addrlen)
+iproto_connection_start(struct iproto_thread *thread, int fd,
+			struct sockaddr *addr, socklen_t addrlen)
 {
 	char name[SERVICE_NAME_MAXLEN];
 	snprintf(name, sizeof(name), "%s/%s", "iobuf",
@@ -1130,82 +1628,227 @@ iproto_on_accept(struct evio_service * /* service */, int fd,
 
 	struct iproto_connection *con;
 
-	con = iproto_connection_new(name, fd);
+	con = iproto_connection_new(thread, name, fd);
 	/*
 	 * Ignore msg allocation failure - the queue size is
 	 * fixed so there is a limited number of msgs in
 	 * use, all stored in just a few blocks of the memory pool.
 	 */
 	struct iproto_msg *msg = iproto_msg_new(con);
-	cmsg_init(msg, connect_route);
+	cmsg_init(msg, thread->connect_route);
 	msg->iobuf = con->iobuf[0];
 	msg->close_connection = false;
-	cpipe_push(&tx_pipe, msg);
+	cpipe_push(&thread->tx_pipe, msg);
+}
+
+/** A connection accepted by the first thread for another one. */
+struct iproto_accept_msg: public cmsg
+{
+	struct iproto_thread *thread;
+	int fd;
+	struct sockaddr_storage addr;
+	socklen_t addrlen;
+};
+
+/** Start a handed off connection in its network thread. */
+static void
+net_accept_connection(struct cmsg *m)
+{
+	struct iproto_accept_msg *msg = (struct iproto_accept_msg *) m;
+	try {
+		iproto_connection_start(msg->thread, msg->fd,
+					(struct sockaddr *) &msg->addr,
+					msg->addrlen);
+	} catch (Exception *e) {
+		close(msg->fd);
+		e->log();
+	}
+	free(msg);
 }
 
-static struct evio_service binary; /* iproto binary listener */
+/**
+ * Only the first thread listens on the socket, so that the
+ * threads don't race for each new connection. It hands the
+ * accepted connections off to all threads in turn, itself
+ * included.
+ */
+static void
+iproto_on_accept(struct evio_service * /* service */, int fd,
+		 struct sockaddr *addr, socklen_t addrlen)
+{
+	struct iproto_thread *thread = &iproto_threads[iproto_accept_next];
+	iproto_accept_next = (iproto_accept_next + 1) % iproto_thread_count;
+	if (thread->id == 0) {
+		iproto_connection_start(thread, fd, addr, addrlen);
+		return;
+	}
+	struct iproto_accept_msg *msg = (struct iproto_accept_msg *)
+		malloc(sizeof(*msg));
+	if (msg == NULL) {
+		tnt_raise(OutOfMemory, sizeof(*msg), "malloc",
+			  "struct iproto_accept_msg");
+	}
+	cmsg_init(msg, thread->accept_route);
+	msg->thread = thread;
+	msg->fd = fd;
+	memcpy(&msg->addr, addr, addrlen);
+	msg->addrlen = addrlen;
+	cpipe_push(&thread->accept_pipe, msg);
+}
+
+/** Name of the cbus endpoint of a network thread. */
+static void
+iproto_thread_endpoint_name(struct iproto_thread *thread, char *buf,
+			    size_t size)
+{
+	if (thread->id == 0)
+		snprintf(buf, size, "net");
+	else
+		snprintf(buf, size, "net.%d", thread->id);
+}
 
 /**
  * The network io thread main function:
  * begin serving the message bus.
  */
 static int
-net_cord_f(va_list /* ap */)
+net_cord_f(va_list ap)
 {
+	struct iproto_thread *thread = va_arg(ap, struct iproto_thread *);
 	/* Got to be called in every thread using iobuf */
 	iobuf_init();
-	mempool_create(&iproto_msg_pool, &cord()->slabc,
+	mempool_create(&thread->msg_pool, &cord()->slabc,
 		       sizeof(struct iproto_msg));
-	mempool_create(&iproto_connection_pool, &cord()->slabc,
+	mempool_create(&thread->connection_pool, &cord()->slabc,
 		       sizeof(struct iproto_connection));
 
-	evio_service_init(loop(), &binary, "binary",
-			  iproto_on_accept, NULL);
+	evio_service_init(loop(), &thread->binary, "binary",
+			  iproto_on_accept, thread);
 
 
 	/* Init statistics counter */
-	rmean_net = rmean_new(rmean_net_strings, IPROTO_LAST);
+	thread->rmean = rmean_new(rmean_net_strings, IPROTO_LAST);
 
-	if (rmean_net == NULL) {
+	if (thread->rmean == NULL) {
 		tnt_raise(OutOfMemory, sizeof(struct rmean),
 			  "rmean", "struct rmean");
 	}
 
 	struct cbus_endpoint endpoint;
+	char name[FIBER_NAME_MAX];
+	iproto_thread_endpoint_name(thread, name, sizeof(name));
 	/* Create "net" endpoint. */
-	cbus_endpoint_create(&endpoint, "net", fiber_schedule_cb, fiber());
+	cbus_endpoint_create(&endpoint, name, fiber_schedule_cb, fiber());
 	/* Create a pipe to "tx" thread. */
-	cpipe_create(&tx_pipe, "tx");
-	cpipe_set_max_input(&tx_pipe, IPROTO_MSG_MAX/2);
+	cpipe_create(&thread->tx_pipe, "tx");
+	cpipe_set_max_input(&thread->tx_pipe, thread->msg_max / 2);
 	/* Process incomming messages. */
 	cbus_loop(&endpoint);
 
-	cpipe_destroy(&tx_pipe);
+	cpipe_destroy(&thread->tx_pipe);
 	/*
 	 * Nothing to do in the fiber so far, the service
 	 * will take care of creating events for incoming
 	 * connections.
 	 */
-	if (evio_service_is_active(&binary))
-		evio_service_stop(&binary);
+	if (evio_service_is_active(&thread->binary))
+		evio_service_stop(&thread->binary);
 
-	rmean_delete(rmean_net);
+	rmean_delete(thread->rmean);
 	return 0;
 }
 
-/** Initialize the iproto subsystem and start network io thread */
+/**
+ * Fill in the message routes of a network thread: all of
+ * them return to the thread via its net_pipe.
+ */
+static void
+iproto_thread_init_routes(struct iproto_thread *thread)
+{
+	struct cpipe *net_pipe = &thread->net_pipe;
+
+	thread->disconnect_route[0] = { tx_process_disconnect, net_pipe };
+	thread->disconnect_route[1] = { net_finish_disconnect, NULL };
+	thread->misc_route[0] = { tx_process_misc, net_pipe };
+	thread->misc_route[1] = { net_send_msg, NULL };
+	thread->select_route[0] = { tx_process_select, net_pipe };
+	thread->select_route[1] = { net_send_msg, NULL };
+	thread->process1_route[0] = { tx_process1, net_pipe };
+	thread->process1_route[1] = { net_send_msg, NULL };
+	thread->sync_route[0] = { tx_process_join_subscribe, net_pipe };
+	thread->sync_route[1] = { net_end_join_subscribe, NULL };
+	thread->connect_route[0] = { tx_process_connect, net_pipe };
+	thread->connect_route[1] = { net_send_greeting, NULL };
+	thread->zerocopy_route[0] = { tx_release_zerocopy, net_pipe };
+	thread->zerocopy_route[1] = { iproto_msg_delete, NULL };
+	thread->accept_route[0] = { net_accept_connection, NULL };
+
+	const struct cmsg_hop **dml_route = thread->dml_route;
+	memset(dml_route, 0, sizeof(thread->dml_route));
+	dml_route[IPROTO_SELECT] = thread->select_route;
+	dml_route[IPROTO_INSERT] = thread->process1_route;
+	dml_route[IPROTO_REPLACE] = thread->process1_route;
+	dml_route[IPROTO_UPDATE] = thread->process1_route;
+	dml_route[IPROTO_DELETE] = thread->process1_route;
+	dml_route[IPROTO_CALL_16] = thread->misc_route;
+	dml_route[IPROTO_AUTH] = thread->misc_route;
+	dml_route[IPROTO_EVAL] = thread->misc_route;
+	dml_route[IPROTO_UPSERT] = thread->process1_route;
+	dml_route[IPROTO_CALL] = thread->misc_route;
+}
+
+/** Initialize the iproto subsystem and start network io threads */
 void
-iproto_init()
+iproto_init(int thread_count)
 {
+	assert(thread_count > 0);
 	tx_cord = cord();
 
-	static struct cord net_cord;
-	if (cord_costart(&net_cord, "iproto", net_cord_f, NULL))
-		panic("failed to initialize iproto thread");
+	iproto_threads = (struct iproto_thread *)
+		calloc(thread_count, sizeof(*iproto_threads));
+	if (iproto_threads == NULL)
+		panic("failed to allocate iproto threads");
+	iproto_thread_count = thread_count;
+
+	for (int i = 0; i < thread_count; i++) {
+		struct iproto_thread *thread = &iproto_threads[i];
+		thread->id = i;
+		/* Share the limit on messages in flight. */
+		thread->msg_max = MAX(IPROTO_MSG_MAX / thread_count, 2);
+		rlist_create(&thread->stopped_connections);
+		iproto_thread_init_routes(thread);
+
+		char name[FIBER_NAME_MAX];
+		if (i == 0)
+			snprintf(name, sizeof(name), "iproto");
+		else
+			snprintf(name, sizeof(name), "iproto.%d", i);
+		if (cord_costart(&thread->cord, name, net_cord_f, thread))
+			panic("failed to initialize iproto thread");
+
+		/* Create a pipe to "net" thread. */
+		iproto_thread_endpoint_name(thread, name, sizeof(name));
+		cpipe_create(&thread->net_pipe, name);
+		cpipe_set_max_input(&thread->net_pipe, thread->msg_max / 2);
+	}
+}
 
-	/* Create a pipe to "net" thread. */
-	cpipe_create(&net_pipe, "net");
-	cpipe_set_max_input(&net_pipe, IPROTO_MSG_MAX/2);
+int
+iproto_rmean_foreach(rmean_cb cb, void *cb_ctx)
+{
+	for (size_t i = 0; i < IPROTO_LAST; i++) {
+		int64_t mean = 0;
+		int64_t total = 0;
+		for (int k = 0; k < iproto_thread_count; k++) {
+			struct rmean *rmean = iproto_threads[k].rmean;
+			mean += rmean_mean(rmean, i);
+			total += rmean_total(rmean, i);
+		}
+		int rc = cb(rmean_net_strings[i], mean, total, cb_ctx);
+		if (rc != 0)
+			return rc;
+	}
+	return 0;
 }
 
 /**
@@ -1216,18 +1859,42 @@ iproto_init()
  */
 struct iproto_bind_msg: public cbus_call_msg
 {
+	struct iproto_thread *thread;
 	const char *uri;
 };
 
+/**
+ * Create pipes from the first thread to the others. Done
+ * on the first bind rather than on thread start, when all
+ * endpoints are known to exist.
+ */
+static void
+iproto_create_accept_pipes(void)
+{
+	assert(cord() == &iproto_threads[0].cord);
+	if (iproto_has_accept_pipes)
+		return;
+	for (int i = 1; i < iproto_thread_count; i++) {
+		struct iproto_thread *thread = &iproto_threads[i];
+		char name[FIBER_NAME_MAX];
+		iproto_thread_endpoint_name(thread, name, sizeof(name));
+		cpipe_create(&thread->accept_pipe, name);
+	}
+	iproto_has_accept_pipes = true;
+}
+
 static int
 iproto_do_bind(struct cbus_call_msg *m)
 {
-	const char *uri  = ((struct iproto_bind_msg *) m)->uri;
+	struct iproto_bind_msg *msg = (struct iproto_bind_msg *) m;
+	struct evio_service *binary = &msg->thread->binary;
 	try {
-		if (evio_service_is_active(&binary))
-			evio_service_stop(&binary);
-		if (uri != NULL)
-			evio_service_bind(&binary, uri);
+		if (evio_service_is_active(binary))
+			evio_service_stop(binary);
+		if (msg->uri != NULL) {
+			iproto_create_accept_pipes();
+			evio_service_bind(binary, msg->uri);
+		}
 	} catch (Exception *e) {
 		return -1;
 	}
@@ -1237,34 +1904,40 @@ iproto_do_bind(struct cbus_call_msg *m)
 static int
 iproto_do_listen(struct cbus_call_msg *m)
 {
-	(void) m;
+	struct iproto_bind_msg *msg = (struct iproto_bind_msg *) m;
+	struct evio_service *binary = &msg->thread->binary;
 	try {
-		if (evio_service_is_active(&binary))
-			evio_service_listen(&binary);
+		if (evio_service_is_active(binary))
+			evio_service_listen(binary);
 	} catch (Exception *e) {
 		return -1;
 	}
 	return 0;
 }
 
-void
-iproto_bind(const char *uri)
+static void
+iproto_thread_call(struct iproto_thread *thread, cbus_call_f func,
+		   const char *uri)
 {
+	/* Declare static to avoid stack corruption on fiber cancel. */
 	static struct iproto_bind_msg m;
+	m.thread = thread;
 	m.uri = uri;
-	if (cbus_call(&net_pipe, &tx_pipe, &m, iproto_do_bind,
+	if (cbus_call(&thread->net_pipe, &thread->tx_pipe, &m, func,
 		      NULL, TIMEOUT_INFINITY))
 		diag_raise();
 }
 
+void
+iproto_bind(const char *uri)
+{
+	iproto_thread_call(&iproto_threads[0], iproto_do_bind, uri);
+}
+
 void
 iproto_listen()
 {
-	/* Declare static to avoid stack corruption on fiber cancel. */
-	static struct cbus_call_msg m;
-	if (cbus_call(&net_pipe, &tx_pipe, &m, iproto_do_listen,
-		      NULL, TIMEOUT_INFINITY))
-		diag_raise();
+	iproto_thread_call(&iproto_threads[0], iproto_do_listen, NULL);
 }
 
 /* vim: set foldmethod=marker */
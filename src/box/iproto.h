@@ -30,8 +30,32 @@
  * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
  * SUCH DAMAGE.
  */
+#include "rmean.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/** The number of iproto messages in flight */
+enum { IPROTO_MSG_MAX = 768 };
+
+/**
+ * Invoke a callback for every network statistics counter,
+ * summed up over all network threads.
+ */
+int
+iproto_rmean_foreach(rmean_cb cb, void *cb_ctx);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+/**
+ * Start network threads. Client connections are spread
+ * among the threads.
+ */
 void
-iproto_init();
+iproto_init(int thread_count);
 
 void
 iproto_bind(const char *uri);
@@ -46,7 +46,7 @@ const unsigned char iproto_key_type[IPROTO_KEY_MAX] =
 		/* 0x07 */	MP_UINT,
 		/* 0x08 */	MP_UINT,
 		/* 0x09 */	MP_UINT,
-		/* 0x0a */	MP_UINT,
+		/* 0x0a */	MP_UINT,   /* IPROTO_STREAM_ID */
 		/* 0x0b */	MP_UINT,
 		/* 0x0c */	MP_UINT,
 		/* 0x0d */	MP_UINT,
@@ -131,7 +131,7 @@ const char *iproto_key_strs[IPROTO_KEY_MAX] = {
 	"",                 /* 0x07 */
 	"",                 /* 0x08 */
 	"",                 /* 0x09 */
-	"",                 /* 0x0a */
+	"stream_id",        /* 0x0a */
 	"",                 /* 0x0b */
 	"",                 /* 0x0c */
 	"",                 /* 0x0d */
@@ -57,6 +57,7 @@ enum iproto_key {
 	IPROTO_LSN = 0x03,
 	IPROTO_TIMESTAMP = 0x04,
 	IPROTO_SCHEMA_ID = 0x05,
+	IPROTO_STREAM_ID = 0x0a,
 	/* Leave a gap for other keys in the header. */
 	IPROTO_SPACE_ID = 0x10,
 	IPROTO_INDEX_ID = 0x11,
@@ -84,7 +85,7 @@ enum iproto_key {
 #define bit(c) (1ULL<<IPROTO_##c)
 
 #define IPROTO_HEAD_BMAP (bit(REQUEST_TYPE) | bit(SYNC) | bit(REPLICA_ID) |\
-			  bit(LSN) | bit(SCHEMA_ID))
+			  bit(LSN) | bit(SCHEMA_ID) | bit(STREAM_ID))
 #define IPROTO_BODY_BMAP (bit(SPACE_ID) | bit(INDEX_ID) | bit(LIMIT) |\
 			  bit(OFFSET) | bit(ITERATOR) | bit(INDEX_BASE) |\
 			  bit(KEY) | bit(TUPLE) | bit(FUNCTION_NAME) | \
@@ -132,6 +133,10 @@ enum iproto_type {
 	IPROTO_UPSERT = 9,
 	IPROTO_CALL = 10,
 	IPROTO_TYPE_STAT_MAX = IPROTO_CALL + 1,
+	/* stream transaction control codes */
+	IPROTO_BEGIN = 14,
+	IPROTO_COMMIT = 15,
+	IPROTO_ROLLBACK = 16,
 	/* admin command codes */
 	IPROTO_PING = 64,
 	IPROTO_JOIN = 65,
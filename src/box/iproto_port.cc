@@ -168,7 +168,14 @@ void
 iproto_reply_select(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
 		    uint32_t count)
 {
-	uint32_t len = obuf_size(buf) - svp->used - 5;
+	iproto_reply_select_tail(buf, svp, sync, count, 0);
+}
+
+void
+iproto_reply_select_tail(struct obuf *buf, struct obuf_svp *svp,
+			 uint64_t sync, uint32_t count, uint32_t tail_size)
+{
+	uint32_t len = obuf_size(buf) - svp->used - 5 + tail_size;
 
 	struct iproto_header_bin header = iproto_header_bin;
 	header.v_len = mp_bswap_u32(len);
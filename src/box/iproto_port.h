@@ -49,6 +49,15 @@ iproto_prepare_select(struct obuf *buf, struct obuf_svp *svp);
 void
 iproto_reply_select(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
 		    uint32_t count);
+
+/**
+ * Same as iproto_reply_select(), but the reply body is followed
+ * by @tail_size bytes of tuple data which are sent bypassing
+ * the output buffer.
+ */
+void
+iproto_reply_select_tail(struct obuf *buf, struct obuf_svp *svp,
+			 uint64_t sync, uint32_t count, uint32_t tail_size);
 #if defined(__cplusplus)
 } /*  extern "C" */
 
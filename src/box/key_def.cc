@@ -87,6 +87,8 @@ const char *index_type_strs[] = { "HASH", "TREE", "BITSET", "RTREE" };
 
 const char *rtree_index_distance_type_strs[] = { "EUCLID", "MANHATTAN" };
 
+const char *compaction_policy_strs[] = { "LEVELED", "TIERED", "TIME_WINDOW" };
+
 const char *func_language_strs[] = {"LUA", "C"};
 
 const uint32_t key_mp_type[] = {
@@ -119,6 +121,12 @@ const struct key_opts key_opts_default = {
 	/* .page_size           = */ 0,
 	/* .run_count_per_level = */ 2,
 	/* .run_size_ratio      = */ 3.5,
+	/* .compactionbuf       = */ { '\0' },
+	/* .compaction          = */ COMPACTION_LEVELED,
+	/* .compaction_window   = */ 86400,
+	/* .bloom_prefix        = */ 0,
+	/* .compression_level   = */ 3,
+	/* .compression_dictionary = */ 0,
 	/* .lsn                 = */ 0,
 };
 
@@ -131,6 +139,11 @@ const struct opt_def key_opts_reg[] = {
 	OPT_DEF("page_size", OPT_INT, struct key_opts, page_size),
 	OPT_DEF("run_count_per_level", OPT_INT, struct key_opts, run_count_per_level),
 	OPT_DEF("run_size_ratio", OPT_FLOAT, struct key_opts, run_size_ratio),
+	OPT_DEF("compaction", OPT_STR, struct key_opts, compactionbuf),
+	OPT_DEF("compaction_window", OPT_INT, struct key_opts, compaction_window),
+	OPT_DEF("bloom_prefix", OPT_INT, struct key_opts, bloom_prefix),
+	OPT_DEF("compression_level", OPT_INT, struct key_opts, compression_level),
+	OPT_DEF("compression_dictionary", OPT_INT, struct key_opts, compression_dictionary),
 	OPT_DEF("lsn", OPT_INT, struct key_opts, lsn),
 	{ NULL, opt_type_MAX, 0, 0 },
 };
@@ -415,10 +428,12 @@ key_validate_parts(struct key_def *key_def, const char *key,
 
 const struct space_opts space_opts_default = {
 	/* .temporary = */ false,
+	/* .defer_deletes = */ false,
 };
 
 const struct opt_def space_opts_reg[] = {
 	OPT_DEF("temporary", OPT_BOOL, struct space_opts, temporary),
+	OPT_DEF("defer_deletes", OPT_BOOL, struct space_opts, defer_deletes),
 	{ NULL, opt_type_MAX, 0, 0 }
 };
 
@@ -451,6 +466,13 @@ space_def_check(struct space_def *def, uint32_t namelen, uint32_t engine_namelen
 				  def->name,
 			         "space does not support temporary flag");
 	}
+	if (def->opts.defer_deletes) {
+		Engine *engine = engine_find(def->engine_name);
+		if (! engine_can_defer_deletes(engine->flags))
+			tnt_raise(ClientError, ER_ALTER_SPACE,
+				  def->name,
+				  "space does not support defer_deletes flag");
+	}
 }
 
 bool
@@ -162,6 +162,18 @@ enum rtree_index_distance_type {
 };
 extern const char *rtree_index_distance_type_strs[];
 
+/** Vinyl compaction policies. */
+enum compaction_policy {
+	/* Levels of fixed target run size, see run_size_ratio. */
+	COMPACTION_LEVELED,
+	/* Tiers of runs of similar size, no cascading merges. */
+	COMPACTION_TIERED,
+	/* Tiered within the current time window only. */
+	COMPACTION_TIME_WINDOW,
+	compaction_policy_MAX
+};
+extern const char *compaction_policy_strs[];
+
 /** Descriptor of a single part in a multipart key. */
 struct key_part {
 	uint32_t fieldno;
@@ -201,6 +213,31 @@ struct key_opts {
 	 * previous one.
 	 */
 	double run_size_ratio;
+	/**
+	 * Vinyl compaction policy.
+	 */
+	char compactionbuf[16];
+	enum compaction_policy compaction;
+	/**
+	 * Length of a time window in seconds for the time window
+	 * compaction policy. Runs created in previous windows are
+	 * never compacted.
+	 */
+	int64_t compaction_window;
+	/**
+	 * Number of leading key parts to build an extra bloom
+	 * filter on in each vinyl run, so that lookups by a key
+	 * prefix can skip runs. 0 disables the prefix filter.
+	 */
+	int64_t bloom_prefix;
+	/** zstd compression level of vinyl run pages. */
+	int64_t compression_level;
+	/**
+	 * Size of the zstd dictionary sampled from the first
+	 * page of each vinyl run and used to compress all its
+	 * pages. 0 disables the dictionary.
+	 */
+	int64_t compression_dictionary;
 	/**
 	 * LSN from the time of index creation.
 	 */
@@ -353,6 +390,12 @@ struct space_opts {
 	 * - changes are not part of a snapshot
 	 */
 	bool temporary;
+	/**
+	 * REPLACE and DELETE don't look up the old tuple to
+	 * delete its keys from secondary indexes. Stale
+	 * secondary index entries are skipped on read instead.
+	 */
+	bool defer_deletes;
 };
 
 extern const struct space_opts space_opts_default;
@@ -131,6 +131,17 @@ lbox_cfg_set_too_long_threshold(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_commit_async_max_bytes(struct lua_State *L)
+{
+	try {
+		box_set_commit_async_max_bytes();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_cfg_set_snap_io_rate_limit(struct lua_State *L)
 {
@@ -142,6 +153,28 @@ lbox_cfg_set_snap_io_rate_limit(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_io_rate_limit(struct lua_State *L)
+{
+	try {
+		box_set_io_rate_limit();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_memtx_snap_threads(struct lua_State *L)
+{
+	try {
+		box_set_memtx_snap_threads();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_cfg_set_read_only(struct lua_State *L)
 {
@@ -167,7 +200,10 @@ box_lua_cfg_init(struct lua_State *L)
 		{"cfg_set_readahead", lbox_cfg_set_readahead},
 		{"cfg_set_io_collect_interval", lbox_cfg_set_io_collect_interval},
 		{"cfg_set_too_long_threshold", lbox_cfg_set_too_long_threshold},
+		{"cfg_set_commit_async_max_bytes", lbox_cfg_set_commit_async_max_bytes},
 		{"cfg_set_snap_io_rate_limit", lbox_cfg_set_snap_io_rate_limit},
+		{"cfg_set_io_rate_limit", lbox_cfg_set_io_rate_limit},
+		{"cfg_set_memtx_snap_threads", lbox_cfg_set_memtx_snap_threads},
 		{"cfg_set_read_only", lbox_cfg_set_read_only},
 		{NULL, NULL}
 	};
@@ -83,6 +83,14 @@ lbox_commit(lua_State *L)
 	return 0;
 }
 
+static int
+lbox_commit_wait(lua_State *L)
+{
+	if (box_txn_commit_wait() != 0)
+		return luaT_error(L);
+	return 0;
+}
+
 static int
 lbox_rollback(lua_State *L)
 {
@@ -105,6 +113,7 @@ lbox_snapshot(struct lua_State *L)
 
 static const struct luaL_reg boxlib[] = {
 	{"commit", lbox_commit},
+	{"commit_wait", lbox_commit_wait},
 	{"rollback", lbox_rollback},
 	{"snapshot", lbox_snapshot},
 	{NULL, NULL}
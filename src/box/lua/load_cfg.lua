@@ -31,11 +31,16 @@ local default_cfg = {
     log_level           = 5,
     io_collect_interval = nil,
     readahead           = 16320,
+    iproto_threads      = 1,
     snap_io_rate_limit  = nil, -- no limit
+    io_rate_limit       = nil, -- no limit
+    memtx_snap_threads  = 1,
     too_long_threshold  = 0.5,
+    commit_async_max_bytes = 1024 * 1024,
     wal_mode            = "write",
     rows_per_wal        = 500000,
     wal_dir_rescan_delay= 2,
+    wal_tail_size       = 16 * 1024 * 1024,
     force_recovery      = false,
     replication         = nil,
     custom_proc_title   = nil,
@@ -43,6 +48,8 @@ local default_cfg = {
     background          = false,
     username            = nil,
     coredump            = false,
+    fiber_stack_size    = 64 * 1024,
+    fiber_stack_guard   = true,
     read_only           = false,
     hot_standby         = false,
 
@@ -77,11 +84,16 @@ local template_cfg = {
     log_level           = 'number',
     io_collect_interval = 'number',
     readahead           = 'number',
+    iproto_threads      = 'number',
     snap_io_rate_limit  = 'number',
+    io_rate_limit       = 'number',
+    memtx_snap_threads  = 'number',
     too_long_threshold  = 'number',
+    commit_async_max_bytes = 'number',
     wal_mode            = 'string',
     rows_per_wal        = 'number',
     wal_dir_rescan_delay= 'number',
+    wal_tail_size       = 'number',
     force_recovery      = 'boolean',
     replication         = 'string, number, table',
     custom_proc_title   = 'string',
@@ -89,6 +101,8 @@ local template_cfg = {
     background          = 'boolean',
     username            = 'string',
     coredump            = 'boolean',
+    fiber_stack_size    = 'number',
+    fiber_stack_guard   = 'boolean',
     checkpoint_interval = 'number',
     checkpoint_count    = 'number',
     read_only           = 'boolean',
@@ -128,7 +142,10 @@ local dynamic_cfg = {
     io_collect_interval     = private.cfg_set_io_collect_interval,
     readahead               = private.cfg_set_readahead,
     too_long_threshold      = private.cfg_set_too_long_threshold,
+    commit_async_max_bytes  = private.cfg_set_commit_async_max_bytes,
     snap_io_rate_limit      = private.cfg_set_snap_io_rate_limit,
+    io_rate_limit           = private.cfg_set_io_rate_limit,
+    memtx_snap_threads      = private.cfg_set_memtx_snap_threads,
     read_only               = private.cfg_set_read_only,
     -- snapshot_daemon
     checkpoint_interval     = box.internal.snapshot_daemon.set_checkpoint_interval,
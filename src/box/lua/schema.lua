@@ -240,6 +240,7 @@ box.schema.space.create = function(name, options)
         user = 'string, number',
         format = 'table',
         temporary = 'boolean',
+        defer_deletes = 'boolean',
     }
     local options_defaults = {
         engine = 'memtx',
@@ -281,6 +282,7 @@ box.schema.space.create = function(name, options)
     -- filter out global parameters from the options array
     local space_options = setmetatable({
         temporary = options.temporary and true or nil,
+        defer_deletes = options.defer_deletes and true or nil,
     }, { __serialize = 'map' })
     _space:insert{id, uid, name, options.engine, options.field_count,
         space_options, format}
@@ -393,6 +395,11 @@ box.schema.index.create = function(space_id, name, options)
         range_size = 'number',
         run_count_per_level = 'number',
         run_size_ratio = 'number',
+        compaction = 'string',
+        compaction_window = 'number',
+        bloom_prefix = 'number',
+        compression_level = 'number',
+        compression_dictionary = 'number',
     }
     check_param_table(options, options_template)
     local options_defaults = {
@@ -463,6 +470,11 @@ box.schema.index.create = function(space_id, name, options)
             range_size = options.range_size,
             run_count_per_level = options.run_count_per_level,
             run_size_ratio = options.run_size_ratio,
+            compaction = options.compaction,
+            compaction_window = options.compaction_window,
+            bloom_prefix = options.bloom_prefix,
+            compression_level = options.compression_level,
+            compression_dictionary = options.compression_dictionary,
             lsn = box.info.cluster.signature,
     }
     local field_type_aliases = {
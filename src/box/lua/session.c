@@ -87,6 +87,24 @@ lbox_session_sync(struct lua_State *L)
 	return 1;
 }
 
+/**
+ * Get or set asynchronous commit mode of the current session.
+ * In this mode a commit doesn't wait for the WAL write, use
+ * box.commit_wait() to wait for it.
+ */
+static int
+lbox_session_commit_async(struct lua_State *L)
+{
+	struct session *session = current_session();
+	if (lua_gettop(L) >= 1) {
+		if (!lua_isboolean(L, 1))
+			luaL_error(L, "session.commit_async(): bad arguments");
+		session->commit_async = lua_toboolean(L, 1);
+	}
+	lua_pushboolean(L, session->commit_async);
+	return 1;
+}
+
 /**
  * Session user id.
  * Note: effective user id (current_user()->uid)
@@ -332,6 +350,7 @@ box_lua_session_init(struct lua_State *L)
 	static const struct luaL_reg sessionlib[] = {
 		{"id", lbox_session_id},
 		{"sync", lbox_session_sync},
+		{"commit_async", lbox_session_commit_async},
 		{"uid", lbox_session_uid},
 		{"user", lbox_session_user},
 		{"su", lbox_session_su},
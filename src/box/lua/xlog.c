@@ -39,6 +39,7 @@
 #include <box/xrow.h>
 #include <box/iproto_constants.h>
 #include <box/tuple.h>
+#include <box/vinyl.h>
 #include <box/lua/tuple.h>
 #include <lua/msgpack.h>
 #include <lua/utils.h>
@@ -221,6 +222,29 @@ lbox_xlog_parser_gc(struct lua_State *L)
 	return 0;
 }
 
+/**
+ * Pages of a vinyl run may be compressed with a dictionary,
+ * which is stored in the .index file next to the .run file.
+ * Load it into the cursor so that the pages can be decoded.
+ */
+static int
+lbox_xlog_load_run_dictionary(struct xlog_cursor *cur, const char *filename)
+{
+	const char *suffix = ".run";
+	size_t len = strlen(filename);
+	size_t suffix_len = strlen(suffix);
+	if (len < suffix_len ||
+	    strcmp(filename + len - suffix_len, suffix) != 0) {
+		diag_set(ClientError, ER_UNSUPPORTED, "xlog reader",
+			 "run file name without '.run' suffix");
+		return -1;
+	}
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%.*s.index",
+		 (int) (len - suffix_len), filename);
+	return vy_run_read_dictionary(path, &cur->zdict, &cur->zdict_size);
+}
+
 static int
 lbox_xlog_parser_open_pairs(struct lua_State *L)
 {
@@ -242,8 +266,16 @@ lbox_xlog_parser_open_pairs(struct lua_State *L)
 	if (xlog_cursor_open(cur, filename) < 0) {
 		return luaT_error(L);
 	}
+	if (strcmp(cur->meta.filetype, "RUN") == 0 &&
+	    lbox_xlog_load_run_dictionary(cur, filename) != 0) {
+		xlog_cursor_close(cur, false);
+		free(cur);
+		return luaT_error(L);
+	}
 	if (strncmp(cur->meta.filetype, "SNAP", 4) != 0 &&
-	    strncmp(cur->meta.filetype, "XLOG", 4) != 0) {
+	    strncmp(cur->meta.filetype, "XLOG", 4) != 0 &&
+	    strcmp(cur->meta.filetype, "RUN") != 0 &&
+	    strcmp(cur->meta.filetype, "INDEX") != 0) {
 		char buf[1024];
 		snprintf(buf, sizeof(buf), "'%.*s' file type",
 			 (int) strlen(cur->meta.filetype),
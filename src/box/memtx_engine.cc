@@ -33,6 +33,8 @@
 #include "memtx_tuple.h"
 
 #include "coeio_file.h"
+#include "tt_pthread.h"
+#include "small/pmatomic.h"
 #include "scoped_guard.h"
 
 #include "tuple.h"
@@ -84,37 +86,270 @@ memtx_end_build_primary_key(struct space *space, void *param)
 	handler->replace = memtx_replace_primary_key;
 }
 
+/** A secondary key to build in bulk at the end of recovery. */
+struct memtx_build_task {
+	MemtxIndex *index;
+	MemtxIndex *pk;
+	struct rlist link;
+	/** Link in memtx_build::done. */
+	struct rlist in_done;
+};
+
 /**
- * Secondary indexes are built in bulk after all data is
- * recovered. This function enables secondary keys on a space.
- * Data dictionary spaces are an exception, they are fully
- * built right from the start.
+ * Bulk build of secondary keys of all spaces. Keys which
+ * allow it are filled and sorted by a pool of threads, all
+ * at once, so the build takes about as long as the build
+ * of the biggest key.
  */
-void
-memtx_build_secondary_keys(struct space *space, void *param)
+struct memtx_build {
+	MemtxEngine *engine;
+	/** Keys to build in threads. */
+	struct rlist tasks;
+	/** Link of the next task to take, protected by the mutex. */
+	struct rlist *next;
+	/** Set if a build thread failed, to stop the others. */
+	bool is_failed;
+	/**
+	 * Keys filled and sorted by the threads, which wait for
+	 * tx to finish them, protected by the mutex.
+	 */
+	struct rlist done;
+	/** Wakes up tx when a key is done or a thread fails. */
+	struct ev_async async;
+	/** The event loop of tx. */
+	struct ev_loop *loop;
+	pthread_mutex_t mutex;
+};
+
+enum { MEMTX_BUILD_THREADS_MAX = 16 };
+
+static inline bool
+memtx_space_needs_build(struct space *space, MemtxEngine *engine)
 {
 	struct MemtxSpace *handler = (struct MemtxSpace *) space->handler;
-	if (handler->engine != param || space_index(space, 0) == NULL ||
-	    handler->replace == memtx_replace_all_keys)
+	return handler->engine == engine && space_index(space, 0) != NULL &&
+	       handler->replace != memtx_replace_all_keys;
+}
+
+static void
+memtx_build_add_space(struct space *space, void *param)
+{
+	struct memtx_build *build = (struct memtx_build *) param;
+	if (!memtx_space_needs_build(space, build->engine) ||
+	    space->index_id_max == 0)
 		return;
 
-	if (space->index_id_max > 0) {
-		MemtxIndex *pk = (MemtxIndex *) space->index[0];
-		uint32_t n_tuples = pk->size();
+	MemtxIndex *pk = (MemtxIndex *) space->index[0];
+	if (pk->size() > 0) {
+		say_info("Building secondary indexes in space '%s'...",
+			 space_name(space));
+	}
+	for (uint32_t j = 1; j < space->index_count; j++) {
+		MemtxIndex *index = (MemtxIndex *) space->index[j];
+		if (!index->canBuildInThread()) {
+			index_build(index, pk);
+			continue;
+		}
+		struct memtx_build_task *task =
+			region_alloc_object_xc(&fiber()->gc,
+					       struct memtx_build_task);
+		task->index = index;
+		task->pk = pk;
+		rlist_add_tail_entry(&build->tasks, task, link);
+	}
+}
 
-		if (n_tuples > 0) {
-			say_info("Building secondary indexes in space '%s'...",
-				 space_name(space));
+/**
+ * Enable all keys of a space once its secondary keys
+ * are built.
+ */
+static void
+memtx_build_end_space(struct space *space, void *param)
+{
+	struct memtx_build *build = (struct memtx_build *) param;
+	if (!memtx_space_needs_build(space, build->engine))
+		return;
+
+	struct MemtxSpace *handler = (struct MemtxSpace *) space->handler;
+	if (space->index_id_max > 0 && space->index[0]->size() > 0)
+		say_info("Space '%s': done", space_name(space));
+	handler->replace = memtx_replace_all_keys;
+}
+
+static struct memtx_build_task *
+memtx_build_next_task(struct memtx_build *build)
+{
+	struct memtx_build_task *task = NULL;
+	tt_pthread_mutex_lock(&build->mutex);
+	if (!build->is_failed && build->next != &build->tasks) {
+		task = rlist_entry(build->next, struct memtx_build_task,
+				   link);
+		build->next = build->next->next;
+	}
+	tt_pthread_mutex_unlock(&build->mutex);
+	return task;
+}
+
+/** A build thread: fill and sort keys until there are none left. */
+static int
+memtx_build_f(va_list ap)
+{
+	struct memtx_build *build = va_arg(ap, struct memtx_build *);
+	struct memtx_build_task *task;
+	while ((task = memtx_build_next_task(build)) != NULL) {
+		try {
+			index_build_fill(task->index, task->pk);
+			task->index->sortBuild();
+		} catch (Exception *) {
+			tt_pthread_mutex_lock(&build->mutex);
+			build->is_failed = true;
+			tt_pthread_mutex_unlock(&build->mutex);
+			ev_async_send(build->loop, &build->async);
+			throw;
 		}
+		tt_pthread_mutex_lock(&build->mutex);
+		rlist_add_tail_entry(&build->done, task, in_done);
+		tt_pthread_mutex_unlock(&build->mutex);
+		ev_async_send(build->loop, &build->async);
+	}
+	return 0;
+}
 
-		for (uint32_t j = 1; j < space->index_count; j++)
-			index_build((MemtxIndex *) space->index[j], pk);
+static void
+memtx_build_async_cb(struct ev_loop *loop, struct ev_async *ev, int revents)
+{
+	(void) loop;
+	(void) revents;
+	fiber_wakeup((struct fiber *) ev->data);
+}
 
-		if (n_tuples > 0) {
-			say_info("Space '%s': done", space_name(space));
+/**
+ * Fill and sort keys of the build in threads and finish each
+ * of them in tx as soon as it is sorted. A sorted key holds
+ * a temporary array of all tuples of the space, so there are
+ * never more such arrays than threads plus the keys tx hasn't
+ * picked up yet. The tx fiber yields while waiting for the
+ * threads, but nothing may change memtx spaces until recovery
+ * is complete.
+ */
+static void
+memtx_build_run(struct memtx_build *build, int threads, int task_count)
+{
+	/*
+	 * If the build fails, keys which are filled but not
+	 * finished still hold their temporary arrays. Free them
+	 * once the threads are joined and no longer touch them.
+	 */
+	auto abort_guard = make_scoped_guard([=]{
+		struct memtx_build_task *task;
+		rlist_foreach_entry(task, &build->tasks, link)
+			task->index->abortBuild();
+	});
+	struct cord *workers = (struct cord *)
+		region_alloc_xc(&fiber()->gc, threads * sizeof(struct cord));
+	build->next = rlist_first(&build->tasks);
+	build->loop = loop();
+	ev_async_init(&build->async, memtx_build_async_cb);
+	build->async.data = fiber();
+	ev_async_start(loop(), &build->async);
+	int started = 0;
+	int rc = 0;
+	for (; started < threads; started++) {
+		char name[FIBER_NAME_MAX];
+		snprintf(name, sizeof(name), "index_build.%d", started);
+		if (cord_costart(&workers[started], name,
+				 memtx_build_f, build) != 0) {
+			tt_pthread_mutex_lock(&build->mutex);
+			build->is_failed = true;
+			tt_pthread_mutex_unlock(&build->mutex);
+			rc = -1;
+			break;
 		}
 	}
-	handler->replace = memtx_replace_all_keys;
+	/* The final step allocates index memory, do it in tx. */
+	int finished = 0;
+	while (rc == 0 && finished < task_count) {
+		struct rlist done;
+		rlist_create(&done);
+		tt_pthread_mutex_lock(&build->mutex);
+		rlist_splice(&done, &build->done);
+		bool is_failed = build->is_failed;
+		tt_pthread_mutex_unlock(&build->mutex);
+		struct memtx_build_task *task;
+		rlist_foreach_entry(task, &done, in_done) {
+			try {
+				ERROR_INJECT(ERRINJ_MEMTX_BUILD,
+					     tnt_raise(ClientError, ER_INJECTION,
+						       "index build"));
+				task->index->endBuild();
+			} catch (Exception *) {
+				tt_pthread_mutex_lock(&build->mutex);
+				build->is_failed = true;
+				tt_pthread_mutex_unlock(&build->mutex);
+				rc = -1;
+				break;
+			}
+			finished++;
+		}
+		if (rc != 0 || is_failed)
+			break;
+		if (rlist_empty(&done))
+			fiber_yield();
+	}
+	for (int i = 0; i < started; i++) {
+		if (cord_cojoin(&workers[i]) != 0)
+			rc = -1;
+	}
+	ev_async_stop(loop(), &build->async);
+	if (rc != 0)
+		diag_raise();
+	abort_guard.is_active = false;
+}
+
+/**
+ * Secondary indexes are built in bulk after all data is
+ * recovered. This function builds secondary keys of all
+ * memtx spaces and enables them.
+ * Data dictionary spaces are an exception, they are fully
+ * built right from the start.
+ */
+static void
+memtx_build_secondary_keys(MemtxEngine *engine)
+{
+	struct memtx_build build;
+	build.engine = engine;
+	rlist_create(&build.tasks);
+	build.next = &build.tasks;
+	build.is_failed = false;
+	rlist_create(&build.done);
+	tt_pthread_mutex_init(&build.mutex, NULL);
+	auto guard = make_scoped_guard([&]{
+		tt_pthread_mutex_destroy(&build.mutex);
+	});
+
+	space_foreach(memtx_build_add_space, &build);
+
+	int task_count = 0;
+	struct memtx_build_task *task;
+	rlist_foreach_entry(task, &build.tasks, link)
+		task_count++;
+	long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+	int threads = MIN(task_count, MEMTX_BUILD_THREADS_MAX);
+	if (cpu_count > 0 && threads > cpu_count)
+		threads = cpu_count;
+	if (threads > 1) {
+		memtx_build_run(&build, threads, task_count);
+	} else {
+		/* Let a single key use all threads to sort. */
+		rlist_foreach_entry(task, &build.tasks, link) {
+			ERROR_INJECT(ERRINJ_MEMTX_BUILD,
+				     tnt_raise(ClientError, ER_INJECTION,
+					       "index build"));
+			index_build(task->index, task->pk);
+		}
+	}
+
+	space_foreach(memtx_build_end_space, &build);
 }
 
 MemtxEngine::MemtxEngine(const char *snap_dirname, bool force_recovery,
@@ -124,12 +359,13 @@ MemtxEngine::MemtxEngine(const char *snap_dirname, bool force_recovery,
 	m_checkpoint(0),
 	m_state(MEMTX_INITIALIZED),
 	m_snap_io_rate_limit(0),
+	m_snap_threads(1),
 	m_force_recovery(force_recovery)
 {
 	memtx_tuple_init(tuple_arena_max_size, objsize_min, objsize_max,
 			 alloc_factor);
 
-	flags = ENGINE_CAN_BE_TEMPORARY;
+	flags = ENGINE_CAN_BE_TEMPORARY | ENGINE_CAN_COMMIT_ASYNC;
 	xdir_create(&m_snap_dir, snap_dirname, SNAP, &INSTANCE_UUID);
 	m_snap_dir.force_recovery = force_recovery;
 	xdir_scan_xc(&m_snap_dir);
@@ -267,7 +503,7 @@ MemtxEngine::beginFinalRecovery()
 		 * unique keys.
 		 */
 		m_state = MEMTX_OK;
-		space_foreach(memtx_build_secondary_keys, this);
+		memtx_build_secondary_keys(this);
 	}
 }
 
@@ -283,7 +519,7 @@ MemtxEngine::endRecovery()
 	if (m_state != MEMTX_OK) {
 		assert(m_state == MEMTX_FINAL_RECOVERY);
 		m_state = MEMTX_OK;
-		space_foreach(memtx_build_secondary_keys, this);
+		memtx_build_secondary_keys(this);
 	}
 }
 
@@ -589,7 +825,7 @@ MemtxEngine::bootstrap()
 static void
 checkpoint_write_row(struct xlog *l, struct xrow_header *row)
 {
-	static ev_tstamp last = 0;
+	static __thread ev_tstamp last = 0;
 	if (last == 0) {
 		ev_now_update(loop());
 		last = ev_now(loop());
@@ -602,9 +838,13 @@ checkpoint_write_row(struct xlog *l, struct xrow_header *row)
 	 * This makes streaming such rows to a replica or
 	 * to recovery look similar to streaming a normal
 	 * WAL. @sa the place which skips old rows in
-	 * recovery_apply_row().
+	 * recover_xlog(). Writer threads take numbers from
+	 * the log which owns the file, so that they don't
+	 * repeat and its counter covers all rows written.
 	 */
-	row->lsn = ++l->rows;
+	struct xlog *file = l->parent != NULL ? l->parent : l;
+	int64_t rows = pm_atomic_fetch_add(&file->rows, 1) + 1;
+	row->lsn = rows;
 	row->sync = 0; /* don't write sync to wal */
 
 	ssize_t written = xlog_write_row(l, row);
@@ -613,8 +853,8 @@ checkpoint_write_row(struct xlog *l, struct xrow_header *row)
 		diag_raise();
 	}
 
-	if (l->rows % 100000 == 0)
-		say_crit("%.1fM rows written", l->rows / 1000000.);
+	if (rows % 100000 == 0)
+		say_crit("%.1fM rows written", rows / 1000000.);
 
 }
 
@@ -644,41 +884,70 @@ checkpoint_write_tuple(struct xlog *l, uint32_t n, struct tuple *tuple)
 struct checkpoint_entry {
 	struct space *space;
 	struct iterator *iterator;
+	/** Number of tuples in the space. */
+	size_t size;
 	struct rlist link;
 };
 
 struct checkpoint {
 	/**
 	 * List of MemTX spaces to snapshot, with consistent
-	 * read view iterators.
+	 * read view iterators. System spaces go first.
 	 */
 	struct rlist entries;
 	uint64_t snap_io_rate_limit;
+	/** Number of threads writing user spaces. */
+	int threads;
 	struct cord cord;
 	bool waiting_for_snap_thread;
 	/** The vclock of the snapshot file. */
 	struct vclock *vclock;
 	struct xdir dir;
+	/** The snapshot file, shared by all writer threads. */
+	struct xlog *snap;
+	/**
+	 * Link of the next entry to write, protected by
+	 * the mutex. Snapshot writer threads take spaces
+	 * one by one from the list.
+	 */
+	struct rlist *next;
+	/** Set if a writer failed, to stop the others. */
+	bool is_failed;
+	pthread_mutex_t mutex;
+	/** Keeps deleted tuples for the frozen iterators. */
+	struct memtx_read_view read_view;
+	bool has_read_view;
 };
 
 static void
 checkpoint_init(struct checkpoint *ckpt, const char *snap_dirname,
-		uint64_t snap_io_rate_limit)
+		uint64_t snap_io_rate_limit, int threads)
 {
 	ckpt->entries = RLIST_HEAD_INITIALIZER(ckpt->entries);
 	ckpt->waiting_for_snap_thread = false;
 	xdir_create(&ckpt->dir, snap_dirname, SNAP, &INSTANCE_UUID);
 	ckpt->snap_io_rate_limit = snap_io_rate_limit;
+	ckpt->threads = threads;
+	ckpt->snap = NULL;
+	ckpt->next = NULL;
+	ckpt->is_failed = false;
+	ckpt->has_read_view = false;
 	/* May be used in abortCheckpoint() */
 	ckpt->vclock = (struct vclock *) malloc(sizeof(*ckpt->vclock));
 	if (ckpt->vclock == NULL)
 		tnt_raise(OutOfMemory, sizeof(*ckpt->vclock),
 			  "malloc", "vclock");
 	vclock_create(ckpt->vclock);
+	tt_pthread_mutex_init(&ckpt->mutex, NULL);
 }
 
+/**
+ * Destroy the frozen iterators of a checkpoint and close its
+ * read view. Done as soon as the snapshot is written, so that
+ * deleted tuples are not kept while other engines checkpoint.
+ */
 static void
-checkpoint_destroy(struct checkpoint *ckpt)
+checkpoint_close_read_view(struct checkpoint *ckpt)
 {
 	struct checkpoint_entry *entry;
 	rlist_foreach_entry(entry, &ckpt->entries, link) {
@@ -687,8 +956,19 @@ checkpoint_destroy(struct checkpoint *ckpt)
 		entry->iterator->free(entry->iterator);
 	}
 	ckpt->entries = RLIST_HEAD_INITIALIZER(ckpt->entries);
+	if (ckpt->has_read_view) {
+		memtx_read_view_close(&ckpt->read_view);
+		ckpt->has_read_view = false;
+	}
+}
+
+static void
+checkpoint_destroy(struct checkpoint *ckpt)
+{
+	checkpoint_close_read_view(ckpt);
 	xdir_destroy(&ckpt->dir);
 	free(ckpt->vclock);
+	tt_pthread_mutex_destroy(&ckpt->mutex);
 }
 
 
@@ -705,15 +985,99 @@ checkpoint_add_space(struct space *sp, void *data)
 	struct checkpoint *ckpt = (struct checkpoint *)data;
 	struct checkpoint_entry *entry;
 	entry = region_alloc_object_xc(&fiber()->gc, struct checkpoint_entry);
-	rlist_add_tail_entry(&ckpt->entries, entry, link);
-
 	entry->space = sp;
+	entry->size = pk->size();
+	/*
+	 * Keep user spaces sorted by size, largest first, so
+	 * that writer threads finish at about the same time.
+	 * System spaces are visited first and keep their order.
+	 */
+	struct checkpoint_entry *next = NULL;
+	if (!space_is_system(sp)) {
+		rlist_foreach_entry(next, &ckpt->entries, link) {
+			if (!space_is_system(next->space) &&
+			    next->size < entry->size)
+				break;
+		}
+	}
+	if (next != NULL && &next->link != &ckpt->entries)
+		rlist_add_tail_entry(&next->link, entry, link);
+	else
+		rlist_add_tail_entry(&ckpt->entries, entry, link);
+
 	entry->iterator = pk->allocIterator();
 
 	pk->initIterator(entry->iterator, ITER_ALL, NULL, 0);
 	pk->createReadViewForIterator(entry->iterator);
 };
 
+/**
+ * Take the next space to write. Returns NULL if there are
+ * no spaces left or another writer failed.
+ */
+static struct checkpoint_entry *
+checkpoint_next_entry(struct checkpoint *ckpt)
+{
+	struct checkpoint_entry *entry = NULL;
+	tt_pthread_mutex_lock(&ckpt->mutex);
+	if (!ckpt->is_failed && ckpt->next != &ckpt->entries) {
+		entry = rlist_entry(ckpt->next, struct checkpoint_entry,
+				    link);
+		ckpt->next = ckpt->next->next;
+	}
+	tt_pthread_mutex_unlock(&ckpt->mutex);
+	return entry;
+}
+
+static void
+checkpoint_write_entry(struct xlog *l, struct checkpoint_entry *entry)
+{
+	struct tuple *tuple;
+	struct iterator *it = entry->iterator;
+	for (tuple = it->next(it); tuple; tuple = it->next(it))
+		checkpoint_write_tuple(l, space_id(entry->space), tuple);
+}
+
+/**
+ * Write spaces taken from the list of a checkpoint to a log
+ * until there are no spaces left.
+ */
+static void
+checkpoint_write_entries(struct checkpoint *ckpt, struct xlog *l)
+{
+	try {
+		struct checkpoint_entry *entry;
+		while ((entry = checkpoint_next_entry(ckpt)) != NULL)
+			checkpoint_write_entry(l, entry);
+		if (xlog_flush(l) < 0)
+			diag_raise();
+	} catch (Exception *) {
+		tt_pthread_mutex_lock(&ckpt->mutex);
+		ckpt->is_failed = true;
+		tt_pthread_mutex_unlock(&ckpt->mutex);
+		throw;
+	}
+}
+
+/**
+ * A snapshot writer thread: frames and compresses rows in
+ * its own buffer, and appends them to the shared snapshot
+ * file.
+ */
+static int
+checkpoint_worker_f(va_list ap)
+{
+	struct checkpoint *ckpt = va_arg(ap, struct checkpoint *);
+
+	struct xlog part;
+	if (xlog_create_child(&part, ckpt->snap) != 0)
+		diag_raise();
+	auto guard = make_scoped_guard([&]{ xlog_close(&part, false); });
+
+	checkpoint_write_entries(ckpt, &part);
+	return 0;
+}
+
 int
 checkpoint_f(va_list ap)
 {
@@ -725,18 +1089,59 @@ checkpoint_f(va_list ap)
 
 	auto guard = make_scoped_guard([&]{ xlog_close(&snap, false); });
 	snap.rate_limit = ckpt->snap_io_rate_limit;
+	snap.io_limiter = &io_limiter;
+	snap.io_class = IO_CLASS_SNAPSHOT;
 
 	say_info("saving snapshot `%s'", snap.filename);
+	/*
+	 * System spaces must precede the data they define
+	 * in the snapshot, write them first and in order.
+	 */
 	struct checkpoint_entry *entry;
 	rlist_foreach_entry(entry, &ckpt->entries, link) {
-		struct tuple *tuple;
-		struct iterator *it = entry->iterator;
-		for (tuple = it->next(it); tuple; tuple = it->next(it)) {
-			checkpoint_write_tuple(&snap, space_id(entry->space),
-					       tuple);
+		if (!space_is_system(entry->space))
+			break;
+		checkpoint_write_entry(&snap, entry);
+	}
+	ckpt->next = &entry->link;
+	if (ckpt->threads <= 1) {
+		checkpoint_write_entries(ckpt, &snap);
+		say_info("done");
+		return 0;
+	}
+	/*
+	 * The rest of the spaces may go in any order.
+	 * Make sure the system spaces hit the file before
+	 * the writer threads start appending to it.
+	 */
+	if (xlog_flush(&snap) < 0)
+		diag_raise();
+	ckpt->snap = &snap;
+
+	struct cord *workers = (struct cord *)
+		region_alloc_xc(&fiber()->gc, ckpt->threads *
+				sizeof(struct cord));
+	int started = 0;
+	int rc = 0;
+	for (; started < ckpt->threads; started++) {
+		char name[FIBER_NAME_MAX];
+		snprintf(name, sizeof(name), "snapshot.%d", started);
+		if (cord_costart(&workers[started], name,
+				 checkpoint_worker_f, ckpt) != 0) {
+			tt_pthread_mutex_lock(&ckpt->mutex);
+			ckpt->is_failed = true;
+			tt_pthread_mutex_unlock(&ckpt->mutex);
+			rc = -1;
+			break;
 		}
 	}
-	xlog_flush(&snap);
+	for (int i = 0; i < started; i++) {
+		if (cord_cojoin(&workers[i]) != 0)
+			rc = -1;
+	}
+	ckpt->snap = NULL;
+	if (rc != 0)
+		diag_raise();
 	say_info("done");
 	return 0;
 }
@@ -748,11 +1153,15 @@ MemtxEngine::beginCheckpoint()
 
 	m_checkpoint = region_alloc_object_xc(&fiber()->gc, struct checkpoint);
 
-	checkpoint_init(m_checkpoint, m_snap_dir.dirname, m_snap_io_rate_limit);
+	checkpoint_init(m_checkpoint, m_snap_dir.dirname, m_snap_io_rate_limit,
+			m_snap_threads);
+	/*
+	 * Tuples deleted from now on must outlive the
+	 * iterators frozen below.
+	 */
+	memtx_read_view_open(&m_checkpoint->read_view);
+	m_checkpoint->has_read_view = true;
 	space_foreach(checkpoint_add_space, m_checkpoint);
-
-	/* increment snapshot version; set tuple deletion to delayed mode */
-	memtx_tuple_begin_snapshot();
 	return 0;
 }
 
@@ -775,6 +1184,8 @@ MemtxEngine::waitCheckpoint(struct vclock *vclock)
 		error_log(diag_last_error(diag_get()));
 
 	m_checkpoint->waiting_for_snap_thread = false;
+	/* The snapshot thread doesn't need the read view any more. */
+	checkpoint_close_read_view(m_checkpoint);
 	return result;
 }
 
@@ -787,8 +1198,6 @@ MemtxEngine::commitCheckpoint(struct vclock *vclock)
 	/* waitCheckpoint() must have been done. */
 	assert(!m_checkpoint->waiting_for_snap_thread);
 
-	memtx_tuple_end_snapshot();
-
 	int64_t lsn = vclock_sum(m_checkpoint->vclock);
 	struct xdir *dir = &m_checkpoint->dir;
 	/* rename snapshot on completion */
@@ -819,8 +1228,6 @@ MemtxEngine::abortCheckpoint()
 		m_checkpoint->waiting_for_snap_thread = false;
 	}
 
-	memtx_tuple_end_snapshot();
-
 	/** Remove garbage .inprogress file. */
 	char *filename =
 		xdir_format_filename(&m_checkpoint->dir,
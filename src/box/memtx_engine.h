@@ -104,6 +104,11 @@ struct MemtxEngine: public Engine {
 	{
 		m_snap_io_rate_limit = new_limit * 1024 * 1024;
 	}
+	/* Update the number of snapshot writer threads. */
+	void setSnapThreads(int threads)
+	{
+		m_snap_threads = threads;
+	}
 	/**
 	 * Return LSN of the most recent snapshot or -1 if there is
 	 * no snapshot.
@@ -120,6 +125,8 @@ private:
 	struct xdir m_snap_dir;
 	/** Limit disk usage of checkpointing (bytes per second). */
 	uint64_t m_snap_io_rate_limit;
+	/** Number of threads writing a snapshot. */
+	int m_snap_threads;
 	bool m_force_recovery;
 };
 
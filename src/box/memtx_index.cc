@@ -33,6 +33,7 @@
 #include "memtx_index.h"
 #include "tuple.h"
 #include "say.h"
+#include "scoped_guard.h"
 #include "schema.h"
 #include "user_def.h"
 #include "space.h"
@@ -51,10 +52,24 @@ MemtxIndex::buildNext(struct tuple *tuple)
 	replace(NULL, tuple, DUP_INSERT);
 }
 
+void
+MemtxIndex::sortBuild()
+{}
+
 void
 MemtxIndex::endBuild()
 {}
 
+void
+MemtxIndex::abortBuild()
+{}
+
+bool
+MemtxIndex::canBuildInThread() const
+{
+	return false;
+}
+
 struct tuple *
 MemtxIndex::min(const char *key, uint32_t part_count) const
 {
@@ -87,7 +102,18 @@ MemtxIndex::count(enum iterator_type type, const char *key,
 }
 
 void
-index_build(MemtxIndex *index, MemtxIndex *pk)
+MemtxIndex::initIteratorWithOffset(struct iterator *it,
+				   enum iterator_type type,
+				   const char *key, uint32_t part_count,
+				   uint32_t offset) const
+{
+	initIterator(it, type, key, part_count);
+	while (offset > 0 && it->next(it) != NULL)
+		offset--;
+}
+
+void
+index_build_fill(MemtxIndex *index, MemtxIndex *pk)
 {
 	uint32_t n_tuples = pk->size();
 	uint32_t estimated_tuples = n_tuples * 1.2;
@@ -101,11 +127,21 @@ index_build(MemtxIndex *index, MemtxIndex *pk)
 			 index_name(index));
 	}
 
-	struct iterator *it = pk->position();
+	/*
+	 * Don't use pk->position(), it may be in use by
+	 * another thread building another index.
+	 */
+	struct iterator *it = pk->allocIterator();
+	auto guard = make_scoped_guard([=]{ it->free(it); });
 	pk->initIterator(it, ITER_ALL, NULL, 0);
 	struct tuple *tuple;
 	while ((tuple = it->next(it)))
 		index->buildNext(tuple);
+}
 
+void
+index_build(MemtxIndex *index, MemtxIndex *pk)
+{
+	index_build_fill(index, pk);
 	index->endBuild();
 }
@@ -47,6 +47,16 @@ public:
 				  uint32_t part_count) const override;
 	virtual size_t count(enum iterator_type type, const char *key,
 			     uint32_t part_count) const override;
+	/**
+	 * Same as initIterator(), but the iterator skips the
+	 * first @a offset tuples. The default implementation
+	 * simply fetches and discards them.
+	 */
+	virtual void initIteratorWithOffset(struct iterator *iterator,
+					    enum iterator_type type,
+					    const char *key,
+					    uint32_t part_count,
+					    uint32_t offset) const;
 
 	inline struct iterator *position() const
 	{
@@ -66,7 +76,26 @@ public:
 	 */
 	virtual void reserve(uint32_t /* size_hint */);
 	virtual void buildNext(struct tuple *tuple);
+	/**
+	 * Optional step before endBuild(): sort the tuples
+	 * given to buildNext() in the build order.
+	 */
+	virtual void sortBuild();
 	virtual void endBuild();
+	/**
+	 * Drop whatever beginBuild(), buildNext() and
+	 * sortBuild() have accumulated if the build can't
+	 * be completed with endBuild().
+	 */
+	virtual void abortBuild();
+	/**
+	 * True if beginBuild(), reserve(), buildNext() and
+	 * sortBuild() don't touch memory shared with the rest
+	 * of memtx, and thus may be called from a thread other
+	 * than tx to build several indexes at once. endBuild()
+	 * must always be called from tx.
+	 */
+	virtual bool canBuildInThread() const;
 protected:
 	/*
 	 * Pre-allocated iterator to speed up the main case of
@@ -79,4 +108,13 @@ protected:
 void
 index_build(MemtxIndex *index, MemtxIndex *pk);
 
+/**
+ * The first part of index_build(): begin building the index
+ * and feed it all tuples of the primary key. Completed with
+ * endBuild(). Allowed in a thread other than tx if
+ * index->canBuildInThread().
+ */
+void
+index_build_fill(MemtxIndex *index, MemtxIndex *pk);
+
 #endif /* TARANTOOL_BOX_MEMTX_INDEX_H_INCLUDED */
@@ -519,14 +519,10 @@ MemtxSpace::executeSelect(struct txn *, struct space *space,
 		diag_raise();
 
 	struct iterator *it = index->position();
-	index->initIterator(it, type, key, part_count);
+	index->initIteratorWithOffset(it, type, key, part_count, offset);
 
 	struct tuple *tuple;
 	while ((tuple = it->next(it)) != NULL) {
-		if (offset > 0) {
-			offset--;
-			continue;
-		}
 		if (limit == found++)
 			break;
 		port_add_tuple(port, tuple);
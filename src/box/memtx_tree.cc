@@ -43,30 +43,57 @@ struct key_data
 {
 	const char *key;
 	uint32_t part_count;
+	/** @sa key_hint(). */
+	hint_t hint;
 };
 
+static inline void
+key_data_create(struct key_data *key_data, const char *key,
+		uint32_t part_count, const struct key_def *key_def)
+{
+	key_data->key = key;
+	key_data->part_count = part_count;
+	key_data->hint = key_hint(key, part_count, key_def);
+}
+
+static inline void
+memtx_tree_data_create(struct memtx_tree_data *data, struct tuple *tuple,
+		       const struct key_def *key_def)
+{
+	data->tuple = tuple;
+	data->hint = tuple_hint(tuple, key_def);
+}
+
 int
-memtx_tree_compare(const tuple *a, const tuple *b, struct key_def *key_def)
+memtx_tree_compare(const struct memtx_tree_data *a,
+		   const struct memtx_tree_data *b, struct key_def *key_def)
 {
-	int r = tuple_compare(a, b, key_def);
+	int r = hint_cmp(a->hint, b->hint);
+	if (r != 0)
+		return r;
+	r = tuple_compare(a->tuple, b->tuple, key_def);
 	if (r == 0 && !key_def->opts.is_unique)
-		r = a < b ? -1 : a > b;
+		r = a->tuple < b->tuple ? -1 : a->tuple > b->tuple;
 	return r;
 }
 
 int
-memtx_tree_compare_key(const tuple *a, const struct key_data *key_data,
+memtx_tree_compare_key(const struct memtx_tree_data *a,
+		       const struct key_data *key_data,
 		       struct key_def *key_def)
 {
-	return tuple_compare_with_key(a, key_data->key,
+	int r = hint_cmp(a->hint, key_data->hint);
+	if (r != 0)
+		return r;
+	return tuple_compare_with_key(a->tuple, key_data->key,
 				      key_data->part_count, key_def);
 }
 
 int
 memtx_tree_qcompare(const void* a, const void *b, void *c)
 {
-	return memtx_tree_compare(*(struct tuple **)a,
-		*(struct tuple **)b, (struct key_def *)c);
+	return memtx_tree_compare((struct memtx_tree_data *)a,
+		(struct memtx_tree_data *)b, (struct key_def *)c);
 }
 
 /* {{{ MemtxTree Iterators ****************************************/
@@ -105,49 +132,53 @@ static struct tuple *
 tree_iterator_fwd(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	struct memtx_tree_data *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res)
 		return 0;
 	memtx_tree_iterator_next(it->tree, &it->tree_iterator);
-	return *res;
+	return res->tuple;
 }
 
 static struct tuple *
 tree_iterator_bwd(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	struct memtx_tree_data *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res)
 		return 0;
 	memtx_tree_iterator_prev(it->tree, &it->tree_iterator);
-	return *res;
+	return res->tuple;
 }
 
 static struct tuple *
 tree_iterator_fwd_check_equality(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	struct memtx_tree_data *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res)
 		return 0;
-	if (memtx_tree_compare_key(*res, &it->key_data, it->key_def) != 0) {
+	if (memtx_tree_compare_key(res, &it->key_data, it->key_def) != 0) {
 		it->tree_iterator = memtx_tree_invalid_iterator();
 		return 0;
 	}
 	memtx_tree_iterator_next(it->tree, &it->tree_iterator);
-	return *res;
+	return res->tuple;
 }
 
 static struct tuple *
 tree_iterator_fwd_check_next_equality(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	struct memtx_tree_data *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res)
 		return 0;
 	memtx_tree_iterator_next(it->tree, &it->tree_iterator);
 	iterator->next = tree_iterator_fwd_check_equality;
-	return *res;
+	return res->tuple;
 }
 
 static struct tuple *
@@ -163,15 +194,16 @@ static struct tuple *
 tree_iterator_bwd_check_equality(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	struct memtx_tree_data *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res)
 		return 0;
-	if (memtx_tree_compare_key(*res, &it->key_data, it->key_def) != 0) {
+	if (memtx_tree_compare_key(res, &it->key_data, it->key_def) != 0) {
 		it->tree_iterator = memtx_tree_invalid_iterator();
 		return 0;
 	}
 	memtx_tree_iterator_prev(it->tree, &it->tree_iterator);
-	return *res;
+	return res->tuple;
 }
 
 static struct tuple *
@@ -188,7 +220,7 @@ tree_iterator_bwd_skip_one_check_next_equality(struct iterator *iterator)
 
 MemtxTree::MemtxTree(struct key_def *key_def_arg)
 	: MemtxIndex(key_def_arg), build_array(0), build_array_size(0),
-	  build_array_alloc_size(0)
+	  build_array_alloc_size(0), build_array_is_sorted(false)
 {
 	memtx_index_arena_init();
 	memtx_tree_create(&tree, key_def,
@@ -217,8 +249,8 @@ MemtxTree::bsize() const
 struct tuple *
 MemtxTree::random(uint32_t rnd) const
 {
-	struct tuple **res = memtx_tree_random(&tree, rnd);
-	return res ? *res : 0;
+	struct memtx_tree_data *res = memtx_tree_random(&tree, rnd);
+	return res ? res->tuple : 0;
 }
 
 struct tuple *
@@ -227,10 +259,59 @@ MemtxTree::findByKey(const char *key, uint32_t part_count) const
 	assert(key_def->opts.is_unique && part_count == key_def->part_count);
 
 	struct key_data key_data;
-	key_data.key = key;
-	key_data.part_count = part_count;
-	struct tuple **res = memtx_tree_find(&tree, &key_data);
-	return res ? *res : 0;
+	key_data_create(&key_data, key, part_count, key_def);
+	struct memtx_tree_data *res = memtx_tree_find(&tree, &key_data);
+	return res ? res->tuple : 0;
+}
+
+/**
+ * Find the offsets of the first element that is not less than
+ * the key (@a lo) and of the first element that is greater than
+ * the key (@a hi). An empty key matches the whole tree.
+ */
+static void
+memtx_tree_key_range(const struct memtx_tree *tree,
+		     struct key_data *key_data, size_t *lo, size_t *hi)
+{
+	if (key_data->part_count == 0) {
+		*lo = 0;
+		*hi = memtx_tree_size(tree);
+		return;
+	}
+	memtx_tree_lower_bound_get_offset(tree, key_data, NULL, lo);
+	memtx_tree_upper_bound_get_offset(tree, key_data, NULL, hi);
+}
+
+size_t
+MemtxTree::count(enum iterator_type type, const char *key,
+		 uint32_t part_count) const
+{
+	if (type < 0 || type > ITER_GT)
+		return MemtxIndex::count(type, key, part_count);
+	if (part_count == 0)
+		return size();
+
+	struct key_data key_data;
+	key_data_create(&key_data, key, part_count, key_def);
+	size_t lo, hi;
+	memtx_tree_key_range(&tree, &key_data, &lo, &hi);
+	switch (type) {
+	case ITER_EQ:
+	case ITER_REQ:
+		return hi - lo;
+	case ITER_ALL:
+	case ITER_GE:
+		return size() - lo;
+	case ITER_GT:
+		return size() - hi;
+	case ITER_LE:
+		return hi;
+	case ITER_LT:
+		return lo;
+	default:
+		unreachable();
+	}
+	return 0;
 }
 
 struct tuple *
@@ -240,22 +321,26 @@ MemtxTree::replace(struct tuple *old_tuple, struct tuple *new_tuple,
 	uint32_t errcode;
 
 	if (new_tuple) {
-		struct tuple *dup_tuple = NULL;
+		struct memtx_tree_data new_data;
+		memtx_tree_data_create(&new_data, new_tuple, key_def);
+		struct memtx_tree_data dup_data;
+		dup_data.tuple = NULL;
 
 		/* Try to optimistically replace the new_tuple. */
 		int tree_res =
-		memtx_tree_insert(&tree, new_tuple, &dup_tuple);
+		memtx_tree_insert(&tree, new_data, &dup_data);
 		if (tree_res) {
 			tnt_raise(OutOfMemory, BPS_TREE_EXTENT_SIZE,
 				  "MemtxTree", "replace");
 		}
 
+		struct tuple *dup_tuple = dup_data.tuple;
 		errcode = replace_check_dup(old_tuple, dup_tuple, mode);
 
 		if (errcode) {
-			memtx_tree_delete(&tree, new_tuple);
+			memtx_tree_delete(&tree, new_data);
 			if (dup_tuple)
-				memtx_tree_insert(&tree, dup_tuple, 0);
+				memtx_tree_insert(&tree, dup_data, 0);
 			struct space *sp = space_cache_find(key_def->space_id);
 			tnt_raise(ClientError, errcode, index_name(this),
 				  space_name(sp));
@@ -264,7 +349,9 @@ MemtxTree::replace(struct tuple *old_tuple, struct tuple *new_tuple,
 			return dup_tuple;
 	}
 	if (old_tuple) {
-		memtx_tree_delete(&tree, old_tuple);
+		struct memtx_tree_data old_data;
+		memtx_tree_data_create(&old_data, old_tuple, key_def);
+		memtx_tree_delete(&tree, old_data);
 	}
 	return old_tuple;
 }
@@ -305,8 +392,7 @@ MemtxTree::initIterator(struct iterator *iterator, enum iterator_type type,
 		type = iterator_type_is_reverse(type) ? ITER_LE : ITER_GE;
 		key = 0;
 	}
-	it->key_data.key = key;
-	it->key_data.part_count = part_count;
+	key_data_create(&it->key_data, key, part_count, key_def);
 
 	bool exact = false;
 	if (key == 0) {
@@ -355,6 +441,76 @@ MemtxTree::initIterator(struct iterator *iterator, enum iterator_type type,
 	}
 }
 
+void
+MemtxTree::initIteratorWithOffset(struct iterator *iterator,
+				  enum iterator_type type,
+				  const char *key, uint32_t part_count,
+				  uint32_t offset) const
+{
+	if (offset == 0 || type < 0 || type > ITER_GT) {
+		return MemtxIndex::initIteratorWithOffset(iterator, type, key,
+							  part_count, offset);
+	}
+	assert(part_count == 0 || key != NULL);
+	struct tree_iterator *it = tree_iterator(iterator);
+	key_data_create(&it->key_data, key, part_count, key_def);
+
+	/*
+	 * Find the range of positions the iterator would walk
+	 * through and jump right to the offset-th of them.
+	 */
+	size_t lo, hi;
+	memtx_tree_key_range(&tree, &it->key_data, &lo, &hi);
+	if (part_count == 0)
+		type = iterator_type_is_reverse(type) ? ITER_LE : ITER_GE;
+	size_t begin, end;
+	switch (type) {
+	case ITER_EQ:
+	case ITER_REQ:
+		begin = lo;
+		end = hi;
+		break;
+	case ITER_ALL:
+	case ITER_GE:
+		begin = lo;
+		end = size();
+		break;
+	case ITER_GT:
+		begin = hi;
+		end = size();
+		break;
+	case ITER_LE:
+		begin = 0;
+		end = hi;
+		break;
+	case ITER_LT:
+		begin = 0;
+		end = lo;
+		break;
+	default:
+		unreachable();
+		return;
+	}
+	if (end - begin <= offset) {
+		it->tree_iterator = memtx_tree_invalid_iterator();
+		it->base.next = tree_iterator_dummie;
+		return;
+	}
+	if (iterator_type_is_reverse(type)) {
+		it->tree_iterator =
+			memtx_tree_iterator_at(&tree, end - 1 - offset);
+		it->base.next = type == ITER_REQ ?
+				tree_iterator_bwd_check_equality :
+				tree_iterator_bwd;
+	} else {
+		it->tree_iterator =
+			memtx_tree_iterator_at(&tree, begin + offset);
+		it->base.next = type == ITER_EQ ?
+				tree_iterator_fwd_check_equality :
+				tree_iterator_fwd;
+	}
+}
+
 void
 MemtxTree::beginBuild()
 {
@@ -366,8 +522,8 @@ MemtxTree::reserve(uint32_t size_hint)
 {
 	if (size_hint < build_array_alloc_size)
 		return;
-	build_array = (struct tuple**)
-		realloc(build_array, size_hint * sizeof(struct tuple *));
+	build_array = (struct memtx_tree_data *)
+		realloc(build_array, size_hint * sizeof(*build_array));
 	build_array_alloc_size = size_hint;
 }
 
@@ -375,32 +531,68 @@ void
 MemtxTree::buildNext(struct tuple *tuple)
 {
 	if (!build_array) {
-		build_array = (struct tuple**)malloc(BPS_TREE_EXTENT_SIZE);
+		build_array = (struct memtx_tree_data *)
+			malloc(BPS_TREE_EXTENT_SIZE);
 		build_array_alloc_size =
-			BPS_TREE_EXTENT_SIZE / sizeof(struct tuple*);
+			BPS_TREE_EXTENT_SIZE / sizeof(*build_array);
 	}
 	assert(build_array_size <= build_array_alloc_size);
 	if (build_array_size == build_array_alloc_size) {
 		build_array_alloc_size = build_array_alloc_size +
 					 build_array_alloc_size / 2;
-		build_array = (struct tuple**)
+		build_array = (struct memtx_tree_data *)
 			realloc(build_array,
 				build_array_alloc_size *
-				sizeof(struct tuple *));
+				sizeof(*build_array));
 	}
-	build_array[build_array_size++] = tuple;
+	memtx_tree_data_create(&build_array[build_array_size++], tuple,
+			       key_def);
+}
+
+void
+MemtxTree::sortBuild()
+{
+	/*
+	 * Called from a build thread, running along with
+	 * other build threads: don't spawn more threads.
+	 */
+	qsort_arg(build_array, build_array_size, sizeof(*build_array),
+		  memtx_tree_qcompare, key_def);
+	build_array_is_sorted = true;
 }
 
 void
 MemtxTree::endBuild()
 {
-	qsort_arg(build_array, build_array_size, sizeof(struct tuple *), memtx_tree_qcompare, key_def);
+	if (!build_array_is_sorted) {
+		qsort_arg_mt(build_array, build_array_size,
+			     sizeof(*build_array), memtx_tree_qcompare,
+			     key_def);
+	}
 	memtx_tree_build(&tree, build_array, build_array_size);
 
 	free(build_array);
 	build_array = 0;
 	build_array_size = 0;
 	build_array_alloc_size = 0;
+	build_array_is_sorted = false;
+}
+
+void
+MemtxTree::abortBuild()
+{
+	free(build_array);
+	build_array = 0;
+	build_array_size = 0;
+	build_array_alloc_size = 0;
+	build_array_is_sorted = false;
+}
+
+bool
+MemtxTree::canBuildInThread() const
+{
+	/* The build array is allocated with malloc(). */
+	return true;
 }
 
 /**
@@ -33,24 +33,42 @@
 
 #include "memtx_index.h"
 #include "memtx_engine.h"
+#include "tuple_compare.h"
 
 struct tuple;
 struct key_data;
 
+/**
+ * An element of a memtx tree: a tuple along with the hint
+ * of its first key part. Comparisons look at the hints
+ * first and only dereference the tuples if the hints
+ * can't tell the order, which saves a cache miss per tree
+ * level on lookups.
+ */
+struct memtx_tree_data {
+	struct tuple *tuple;
+	/** @sa tuple_hint(). */
+	hint_t hint;
+};
+
 int
-memtx_tree_compare(const struct tuple *a, const struct tuple *b, struct key_def *key_def);
+memtx_tree_compare(const struct memtx_tree_data *a,
+		   const struct memtx_tree_data *b, struct key_def *key_def);
 
 int
-memtx_tree_compare_key(const tuple *a, const key_data *b, struct key_def *key_def);
+memtx_tree_compare_key(const struct memtx_tree_data *a, const key_data *b,
+		       struct key_def *key_def);
 
 #define BPS_TREE_NAME memtx_tree
 #define BPS_TREE_BLOCK_SIZE (512)
 #define BPS_TREE_EXTENT_SIZE MEMTX_EXTENT_SIZE
-#define BPS_TREE_COMPARE(a, b, arg) memtx_tree_compare(a, b, arg)
-#define BPS_TREE_COMPARE_KEY(a, b, arg) memtx_tree_compare_key(a, b, arg)
-#define bps_tree_elem_t struct tuple *
+#define BPS_TREE_COMPARE(a, b, arg) memtx_tree_compare(&(a), &(b), arg)
+#define BPS_TREE_COMPARE_KEY(a, b, arg) memtx_tree_compare_key(&(a), b, arg)
+#define bps_tree_elem_t struct memtx_tree_data
 #define bps_tree_key_t struct key_data *
 #define bps_tree_arg_t struct key_def *
+#define BPS_TREE_NO_DEBUG
+#define BPS_TREE_CHILD_COUNTS
 
 #include "salad/bps_tree.h"
 
@@ -62,11 +80,16 @@ public:
 	virtual void beginBuild() override;
 	virtual void reserve(uint32_t size_hint) override;
 	virtual void buildNext(struct tuple *tuple) override;
+	virtual void sortBuild() override;
 	virtual void endBuild() override;
+	virtual void abortBuild() override;
+	virtual bool canBuildInThread() const override;
 	virtual size_t size() const override;
 	virtual struct tuple *random(uint32_t rnd) const override;
 	virtual struct tuple *findByKey(const char *key,
 					uint32_t part_count) const override;
+	virtual size_t count(enum iterator_type type, const char *key,
+			     uint32_t part_count) const override;
 	virtual struct tuple *replace(struct tuple *old_tuple,
 				      struct tuple *new_tuple,
 				      enum dup_replace_mode mode) override;
@@ -77,6 +100,11 @@ public:
 				  enum iterator_type type,
 				  const char *key,
 				  uint32_t part_count) const override;
+	virtual void initIteratorWithOffset(struct iterator *iterator,
+					    enum iterator_type type,
+					    const char *key,
+					    uint32_t part_count,
+					    uint32_t offset) const override;
 
 	/**
 	 * Create a read view for iterator so further index modifications
@@ -91,8 +119,10 @@ public:
 
 // protected:
 	struct memtx_tree tree;
-	struct tuple **build_array;
+	struct memtx_tree_data *build_array;
 	size_t build_array_size, build_array_alloc_size;
+	/** Set by sortBuild(), so endBuild() doesn't sort again. */
+	bool build_array_is_sorted;
 };
 
 #endif /* TARANTOOL_BOX_MEMTX_TREE_H_INCLUDED */
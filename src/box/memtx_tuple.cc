@@ -34,15 +34,18 @@
 #include "small/small.h"
 #include "small/region.h"
 #include "small/quota.h"
+#include "small/rlist.h"
+#include "salad/stailq.h"
 #include "fiber.h"
 #include "box.h"
 
 struct memtx_tuple {
 	/*
-	 * sic: the header of the tuple is used
-	 * to store a free list pointer in smfree_delayed.
+	 * sic: the header of a deleted tuple is used to
+	 * store a garbage list pointer of a read view.
 	 * Please don't change it without understanding
-	 * how smfree_delayed and snapshotting COW works.
+	 * how memtx_tuple_delete() and snapshotting COW
+	 * works.
 	 */
 	/** Snapshot generation version. */
 	uint32_t version;
@@ -60,6 +63,9 @@ struct small_alloc memtx_alloc; /* used box box.slab.info() */
 
 uint32_t snapshot_version;
 
+/** Open read views, from the oldest to the newest. */
+static RLIST_HEAD(read_views);
+
 enum {
 	/** Lowest allowed slab_alloc_minimal */
 	OBJSIZE_MIN = 16,
@@ -187,24 +193,72 @@ memtx_tuple_delete(struct tuple_format *format, struct tuple *tuple)
 	tuple_format_ref(format, -1);
 	struct memtx_tuple *memtx_tuple =
 		container_of(tuple, struct memtx_tuple, base);
-	if (!memtx_alloc.is_delayed_free_mode ||
-	    memtx_tuple->version == snapshot_version)
+	/*
+	 * A tuple is visible to open read views only if it was
+	 * created before the newest one was opened. Tuples of the
+	 * default format don't belong to any space and can't be
+	 * reached from a read view.
+	 */
+	if (rlist_empty(&read_views) || format == tuple_format_default) {
 		smfree(&memtx_alloc, memtx_tuple, total);
-	else
-		smfree_delayed(&memtx_alloc, memtx_tuple, total);
+		return;
+	}
+	/*
+	 * The tuple must be kept until all read views opened
+	 * after it was created are closed. Hand it to the oldest
+	 * of them. The list link overwrites the head of the
+	 * tuple header, while the data, its size and offset stay
+	 * intact for the frozen iterators.
+	 */
+	struct memtx_read_view *rv;
+	rlist_foreach_entry(rv, &read_views, in_read_views) {
+		if (memtx_tuple->version < rv->version) {
+			stailq_add_tail(&rv->garbage,
+					(struct stailq_entry *) memtx_tuple);
+			return;
+		}
+	}
+	smfree(&memtx_alloc, memtx_tuple, total);
 }
 
 void
-memtx_tuple_begin_snapshot()
+memtx_read_view_open(struct memtx_read_view *rv)
 {
-	snapshot_version++;
-	small_alloc_setopt(&memtx_alloc, SMALL_DELAYED_FREE_MODE, true);
+	rv->version = ++snapshot_version;
+	stailq_create(&rv->garbage);
+	rlist_add_tail_entry(&read_views, rv, in_read_views);
 }
 
 void
-memtx_tuple_end_snapshot()
+memtx_read_view_close(struct memtx_read_view *rv)
 {
-	small_alloc_setopt(&memtx_alloc, SMALL_DELAYED_FREE_MODE, false);
+	assert(!rlist_empty(&read_views));
+	/*
+	 * Tuples kept for this read view are also visible to
+	 * all read views opened after it. If there are any, pass
+	 * the tuples to the next one, otherwise free them.
+	 */
+	if (rv != rlist_last_entry(&read_views, struct memtx_read_view,
+				   in_read_views)) {
+		struct memtx_read_view *next = rlist_next_entry(rv,
+							in_read_views);
+		stailq_concat(&next->garbage, &rv->garbage);
+	} else {
+		while (!stailq_empty(&rv->garbage)) {
+			struct memtx_tuple *memtx_tuple =
+				(struct memtx_tuple *)
+				stailq_shift(&rv->garbage);
+			/*
+			 * The tuple format may be gone by now,
+			 * but the size is still known from the
+			 * tuple data offset.
+			 */
+			size_t total = offsetof(struct memtx_tuple, base) +
+				       tuple_size(&memtx_tuple->base);
+			smfree(&memtx_alloc, memtx_tuple, total);
+		}
+	}
+	rlist_del_entry(rv, in_read_views);
 }
 
 box_tuple_t *
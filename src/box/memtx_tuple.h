@@ -32,6 +32,8 @@
  */
 
 #include "diag.h"
+#include "small/rlist.h"
+#include "salad/stailq.h"
 #include "tuple_format.h"
 #include "tuple.h"
 
@@ -66,11 +68,34 @@ memtx_tuple_delete(struct tuple_format *format, struct tuple *tuple);
 /** tuple format vtab for memtx engine. */
 extern struct tuple_format_vtab memtx_tuple_format_vtab;
 
+/**
+ * A consistent read view of memtx spaces. While a read view
+ * is open, tuples which existed at the moment it was opened
+ * are not freed when deleted from a space, so that index
+ * iterators frozen at that moment (see
+ * Index::createReadViewForIterator()) can still access them.
+ * Tuples created after the newest read view was opened and
+ * tuples which are never stored in an index are freed at once.
+ * A deleted tuple is freed as soon as the last read view that
+ * can see it is closed, regardless of other read views.
+ */
+struct memtx_read_view {
+	/** Tuple version at the moment the read view was opened. */
+	uint32_t version;
+	/**
+	 * Deleted tuples visible to this read view and to no
+	 * older one, linked through the tuple header.
+	 */
+	struct stailq garbage;
+	/** Link in the list of open read views. */
+	struct rlist in_read_views;
+};
+
 void
-memtx_tuple_begin_snapshot();
+memtx_read_view_open(struct memtx_read_view *rv);
 
 void
-memtx_tuple_end_snapshot();
+memtx_read_view_close(struct memtx_read_view *rv);
 
 /** \cond public */
 
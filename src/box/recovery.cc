@@ -35,7 +35,8 @@
 #include "xlog.h"
 #include "xrow.h"
 #include "xstream.h"
-#include "wal.h" /* wal_watcher */
+#include "wal.h" /* wal_watcher, wal_tail_read() */
+#include "small/ibuf.h"
 #include "replication.h"
 #include "session.h"
 
@@ -335,6 +336,9 @@ recover_current_wal:
 		 */
 	}
 
+	/* We've read everything there is, let the stream know. */
+	xstream_flush(stream);
+
 	if (stop_vclock != NULL && vclock_compare(&r->vclock, stop_vclock) != 0)
 		tnt_raise(XlogGapError, &r->vclock, stop_vclock);
 
@@ -481,6 +485,45 @@ public:
 	}
 };
 
+enum {
+	/** How many bytes of rows to copy from the WAL tail at once. */
+	WAL_TAIL_READ_SIZE = 128 * 1024,
+};
+
+/**
+ * Feed the stream with rows from the in-memory WAL tail, see
+ * wal_tail_read().
+ *
+ * @retval 0 all rows written to WAL so far have been read
+ * @retval -1 the rows are not in memory, read xlog files
+ */
+static int
+recover_wal_tail(struct recovery *r, struct xstream *stream,
+		 struct wal_tail_cursor *cursor, struct ibuf *buf)
+{
+	while (true) {
+		ibuf_reset(buf);
+		if (wal_tail_read(cursor, &r->vclock, buf,
+				  WAL_TAIL_READ_SIZE) != 0)
+			return -1;
+		if (ibuf_used(buf) == 0)
+			break;
+		const char *pos = buf->rpos;
+		while (pos < buf->wpos) {
+			struct xrow_header row;
+			if (wal_tail_decode_row(&pos, buf->wpos, &row) != 0)
+				diag_raise();
+			int64_t current_lsn = vclock_get(&r->vclock,
+							 row.replica_id);
+			if (row.lsn <= current_lsn)
+				continue; /* already sent, skip */
+			xstream_write(stream, &row);
+		}
+	}
+	xstream_flush(stream);
+	return 0;
+}
+
 static int
 recovery_follow_f(va_list ap)
 {
@@ -490,7 +533,24 @@ recovery_follow_f(va_list ap)
 
 	WalSubscription subscription(r->wal_dir.dirname);
 
+	/*
+	 * Fresh rows are read from the WAL writer memory, if
+	 * possible. Xlog files are only read when we're lagging
+	 * too far behind, e.g. when a replica has just connected
+	 * or is slow.
+	 */
+	struct wal_tail_cursor tail_cursor;
+	wal_tail_cursor_create(&tail_cursor);
+	struct ibuf tail_buf;
+	ibuf_create(&tail_buf, &cord()->slabc, WAL_TAIL_READ_SIZE);
+	auto tail_buf_guard = make_scoped_guard([&]{
+		ibuf_destroy(&tail_buf);
+	});
+
 	while (! fiber_is_cancelled()) {
+		if (recover_wal_tail(r, stream, &tail_cursor,
+				     &tail_buf) == 0)
+			goto wait;
 
 		/*
 		 * Recover until there is no new stuff which appeared in
@@ -528,7 +588,7 @@ recovery_follow_f(va_list ap)
 
 		subscription.set_log_path(r->cursor.state != XLOG_CURSOR_CLOSED ?
 					  r->cursor.name: NULL);
-
+wait:
 		if (subscription.signaled == false) {
 			/**
 			 * Allow an immediate wakeup/break loop
@@ -51,6 +51,18 @@ static void
 relay_send_final_join_row(struct xstream *stream, struct xrow_header *packet);
 static void
 relay_send_subscribe_row(struct xstream *stream, struct xrow_header *row);
+static void
+relay_flush_stream(struct xstream *stream);
+
+enum {
+	/**
+	 * Rows read from WALs are accumulated in the relay
+	 * output buffer and sent in a single writev() once the
+	 * buffer grows that big or there are no more rows to
+	 * read at the moment.
+	 */
+	RELAY_BATCH_SIZE = 128 * 1024,
+};
 
 static inline void
 relay_create(struct relay *relay, int fd, uint64_t sync,
@@ -68,6 +80,24 @@ relay_destroy(struct relay *relay)
 	(void) relay;
 }
 
+/**
+ * Start batching rows sent to the replica. Must be called from
+ * the thread which writes the rows.
+ */
+static inline void
+relay_batch_create(struct relay *relay)
+{
+	obuf_create(&relay->batch, &cord()->slabc, RELAY_BATCH_SIZE);
+	relay->stream.flush = relay_flush_stream;
+}
+
+static inline void
+relay_batch_destroy(struct relay *relay)
+{
+	relay->stream.flush = NULL;
+	obuf_destroy(&relay->batch);
+}
+
 static inline void
 relay_set_cord_name(int fd)
 {
@@ -102,6 +132,10 @@ relay_final_join_f(va_list ap)
 	struct relay *relay = va_arg(ap, struct relay *);
 	coeio_enable();
 	relay_set_cord_name(relay->io.fd);
+	relay_batch_create(relay);
+	auto batch_guard = make_scoped_guard([=]{
+		relay_batch_destroy(relay);
+	});
 
 	/* Send all WALs until stop_vclock */
 	assert(relay->stream.write != NULL);
@@ -154,6 +188,10 @@ relay_subscribe_f(va_list ap)
 	coeio_enable();
 	relay->stream.write = relay_send_subscribe_row;
 	relay_set_cord_name(relay->io.fd);
+	relay_batch_create(relay);
+	auto batch_guard = make_scoped_guard([=]{
+		relay_batch_destroy(relay);
+	});
 	recovery_follow_local(r, &relay->stream, fiber_name(fiber()),
 			      relay->wal_dir_rescan_delay);
 
@@ -250,6 +288,43 @@ relay_send(struct relay *relay, struct xrow_header *packet)
 	fiber_gc();
 }
 
+/** Send all rows accumulated by relay_send_batched(). */
+static void
+relay_flush(struct relay *relay)
+{
+	struct obuf *batch = &relay->batch;
+	if (obuf_size(batch) == 0)
+		return;
+	coio_writev(&relay->io, batch->iov, obuf_iovcnt(batch),
+		    obuf_size(batch));
+	obuf_reset(batch);
+}
+
+static void
+relay_flush_stream(struct xstream *stream)
+{
+	struct relay *relay = container_of(stream, struct relay, stream);
+	relay_flush(relay);
+}
+
+/**
+ * Same as relay_send(), but only appends the row to the
+ * output buffer, which is flushed when it's big enough or
+ * when recovery runs out of rows.
+ */
+static void
+relay_send_batched(struct relay *relay, struct xrow_header *packet)
+{
+	packet->sync = relay->sync;
+	struct iovec iov[XROW_IOVMAX];
+	int iovcnt = xrow_to_iovec(packet, iov);
+	for (int i = 0; i < iovcnt; i++)
+		obuf_dup_xc(&relay->batch, iov[i].iov_base, iov[i].iov_len);
+	fiber_gc();
+	if (obuf_size(&relay->batch) >= RELAY_BATCH_SIZE)
+		relay_flush(relay);
+}
+
 static void
 relay_send_initial_join_row(struct xstream *stream, struct xrow_header *row)
 {
@@ -270,9 +345,10 @@ relay_send_final_join_row(struct xstream *stream, struct xrow_header *row)
 
 	vclock_follow(&r->vclock, row->replica_id, row->lsn);
 
-	relay_send(relay, row);
+	relay_send_batched(relay, row);
 	ERROR_INJECT(ERRINJ_RELAY,
 	{
+		relay_flush(relay);
 		fiber_sleep(1000.0);
 	});
 }
@@ -292,9 +368,10 @@ relay_send_subscribe_row(struct xstream *stream, struct xrow_header *packet)
 	 * (i.e. don't send replica's own rows back).
 	 */
 	if (packet->replica_id != relay->replica_id) {
-		relay_send(relay, packet);
+		relay_send_batched(relay, packet);
 		ERROR_INJECT(ERRINJ_RELAY,
 		{
+			relay_flush(relay);
 			fiber_sleep(1000.0);
 		});
 	}
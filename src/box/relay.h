@@ -34,6 +34,7 @@
 #include "fiber.h"
 #include "vclock.h"
 #include "xstream.h"
+#include "small/obuf.h"
 
 struct replica;
 struct tt_uuid;
@@ -48,6 +49,11 @@ struct relay {
 	uint64_t sync;
 	struct recovery *r;
 	struct xstream stream;
+	/**
+	 * Rows encoded but not sent yet. Allocated in the
+	 * relay thread, see relay_send_batched().
+	 */
+	struct obuf batch;
 	struct vclock stop_vclock;
 	ev_tstamp wal_dir_rescan_delay;
 	uint32_t replica_id;
@@ -84,6 +84,8 @@ session_create(int fd)
 	session->id = sid_max();
 	session->fd =  fd;
 	session->sync = 0;
+	session->commit_async = false;
+	session->commit_async_failed = false;
 	/* For on_connect triggers. */
 	credentials_init(&session->credentials, guest_user->auth_token,
 			 guest_user->def.uid);
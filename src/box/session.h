@@ -77,6 +77,13 @@ struct session {
 	char salt[SESSION_SEED_SIZE];
 	/** Cached user id and global grants */
 	struct credentials credentials;
+	/**
+	 * If true, a commit doesn't wait for the WAL write,
+	 * see box_txn_commit_wait().
+	 */
+	bool commit_async;
+	/** Set if an asynchronous commit has been rolled back. */
+	bool commit_async_failed;
 	/** Trigger for fiber on_stop to cleanup created on-demand session */
 	struct trigger fiber_on_stop;
 };
@@ -850,3 +850,99 @@ tuple_compare_with_key_create(const struct key_def *def)
 }
 
 /* }}} tuple_compare_with_key */
+
+/* {{{ tuple_hint */
+
+/**
+ * Hints are monotonic, but not necessarily strictly monotonic,
+ * so values that don't fit are clamped to the largest hint
+ * distinct from HINT_NONE.
+ */
+static inline hint_t
+hint_clamp(uint64_t val)
+{
+	return val < HINT_NONE ? val : HINT_NONE - 1;
+}
+
+static inline hint_t
+field_hint_uint(const char *field)
+{
+	if (mp_typeof(*field) != MP_UINT)
+		return HINT_NONE;
+	return hint_clamp(mp_decode_uint(&field));
+}
+
+static inline hint_t
+field_hint_integer(const char *field)
+{
+	/*
+	 * Negative values are mapped to [0, 2^63), non-negative
+	 * ones are halved and mapped to [2^63, 2^64). A msgpack
+	 * encoder is free to store a non-negative value as MP_INT,
+	 * so such values must get the same hint as MP_UINT ones.
+	 */
+	switch (mp_typeof(*field)) {
+	case MP_INT: {
+		int64_t val = mp_decode_int(&field);
+		if (val >= 0)
+			return hint_clamp((1ULL << 63) + ((uint64_t)val >> 1));
+		return (uint64_t)val - (uint64_t)INT64_MIN;
+	}
+	case MP_UINT:
+		return hint_clamp((1ULL << 63) + (mp_decode_uint(&field) >> 1));
+	default:
+		return HINT_NONE;
+	}
+}
+
+static inline hint_t
+field_hint_str(const char *field)
+{
+	if (mp_typeof(*field) != MP_STR)
+		return HINT_NONE;
+	/* Strings are compared with memcmp(), use a big-endian prefix. */
+	uint32_t len;
+	const char *str = mp_decode_str(&field, &len);
+	uint64_t val = 0;
+	uint32_t size = MIN(len, (uint32_t)sizeof(val));
+	for (uint32_t i = 0; i < size; i++)
+		val |= (uint64_t)(uint8_t)str[i] << (56 - 8 * i);
+	return hint_clamp(val);
+}
+
+hint_t
+field_hint(const char *field, enum field_type type)
+{
+	switch (type) {
+	case FIELD_TYPE_UNSIGNED:
+		return field_hint_uint(field);
+	case FIELD_TYPE_INTEGER:
+		return field_hint_integer(field);
+	case FIELD_TYPE_STRING:
+		return field_hint_str(field);
+	default:
+		return HINT_NONE;
+	}
+}
+
+hint_t
+tuple_hint(const struct tuple *tuple, const struct key_def *key_def)
+{
+	if (key_def->part_count == 0)
+		return HINT_NONE;
+	const struct key_part *part = &key_def->parts[0];
+	const char *field = tuple_field(tuple, part->fieldno);
+	if (field == NULL)
+		return HINT_NONE;
+	return field_hint(field, part->type);
+}
+
+hint_t
+key_hint(const char *key, uint32_t part_count, const struct key_def *key_def)
+{
+	if (part_count == 0 || key_def->part_count == 0)
+		return HINT_NONE;
+	return field_hint(key, key_def->parts[0].type);
+}
+
+/* }}} tuple_hint */
@@ -108,6 +108,57 @@ tuple_compare_with_key(const struct tuple *tuple, const char *key,
 					       key_def);
 }
 
+/**
+ * A hint is a 64-bit value computed from the first part of
+ * a key or a tuple, such that hint(a) < hint(b) implies a < b.
+ * Unequal hints allow to order two tuples without looking at
+ * the tuple data, equal hints tell nothing and require a full
+ * comparison. HINT_NONE is returned if the hint can't be
+ * computed, e.g. if the key is empty or the first key part
+ * has a type without hint support.
+ */
+typedef uint64_t hint_t;
+
+#define HINT_NONE ((hint_t)UINT64_MAX)
+
+/**
+ * Compute the hint of a MessagePack field of the given type.
+ */
+hint_t
+field_hint(const char *field, enum field_type type);
+
+/**
+ * Compute the hint of a tuple.
+ * @param tuple tuple
+ * @param key_def key definition
+ */
+hint_t
+tuple_hint(const struct tuple *tuple, const struct key_def *key_def);
+
+/**
+ * Compute the hint of a key.
+ * @param key key parts without MessagePack array header
+ * @param part_count the number of parts in @a key
+ * @param key_def key definition
+ */
+hint_t
+key_hint(const char *key, uint32_t part_count, const struct key_def *key_def);
+
+/**
+ * Compare two hints.
+ * @retval <0 if a < b
+ * @retval >0 if a > b
+ * @retval 0  if the hints can't tell the order and a full
+ *            comparison is required
+ */
+static inline int
+hint_cmp(hint_t a, hint_t b)
+{
+	if (a == b || a == HINT_NONE || b == HINT_NONE)
+		return 0;
+	return a < b ? -1 : 1;
+}
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
@@ -34,7 +34,9 @@
 #include "tuple.h"
 #include "recovery.h"
 #include "wal.h"
+#include "session.h"
 #include <fiber.h>
+#include "ipc.h"
 #include "xrow.h"
 
 enum {
@@ -46,6 +48,35 @@ enum {
 };
 
 double too_long_threshold;
+size_t txn_async_max_bytes;
+
+/**
+ * An asynchronous commit which is not acknowledged by WAL yet,
+ * see txn_commit_async().
+ */
+struct txn_async_entry {
+	/** Link in txn_async.queue. */
+	struct rlist in_queue;
+	/** Sequence number of the commit. */
+	int64_t seq;
+	/** Size of the redo rows of the transaction. */
+	size_t size;
+};
+
+/** Asynchronous commits of the tx thread. */
+static struct {
+	/** Commits not acknowledged by WAL yet, in WAL order. */
+	struct rlist queue;
+	/** Sequence number of the last queued commit. */
+	int64_t seq;
+	/** Total size of the redo rows of the queued commits. */
+	size_t bytes;
+	/** Broadcast whenever a commit leaves the queue. */
+	struct ipc_cond cond;
+} txn_async = {
+	RLIST_HEAD_INITIALIZER(txn_async.queue), 0, 0,
+	{ RLIST_HEAD_INITIALIZER(txn_async.cond.waiters) }
+};
 
 static inline void
 fiber_set_txn(struct fiber *fiber, struct txn *txn)
@@ -69,6 +100,7 @@ txn_add_redo(struct txn_stmt *stmt, struct request *request)
 	row->lsn = 0;
 	row->sync = 0;
 	row->tm = 0;
+	row->stream_id = 0;
 	row->bodycnt = request_encode_xc(request, row->body);
 	stmt->row = row;
 }
@@ -243,6 +275,140 @@ txn_write_to_wal(struct txn *txn)
 	return res;
 }
 
+/**
+ * Copy a prepared transaction, its statements and redo rows
+ * to the region of the current fiber, so that the copy can
+ * outlive the fiber which has started the transaction.
+ * Tuples and engine data are shared with the original.
+ */
+static struct txn *
+txn_dup(struct txn *src, size_t *size)
+{
+	struct region *gc = &fiber()->gc;
+	struct txn *txn = region_alloc_object_xc(gc, struct txn);
+	*txn = *src;
+	stailq_create(&txn->stmts);
+	/* Cleared by Engine::prepare(), must not point to @a src. */
+	rlist_create(&txn->fiber_on_yield.link);
+	rlist_create(&txn->fiber_on_stop.link);
+	*size = 0;
+	struct txn_stmt *src_stmt;
+	stailq_foreach_entry(src_stmt, &src->stmts, next) {
+		struct txn_stmt *stmt =
+			region_alloc_object_xc(gc, struct txn_stmt);
+		*stmt = *src_stmt;
+		stailq_add_tail_entry(&txn->stmts, stmt, next);
+		if (src_stmt->row == NULL)
+			continue;
+		struct xrow_header *row =
+			region_alloc_object_xc(gc, struct xrow_header);
+		*row = *src_stmt->row;
+		for (int i = 0; i < row->bodycnt; i++) {
+			size_t len = row->body[i].iov_len;
+			void *base = region_alloc_xc(gc, len);
+			memcpy(base, row->body[i].iov_base, len);
+			row->body[i].iov_base = base;
+			*size += len;
+		}
+		stmt->row = row;
+	}
+	return txn;
+}
+
+/**
+ * Write a copy of a prepared transaction to WAL and complete
+ * it on behalf of the fiber which has started it. The copy is
+ * made before the first yield, so the origin may be freed as
+ * soon as the fiber is started.
+ */
+static int
+txn_commit_async_f(va_list ap)
+{
+	struct txn *origin = va_arg(ap, struct txn *);
+	uint32_t sid = va_arg(ap, uint32_t);
+	bool *is_queued = va_arg(ap, bool *);
+
+	struct txn_async_entry entry;
+	struct txn *txn;
+	try {
+		txn = txn_dup(origin, &entry.size);
+	} catch (Exception *e) {
+		/* The origin is committed synchronously. */
+		return -1;
+	}
+	fiber_set_txn(fiber(), txn);
+	entry.seq = ++txn_async.seq;
+	rlist_add_tail_entry(&txn_async.queue, &entry, in_queue);
+	txn_async.bytes += entry.size;
+	*is_queued = true;
+
+	int64_t signature;
+	try {
+		signature = txn_write_to_wal(txn);
+	} catch (Exception *e) {
+		/*
+		 * The transaction has been rolled back along with
+		 * all transactions queued after it. Let the session
+		 * know on the next box.commit_wait().
+		 */
+		signature = -1;
+		struct session *session = session_find(sid);
+		if (session != NULL)
+			session->commit_async_failed = true;
+	}
+	if (signature >= 0) {
+		txn->engine->commit(txn, signature);
+		TRASH(txn);
+		fiber_gc();
+		fiber_set_txn(fiber(), NULL);
+	}
+	rlist_del_entry(&entry, in_queue);
+	txn_async.bytes -= entry.size;
+	ipc_cond_broadcast(&txn_async.cond);
+	return 0;
+}
+
+/**
+ * Hand a prepared transaction over to a new fiber which waits
+ * for WAL instead of the current one. Only engines which make
+ * changes visible before commit support this, so the fiber
+ * observes its own changes as usual. Transactions with commit
+ * or rollback triggers (e.g. DDL) are always synchronous.
+ *
+ * If WAL fails, the cascading rollback undoes the transaction
+ * as well as everything queued after it, including subsequent
+ * transactions of this fiber.
+ *
+ * @retval true the transaction is queued to WAL
+ * @retval false the transaction must be committed synchronously
+ */
+static bool
+txn_commit_async(struct txn *txn)
+{
+	struct session *session = fiber_get_session(fiber());
+	if (session == NULL || !session->commit_async || wal == NULL ||
+	    txn->n_rows == 0 || txn->has_triggers ||
+	    !engine_can_commit_async(txn->engine->flags))
+		return false;
+
+	bool is_queued = false;
+	struct fiber *f = fiber_new_xc("commit_async", txn_commit_async_f);
+	fiber_start(f, txn, session->id, &is_queued);
+	if (!is_queued)
+		return false;
+	TRASH(txn);
+	fiber_gc();
+	fiber_set_txn(fiber(), NULL);
+	/*
+	 * Bound the durability lag: don't let the fiber run
+	 * ahead while too many bytes are not acknowledged.
+	 */
+	while (txn_async.bytes > txn_async_max_bytes &&
+	       !fiber_is_cancelled())
+		ipc_cond_wait(&txn_async.cond);
+	return true;
+}
+
 void
 txn_commit(struct txn *txn)
 {
@@ -255,6 +421,8 @@ txn_commit(struct txn *txn)
 		int64_t signature = -1;
 		txn->engine->prepare(txn);
 
+		if (txn_commit_async(txn))
+			return;
 		if (txn->n_rows > 0)
 			signature = txn_write_to_wal(txn);
 		/*
@@ -371,6 +539,33 @@ box_txn_commit()
 	return 0;
 }
 
+int
+box_txn_commit_wait()
+{
+	if (in_txn()) {
+		diag_set(ClientError, ER_ACTIVE_TRANSACTION);
+		return -1;
+	}
+	/* Wait for the commits queued so far, not for new ones. */
+	int64_t seq = txn_async.seq;
+	while (!rlist_empty(&txn_async.queue) &&
+	       rlist_first_entry(&txn_async.queue, struct txn_async_entry,
+				 in_queue)->seq <= seq) {
+		if (fiber_is_cancelled()) {
+			diag_set(FiberIsCancelled);
+			return -1;
+		}
+		ipc_cond_wait(&txn_async.cond);
+	}
+	struct session *session = fiber_get_session(fiber());
+	if (session != NULL && session->commit_async_failed) {
+		session->commit_async_failed = false;
+		diag_set(ClientError, ER_WAL_IO);
+		return -1;
+	}
+	return 0;
+}
+
 int
 box_txn_rollback()
 {
@@ -73,6 +73,11 @@ struct txn_stmt {
 #include "fiber.h"
 
 extern double too_long_threshold;
+/**
+ * Max size of rows of asynchronous commits not acknowledged
+ * by WAL yet, see box_txn_commit_wait().
+ */
+extern size_t txn_async_max_bytes;
 struct tuple;
 
 struct txn {
@@ -271,6 +276,18 @@ box_txn_begin(void);
 API_EXPORT int
 box_txn_commit(void);
 
+/**
+ * Wait until all transactions committed asynchronously so far
+ * are written to disk. A session commits asynchronously if
+ * box.session.commit_async() is set for it.
+ * @retval 0 - success
+ * @retval -1 - failed, an asynchronous commit of the current
+ * session has been rolled back since the last call, or there
+ * is an active transaction.
+ */
+API_EXPORT int
+box_txn_commit_wait(void);
+
 /**
  * Rollback the current transaction.
  * May fail if called from a nested
@@ -36,8 +36,10 @@
 #include "vy_stmt_iterator.h"
 #include "vy_mem.h"
 #include "vy_cache.h"
+#include "io_limiter.h"
 
 #include <dirent.h>
+#include <sys/stat.h>
 
 #include <bit/bit.h>
 #include <small/rlist.h>
@@ -48,6 +50,7 @@
 #include <small/lsregion.h>
 #include <msgpuck/msgpuck.h>
 #include <coeio_file.h>
+#include <third_party/qsort_arg.h>
 
 #include "trivia/util.h"
 #include "crc32.h"
@@ -92,6 +95,7 @@ struct vy_scheduler;
 struct vy_task;
 struct vy_stat;
 struct vy_squash_queue;
+struct vy_page_cache;
 
 enum vy_status {
 	VINYL_OFFLINE,
@@ -133,6 +137,8 @@ struct vy_env {
 	struct vy_stat      *stat;
 	/** Upsert squash queue */
 	struct vy_squash_queue *squash_queue;
+	/** Cache of decompressed run pages shared by all iterators */
+	struct vy_page_cache *page_cache;
 	/** Tuple format for keys (SELECT) */
 	struct tuple_format *key_format;
 	/** Mempool for struct vy_cursor */
@@ -147,6 +153,15 @@ struct vy_env {
 	struct vy_quota     quota;
 	/** Timer for updating quota watermark. */
 	ev_timer            quota_timer;
+	/**
+	 * Read latency counters as of the last quota timer
+	 * tick and the average read latency observed while
+	 * compaction was not slowed down.
+	 * @sa vy_env_update_compaction_io_weight().
+	 */
+	uint64_t            last_get_count;
+	double              last_get_total;
+	double              avg_get_latency;
 	/** Enviroment for cache subsystem */
 	struct vy_cache_env cache_env;
 };
@@ -379,6 +394,19 @@ struct vy_run_info {
 	/** Bloom filter of all tuples in run */
 	bool has_bloom;
 	struct bloom bloom;
+	/**
+	 * Bloom filter of all distinct key prefixes in run,
+	 * see vy_index.bloom_prefix_def.
+	 */
+	bool has_prefix_bloom;
+	struct bloom prefix_bloom;
+	/**
+	 * zstd dictionary all pages of the run are compressed
+	 * with, sampled from statements of the first page, or
+	 * NULL. @sa key_opts.compression_dictionary.
+	 */
+	char *dict;
+	uint32_t dict_size;
 	/** Pages meta. */
 	struct vy_page_info *page_infos;
 };
@@ -402,6 +430,8 @@ struct vy_page_info {
 	char *min_key;
 	/* row index offset in page */
 	uint32_t row_index_offset;
+	/* key hint array offset in page, 0 if the page has no hints */
+	uint32_t key_hints_offset;
 };
 
 static int
@@ -424,8 +454,19 @@ struct vy_run {
 	int refs;
 	/** Link in range->runs list. */
 	struct rlist in_range;
+	/**
+	 * List of pages of this run stored in the shared page
+	 * cache, linked by vy_page->in_run. Used to purge the
+	 * pages from the cache when the run is deleted.
+	 */
+	struct rlist cached_pages;
 	/** Unique ID of this run. */
 	int64_t id;
+	/**
+	 * Time when the run file was written. Used by the time
+	 * window compaction policy.
+	 */
+	time_t create_time;
 };
 
 struct vy_range {
@@ -631,6 +672,13 @@ struct vy_index {
 	 * space:create_index().
 	 */
 	struct key_def *user_key_def;
+	/**
+	 * A key definition consisting of the first
+	 * key_opts.bloom_prefix parts of user_key_def,
+	 * used to build and check per-run prefix bloom
+	 * filters. NULL if the prefix filter is disabled.
+	 */
+	struct key_def *bloom_prefix_def;
 	/** A tuple format for key_def. */
 	struct tuple_format *surrogate_format;
 	/**
@@ -957,6 +1005,17 @@ vy_read_iterator_next(struct vy_read_iterator *itr, struct tuple **result);
 static void
 vy_read_iterator_close(struct vy_read_iterator *itr);
 
+enum {
+	/**
+	 * Max number of secondary index statements a cursor
+	 * reads ahead to look them up in the primary index
+	 * at once.
+	 */
+	VY_CURSOR_BATCH_MAX = 64,
+	/** Max number of fibers looking up a batch. */
+	VY_CURSOR_LOOKUP_FIBERS = 8,
+};
+
 /** Cursor. */
 struct vy_cursor {
 	/**
@@ -988,6 +1047,100 @@ struct vy_cursor {
 	struct vy_read_iterator iterator;
 	/** Set to true, if need to check statements to match the cursor key. */
 	bool need_check_eq;
+	/**
+	 * Full tuples looked up in the primary index for
+	 * statements read ahead from a secondary index, in the
+	 * secondary index order. Used only by autocommit
+	 * cursors. Such a cursor has no read view, so the batch
+	 * is valid only until the next commit, @sa batch_lsn.
+	 */
+	struct tuple *batch[VY_CURSOR_BATCH_MAX];
+	/** Secondary index statements of the batch, referenced. */
+	struct tuple *batch_stmts[VY_CURSOR_BATCH_MAX];
+	/** Number of tuples in the batch. */
+	int batch_count;
+	/** Position of the next tuple to return from the batch. */
+	int batch_pos;
+	/**
+	 * Size of the next batch. Starts with one statement
+	 * and doubles with every batch, so that short selects
+	 * don't read ahead much.
+	 */
+	int batch_size;
+	/** LSN of the last commit at the time the batch was read. */
+	int64_t batch_lsn;
+	/** Secondary index statement of the last returned tuple. */
+	struct tuple *last_stmt;
+	/**
+	 * Key the iterator was reopened with after a batch had
+	 * been dropped, or NULL.
+	 */
+	struct tuple *restart_key;
+	/** Set when the iterator has nothing more to read. */
+	bool is_eof;
+};
+
+struct vy_page_cache_key {
+	int64_t run_id;
+	uint32_t page_no;
+};
+
+struct mh_vy_page_node_t {
+	struct vy_page_cache_key key;
+	struct vy_page *page;
+};
+
+static inline uint32_t
+vy_page_cache_key_hash(const struct vy_page_cache_key *key)
+{
+	uint64_t h = (uint64_t)key->run_id * 0x9E3779B97F4A7C15ULL;
+	return (uint32_t)(h >> 32) ^ key->page_no;
+}
+
+#define mh_name _vy_page
+#define mh_key_t const struct vy_page_cache_key *
+#define mh_node_t struct mh_vy_page_node_t
+#define mh_arg_t void *
+#define mh_hash_key(a, arg) vy_page_cache_key_hash(a)
+#define mh_hash(a, arg) vy_page_cache_key_hash(&(a)->key)
+#define mh_cmp_key(a, b, arg) \
+	((a)->run_id != (b)->key.run_id || (a)->page_no != (b)->key.page_no)
+#define mh_cmp(a, b, arg) mh_cmp_key(&(a)->key, b, arg)
+#define MH_SOURCE 1
+#include "salad/mhash.h"
+
+/**
+ * Cache of decompressed run pages shared by all run iterators
+ * of the TX thread. A page is looked up by (run id, page number).
+ * Pages currently used by someone are pinned with a reference
+ * counter, unused ones are kept in the LRU list and evicted when
+ * the memory quota shared with the tuple cache is exceeded.
+ * While a page is being read from the disk, it is present in
+ * the cache with is_loading flag set so that other fibers wait
+ * for the read in progress instead of issuing their own.
+ *
+ * The cache is not thread-safe: iterators of worker threads use
+ * private pages.
+ */
+struct vy_page_cache {
+	/** (run_id, page_no) -> struct vy_page. */
+	struct mh_vy_page_t *hash;
+	/** Unused cached pages. The first element is the newest. */
+	struct rlist lru;
+	/** Tuple cache environment, whose quota is shared. */
+	struct vy_cache_env *cache_env;
+	/** Number of cached pages. */
+	size_t count;
+	/** Memory used by cached pages. */
+	size_t used;
+	/**
+	 * Size of pages that are being read ahead or have been
+	 * read ahead and not used yet. Limits the read-ahead
+	 * window of all run iterators together.
+	 */
+	size_t readahead_size;
+	/** Read-ahead fibers in progress, linked by vy_readahead. */
+	struct rlist readahead;
 };
 
 /**
@@ -1374,15 +1527,23 @@ vy_run_new(int64_t id)
 	run->id = id;
 	run->fd = -1;
 	run->refs = 1;
+	run->create_time = 0;
 	rlist_create(&run->in_range);
+	rlist_create(&run->cached_pages);
 	TRASH(&run->info.bloom);
 	run->info.has_bloom = false;
+	TRASH(&run->info.prefix_bloom);
+	run->info.has_prefix_bloom = false;
 	return run;
 }
 
+static void
+vy_page_cache_forget_run(struct vy_run *run);
+
 static void
 vy_run_delete(struct vy_run *run)
 {
+	vy_page_cache_forget_run(run);
 	if (run->fd >= 0 && close(run->fd) < 0)
 		say_syserror("close failed");
 	if (run->info.page_infos != NULL) {
@@ -1393,6 +1554,9 @@ vy_run_delete(struct vy_run *run)
 	}
 	if (run->info.has_bloom)
 		bloom_destroy(&run->info.bloom, runtime.quota);
+	if (run->info.has_prefix_bloom)
+		bloom_destroy(&run->info.prefix_bloom, runtime.quota);
+	free(run->info.dict);
 	TRASH(run);
 	free(run);
 }
@@ -2111,10 +2275,70 @@ vy_row_index_encode(const uint32_t *row_index, uint32_t count,
 	return xrow->bodycnt >= 0 ? 0 : -1;
 }
 
+/**
+ * Encode the array of key hints of page statements as xrow.
+ * The hints are stored next to the row index so that a binary
+ * search in a page can skip decoding most of statements.
+ *
+ * @param key_hints key hints
+ * @param count number of hints
+ * @param[out] xrow xrow to fill.
+ * @retval 0 for success
+ * @retval -1 for error
+ */
+static int
+vy_key_hints_encode(const hint_t *key_hints, uint32_t count,
+		    struct xrow_header *xrow)
+{
+	memset(xrow, 0, sizeof(*xrow));
+	xrow->type = IPROTO_REPLACE;
+
+	struct request request;
+	request_create(&request, IPROTO_REPLACE);
+	size_t tuple_size = mp_sizeof_array(1) +
+			    mp_sizeof_bin(sizeof(hint_t) * count);
+	char *tuple = region_alloc(&fiber()->gc, tuple_size);
+	if (tuple == NULL) {
+		diag_set(OutOfMemory, tuple_size, "region", "key hints");
+		return -1;
+	}
+	request.tuple = tuple;
+	tuple = mp_encode_array(tuple, 1);
+	tuple = mp_encode_binl(tuple, sizeof(hint_t) * count);
+	for (uint32_t i = 0; i < count; ++i)
+		tuple = mp_store_u64(tuple, key_hints[i]);
+	request.tuple_end = tuple;
+	assert(request.tuple_end == request.tuple + tuple_size);
+	xrow->bodycnt = request_encode(&request, xrow->body);
+	return xrow->bodycnt >= 0 ? 0 : -1;
+}
+
+/**
+ * Append the data of a statement to the run dictionary,
+ * as much as fits into max_size bytes.
+ */
+static void
+vy_run_dict_add(struct vy_run_info *run_info, const struct tuple *stmt,
+		uint32_t max_size)
+{
+	assert(run_info->dict_size <= max_size);
+	uint32_t size;
+	const char *data = tuple_data_range(stmt, &size);
+	size = MIN(size, max_size - run_info->dict_size);
+	memcpy(run_info->dict + run_info->dict_size, data, size);
+	run_info->dict_size += size;
+}
+
 /**
  * Write statements from the iterator to a new page in the run,
  * update page and run statistics.
  *
+ * If @prefix_bs is not NULL, hashes of key prefixes defined by
+ * @prefix_def are added to it. Since statements are sorted, equal
+ * prefixes go in a row, so a hash is only added when it differs
+ * from the previous one to keep the estimate of the number of
+ * distinct values close to the real one.
+ *
  *  @retval  1 all is ok, the iterator is finished
  *  @retval  0 all is ok, the iterator isn't finished
  *  @retval -1 error occurred
@@ -2123,8 +2347,10 @@ static int
 vy_run_write_page(struct vy_run_info *run_info, struct xlog *data_xlog,
 		  struct vy_write_iterator *wi, const char *split_key,
 		  uint32_t *page_info_capacity, struct bloom_spectrum *bs,
+		  struct bloom_spectrum *prefix_bs,
 		  struct tuple **curr_stmt, const struct key_def *key_def,
-		  const struct key_def *user_key_def)
+		  const struct key_def *user_key_def,
+		  const struct key_def *prefix_def)
 {
 	assert(curr_stmt != NULL);
 	assert(*curr_stmt != NULL);
@@ -2132,6 +2358,9 @@ vy_run_write_page(struct vy_run_info *run_info, struct xlog *data_xlog,
 	/* row offsets accumulator */
 	struct ibuf row_index_buf;
 	ibuf_create(&row_index_buf, &cord()->slabc, sizeof(uint32_t) * 4096);
+	/* key hints accumulator */
+	struct ibuf key_hints_buf;
+	ibuf_create(&key_hints_buf, &cord()->slabc, sizeof(hint_t) * 4096);
 
 	if (run_info->count >= *page_info_capacity) {
 		uint32_t cap = *page_info_capacity > 0 ?
@@ -2151,6 +2380,8 @@ vy_run_write_page(struct vy_run_info *run_info, struct xlog *data_xlog,
 	struct vy_page_info *page = run_info->page_infos + run_info->count;
 	vy_page_info_create(page, data_xlog->offset, key_def, *curr_stmt);
 	bool end_of_run = false;
+	bool has_prefix_hash = false;
+	uint32_t prefix_hash = 0;
 	xlog_tx_begin(data_xlog);
 
 	do {
@@ -2164,9 +2395,28 @@ vy_run_write_page(struct vy_run_info *run_info, struct xlog *data_xlog,
 		*offset = page->unpacked_size;
 
 		struct tuple *stmt = *curr_stmt;
+		hint_t *hint = (hint_t *) ibuf_alloc(&key_hints_buf,
+						     sizeof(hint_t));
+		if (hint == NULL) {
+			diag_set(OutOfMemory, sizeof(hint_t),
+				 "ibuf", "key hints");
+			goto error_rollback;
+		}
+		*hint = vy_stmt_hint(stmt, key_def);
+
 		if (vy_run_dump_stmt(stmt, data_xlog, page, key_def) != 0)
 			goto error_rollback;
+		if (run_info->count == 0 && run_info->dict != NULL)
+			vy_run_dict_add(run_info, stmt,
+					key_def->opts.compression_dictionary);
 		bloom_spectrum_add(bs, tuple_hash(stmt, user_key_def));
+		if (prefix_bs != NULL) {
+			uint32_t hash = tuple_hash(stmt, prefix_def);
+			if (!has_prefix_hash || hash != prefix_hash)
+				bloom_spectrum_add(prefix_bs, hash);
+			has_prefix_hash = true;
+			prefix_hash = hash;
+		}
 
 		if (vy_write_iterator_next(wi, curr_stmt))
 			goto error_rollback;
@@ -2196,6 +2446,31 @@ vy_run_write_page(struct vy_run_info *run_info, struct xlog *data_xlog,
 
 	page->unpacked_size += written;
 
+	/* Save offset to key hints */
+	page->key_hints_offset = page->unpacked_size;
+
+	/* Write key hints */
+	const hint_t *key_hints = (const hint_t *) key_hints_buf.rpos;
+	assert(ibuf_used(&key_hints_buf) == sizeof(hint_t) * page->count);
+	if (vy_key_hints_encode(key_hints, page->count, &xrow) < 0)
+		goto error_rollback;
+
+	written = xlog_write_row(data_xlog, &xrow);
+	if (written < 0)
+		goto error_rollback;
+
+	page->unpacked_size += written;
+
+	/*
+	 * The dictionary is complete once the first page is
+	 * filled, all pages including the first one are
+	 * compressed with it.
+	 */
+	if (run_info->count == 0 && run_info->dict != NULL) {
+		data_xlog->zdict = run_info->dict;
+		data_xlog->zdict_size = run_info->dict_size;
+	}
+
 	written = xlog_tx_commit(data_xlog);
 	if (written == 0)
 		written = xlog_flush(data_xlog);
@@ -2214,12 +2489,14 @@ vy_run_write_page(struct vy_run_info *run_info, struct xlog *data_xlog,
 	run_info->size += page->size;
 	run_info->keys += page->count;
 
+	ibuf_destroy(&key_hints_buf);
 	ibuf_destroy(&row_index_buf);
 	return !end_of_run ? 0: 1;
 
 error_rollback:
 	xlog_tx_rollback(data_xlog);
 error_row_index:
+	ibuf_destroy(&key_hints_buf);
 	ibuf_destroy(&row_index_buf);
 	return -1;
 }
@@ -2235,8 +2512,11 @@ static int
 vy_run_write_data(struct vy_run *run, const char *dirpath,
 		  struct vy_write_iterator *wi, struct tuple **curr_stmt,
 		  const char *end_key, struct bloom_spectrum *bs,
+		  struct bloom_spectrum *prefix_bs,
 		  const struct key_def *key_def,
-		  const struct key_def *user_key_def)
+		  const struct key_def *user_key_def,
+		  const struct key_def *prefix_def,
+		  enum io_class io_class)
 {
 	assert(curr_stmt != NULL);
 	assert(*curr_stmt != NULL);
@@ -2253,6 +2533,20 @@ vy_run_write_data(struct vy_run *run, const char *dirpath,
 	};
 	if (xlog_create(&data_xlog, path, &meta) < 0)
 		return -1;
+	data_xlog.io_limiter = &io_limiter;
+	data_xlog.io_class = io_class;
+	data_xlog.compression_level = key_def->opts.compression_level;
+
+	assert(run_info->dict == NULL);
+	if (key_def->opts.compression_dictionary > 0) {
+		size_t size = key_def->opts.compression_dictionary;
+		run_info->dict = malloc(size);
+		if (run_info->dict == NULL) {
+			diag_set(OutOfMemory, size, "malloc",
+				 "compression dictionary");
+			goto err;
+		}
+	}
 
 	/*
 	 * Read from the iterator until it's exhausted or
@@ -2265,7 +2559,8 @@ vy_run_write_data(struct vy_run *run, const char *dirpath,
 	do {
 		rc = vy_run_write_page(run_info, &data_xlog, wi,
 				       end_key, &page_infos_capacity, bs,
-				       curr_stmt, key_def, user_key_def);
+				       prefix_bs, curr_stmt, key_def,
+				       user_key_def, prefix_def);
 		if (rc < 0)
 			goto err;
 		fiber_gc();
@@ -2277,6 +2572,7 @@ vy_run_write_data(struct vy_run *run, const char *dirpath,
 		goto err;
 
 	run->fd = data_xlog.fd;
+	run->create_time = time(NULL);
 	xlog_close(&data_xlog, true);
 	fiber_gc();
 
@@ -2293,14 +2589,16 @@ enum vy_request_page_key {
 	VY_PAGE_REQUEST_COUNT = 1,
 	VY_PAGE_MIN_KEY = 2,
 	VY_PAGE_DATA_SIZE = 3,
-	VY_PAGE_ROW_INDEX_OFFSET = 4
+	VY_PAGE_ROW_INDEX_OFFSET = 4,
+	VY_PAGE_KEY_HINTS_OFFSET = 5
 };
 
 const char *vy_page_info_key_strs[] = {
 	"count",
 	"min",
 	"data size",
-	"row index"
+	"row index",
+	"key hints"
 };
 
 const uint64_t vy_page_info_key_map = (1 << VY_PAGE_REQUEST_COUNT) |
@@ -2333,14 +2631,16 @@ vy_page_info_encode(const struct vy_page_info *page_info,
 	mp_next(&tmp);
 	min_key_size = tmp - page_info->min_key;
 
+	/* key hints are optional */
+	uint32_t map_size = page_info->key_hints_offset != 0 ? 5 : 4;
+
 	/* calc tuple size */
 	uint32_t size;
 	/* 3 items: page offset, size, and map */
 	size = mp_sizeof_array(3) +
 	       mp_sizeof_uint(page_info->offset) +
 	       mp_sizeof_uint(page_info->size) +
-	       /* page map contains 4 items */
-	       mp_sizeof_map(4) +
+	       mp_sizeof_map(map_size) +
 	       mp_sizeof_uint(VY_PAGE_REQUEST_COUNT) +
 	       mp_sizeof_uint(page_info->count) +
 	       mp_sizeof_uint(VY_PAGE_MIN_KEY) +
@@ -2349,6 +2649,10 @@ vy_page_info_encode(const struct vy_page_info *page_info,
 	       mp_sizeof_uint(page_info->unpacked_size) +
 	       mp_sizeof_uint(VY_PAGE_ROW_INDEX_OFFSET) +
 	       mp_sizeof_uint(page_info->row_index_offset);
+	if (page_info->key_hints_offset != 0) {
+		size += mp_sizeof_uint(VY_PAGE_KEY_HINTS_OFFSET) +
+			mp_sizeof_uint(page_info->key_hints_offset);
+	}
 
 	char *pos = region_alloc(region, size);
 	if (pos == NULL) {
@@ -2360,7 +2664,7 @@ vy_page_info_encode(const struct vy_page_info *page_info,
 	pos = mp_encode_array(pos, 3);
 	pos = mp_encode_uint(pos, page_info->offset);
 	pos = mp_encode_uint(pos, page_info->size);
-	pos = mp_encode_map(pos, 4);
+	pos = mp_encode_map(pos, map_size);
 	pos = mp_encode_uint(pos, VY_PAGE_REQUEST_COUNT);
 	pos = mp_encode_uint(pos, page_info->count);
 	pos = mp_encode_uint(pos, VY_PAGE_MIN_KEY);
@@ -2370,6 +2674,11 @@ vy_page_info_encode(const struct vy_page_info *page_info,
 	pos = mp_encode_uint(pos, page_info->unpacked_size);
 	pos = mp_encode_uint(pos, VY_PAGE_ROW_INDEX_OFFSET);
 	pos = mp_encode_uint(pos, page_info->row_index_offset);
+	if (page_info->key_hints_offset != 0) {
+		pos = mp_encode_uint(pos, VY_PAGE_KEY_HINTS_OFFSET);
+		pos = mp_encode_uint(pos, page_info->key_hints_offset);
+	}
+	assert(pos == request.tuple + size);
 	request.tuple_end = pos;
 
 	memset(xrow, 0, sizeof(*xrow));
@@ -2432,6 +2741,9 @@ vy_page_info_decode(struct vy_page_info *page, const struct xrow_header *xrow)
 		case VY_PAGE_ROW_INDEX_OFFSET:
 			page->row_index_offset = mp_decode_uint(&pos);
 			break;
+		case VY_PAGE_KEY_HINTS_OFFSET:
+			page->key_hints_offset = mp_decode_uint(&pos);
+			break;
 		default:
 			diag_set(ClientError, ER_VINYL, "Can't decode page meta "
 				 "unknown page meta key %d", key);
@@ -2459,13 +2771,17 @@ enum vy_request_run_key {
 	VY_RUN_MAX_LSN = 2,
 	VY_RUN_PAGE_COUNT = 3,
 	VY_RUN_BLOOM = 4,
+	VY_RUN_PREFIX_BLOOM = 5,
+	VY_RUN_DICTIONARY = 6,
 };
 
 const char *vy_run_info_key_strs[] = {
 	"min lsn",
 	"max lsn",
 	"page count",
-	"bloom filter"
+	"bloom filter",
+	"prefix bloom filter",
+	"compression dictionary"
 };
 
 const uint64_t vy_run_info_key_map = (1 << VY_RUN_MIN_LSN) |
@@ -2549,9 +2865,15 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 	assert(run_info->has_bloom);
 	size_t size = mp_sizeof_array(1);
 	/*
-	 * run map size: min lsn, max lsn, page count
-	 */
-	size += mp_sizeof_map(4);
+	 * run map size: min lsn, max lsn, page count, bloom filter,
+	 * an optional prefix bloom filter and an optional dictionary
+	 */
+	uint32_t map_size = 4;
+	if (run_info->has_prefix_bloom)
+		map_size++;
+	if (run_info->dict != NULL)
+		map_size++;
+	size += mp_sizeof_map(map_size);
 	size += mp_sizeof_uint(VY_RUN_MIN_LSN) +
 		mp_sizeof_uint(run_info->min_lsn);
 	size += mp_sizeof_uint(VY_RUN_MAX_LSN) +
@@ -2560,6 +2882,12 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 		mp_sizeof_uint(run_info->count);
 	size += mp_sizeof_uint(VY_RUN_BLOOM) +
 		vy_run_bloom_encode_size(&run_info->bloom);
+	if (run_info->has_prefix_bloom)
+		size += mp_sizeof_uint(VY_RUN_PREFIX_BLOOM) +
+			vy_run_bloom_encode_size(&run_info->prefix_bloom);
+	if (run_info->dict != NULL)
+		size += mp_sizeof_uint(VY_RUN_DICTIONARY) +
+			mp_sizeof_bin(run_info->dict_size);
 
 	char *tuple = region_alloc(&fiber()->gc, size);
 	if (tuple == NULL) {
@@ -2569,7 +2897,7 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 	char *pos = tuple;
 	/* encode values */
 	pos = mp_encode_array(pos, 1);
-	pos = mp_encode_map(pos, 4);
+	pos = mp_encode_map(pos, map_size);
 	pos = mp_encode_uint(pos, VY_RUN_MIN_LSN);
 	pos = mp_encode_uint(pos, run_info->min_lsn);
 	pos = mp_encode_uint(pos, VY_RUN_MAX_LSN);
@@ -2578,6 +2906,14 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 	pos = mp_encode_uint(pos, run_info->count);
 	pos = mp_encode_uint(pos, VY_RUN_BLOOM);
 	pos = vy_run_bloom_encode(pos, &run_info->bloom);
+	if (run_info->has_prefix_bloom) {
+		pos = mp_encode_uint(pos, VY_RUN_PREFIX_BLOOM);
+		pos = vy_run_bloom_encode(pos, &run_info->prefix_bloom);
+	}
+	if (run_info->dict != NULL) {
+		pos = mp_encode_uint(pos, VY_RUN_DICTIONARY);
+		pos = mp_encode_bin(pos, run_info->dict, run_info->dict_size);
+	}
 
 	/* put tuple in a replace request to run's space */
 	struct request request;
@@ -2624,6 +2960,8 @@ vy_run_info_decode(struct vy_run_info *run_info,
 	uint64_t key_map = vy_run_info_key_map;
 	uint32_t map_size = mp_decode_map(&pos);
 	uint32_t map_item;
+	const char *dict;
+	uint32_t dict_size;
 	/* decode run values */
 	for (map_item = 0; map_item < map_size; ++map_item) {
 		uint32_t key = mp_decode_uint(&pos);
@@ -2644,6 +2982,24 @@ vy_run_info_decode(struct vy_run_info *run_info,
 			else
 				return -1;
 			break;
+		case VY_RUN_PREFIX_BLOOM:
+			if (vy_run_bloom_decode(&pos,
+						&run_info->prefix_bloom) == 0)
+				run_info->has_prefix_bloom = true;
+			else
+				return -1;
+			break;
+		case VY_RUN_DICTIONARY:
+			dict = mp_decode_bin(&pos, &dict_size);
+			run_info->dict = malloc(MAX(dict_size, 1));
+			if (run_info->dict == NULL) {
+				diag_set(OutOfMemory, dict_size, "malloc",
+					 "compression dictionary");
+				return -1;
+			}
+			memcpy(run_info->dict, dict, dict_size);
+			run_info->dict_size = dict_size;
+			break;
 		default:
 			diag_set(ClientError, ER_VINYL,
 				 "Unknown run meta key %d", key);
@@ -2844,6 +3200,9 @@ vy_run_recover(struct vy_run *run, const char *dir)
 	}
 	run->fd = cursor.fd;
 	xlog_cursor_close(&cursor, true);
+	/* Run files are never modified after they are written. */
+	struct stat st;
+	run->create_time = fstat(run->fd, &st) == 0 ? st.st_mtime : time(NULL);
 	return 0;
 
 fail_close:
@@ -2852,6 +3211,49 @@ fail:
 	return -1;
 }
 
+int
+vy_run_read_dictionary(const char *path, char **dict, size_t *dict_size)
+{
+	struct vy_run_info info;
+	memset(&info, 0, sizeof(info));
+	struct xlog_cursor cursor;
+	if (xlog_cursor_open(&cursor, path))
+		return -1;
+
+	int rc = -1;
+	if (strcmp(cursor.meta.filetype, XLOG_META_TYPE_INDEX) != 0) {
+		diag_set(ClientError, ER_INVALID_XLOG_TYPE,
+			 XLOG_META_TYPE_INDEX, cursor.meta.filetype);
+		goto out;
+	}
+	/* The run header is the first row of the first tx. */
+	struct xrow_header xrow;
+	int next_rc = xlog_cursor_next_tx(&cursor);
+	if (next_rc == 0)
+		next_rc = xlog_cursor_next_row(&cursor, &xrow);
+	if (next_rc != 0) {
+		if (next_rc > 0) {
+			diag_set(ClientError, ER_VINYL,
+				 "Run meta file is empty");
+		}
+		goto out;
+	}
+	if (vy_run_info_decode(&info, &xrow) != 0)
+		goto out;
+	*dict = info.dict;
+	*dict_size = info.dict_size;
+	info.dict = NULL;
+	rc = 0;
+out:
+	if (info.has_bloom)
+		bloom_destroy(&info.bloom, runtime.quota);
+	if (info.has_prefix_bloom)
+		bloom_destroy(&info.prefix_bloom, runtime.quota);
+	free(info.dict);
+	xlog_cursor_close(&cursor, false);
+	return rc;
+}
+
 /* Move the active in-memory index of a range to the frozen list. */
 static void
 vy_range_freeze_mem(struct vy_range *range)
@@ -3005,7 +3407,7 @@ static int
 vy_range_write_run(struct vy_range *range, struct vy_write_iterator *wi,
 		   struct tuple **stmt, size_t *written,
 		   size_t max_output_count, double bloom_fpr,
-		   uint64_t *dumped_statements)
+		   uint64_t *dumped_statements, enum io_class io_class)
 {
 	assert(stmt != NULL);
 
@@ -3027,14 +3429,28 @@ vy_range_write_run(struct vy_range *range, struct vy_write_iterator *wi,
 	struct bloom_spectrum bs;
 	bloom_spectrum_create(&bs, max_output_count, bloom_fpr, runtime.quota);
 
+	const struct key_def *prefix_def = index->bloom_prefix_def;
+	struct bloom_spectrum prefix_bs;
+	if (prefix_def != NULL)
+		bloom_spectrum_create(&prefix_bs, max_output_count,
+				      bloom_fpr, runtime.quota);
+
 	if (vy_run_write_data(run, index->path, wi, stmt, range->end, &bs,
-			      key_def, user_key_def) != 0)
+			      prefix_def != NULL ? &prefix_bs : NULL,
+			      key_def, user_key_def, prefix_def,
+			      io_class) != 0)
 		return -1;
 
 	bloom_spectrum_choose(&bs, &run->info.bloom);
 	run->info.has_bloom = true;
 	bloom_spectrum_destroy(&bs, runtime.quota);
 
+	if (prefix_def != NULL) {
+		bloom_spectrum_choose(&prefix_bs, &run->info.prefix_bloom);
+		run->info.has_prefix_bloom = true;
+		bloom_spectrum_destroy(&prefix_bs, runtime.quota);
+	}
+
 	if (vy_run_write_index(run, index->path) != 0)
 		return -1;
 
@@ -3113,7 +3529,7 @@ vy_range_needs_split(struct vy_range *range, const char **p_split_key)
  * this level and all preceding levels.
  */
 static void
-vy_range_update_compact_priority(struct vy_range *range)
+vy_range_leveled_compact_priority(struct vy_range *range)
 {
 	struct key_opts *opts = &range->index->key_def->opts;
 
@@ -3187,6 +3603,111 @@ vy_range_update_compact_priority(struct vy_range *range)
 	}
 }
 
+/**
+ * Size-tiered compaction. Runs of similar size are grouped in
+ * tiers: a run joins the current tier unless it is more than
+ * run_size_ratio times larger than the first run of the tier,
+ * in which case it starts a new tier. When the number of runs
+ * in a tier exceeds run_count_per_level, the tier is compacted
+ * along with all upper tiers and in-memory indexes.
+ *
+ * Unlike the leveled policy, a tier isn't compacted ahead of
+ * time to make room for a compacted upper tier, so each run is
+ * rewritten roughly once per tier. This suits write-heavy
+ * spaces at the cost of more runs to read from.
+ *
+ * Only the @run_count newest runs are considered.
+ */
+static void
+vy_range_tiered_compact_priority(struct vy_range *range, int run_count)
+{
+	struct key_opts *opts = &range->index->key_def->opts;
+
+	assert(opts->run_count_per_level > 0);
+	assert(opts->run_size_ratio > 1);
+
+	range->compact_priority = 0;
+
+	/* Total number of checked runs. */
+	int total_run_count = 0;
+	/* The number of runs in the current tier. */
+	uint32_t tier_run_count = 0;
+	/* Size of the first run of the current tier. */
+	uint64_t tier_run_size = 0;
+
+	struct vy_run *run;
+	rlist_foreach_entry(run, &range->runs, in_range) {
+		if (total_run_count == run_count)
+			break;
+		uint64_t run_size = vy_run_size(run);
+		total_run_count++;
+		if (tier_run_count > 0 &&
+		    run_size <= tier_run_size * opts->run_size_ratio) {
+			tier_run_count++;
+		} else {
+			/*
+			 * The run is too big for the current
+			 * tier, start a new one. Runs smaller
+			 * than a dump all go to the first tier.
+			 */
+			tier_run_count = 1;
+			tier_run_size = MAX(run_size, range->max_dump_size);
+		}
+		if (tier_run_count > opts->run_count_per_level)
+			range->compact_priority = total_run_count;
+	}
+}
+
+/**
+ * Time window compaction, for append-mostly data like time
+ * series. Time is divided into windows of compaction_window
+ * seconds. Runs created in the current window are compacted
+ * with the size-tiered policy, while runs of previous windows,
+ * which hold data that is not updated any more, are never
+ * rewritten. Since a run leaves the current window without the
+ * range being touched, the scheduler recomputes the priority of
+ * such a range before compacting it.
+ */
+static void
+vy_range_time_window_compact_priority(struct vy_range *range)
+{
+	struct key_opts *opts = &range->index->key_def->opts;
+	assert(opts->compaction_window > 0);
+
+	int64_t window = time(NULL) / opts->compaction_window;
+	int run_count = 0;
+	struct vy_run *run;
+	rlist_foreach_entry(run, &range->runs, in_range) {
+		if (run->create_time / opts->compaction_window != window)
+			break;
+		run_count++;
+	}
+	vy_range_tiered_compact_priority(range, run_count);
+}
+
+/**
+ * Compute the number of runs of a range to compact according to
+ * the compaction policy of the index and store it in
+ * @compact_priority.
+ */
+static void
+vy_range_update_compact_priority(struct vy_range *range)
+{
+	switch (range->index->key_def->opts.compaction) {
+	case COMPACTION_LEVELED:
+		vy_range_leveled_compact_priority(range);
+		break;
+	case COMPACTION_TIERED:
+		vy_range_tiered_compact_priority(range, range->run_count);
+		break;
+	case COMPACTION_TIME_WINDOW:
+		vy_range_time_window_compact_priority(range);
+		break;
+	default:
+		unreachable();
+	}
+}
+
 /**
  * Check if a range should be coalesced with one or more its neighbors.
  * If it should, return true and set @p_first and @p_last to the first
@@ -3864,7 +4385,8 @@ vy_task_dump_execute(struct vy_task *task)
 	if (vy_write_iterator_next(wi, &stmt) != 0 ||
 	    vy_range_write_run(range, wi, &stmt, &task->dump_size,
 			       task->max_output_count, task->bloom_fpr,
-			       &task->dumped_statements) != 0) {
+			       &task->dumped_statements,
+			       IO_CLASS_DUMP) != 0) {
 		vy_write_iterator_cleanup(wi);
 		return -1;
 	}
@@ -4031,7 +4553,7 @@ vy_task_split_execute(struct vy_task *task)
 		}
 		if (vy_range_write_run(r, wi, &stmt, &task->dump_size,
 				       task->max_output_count, task->bloom_fpr,
-				       &unused) != 0)
+				       &unused, IO_CLASS_COMPACTION) != 0)
 			goto error;
 	}
 	vy_write_iterator_cleanup(wi);
@@ -4272,7 +4794,7 @@ vy_task_compact_execute(struct vy_task *task)
 	if (vy_write_iterator_next(wi, &stmt) != 0 ||
 	    vy_range_write_run(range, wi, &stmt, &task->dump_size,
 			       task->max_output_count, task->bloom_fpr,
-			       &unused) != 0) {
+			       &unused, IO_CLASS_COMPACTION) != 0) {
 		vy_write_iterator_cleanup(wi);
 		return -1;
 	}
@@ -4479,6 +5001,9 @@ heap_compact_less(struct heap_node *a, struct heap_node *b)
 
 #include "salad/heap.h"
 
+#undef HEAP_LESS
+#undef HEAP_NAME
+
 struct vy_scheduler {
 	pthread_mutex_t        mutex;
 	struct vy_env    *env;
@@ -4532,6 +5057,8 @@ struct vy_scheduler {
 	ev_tstamp timeout;
 	/** Set if the scheduler is throttled due to errors. */
 	bool is_throttled;
+	/** Set if dumps are not throttled by the I/O limiter. */
+	bool is_dump_urgent;
 
 	/**
 	 * List of all non-empty in-memory indexes.
@@ -4560,6 +5087,20 @@ vy_scheduler_stop_workers(struct vy_scheduler *scheduler);
 static int
 vy_scheduler_f(va_list va);
 
+/**
+ * Once memory usage exceeds the watermark, transactions are
+ * about to be throttled until memory is dumped, so dumps must
+ * not wait for the I/O limiter.
+ */
+static void
+vy_scheduler_set_dump_urgent(struct vy_scheduler *scheduler, bool is_urgent)
+{
+	if (scheduler->is_dump_urgent == is_urgent)
+		return;
+	scheduler->is_dump_urgent = is_urgent;
+	io_limiter_set_urgent(&io_limiter, IO_CLASS_DUMP, is_urgent);
+}
+
 static void
 vy_scheduler_quota_cb(enum vy_quota_event event, void *arg)
 {
@@ -4570,12 +5111,15 @@ vy_scheduler_quota_cb(enum vy_quota_event event, void *arg)
 
 	switch (event) {
 	case VY_QUOTA_EXCEEDED:
+		vy_scheduler_set_dump_urgent(scheduler, true);
 		ipc_cond_signal(&scheduler->scheduler_cond);
 		break;
 	case VY_QUOTA_THROTTLED:
 		ipc_cond_wait(&scheduler->quota_cond);
 		break;
 	case VY_QUOTA_RELEASED:
+		vy_scheduler_set_dump_urgent(scheduler,
+			vy_quota_is_exceeded(&scheduler->env->quota));
 		ipc_cond_broadcast(&scheduler->quota_cond);
 		break;
 	default:
@@ -4726,10 +5270,29 @@ vy_scheduler_peek_compact(struct vy_scheduler *scheduler,
 			  struct vy_task **ptask)
 {
 	*ptask = NULL;
-	struct heap_node *pn = vy_compact_heap_top(&scheduler->compact_heap);
+	struct heap_node *pn;
+	struct vy_range *range;
+retry:
+	pn = vy_compact_heap_top(&scheduler->compact_heap);
 	if (pn == NULL)
 		return 0; /* nothing to do */
-	struct vy_range *range = container_of(pn, struct vy_range, in_compact);
+	range = container_of(pn, struct vy_range, in_compact);
+	if (range->index->key_def->opts.compaction == COMPACTION_TIME_WINDOW) {
+		/*
+		 * Runs drop out of the current time window as time
+		 * passes, not when the range is dumped or compacted,
+		 * so the priority stored in the heap may be stale.
+		 * Recompute it and pick another range if it went
+		 * down, lest we rewrite runs of a past window.
+		 */
+		int old_priority = range->compact_priority;
+		vy_range_update_compact_priority(range);
+		if (range->compact_priority != old_priority) {
+			vy_compact_heap_update(&scheduler->compact_heap,
+					       &range->in_compact);
+			goto retry;
+		}
+	}
 	if (range->compact_priority == 0)
 		return 0; /* nothing to do */
 	*ptask = vy_task_compact_new(&scheduler->task_pool, range);
@@ -5305,6 +5868,13 @@ vy_info_append_performance(struct vy_env *env, struct vy_info_handler *h)
 	vy_info_append_u64(h, "used", ce->quota.used);
 	vy_info_table_end(h);
 
+	struct vy_page_cache *pc = env->page_cache;
+	vy_info_table_begin(h, "page_cache");
+	vy_info_append_u64(h, "count", pc->count);
+	vy_info_append_u64(h, "used", pc->used);
+	vy_info_append_u64(h, "readahead", pc->readahead_size);
+	vy_info_table_end(h);
+
 	vy_info_table_begin(h, "iterator");
 	vy_info_append_iterator_stat(h, "txw", &stat->txw_stat);
 	vy_info_append_iterator_stat(h, "cache", &stat->cache_stat);
@@ -5577,6 +6147,22 @@ vy_index_new(struct vy_env *e, struct key_def *user_key_def,
 			goto fail_key_def;
 	}
 
+	uint32_t bloom_prefix = user_key_def->opts.bloom_prefix;
+	if (bloom_prefix > 0) {
+		assert(bloom_prefix < user_key_def->part_count);
+		index->bloom_prefix_def =
+			key_def_new(user_key_def->space_id, user_key_def->iid,
+				    user_key_def->name, user_key_def->type,
+				    &user_key_def->opts, bloom_prefix);
+		if (index->bloom_prefix_def == NULL)
+			goto fail_bloom_prefix_def;
+		for (uint32_t i = 0; i < bloom_prefix; i++) {
+			const struct key_part *part = &user_key_def->parts[i];
+			key_def_set_part(index->bloom_prefix_def, i,
+					 part->fieldno, part->type);
+		}
+	}
+
 	struct rlist key_list;
 	rlist_create(&key_list);
 	rlist_add_entry(&key_list, index->key_def, link);
@@ -5655,6 +6241,9 @@ fail_space_format_with_colmask:
 fail_upsert_format:
 	tuple_format_ref(index->surrogate_format, -1);
 fail_format:
+	if (index->bloom_prefix_def != NULL)
+		key_def_delete(index->bloom_prefix_def);
+fail_bloom_prefix_def:
 	if (user_key_def->iid > 0)
 		key_def_delete(index->key_def);
 fail_key_def:
@@ -5737,6 +6326,8 @@ vy_index_delete(struct vy_index *index)
 	tuple_format_ref(index->surrogate_format, -1);
 	tuple_format_ref(index->space_format_with_colmask, -1);
 	tuple_format_ref(index->upsert_format, -1);
+	if (index->bloom_prefix_def != NULL)
+		key_def_delete(index->bloom_prefix_def);
 	if (index->key_def->iid > 0)
 		key_def_delete(index->key_def);
 	key_def_delete(index->user_key_def);
@@ -6324,6 +6915,50 @@ error:
 	return -1;
 }
 
+/**
+ * Execute REPLACE in a space with deferred deletes: the new
+ * tuple is written to all indexes without looking up the old
+ * one. Keys of the old tuple are left in the secondary indexes
+ * and skipped on read as stale. The space must not have unique
+ * secondary indexes and on_replace triggers.
+ * @param tx      Current transaction.
+ * @param space   Vinyl space.
+ * @param request Request with the tuple data.
+ * @param stmt    Statement for triggers is filled with the new
+ *                statement.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory error OR the primary index is not found.
+ */
+static inline int
+vy_replace_blind(struct vy_tx *tx, struct space *space,
+		 struct request *request, struct txn_stmt *stmt)
+{
+	assert(tx != NULL && tx->state == VINYL_TX_READY);
+	assert(space->def.opts.defer_deletes);
+	assert(rlist_empty(&space->on_replace));
+	if (vy_index_find(space, 0) == NULL)
+		return -1;
+	struct tuple *new_stmt =
+		vy_stmt_new_replace(space->format, request->tuple,
+				    request->tuple_end);
+	if (new_stmt == NULL)
+		return -1;
+	for (uint32_t iid = 0; iid < space->index_count; ++iid) {
+		struct vy_index *index = vy_index(space->index[iid]);
+		assert(iid == 0 || !index->user_key_def->opts.is_unique);
+		if (vy_tx_set(tx, index, new_stmt) != 0) {
+			tuple_unref(new_stmt);
+			return -1;
+		}
+	}
+	if (stmt != NULL)
+		stmt->new_tuple = new_stmt;
+	else
+		tuple_unref(new_stmt);
+	return 0;
+}
+
 /**
  * Check that the key can be used for search in a unique index.
  * @param  index      Index for checking.
@@ -6367,7 +7002,9 @@ vy_unique_key_validate(struct vy_index *index, const char *key,
  * @param index     Secondary index.
  * @param partial   Partial tuple from the secondary \p index.
  * @param[out] full The full tuple is stored here. Must be
- *                  unreferenced after usage.
+ *                  unreferenced after usage. Set to NULL if
+ *                  the tuple is not found or the secondary
+ *                  index entry is stale.
  *
  * @retval  0 Success.
  * @retval -1 Memory error.
@@ -6393,7 +7030,20 @@ vy_index_full_by_stmt(struct vy_tx *tx, struct vy_index *index,
 	struct space *space = index->space;
 	struct vy_index *pk = vy_index_find(space, 0);
 	assert(pk != NULL);
-	return vy_index_get(tx, pk, pkey, part_count, full);
+	if (vy_index_get(tx, pk, pkey, part_count, full) != 0)
+		return -1;
+	/*
+	 * If the space defers deletes, the secondary index may
+	 * still store keys of an overwritten or deleted tuple.
+	 * Such an entry is stale unless the tuple found in the
+	 * primary index has the same secondary key.
+	 */
+	if (space->def.opts.defer_deletes && *full != NULL &&
+	    vy_tuple_compare(*full, partial, index->key_def) != 0) {
+		tuple_unref(*full);
+		*full = NULL;
+	}
+	return 0;
 }
 
 /**
@@ -6473,7 +7123,12 @@ vy_delete(struct vy_tx *tx, struct txn_stmt *stmt, struct space *space,
 	struct vy_index *index = vy_index_find_unique(space, request->index_id);
 	if (index == NULL)
 		return -1;
-	bool has_secondary = space->index_count > 1;
+	/*
+	 * If the space defers deletes, keys of the deleted tuple
+	 * are left in secondary indexes and skipped on read.
+	 */
+	bool has_secondary = space->index_count > 1 &&
+			     !space->def.opts.defer_deletes;
 	const char *key = request->key;
 	uint32_t part_count = mp_decode_array(&key);
 	if (vy_unique_key_validate(index, key, part_count))
@@ -6498,7 +7153,7 @@ vy_delete(struct vy_tx *tx, struct txn_stmt *stmt, struct space *space,
 	if (has_secondary) {
 		assert(stmt->old_tuple != NULL);
 		return vy_delete_impl(tx, space, stmt->old_tuple);
-	} else { /* Primary is the single index in the space. */
+	} else { /* Only the primary index needs the DELETE. */
 		assert(index->key_def->iid == 0);
 		struct tuple *delete =
 			vy_stmt_new_surrogate_delete_from_key(space->format,
@@ -6934,6 +7589,10 @@ vy_replace(struct vy_tx *tx, struct txn_stmt *stmt, struct space *space,
 	if (space->index_count == 1) {
 		/* Replace in a space with a single index. */
 		return vy_replace_one(tx, space, request, stmt);
+	} else if (space->def.opts.defer_deletes &&
+		   rlist_empty(&space->on_replace)) {
+		/* Don't read the old tuple, leave its keys stale. */
+		return vy_replace_blind(tx, space, request, stmt);
 	} else {
 		/* Replace in a space with secondary indexes. */
 		return vy_replace_impl(tx, space, request, stmt);
@@ -7116,6 +7775,47 @@ vy_get(struct vy_tx *tx, struct vy_index *index, const char *key,
 
 /** {{{ Environment */
 
+/**
+ * Read latency greater than the average times this factor
+ * makes compaction slow down.
+ */
+#define VY_READ_LATENCY_SPIKE			2
+/** Min share of the I/O bandwidth left to compaction. */
+#define VY_COMPACTION_IO_WEIGHT_MIN		(1. / 16)
+
+/**
+ * Compaction competes for the disk with foreground reads.
+ * If reads done since the last call took noticeably longer
+ * than usual, halve the share of the I/O bandwidth given to
+ * compaction by the I/O limiter, otherwise double it back.
+ */
+static void
+vy_env_update_compaction_io_weight(struct vy_env *e)
+{
+	struct vy_latency *lat = &e->stat->get_latency;
+	uint64_t count = lat->count - e->last_get_count;
+	double total = lat->total - e->last_get_total;
+	e->last_get_count = lat->count;
+	e->last_get_total = lat->total;
+	if (count == 0)
+		return;
+	double latency = total / count;
+	double weight = io_limiter_weight(&io_limiter, IO_CLASS_COMPACTION);
+	if (e->avg_get_latency > 0 &&
+	    latency > e->avg_get_latency * VY_READ_LATENCY_SPIKE) {
+		weight = MAX(weight / 2, VY_COMPACTION_IO_WEIGHT_MIN);
+	} else {
+		weight = MIN(weight * 2, 1.);
+		/* Only learn the usual latency from calm periods. */
+		if (e->avg_get_latency == 0)
+			e->avg_get_latency = latency;
+		else
+			e->avg_get_latency = 0.9 * e->avg_get_latency +
+					     0.1 * latency;
+	}
+	io_limiter_set_weight(&io_limiter, IO_CLASS_COMPACTION, weight);
+}
+
 static void
 vy_env_quota_timer_cb(ev_loop *loop, ev_timer *timer, int events)
 {
@@ -7138,6 +7838,7 @@ vy_env_quota_timer_cb(ev_loop *loop, ev_timer *timer, int events)
 
 	vy_quota_update_watermark(&e->quota, max_range_size,
 				  tx_write_rate, dump_bandwidth);
+	vy_env_update_compaction_io_weight(e);
 }
 
 /** Destructor for env->zdctx_key thread-local variable */
@@ -7152,6 +7853,12 @@ static struct vy_squash_queue *
 vy_squash_queue_new(void);
 static void
 vy_squash_queue_delete(struct vy_squash_queue *q);
+static struct vy_page_cache *
+vy_page_cache_new(struct vy_cache_env *cache_env);
+static void
+vy_page_cache_delete(struct vy_page_cache *cache);
+static void
+vy_page_cache_join_readahead(struct vy_page_cache *cache);
 
 struct vy_env *
 vy_env_new(void)
@@ -7182,6 +7889,9 @@ vy_env_new(void)
 	e->log = vy_log_new(e->conf->path, vy_run_gc_cb, e);
 	if (e->log == NULL)
 		goto error_log;
+	e->page_cache = vy_page_cache_new(&e->cache_env);
+	if (e->page_cache == NULL)
+		goto error_page_cache;
 	RLIST_HEAD(empty_list);
 	e->key_format = tuple_format_new(&vy_tuple_format_vtab,
 					  &empty_list, 0);
@@ -7204,8 +7914,12 @@ vy_env_new(void)
 	ev_timer_start(loop(), &e->quota_timer);
 	vy_cache_env_create(&e->cache_env, slab_cache,
 			    e->conf->cache);
+	e->cache_env.evict_other = vy_page_cache_evict_lru;
+	e->cache_env.evict_other_arg = e->page_cache;
 	return e;
 error_key_format:
+	vy_page_cache_delete(e->page_cache);
+error_page_cache:
 	vy_log_delete(e->log);
 error_log:
 	vy_squash_queue_delete(e->squash_queue);
@@ -7225,6 +7939,11 @@ error_conf:
 void
 vy_env_delete(struct vy_env *e)
 {
+	/*
+	 * Read-ahead fibers reference runs and pages,
+	 * finish them before freeing anything.
+	 */
+	vy_page_cache_join_readahead(e->page_cache);
 	struct vy_index *index, *tmp;
 	rlist_foreach_entry_safe(index, &e->indexes, link, tmp)
 		vy_index_unref(index);
@@ -7235,6 +7954,7 @@ vy_env_delete(struct vy_env *e)
 	vy_conf_delete(e->conf);
 	vy_stat_delete(e->stat);
 	vy_log_delete(e->log);
+	vy_page_cache_delete(e->page_cache);
 	tuple_format_ref(e->key_format, -1);
 	mempool_destroy(&e->cursor_pool);
 	mempool_destroy(&e->read_task_pool);
@@ -7326,11 +8046,27 @@ struct vy_run_iterator_pos {
 	uint32_t pos_in_page;
 };
 
-/**
- * Return statements from vy_run based on initial search key,
- * iteration order and view lsn.
- *
- * All statements with lsn > vlsn are skipped.
+enum {
+	/**
+	 * Number of pages a run iterator must load one after
+	 * another in the iteration order before it starts reading
+	 * pages ahead.
+	 */
+	VY_RUN_READAHEAD_MIN_SEQ = 2,
+	/** Max number of pages a run iterator reads ahead. */
+	VY_RUN_READAHEAD_MAX = 32,
+	/**
+	 * Pages read ahead by all iterators and not used yet
+	 * may take up to 1/N of the cache memory quota.
+	 */
+	VY_RUN_READAHEAD_QUOTA_SHARE = 16,
+};
+
+/**
+ * Return statements from vy_run based on initial search key,
+ * iteration order and view lsn.
+ *
+ * All statements with lsn > vlsn are skipped.
  * The API allows to traverse over resulting statements within two
  * dimensions - key and lsn. next_key() switches to the youngest
  * statement of the next key, according to the iteration order,
@@ -7388,6 +8124,17 @@ struct vy_run_iterator {
 	bool search_started;
 	/** Search is finished, you will not get more values from iterator */
 	bool search_ended;
+	/** Number of the page loaded last, -1 if none. */
+	int64_t last_page_no;
+	/**
+	 * Number of pages loaded one after another in the
+	 * iteration order, ending with last_page_no. Once it
+	 * reaches VY_RUN_READAHEAD_MIN_SEQ, the iterator starts
+	 * reading pages ahead.
+	 */
+	uint32_t seq_page_count;
+	/** Number of the next page to read ahead. */
+	int64_t readahead_page_no;
 };
 
 static void
@@ -7415,8 +8162,43 @@ struct vy_page {
 	uint32_t unpacked_size;
 	/** Array with row offsets in page data */
 	uint32_t *row_index;
+	/**
+	 * Array with key hints of page statements or NULL if
+	 * the page was written without hints.
+	 */
+	hint_t *key_hints;
 	/** Page data */
 	char *data;
+	/** ID of the run this page belongs to. */
+	int64_t run_id;
+	/**
+	 * Number of users of the page: iterators, read tasks and
+	 * fibers waiting for the page to be loaded. An unused page
+	 * is either freed or, if it is cached, moved to the LRU
+	 * list of the page cache.
+	 */
+	int refs;
+	/** Set while the page data is being read from the disk. */
+	bool is_loading;
+	/** Set if the page failed to load and must not be used. */
+	bool is_broken;
+	/** Signalled when the page is loaded or fails to load. */
+	struct ipc_cond load_cond;
+	/**
+	 * Set if the page was read ahead and hasn't been used by
+	 * an iterator yet. Such a page is accounted in
+	 * vy_page_cache->readahead_size.
+	 */
+	bool is_readahead;
+	/**
+	 * Page cache this page is stored in or NULL if the page
+	 * is private to its reader.
+	 */
+	struct vy_page_cache *cache;
+	/** Link in vy_page_cache->lru, valid only if refs == 0. */
+	struct rlist in_lru;
+	/** Link in vy_run->cached_pages. */
+	struct rlist in_run;
 };
 
 static struct vy_page *
@@ -7438,32 +8220,259 @@ vy_page_new(const struct vy_page_info *page_info)
 		return NULL;
 	}
 
+	page->key_hints = NULL;
+	if (page_info->key_hints_offset != 0) {
+		page->key_hints = calloc(page_info->count, sizeof(hint_t));
+		if (page->key_hints == NULL) {
+			diag_set(OutOfMemory, page_info->count * sizeof(hint_t),
+				 "malloc", "page->key_hints");
+			free(page->row_index);
+			free(page);
+			return NULL;
+		}
+	}
+
 	page->data = (char *)malloc(page_info->unpacked_size);
 	if (page->data == NULL) {
 		diag_set(OutOfMemory, page_info->unpacked_size,
 			 "malloc", "page->data");
+		free(page->key_hints);
 		free(page->row_index);
 		free(page);
 		return NULL;
 	}
+	page->page_no = UINT32_MAX;
+	page->run_id = -1;
+	page->refs = 1;
+	page->is_loading = false;
+	page->is_broken = false;
+	ipc_cond_create(&page->load_cond);
+	page->is_readahead = false;
+	page->cache = NULL;
+	rlist_create(&page->in_lru);
+	rlist_create(&page->in_run);
 	return page;
 }
 
 static void
 vy_page_delete(struct vy_page *page)
 {
+	assert(page->refs == 0);
+	assert(page->cache == NULL);
 	uint32_t *row_index = page->row_index;
+	hint_t *key_hints = page->key_hints;
 	char *data = page->data;
+	ipc_cond_destroy(&page->load_cond);
 #if !defined(NDEBUG)
 	memset(page->row_index, '#', sizeof(uint32_t) * page->count);
+	if (page->key_hints != NULL)
+		memset(page->key_hints, '#', sizeof(hint_t) * page->count);
 	memset(page->data, '#', page->unpacked_size);
 	memset(page, '#', sizeof(*page));
 #endif /* !defined(NDEBUG) */
 	free(row_index);
+	free(key_hints);
 	free(data);
 	free(page);
 }
 
+/** Memory consumed by a page, accounted in the cache quota. */
+static inline size_t
+vy_page_mem_used(const struct vy_page *page)
+{
+	size_t size = sizeof(*page) + sizeof(uint32_t) * page->count +
+		      page->unpacked_size;
+	if (page->key_hints != NULL)
+		size += sizeof(hint_t) * page->count;
+	return size;
+}
+
+/** {{{ Page cache */
+
+static struct vy_page_cache *
+vy_page_cache_new(struct vy_cache_env *cache_env)
+{
+	struct vy_page_cache *cache = malloc(sizeof(*cache));
+	if (cache == NULL) {
+		diag_set(OutOfMemory, sizeof(*cache), "malloc",
+			 "struct vy_page_cache");
+		return NULL;
+	}
+	cache->hash = mh_vy_page_new();
+	if (cache->hash == NULL) {
+		diag_set(OutOfMemory, sizeof(*cache->hash), "malloc",
+			 "page cache hash");
+		free(cache);
+		return NULL;
+	}
+	rlist_create(&cache->lru);
+	cache->cache_env = cache_env;
+	cache->count = 0;
+	cache->used = 0;
+	cache->readahead_size = 0;
+	rlist_create(&cache->readahead);
+	return cache;
+}
+
+/**
+ * Account a page read ahead and not used yet in the read-ahead
+ * size or drop it from there.
+ */
+static void
+vy_page_cache_set_readahead(struct vy_page_cache *cache,
+			    struct vy_page *page, bool is_readahead)
+{
+	if (page->is_readahead == is_readahead)
+		return;
+	page->is_readahead = is_readahead;
+	if (is_readahead)
+		cache->readahead_size += page->unpacked_size;
+	else
+		cache->readahead_size -= page->unpacked_size;
+}
+
+/**
+ * Remove a page from the cache. The page is freed as soon as
+ * the last reference to it is dropped.
+ */
+static void
+vy_page_cache_evict(struct vy_page_cache *cache, struct vy_page *page)
+{
+	assert(page->cache == cache);
+	struct vy_page_cache_key key = { page->run_id, page->page_no };
+	mh_int_t k = mh_vy_page_find(cache->hash, &key, NULL);
+	assert(k != mh_end(cache->hash));
+	mh_vy_page_del(cache->hash, k, NULL);
+	rlist_del_entry(page, in_run);
+	rlist_del_entry(page, in_lru);
+	vy_page_cache_set_readahead(cache, page, false);
+	cache->count--;
+	cache->used -= vy_page_mem_used(page);
+	vy_quota_release(&cache->cache_env->quota, vy_page_mem_used(page));
+	page->cache = NULL;
+	if (page->refs == 0)
+		vy_page_delete(page);
+}
+
+static void
+vy_page_cache_delete(struct vy_page_cache *cache)
+{
+	assert(rlist_empty(&cache->readahead));
+	mh_int_t k;
+	mh_foreach(cache->hash, k) {
+		struct vy_page *page = mh_vy_page_node(cache->hash, k)->page;
+		rlist_del_entry(page, in_run);
+		rlist_del_entry(page, in_lru);
+		vy_quota_release(&cache->cache_env->quota,
+				 vy_page_mem_used(page));
+		page->cache = NULL;
+		if (page->refs == 0)
+			vy_page_delete(page);
+	}
+	mh_vy_page_delete(cache->hash);
+	TRASH(cache);
+	free(cache);
+}
+
+/**
+ * Evict the oldest unused page.
+ * Called by the tuple cache, which shares the quota.
+ */
+static bool
+vy_page_cache_evict_lru(void *arg)
+{
+	struct vy_page_cache *cache = (struct vy_page_cache *)arg;
+	if (rlist_empty(&cache->lru))
+		return false;
+	struct vy_page *page = rlist_last_entry(&cache->lru, struct vy_page,
+						in_lru);
+	vy_page_cache_evict(cache, page);
+	return true;
+}
+
+/**
+ * Evict unused pages and cached tuples until the memory quota
+ * is met. @sa vy_cache_env_gc()
+ */
+static void
+vy_page_cache_gc(struct vy_page_cache *cache)
+{
+	vy_cache_env_gc(cache->cache_env, UINT32_MAX);
+}
+
+static struct vy_page *
+vy_page_cache_find(struct vy_page_cache *cache, int64_t run_id,
+		   uint32_t page_no)
+{
+	struct vy_page_cache_key key = { run_id, page_no };
+	mh_int_t k = mh_vy_page_find(cache->hash, &key, NULL);
+	if (k == mh_end(cache->hash))
+		return NULL;
+	return mh_vy_page_node(cache->hash, k)->page;
+}
+
+/**
+ * Add a referenced page to the cache.
+ * @retval 0 success
+ * @retval -1 memory error
+ */
+static int
+vy_page_cache_put(struct vy_page_cache *cache, struct vy_run *run,
+		  struct vy_page *page)
+{
+	assert(page->cache == NULL);
+	assert(page->refs > 0);
+	page->run_id = run->id;
+	struct mh_vy_page_node_t node = { { page->run_id, page->page_no },
+					  page };
+	mh_int_t k = mh_vy_page_put(cache->hash, &node, NULL, NULL);
+	if (k == mh_end(cache->hash)) {
+		diag_set(OutOfMemory, 0, "mhash", "page cache");
+		return -1;
+	}
+	page->cache = cache;
+	rlist_add_entry(&run->cached_pages, page, in_run);
+	cache->count++;
+	cache->used += vy_page_mem_used(page);
+	vy_quota_force_use(&cache->cache_env->quota, vy_page_mem_used(page));
+	vy_page_cache_gc(cache);
+	return 0;
+}
+
+/** Purge all pages of a run that is about to be deleted. */
+static void
+vy_page_cache_forget_run(struct vy_run *run)
+{
+	struct vy_page *page, *tmp;
+	rlist_foreach_entry_safe(page, &run->cached_pages, in_run, tmp)
+		vy_page_cache_evict(page->cache, page);
+}
+
+static void
+vy_page_ref(struct vy_page *page)
+{
+	if (page->refs++ == 0 && page->cache != NULL)
+		rlist_del_entry(page, in_lru);
+}
+
+static void
+vy_page_unref(struct vy_page *page)
+{
+	assert(page->refs > 0);
+	if (--page->refs > 0)
+		return;
+	if (page->cache == NULL) {
+		vy_page_delete(page);
+	} else if (page->is_broken) {
+		vy_page_cache_evict(page->cache, page);
+	} else {
+		rlist_add_entry(&page->cache->lru, page, in_lru);
+		vy_page_cache_gc(page->cache);
+	}
+}
+
+/** }}} Page cache */
+
 /**
  * Read raw stmt data from the page
  * @param page          Page.
@@ -7530,17 +8539,19 @@ vy_run_iterator_cache_touch(struct vy_run_iterator *itr, uint32_t page_no)
 }
 
 /**
- * Put page to LRU cache
+ * Put page to LRU cache. The iterator takes over the reference
+ * to the page passed by the caller.
  */
 static void
 vy_run_iterator_cache_put(struct vy_run_iterator *itr, struct vy_page *page,
 			  uint32_t page_no)
 {
+	assert(page->page_no == page_no);
+	(void)page_no;
 	if (itr->prev_page != NULL)
-		vy_page_delete(itr->prev_page);
+		vy_page_unref(itr->prev_page);
 	itr->prev_page = itr->curr_page;
 	itr->curr_page = page;
-	page->page_no = page_no;
 }
 
 /**
@@ -7555,9 +8566,9 @@ vy_run_iterator_cache_clean(struct vy_run_iterator *itr)
 		itr->curr_stmt_pos.page_no = UINT32_MAX;
 	}
 	if (itr->curr_page != NULL) {
-		vy_page_delete(itr->curr_page);
+		vy_page_unref(itr->curr_page);
 		if (itr->prev_page != NULL)
-			vy_page_delete(itr->prev_page);
+			vy_page_unref(itr->prev_page);
 		itr->curr_page = itr->prev_page = NULL;
 	}
 }
@@ -7588,6 +8599,33 @@ error:
 	assert(pos == request.tuple_end);
 	return 0;
 }
+
+static int
+vy_key_hints_decode(hint_t *key_hints, uint32_t count,
+		    struct xrow_header *xrow)
+{
+	struct request request;
+	request_create(&request, xrow->type);
+	if (request_decode(&request, xrow->body->iov_base,
+			   xrow->body->iov_len) == -1) {
+		return -1;
+	}
+	if (request.tuple == NULL) {
+error:
+		diag_set(ClientError, ER_VINYL, "Can't decode key hints");
+		return -1;
+	}
+	const char *pos = request.tuple;
+	if (mp_decode_array(&pos) != 1)
+		goto error;
+	uint32_t size = mp_decode_binl(&pos);
+	if (size != sizeof(hint_t) * count)
+		goto error;
+	for (uint32_t i = 0; i < count; ++i)
+		key_hints[i] = mp_load_u64(&pos);
+	assert(pos == request.tuple_end);
+	return 0;
+}
 /**
  * Read a page requests from vinyl xlog data file.
  *
@@ -7595,8 +8633,8 @@ error:
  * @retval -1 on error, check diag
  */
 static int
-vy_page_read(struct vy_page *page, const struct vy_page_info *page_info, int fd,
-	     ZSTD_DStream *zdctx)
+vy_page_read(struct vy_page *page, const struct vy_page_info *page_info,
+	     const struct vy_run *run, ZSTD_DStream *zdctx)
 {
 	/* read xlog tx from xlog file */
 	size_t region_svp = region_used(&fiber()->gc);
@@ -7605,7 +8643,7 @@ vy_page_read(struct vy_page *page, const struct vy_page_info *page_info, int fd,
 		diag_set(OutOfMemory, page_info->size, "region gc", "page");
 		return -1;
 	}
-	ssize_t readen = fio_pread(fd, data, page_info->size,
+	ssize_t readen = fio_pread(run->fd, data, page_info->size,
 				   page_info->offset);
 	if (readen < 0) {
 		/* TODO: report filename */
@@ -7624,7 +8662,8 @@ vy_page_read(struct vy_page *page, const struct vy_page_info *page_info, int fd,
 	const char *data_end = data + readen;
 	char *rows = page->data;
 	char *rows_end = rows + page_info->unpacked_size;
-	if (xlog_tx_decode(data, data_end, rows, rows_end, zdctx) != 0)
+	if (xlog_tx_decode(data, data_end, rows, rows_end, zdctx,
+			   run->info.dict, run->info.dict_size) != 0)
 		goto error;
 
 	struct xrow_header xrow;
@@ -7634,6 +8673,14 @@ vy_page_read(struct vy_page *page, const struct vy_page_info *page_info, int fd,
 		goto error;
 	if (vy_row_index_decode(page->row_index, page->count, &xrow) != 0)
 		goto error;
+	if (page->key_hints != NULL) {
+		data_pos = page->data + page_info->key_hints_offset;
+		if (xrow_header_decode(&xrow, &data_pos, data_end) == -1)
+			goto error;
+		if (vy_key_hints_decode(page->key_hints, page->count,
+					&xrow) != 0)
+			goto error;
+	}
 	region_truncate(&fiber()->gc, region_svp);
 	ERROR_INJECT(ERRINJ_VY_READ_PAGE, {
 		diag_set(ClientError, ER_VINYL, "page read injection");
@@ -7674,7 +8721,7 @@ vy_page_read_cb(struct coio_task *base)
 	if (zdctx == NULL)
 		return -1;
 	task->rc = vy_page_read(task->page, &task->page_info,
-				task->run->fd, zdctx);
+				task->run, zdctx);
 	return task->rc;
 }
 
@@ -7685,14 +8732,269 @@ static int
 vy_page_read_cb_free(struct coio_task *base)
 {
 	struct vy_page_read_task *task = (struct vy_page_read_task *)base;
-	if (task->page)
-		vy_page_delete(task->page);
+	vy_page_unref(task->page);
 	vy_run_unref(task->run);
 	coio_task_destroy(&task->base);
 	mempool_free(&task->env->read_task_pool, task);
 	return 0;
 }
 
+/**
+ * Read a page of a run from the disk using coeio and store it in
+ * the page cache. Until the read completes, the page stays in the
+ * cache with is_loading flag set, so that fibers looking for the
+ * same page wait for this read instead of issuing another one.
+ * Yields. On success the page is returned referenced.
+ */
+static NODISCARD int
+vy_page_cache_read(struct vy_page_cache *cache, struct vy_env *env,
+		   struct vy_run *run, uint32_t page_no,
+		   struct vy_page **result)
+{
+	struct vy_page_info *page_info = vy_run_page_info(run, page_no);
+	struct vy_page *page = vy_page_new(page_info);
+	if (page == NULL)
+		return -1;
+	page->page_no = page_no;
+	if (vy_page_cache_put(cache, run, page) != 0) {
+		vy_page_unref(page);
+		return -1;
+	}
+	page->is_loading = true;
+
+	/* Allocate a coio task */
+	struct vy_page_read_task *task =
+		(struct vy_page_read_task *)mempool_alloc(&env->read_task_pool);
+	if (task == NULL) {
+		diag_set(OutOfMemory, sizeof(*task), "malloc",
+			 "vy_page_read_task");
+		goto error;
+	}
+	coio_task_create(&task->base, vy_page_read_cb,
+			  vy_page_read_cb_free);
+
+	/*
+	 * Make sure the run file descriptor won't be closed
+	 * (even worse, reopened) while a coeio thread is
+	 * reading it. The page is referenced by the task too,
+	 * since the task may outlive this fiber if it's cancelled.
+	 */
+	task->run = run;
+	vy_run_ref(task->run);
+	task->page_info = *page_info;
+	task->env = env;
+	task->page = page;
+	vy_page_ref(task->page);
+
+	/* Post task to coeio */
+	if (coio_task_post(&task->base, TIMEOUT_INFINITY) < 0)
+		goto error; /* timed out or cancelled */
+
+	if (task->rc != 0) {
+		/* posted, but failed */
+		diag_move(&task->base.diag, &fiber()->diag);
+		vy_page_read_cb_free(&task->base);
+		goto error;
+	}
+	vy_page_read_cb_free(&task->base);
+
+	page->is_loading = false;
+	ipc_cond_broadcast(&page->load_cond);
+	*result = page;
+	return 0;
+error:
+	/* Let the waiters know that they must retry. */
+	page->is_loading = false;
+	page->is_broken = true;
+	if (page->cache != NULL)
+		vy_page_cache_evict(cache, page);
+	ipc_cond_broadcast(&page->load_cond);
+	vy_page_unref(page);
+	return -1;
+}
+
+/**
+ * Get a page from the page cache or read it from the disk.
+ * If the page is being read by another fiber, wait for the
+ * read to complete. May yield. On success the page is returned
+ * referenced.
+ */
+static NODISCARD int
+vy_page_cache_get(struct vy_page_cache *cache, struct vy_env *env,
+		  struct vy_run *run, uint32_t page_no,
+		  struct vy_page **result)
+{
+	int rc = -1;
+	/* Pin the run so that it isn't freed while we yield. */
+	vy_run_ref(run);
+	struct vy_page *page;
+	while ((page = vy_page_cache_find(cache, run->id,
+					  page_no)) != NULL) {
+		vy_page_ref(page);
+		while (page->is_loading) {
+			ipc_cond_wait(&page->load_cond);
+			if (fiber_is_cancelled()) {
+				diag_set(FiberIsCancelled);
+				vy_page_unref(page);
+				goto out;
+			}
+		}
+		if (!page->is_broken) {
+			*result = page;
+			rc = 0;
+			goto out;
+		}
+		/* The read failed, try to read the page ourselves. */
+		vy_page_unref(page);
+	}
+	rc = vy_page_cache_read(cache, env, run, page_no, result);
+out:
+	vy_run_unref(run);
+	return rc;
+}
+
+/** A read-ahead in progress, lives on the stack of its fiber. */
+struct vy_readahead {
+	/** Fiber reading the page. */
+	struct fiber *fiber;
+	/** Size of the page, accounted in readahead_size. */
+	size_t size;
+	/** Link in vy_page_cache->readahead. */
+	struct rlist in_cache;
+};
+
+/**
+ * Read-ahead fiber function: load a page into the page cache
+ * and release it, so that it waits in the cache for the reader
+ * that is going to need it. Errors are ignored: the reader will
+ * retry the read and report them.
+ */
+static int
+vy_page_readahead_f(va_list ap)
+{
+	struct vy_env *env = va_arg(ap, struct vy_env *);
+	struct vy_run *run = va_arg(ap, struct vy_run *);
+	uint32_t page_no = va_arg(ap, uint32_t);
+	struct vy_page_cache *cache = env->page_cache;
+
+	struct vy_readahead readahead;
+	readahead.fiber = fiber();
+	readahead.size = vy_run_page_info(run, page_no)->unpacked_size;
+	rlist_add_tail_entry(&cache->readahead, &readahead, in_cache);
+	cache->readahead_size += readahead.size;
+
+	struct vy_page *page;
+	int rc = vy_page_cache_get(cache, env, run, page_no, &page);
+
+	rlist_del_entry(&readahead, in_cache);
+	cache->readahead_size -= readahead.size;
+	if (rc != 0) {
+		diag_clear(diag_get());
+		return 0;
+	}
+	/*
+	 * Keep the page accounted until an iterator uses it,
+	 * unless somebody has taken it already.
+	 */
+	if (page->cache != NULL && page->refs == 1)
+		vy_page_cache_set_readahead(cache, page, true);
+	vy_page_unref(page);
+	return 0;
+}
+
+/**
+ * Finish read-ahead fibers at shutdown. The event loop is
+ * stopped by now, so the fibers can't be joined: a fiber still
+ * waiting for its read task is resumed directly, gives up on
+ * the task and exits. A fiber whose task has completed is
+ * already scheduled and can't be called, it is just forgotten
+ * together with the page it holds.
+ */
+static void
+vy_page_cache_join_readahead(struct vy_page_cache *cache)
+{
+	while (!rlist_empty(&cache->readahead)) {
+		struct vy_readahead *readahead =
+			rlist_first_entry(&cache->readahead,
+					  struct vy_readahead, in_cache);
+		struct fiber *f = readahead->fiber;
+		if (f->flags & FIBER_IS_READY) {
+			rlist_del_entry(readahead, in_cache);
+			cache->readahead_size -= readahead->size;
+			continue;
+		}
+		/* Unlinks the entry and exits. */
+		fiber_call(f);
+	}
+}
+
+/**
+ * Start reading a page into the page cache in the background
+ * unless it is already there. Doesn't yield.
+ */
+static void
+vy_page_cache_readahead(struct vy_page_cache *cache, struct vy_env *env,
+			struct vy_run *run, uint32_t page_no)
+{
+	if (vy_page_cache_find(cache, run->id, page_no) != NULL)
+		return;
+	struct fiber *f = fiber_new("vinyl.readahead", vy_page_readahead_f);
+	if (f == NULL) {
+		/* Not critical, the page will be read on demand. */
+		diag_clear(diag_get());
+		return;
+	}
+	/*
+	 * The fiber runs until it posts the read task and
+	 * yields back, so the run can't go away before the
+	 * fiber references it.
+	 */
+	fiber_start(f, env, run, page_no);
+}
+
+/**
+ * Detect sequential access to the run pages and keep reading
+ * pages ahead of the iterator, so that a scan doesn't wait for
+ * a disk read on each page. The read-ahead window grows with
+ * the length of the sequential run up to VY_RUN_READAHEAD_MAX
+ * pages and is limited by a share of the cache memory quota.
+ */
+static void
+vy_run_iterator_readahead(struct vy_run_iterator *itr, uint32_t page_no)
+{
+	struct vy_run *run = itr->run;
+	struct vy_env *env = itr->index->env;
+	int dir = iterator_direction(itr->iterator_type);
+	if (itr->last_page_no >= 0 && itr->last_page_no + dir == page_no) {
+		itr->seq_page_count++;
+	} else {
+		/* Random access, drop the window. */
+		itr->seq_page_count = 1;
+		itr->readahead_page_no = (int64_t)page_no + dir;
+	}
+	itr->last_page_no = page_no;
+	if (itr->seq_page_count < VY_RUN_READAHEAD_MIN_SEQ)
+		return;
+
+	struct vy_page_cache *cache = env->page_cache;
+	uint32_t depth = MIN(itr->seq_page_count * 2, VY_RUN_READAHEAD_MAX);
+	size_t budget = env->cache_env.quota.limit /
+			VY_RUN_READAHEAD_QUOTA_SHARE;
+	for (uint32_t i = 1; i <= depth; i++) {
+		int64_t next = (int64_t)page_no + dir * (int64_t)i;
+		if (next < 0 || next >= run->info.count)
+			break;
+		/* Skip pages that have been read ahead already. */
+		if ((next - itr->readahead_page_no) * dir < 0)
+			continue;
+		size_t size = vy_run_page_info(run, next)->unpacked_size;
+		if (cache->readahead_size + size > budget)
+			break;
+		vy_page_cache_readahead(cache, env, run, next);
+		itr->readahead_page_no = next + dir;
+	}
+}
+
 /**
  * Get a page by the given number the cache or load it from the disk.
  *
@@ -7705,24 +9007,18 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 			  struct vy_page **result)
 {
 	struct vy_index *index = itr->index;
-	const struct vy_env *env = index->env;
+	struct vy_env *env = index->env;
 
 	/* Check cache */
 	*result = vy_run_iterator_cache_get(itr, page_no);
 	if (*result != NULL)
 		return 0;
 
-	/* Allocate buffers */
-	struct vy_page_info *page_info = vy_run_page_info(itr->run, page_no);
-	struct vy_page *page = vy_page_new(page_info);
-	if (page == NULL)
-		return -1;
-
-	/* Read page data from the disk */
-	int rc;
+	struct vy_page *page;
 	if (cord_is_main() && env->status == VINYL_ONLINE) {
 		/*
-		 * Use coeio for TX thread **after recovery**.
+		 * Use the shared page cache and coeio for TX thread
+		 * **after recovery**.
 		 * Please note that vy_run can go away after yield.
 		 * In this case vy_run_iterator is no more valid and
 		 * rc = -2 is returned to the caller.
@@ -7731,42 +9027,9 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 		uint32_t index_version = itr->index->version;
 		uint32_t range_version = itr->range->version;
 
-		/* Allocate a coio task */
-		struct vy_page_read_task *task =
-			(struct vy_page_read_task *)mempool_alloc(&itr->index->env->read_task_pool);
-		if (task == NULL) {
-			diag_set(OutOfMemory, sizeof(*task), "malloc",
-				 "vy_page_read_task");
-			return -1;
-		}
-		coio_task_create(&task->base, vy_page_read_cb,
-				  vy_page_read_cb_free);
-
-		/*
-		 * Make sure the run file descriptor won't be closed
-		 * (even worse, reopened) while a coeio thread is
-		 * reading it.
-		 */
-		task->run = itr->run;
-		vy_run_ref(task->run);
-		task->page_info = *page_info;
-		task->env = index->env;
-		task->page = page;
-
-		/* Post task to coeio */
-		rc = coio_task_post(&task->base, TIMEOUT_INFINITY);
-		if (rc < 0)
-			return -1; /* timed out or cancelled */
-
-		if (task->rc != 0) {
-			/* posted, but failed */
-			diag_move(&task->base.diag, &fiber()->diag);
-			vy_page_read_cb_free(&task->base);
+		if (vy_page_cache_get(env->page_cache, env, itr->run,
+				      page_no, &page) != 0)
 			return -1;
-		}
-
-		task->page = NULL;
-		vy_page_read_cb_free(&task->base);
 
 		/*
 		 * Check that vy_index/vy_range/vy_run haven't changed
@@ -7777,21 +9040,31 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 			itr->index = NULL;
 			itr->range = NULL;
 			itr->run = NULL;
-			vy_page_delete(page);
+			vy_page_unref(page);
 			return -2; /* iterator is no more valid */
 		}
+		vy_page_cache_set_readahead(env->page_cache, page, false);
+		vy_run_iterator_readahead(itr, page_no);
 	} else {
 		/*
 		 * Optimization: use blocked I/O for non-TX threads or
 		 * during WAL recovery (env->status != VINYL_ONLINE).
+		 * The page cache is not thread-safe, so the page is
+		 * private to the iterator.
 		 */
-		ZSTD_DStream *zdctx = vy_env_get_zdctx(itr->index->env);
+		struct vy_page_info *page_info =
+			vy_run_page_info(itr->run, page_no);
+		page = vy_page_new(page_info);
+		if (page == NULL)
+			return -1;
+		page->page_no = page_no;
+		ZSTD_DStream *zdctx = vy_env_get_zdctx(env);
 		if (zdctx == NULL) {
-			vy_page_delete(page);
+			vy_page_unref(page);
 			return -1;
 		}
-		if (vy_page_read(page, page_info, itr->run->fd, zdctx) != 0) {
-			vy_page_delete(page);
+		if (vy_page_read(page, page_info, itr->run, zdctx) != 0) {
+			vy_page_unref(page);
 			return -1;
 		}
 	}
@@ -7870,6 +9143,8 @@ vy_run_iterator_search_page(struct vy_run_iterator *itr,
  * In terms of STL, makes lower_bound for EQ,GE,LT and upper_bound for GT,LE
  * Additionally *equal_key argument is set to true if the found value is
  * equal to given key (untouched otherwise)
+ * If the page has key hints, statements are decoded only when
+ * the hints can't tell the order.
  * @retval position in the page
  */
 static uint32_t
@@ -7883,21 +9158,29 @@ vy_run_iterator_search_in_page(struct vy_run_iterator *itr,
 	int zero_cmp = itr->iterator_type == ITER_GT ||
 		       itr->iterator_type == ITER_LE ? -1 : 0;
 	struct vy_index *idx = itr->index;
+	hint_t key_hint = page->key_hints != NULL ?
+			  vy_stmt_hint(key, idx->key_def) : HINT_NONE;
 	while (beg != end) {
 		uint32_t mid = beg + (end - beg) / 2;
-		struct tuple *fnd_key = vy_page_stmt(page, mid, itr->format,
-						     itr->upsert_format,
-						     itr->index->key_def);
-		if (fnd_key == NULL)
-			return end;
-		int cmp = vy_stmt_compare(fnd_key, key, idx->key_def);
+		int cmp = 0;
+		if (key_hint != HINT_NONE)
+			cmp = hint_cmp(page->key_hints[mid], key_hint);
+		if (cmp == 0) {
+			struct tuple *fnd_key;
+			fnd_key = vy_page_stmt(page, mid, itr->format,
+					       itr->upsert_format,
+					       itr->index->key_def);
+			if (fnd_key == NULL)
+				return end;
+			cmp = vy_stmt_compare(fnd_key, key, idx->key_def);
+			tuple_unref(fnd_key);
+		}
 		cmp = cmp ? cmp : zero_cmp;
 		*equal_key = *equal_key || cmp == 0;
 		if (cmp < 0)
 			beg = mid + 1;
 		else
 			end = mid;
-		tuple_unref(fnd_key);
 	}
 	return end;
 }
@@ -8081,6 +9364,52 @@ vy_run_iterator_find_lsn(struct vy_run_iterator *itr, struct tuple **ret)
 static NODISCARD int
 vy_run_iterator_next_key(struct vy_stmt_iterator *vitr, struct tuple **ret,
 			 bool *stop);
+/**
+ * Calculate the hash of the first key_def->part_count parts
+ * of a search key, which may be either a SELECT key or a
+ * full statement.
+ */
+static uint32_t
+vy_stmt_key_hash(const struct tuple *key, const struct key_def *key_def)
+{
+	if (vy_stmt_type(key) == IPROTO_SELECT) {
+		const char *data = tuple_data(key);
+		mp_decode_array(&data);
+		return key_hash(data, key_def);
+	}
+	return tuple_hash(key, key_def);
+}
+
+/**
+ * Check run bloom filters for an equality lookup.
+ * The full key filter is used when the key is complete,
+ * the prefix filter is used when the key is at least as
+ * long as the prefix.
+ *
+ * @retval false The run has no statements matching the key.
+ * @retval true  The run may have statements matching the key.
+ */
+static bool
+vy_run_may_contain(const struct vy_run *run, const struct vy_index *index,
+		   enum iterator_type iterator_type, const struct tuple *key)
+{
+	if (iterator_type != ITER_EQ && iterator_type != ITER_REQ)
+		return true;
+	uint32_t part_count = tuple_field_count(key);
+	const struct key_def *user_key_def = index->user_key_def;
+	if (run->info.has_bloom && part_count >= user_key_def->part_count &&
+	    !bloom_possible_has(&run->info.bloom,
+				vy_stmt_key_hash(key, user_key_def)))
+		return false;
+	const struct key_def *prefix_def = index->bloom_prefix_def;
+	if (run->info.has_prefix_bloom && prefix_def != NULL &&
+	    part_count >= prefix_def->part_count &&
+	    !bloom_possible_has(&run->info.prefix_bloom,
+				vy_stmt_key_hash(key, prefix_def)))
+		return false;
+	return true;
+}
+
 /**
  * Find next (lower, older) record with the same key as current
  * Return true if the record was found
@@ -8097,22 +9426,11 @@ vy_run_iterator_start(struct vy_run_iterator *itr, struct tuple **ret)
 	itr->search_started = true;
 	*ret = NULL;
 
-	struct key_def *user_key_def = itr->index->user_key_def;
-	if (itr->run->info.has_bloom && itr->iterator_type == ITER_EQ &&
-	    tuple_field_count(itr->key) >= user_key_def->part_count) {
-		uint32_t hash;
-		if (vy_stmt_type(itr->key) == IPROTO_SELECT) {
-			const char *data = tuple_data(itr->key);
-			mp_decode_array(&data);
-			hash = key_hash(data, user_key_def);
-		} else {
-			hash = tuple_hash(itr->key, user_key_def);
-		}
-		if (!bloom_possible_has(&itr->run->info.bloom, hash)) {
-			itr->search_ended = true;
-			itr->stat->bloom_reflections++;
-			return 0;
-		}
+	if (!vy_run_may_contain(itr->run, itr->index, itr->iterator_type,
+				itr->key)) {
+		itr->search_ended = true;
+		itr->stat->bloom_reflections++;
+		return 0;
 	}
 
 	itr->stat->lookup_count++;
@@ -8231,6 +9549,9 @@ vy_run_iterator_open(struct vy_run_iterator *itr, struct vy_iterator_stat *stat,
 
 	itr->search_started = false;
 	itr->search_ended = false;
+	itr->last_page_no = -1;
+	itr->seq_page_count = 0;
+	itr->readahead_page_no = -1;
 }
 
 /**
@@ -9416,13 +10737,87 @@ struct vy_write_iterator {
 	bool goto_next_key;
 	struct tuple *key;
 	struct tuple *tmp_stmt;
-	struct vy_merge_iterator mi;
+	/** All sources, from the newest to the oldest one. */
+	struct rlist src_list;
+	/** Number of sources in src_list. */
+	uint32_t src_count;
+	/**
+	 * Sources which are not exhausted yet, ordered by
+	 * their current statements, so that merging costs
+	 * O(log N) comparisons per statement rather than O(N),
+	 * which matters for compaction of many runs.
+	 */
+	heap_t src_heap;
+	/** Set once the sources are positioned and in the heap. */
+	bool search_started;
+	/** The last statement taken from the sources. */
+	struct tuple *curr_stmt;
 	/* Usage statistics of mem iterators */
 	struct vy_iterator_stat mem_iterator_stat;
 	/* Usage statistics of run iterators */
 	struct vy_iterator_stat run_iterator_stat;
 };
 
+/**
+ * A source of the write iterator: an iterator over a mem or
+ * a run being written.
+ */
+struct vy_write_src {
+	/** Link in vy_write_iterator::src_heap. */
+	struct heap_node heap_node;
+	/** Link in vy_write_iterator::src_list. */
+	struct rlist in_src_list;
+	/** Source iterator */
+	union {
+		struct vy_run_iterator run_iterator;
+		struct vy_mem_iterator mem_iterator;
+		struct vy_stmt_iterator iterator;
+	};
+	/** The statement the source is positioned on. */
+	struct tuple *stmt;
+	/**
+	 * Ordinal number of the source. Sources are added
+	 * from the newest to the oldest one.
+	 */
+	uint32_t id;
+};
+
+#define HEAP_NAME vy_write_heap
+
+/**
+ * Sources are ordered by key ascending and LSN descending, so
+ * the heap top is the youngest version of the least key. Of
+ * two equal statements the one from a newer source goes first,
+ * like in the merge iterator.
+ */
+static bool
+heap_write_less(heap_t *heap, struct heap_node *a, struct heap_node *b)
+{
+	struct vy_write_iterator *wi =
+		container_of(heap, struct vy_write_iterator, src_heap);
+	struct vy_write_src *left =
+		container_of(a, struct vy_write_src, heap_node);
+	struct vy_write_src *right =
+		container_of(b, struct vy_write_src, heap_node);
+
+	int cmp = vy_tuple_compare(left->stmt, right->stmt,
+				   wi->index->key_def);
+	if (cmp != 0)
+		return cmp < 0;
+	int64_t left_lsn = vy_stmt_lsn(left->stmt);
+	int64_t right_lsn = vy_stmt_lsn(right->stmt);
+	if (left_lsn != right_lsn)
+		return left_lsn > right_lsn;
+	return left->id < right->id;
+}
+
+#define HEAP_LESS(h, l, r) heap_write_less(h, l, r)
+
+#include "salad/heap.h"
+
+#undef HEAP_LESS
+#undef HEAP_NAME
+
 /*
  * Open an empty write iterator. To add sources to the iterator
  * use vy_write_iterator_add_* functions
@@ -9444,8 +10839,11 @@ vy_write_iterator_open(struct vy_write_iterator *wi, struct vy_index *index,
 	wi->upsert_format = index->upsert_format;
 	tuple_format_ref(wi->surrogate_format, 1);
 	tuple_format_ref(wi->upsert_format, 1);
-	vy_merge_iterator_open(&wi->mi, index, ITER_GE, wi->key,
-			       wi->surrogate_format, wi->upsert_format);
+	rlist_create(&wi->src_list);
+	wi->src_count = 0;
+	vy_write_heap_create(&wi->src_heap);
+	wi->search_started = false;
+	wi->curr_stmt = NULL;
 	return 0;
 }
 
@@ -9466,12 +10864,29 @@ vy_write_iterator_new(struct vy_index *index, bool is_last_level,
 	return wi;
 }
 
+/**
+ * Add a source to the write iterator. Must be called before
+ * the iteration is started. Newer sources must be added first.
+ */
+static struct vy_write_src *
+vy_write_iterator_new_src(struct vy_write_iterator *wi)
+{
+	assert(!wi->search_started);
+	struct vy_write_src *src = calloc(1, sizeof(*src));
+	if (src == NULL) {
+		diag_set(OutOfMemory, sizeof(*src), "calloc", "src");
+		return NULL;
+	}
+	src->id = wi->src_count++;
+	rlist_add_tail_entry(&wi->src_list, src, in_src_list);
+	return src;
+}
+
 static NODISCARD int
 vy_write_iterator_add_run(struct vy_write_iterator *wi,
 			  struct vy_range *range, struct vy_run *run)
 {
-	struct vy_merge_src *src;
-	src = vy_merge_iterator_add(&wi->mi, false, false);
+	struct vy_write_src *src = vy_write_iterator_new_src(wi);
 	if (src == NULL)
 		return -1;
 	static const int64_t vlsn = INT64_MAX;
@@ -9484,8 +10899,7 @@ vy_write_iterator_add_run(struct vy_write_iterator *wi,
 static NODISCARD int
 vy_write_iterator_add_mem(struct vy_write_iterator *wi, struct vy_mem *mem)
 {
-	struct vy_merge_src *src;
-	src = vy_merge_iterator_add(&wi->mi, false, false);
+	struct vy_write_src *src = vy_write_iterator_new_src(wi);
 	if (src == NULL)
 		return -1;
 	static const int64_t vlsn = INT64_MAX;
@@ -9494,6 +10908,173 @@ vy_write_iterator_add_mem(struct vy_write_iterator *wi, struct vy_mem *mem)
 	return 0;
 }
 
+/**
+ * Position every source on its first statement and put the
+ * sources into the heap.
+ */
+static NODISCARD int
+vy_write_iterator_start(struct vy_write_iterator *wi)
+{
+	wi->search_started = true;
+	struct vy_write_src *src;
+	rlist_foreach_entry(src, &wi->src_list, in_src_list) {
+		bool stop = false;
+		if (src->iterator.iface->next_key(&src->iterator,
+						  &src->stmt, &stop) != 0)
+			return -1;
+		if (src->stmt == NULL)
+			continue;
+		if (vy_write_heap_insert(&wi->src_heap,
+					 &src->heap_node) != 0) {
+			diag_set(OutOfMemory, sizeof(struct heap_node *),
+				 "realloc", "src_heap");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Move a source to its next statement and restore the heap
+ * order, which costs O(log N) comparisons. If next_key is
+ * set, the rest versions of the current key of the source
+ * are skipped.
+ */
+static NODISCARD int
+vy_write_iterator_src_next(struct vy_write_iterator *wi,
+			   struct vy_write_src *src, bool next_key)
+{
+	struct vy_stmt_iterator *sub_itr = &src->iterator;
+	struct tuple *stmt = NULL;
+	int rc = 0;
+	if (!next_key)
+		rc = sub_itr->iface->next_lsn(sub_itr, &stmt);
+	if (rc == 0 && stmt == NULL) {
+		bool stop = false;
+		rc = sub_itr->iface->next_key(sub_itr, &stmt, &stop);
+	}
+	if (rc != 0)
+		return -1;
+	src->stmt = stmt;
+	if (stmt != NULL)
+		vy_write_heap_update(&wi->src_heap, &src->heap_node);
+	else
+		vy_write_heap_delete(&wi->src_heap, &src->heap_node);
+	return 0;
+}
+
+/**
+ * Check if the heap top is an older version of the key of
+ * the current statement.
+ */
+static bool
+vy_write_iterator_top_is_curr_key(struct vy_write_iterator *wi)
+{
+	struct heap_node *node = vy_write_heap_top(&wi->src_heap);
+	if (node == NULL || wi->curr_stmt == NULL)
+		return false;
+	struct vy_write_src *src =
+		container_of(node, struct vy_write_src, heap_node);
+	return vy_tuple_compare(src->stmt, wi->curr_stmt,
+				wi->index->key_def) == 0;
+}
+
+/**
+ * Take the statement at the heap top and advance its source.
+ * The statement is referenced by the iterator till the next
+ * one is taken.
+ */
+static NODISCARD int
+vy_write_iterator_take(struct vy_write_iterator *wi, struct tuple **ret)
+{
+	*ret = NULL;
+	struct heap_node *node = vy_write_heap_top(&wi->src_heap);
+	if (node == NULL)
+		return 0;
+	struct vy_write_src *src =
+		container_of(node, struct vy_write_src, heap_node);
+	if (wi->curr_stmt != NULL)
+		tuple_unref(wi->curr_stmt);
+	wi->curr_stmt = src->stmt;
+	tuple_ref(wi->curr_stmt);
+	if (vy_write_iterator_src_next(wi, src, false) != 0)
+		return -1;
+	*ret = wi->curr_stmt;
+	return 0;
+}
+
+/**
+ * Iterate to the youngest version of the next key.
+ * @retval 0 success or EOF (*ret == NULL)
+ * @retval -1 read error
+ */
+static NODISCARD int
+vy_write_iterator_next_key(struct vy_write_iterator *wi, struct tuple **ret)
+{
+	while (vy_write_iterator_top_is_curr_key(wi)) {
+		struct vy_write_src *src =
+			container_of(vy_write_heap_top(&wi->src_heap),
+				     struct vy_write_src, heap_node);
+		if (vy_write_iterator_src_next(wi, src, true) != 0)
+			return -1;
+	}
+	return vy_write_iterator_take(wi, ret);
+}
+
+/**
+ * Iterate to the next (elder) version of the same key.
+ * @retval 0 success or EOF (*ret == NULL)
+ * @retval -1 read error
+ */
+static NODISCARD int
+vy_write_iterator_next_lsn(struct vy_write_iterator *wi, struct tuple **ret)
+{
+	*ret = NULL;
+	if (!vy_write_iterator_top_is_curr_key(wi))
+		return 0;
+	return vy_write_iterator_take(wi, ret);
+}
+
+/**
+ * Squash in the single statement all rest statements of current key
+ * starting from the current statement.
+ *
+ * @retval 0 success or EOF (*ret == NULL)
+ * @retval -1 error
+ */
+static NODISCARD int
+vy_write_iterator_squash_upsert(struct vy_write_iterator *wi,
+				struct tuple **ret)
+{
+	*ret = NULL;
+	struct tuple *t = wi->curr_stmt;
+	struct key_def *def = wi->index->key_def;
+	if (t == NULL)
+		return 0;
+	/* Upserts enabled only in the primary index. */
+	assert(vy_stmt_type(t) != IPROTO_UPSERT || def->iid == 0);
+	tuple_ref(t);
+	while (vy_stmt_type(t) == IPROTO_UPSERT) {
+		struct tuple *next;
+		int rc = vy_write_iterator_next_lsn(wi, &next);
+		if (rc != 0) {
+			tuple_unref(t);
+			return rc;
+		}
+		if (next == NULL)
+			break;
+		struct tuple *applied;
+		applied = vy_apply_upsert(t, next, def, wi->surrogate_format,
+					  wi->upsert_format, false);
+		tuple_unref(t);
+		if (applied == NULL)
+			return -1;
+		t = applied;
+	}
+	*ret = t;
+	return 0;
+}
+
 /**
  * The write iterator can return multiple LSNs for the same
  * key, thus next() will automatically switch to the next
@@ -9513,16 +11094,17 @@ vy_write_iterator_next(struct vy_write_iterator *wi, struct tuple **ret)
 	/*
 	 * The write iterator guarantees that the returned stmt
 	 * is alive until the next invocation of next(). If the
-	 * returned stmt is obtained from the merge iterator,
-	 * this guarantee is fulfilled by the merge iterator
-	 * itself. If the write iterator creates the returned
+	 * returned stmt is obtained from a source, this guarantee
+	 * is fulfilled by wi->curr_stmt reference. If the write
+	 * iterator creates the returned
 	 * stmt, e.g. by squashing a bunch of upserts, then
 	 * it must dereference the created stmt here.
 	 */
 	if (wi->tmp_stmt)
 		tuple_unref(wi->tmp_stmt);
 	wi->tmp_stmt = NULL;
-	struct vy_merge_iterator *mi = &wi->mi;
+	if (!wi->search_started && vy_write_iterator_start(wi) != 0)
+		return -1;
 	struct tuple *stmt = NULL;
 	struct vy_index *index = wi->index;
 	struct key_def *def = index->key_def;
@@ -9530,13 +11112,13 @@ vy_write_iterator_next(struct vy_write_iterator *wi, struct tuple **ret)
 	while (true) {
 		if (wi->goto_next_key) {
 			wi->goto_next_key = false;
-			if (vy_merge_iterator_next_key(mi, &stmt))
+			if (vy_write_iterator_next_key(wi, &stmt))
 				return -1;
 		} else {
-			if (vy_merge_iterator_next_lsn(mi, &stmt))
+			if (vy_write_iterator_next_lsn(wi, &stmt))
 				return -1;
 			if (stmt == NULL &&
-			    vy_merge_iterator_next_key(mi, &stmt))
+			    vy_write_iterator_next_key(wi, &stmt))
 				return -1;
 		}
 		if (stmt == NULL)
@@ -9564,10 +11146,8 @@ vy_write_iterator_next(struct vy_write_iterator *wi, struct tuple **ret)
 
 		/* Squash upserts */
 		assert(vy_stmt_type(stmt) == IPROTO_UPSERT);
-		if (vy_merge_iterator_squash_upsert(mi, &stmt, false)) {
-			tuple_unref(stmt);
+		if (vy_write_iterator_squash_upsert(wi, &stmt))
 			return -1;
-		}
 		if (vy_stmt_type(stmt) == IPROTO_UPSERT && wi->is_last_level) {
 			/* Turn UPSERT to REPLACE. */
 			struct tuple *applied;
@@ -9596,7 +11176,15 @@ vy_write_iterator_cleanup(struct vy_write_iterator *wi)
 	if (wi->key != NULL)
 		tuple_unref(wi->key);
 	wi->key = NULL;
-	vy_merge_iterator_cleanup(&wi->mi);
+	if (wi->curr_stmt != NULL)
+		tuple_unref(wi->curr_stmt);
+	wi->curr_stmt = NULL;
+	struct vy_write_src *src;
+	rlist_foreach_entry(src, &wi->src_list, in_src_list) {
+		vy_iterator_close_f cb = src->iterator.iface->cleanup;
+		if (cb != NULL)
+			cb(&src->iterator);
+	}
 }
 
 static void
@@ -9608,7 +11196,13 @@ vy_write_iterator_delete(struct vy_write_iterator *wi)
 	assert(wi->key == NULL);
 	tuple_format_ref(wi->surrogate_format, -1);
 	tuple_format_ref(wi->upsert_format, -1);
-	vy_merge_iterator_close(&wi->mi);
+	assert(wi->curr_stmt == NULL);
+	struct vy_write_src *src, *tmp;
+	rlist_foreach_entry_safe(src, &wi->src_list, in_src_list, tmp) {
+		src->iterator.iface->close(&src->iterator);
+		free(src);
+	}
+	vy_write_heap_destroy(&wi->src_heap);
 
 	free(wi);
 }
@@ -9700,6 +11294,15 @@ vy_read_iterator_add_disk(struct vy_read_iterator *itr)
 	if (itr->index->space_index_count == 1)
 		format = itr->index->space_format;
 	rlist_foreach_entry(run, &itr->curr_range->runs, in_range) {
+		/*
+		 * Skip runs that can't have the key according to
+		 * their bloom filters so as not to open them at all.
+		 */
+		if (!vy_run_may_contain(run, itr->index, itr->iterator_type,
+					itr->key)) {
+			stat->bloom_reflections++;
+			continue;
+		}
 		struct vy_merge_src *sub_src = vy_merge_iterator_add(
 			&itr->merge_iterator, false, true);
 		vy_run_iterator_open(&sub_src->run_iterator, stat,
@@ -10233,6 +11836,239 @@ fail:
 
 /* {{{ Cursor */
 
+/** A statement read from a secondary index to look up. */
+struct vy_cursor_lookup_stmt {
+	/** The statement, referenced. */
+	struct tuple *stmt;
+	/** Position of the statement in vy_cursor::batch. */
+	int pos;
+};
+
+/**
+ * A batch of primary index lookups shared by the fibers
+ * doing them.
+ */
+struct vy_cursor_lookup {
+	struct vy_cursor *cursor;
+	/** Statements to look up, sorted by the primary key. */
+	struct vy_cursor_lookup_stmt stmts[VY_CURSOR_BATCH_MAX];
+	/** Number of statements in stmts. */
+	int count;
+	/** The next statement to look up. */
+	int next;
+	/** Set if a lookup failed, to stop the others. */
+	bool is_failed;
+};
+
+static int
+vy_cursor_lookup_stmt_cmp(const void *a, const void *b, void *arg)
+{
+	const struct vy_cursor_lookup_stmt *left = a;
+	const struct vy_cursor_lookup_stmt *right = b;
+	return vy_tuple_compare(left->stmt, right->stmt,
+				(struct key_def *) arg);
+}
+
+/**
+ * Look up the statements of the batch one by one till none
+ * is left. Run by several fibers at once, so that their disk
+ * reads are issued concurrently. Since the statements are
+ * sorted by the primary key, neighbour lookups usually need
+ * the same page, which is read only once thanks to the page
+ * cache.
+ */
+static int
+vy_cursor_lookup_run(struct vy_cursor_lookup *lookup)
+{
+	struct vy_cursor *c = lookup->cursor;
+	while (lookup->next < lookup->count && !lookup->is_failed) {
+		struct vy_cursor_lookup_stmt *s =
+			&lookup->stmts[lookup->next++];
+		if (vy_index_full_by_stmt(c->tx, c->index, s->stmt,
+					  &c->batch[s->pos]) != 0) {
+			lookup->is_failed = true;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int
+vy_cursor_lookup_f(va_list ap)
+{
+	struct vy_cursor_lookup *lookup = va_arg(ap, struct vy_cursor_lookup *);
+	return vy_cursor_lookup_run(lookup);
+}
+
+/** Release the tuples of a batch that haven't been returned. */
+static void
+vy_cursor_drop_batch(struct vy_cursor *c)
+{
+	for (int i = c->batch_pos; i < c->batch_count; i++) {
+		if (c->batch[i] != NULL)
+			tuple_unref(c->batch[i]);
+		tuple_unref(c->batch_stmts[i]);
+	}
+	c->batch_count = 0;
+	c->batch_pos = 0;
+}
+
+/**
+ * Read the next batch of statements from a secondary index
+ * and look them up in the primary index.
+ */
+static NODISCARD int
+vy_cursor_fill_batch(struct vy_cursor *c)
+{
+	assert(c->batch_pos == c->batch_count);
+	struct vy_index *index = c->index;
+	struct key_def *def = index->key_def;
+	struct vy_cursor_lookup lookup;
+	lookup.cursor = c;
+	lookup.count = 0;
+	lookup.next = 0;
+	lookup.is_failed = false;
+	c->batch_count = 0;
+	c->batch_pos = 0;
+	c->batch_lsn = c->env->xm->lsn;
+
+	int rc = -1;
+	while (lookup.count < c->batch_size) {
+		struct tuple *stmt;
+		if (vy_read_iterator_next(&c->iterator, &stmt) != 0)
+			goto out;
+		c->n_reads++;
+		if (vy_tx_track(c->tx, index, stmt ? stmt : c->key,
+				stmt == NULL))
+			goto out;
+		if (stmt == NULL || (c->need_check_eq &&
+		    vy_tuple_compare_with_key(stmt, c->key, def) != 0)) {
+			c->is_eof = true;
+			break;
+		}
+		tuple_ref(stmt);
+		lookup.stmts[lookup.count].stmt = stmt;
+		lookup.stmts[lookup.count].pos = lookup.count;
+		c->batch[lookup.count] = NULL;
+		c->batch_stmts[lookup.count] = stmt;
+		lookup.count++;
+	}
+	c->batch_size = MIN(c->batch_size * 2, VY_CURSOR_BATCH_MAX);
+
+	struct key_def *pk_def = vy_index(index->space->index[0])->key_def;
+	qsort_arg(lookup.stmts, lookup.count, sizeof(*lookup.stmts),
+		  vy_cursor_lookup_stmt_cmp, pk_def);
+
+	struct fiber *fibers[VY_CURSOR_LOOKUP_FIBERS];
+	int fiber_count = 0;
+	/* The current fiber does lookups too. */
+	while (fiber_count < MIN(lookup.count, VY_CURSOR_LOOKUP_FIBERS) - 1) {
+		struct fiber *f = fiber_new("vinyl.lookup", vy_cursor_lookup_f);
+		if (f == NULL) {
+			/* Do with the fibers we have. */
+			diag_clear(diag_get());
+			break;
+		}
+		fiber_set_joinable(f, true);
+		fibers[fiber_count++] = f;
+		fiber_start(f, &lookup);
+	}
+	rc = vy_cursor_lookup_run(&lookup);
+	for (int i = 0; i < fiber_count; i++) {
+		if (fiber_join(fibers[i]) != 0)
+			rc = -1;
+	}
+out:
+	c->batch_count = lookup.count;
+	if (rc != 0)
+		vy_cursor_drop_batch(c);
+	return rc;
+}
+
+/**
+ * Drop the rest of the batch and reopen the iterator right
+ * after the statement of the last returned tuple.
+ */
+static NODISCARD int
+vy_cursor_restart(struct vy_cursor *c)
+{
+	assert(c->last_stmt != NULL);
+	struct region *region = &fiber()->gc;
+	size_t used = region_used(region);
+	const char *key = tuple_extract_key(c->last_stmt, c->index->key_def,
+					    NULL);
+	if (key == NULL)
+		return -1;
+	struct tuple *restart_key = vy_key_from_msgpack(c->env->key_format,
+							key);
+	region_truncate(region, used);
+	if (restart_key == NULL)
+		return -1;
+	vy_cursor_drop_batch(c);
+	vy_read_iterator_close(&c->iterator);
+	if (c->restart_key != NULL)
+		tuple_unref(c->restart_key);
+	c->restart_key = restart_key;
+	enum iterator_type type =
+		iterator_direction(c->iterator_type) > 0 ? ITER_GT : ITER_LT;
+	vy_read_iterator_open(&c->iterator, c->index, c->tx, type,
+			      restart_key, &c->tx->vlsn, false);
+	/* The iterator doesn't stop at the end of the key any more. */
+	if (c->iterator_type == ITER_EQ)
+		c->need_check_eq = true;
+	c->batch_size = 1;
+	return 0;
+}
+
+/**
+ * vy_cursor_next() for a secondary index in autocommit mode:
+ * statements are read ahead and looked up in the primary
+ * index in batches.
+ */
+static NODISCARD int
+vy_cursor_next_batched(struct vy_cursor *c, struct tuple **result)
+{
+	*result = NULL;
+	for (;;) {
+		if (c->batch_pos == c->batch_count) {
+			if (c->is_eof)
+				return 0;
+			if (vy_cursor_fill_batch(c) != 0)
+				return -1;
+			if (c->batch_count == 0)
+				return 0;
+		} else if (c->batch_lsn != c->env->xm->lsn) {
+			/*
+			 * Something was committed since the batch
+			 * was read, by this fiber between next()
+			 * calls or by another one, so the tuples
+			 * read ahead may be deleted or out of date.
+			 * The first tuple of a batch is returned
+			 * anyway, just like an unbatched cursor
+			 * would do.
+			 */
+			if (vy_cursor_restart(c) != 0)
+				return -1;
+			continue;
+		}
+		*result = c->batch[c->batch_pos];
+		if (c->last_stmt != NULL)
+			tuple_unref(c->last_stmt);
+		c->last_stmt = c->batch_stmts[c->batch_pos];
+		c->batch[c->batch_pos] = NULL;
+		c->batch_stmts[c->batch_pos] = NULL;
+		c->batch_pos++;
+		/*
+		 * The tuple may be missing in the primary index:
+		 * it could be deleted while the batch was being
+		 * looked up, or the secondary index entry may be
+		 * stale in a space with deferred deletes.
+		 */
+		if (*result != NULL)
+			return 0;
+	}
+}
+
 struct vy_cursor *
 vy_cursor_new(struct vy_tx *tx, struct vy_index *index, const char *key,
 	      uint32_t part_count, enum iterator_type type)
@@ -10261,6 +12097,13 @@ vy_cursor_new(struct vy_tx *tx, struct vy_index *index, const char *key,
 	c->tx = tx;
 	c->start = tx->start;
 	c->need_check_eq = false;
+	c->batch_count = 0;
+	c->batch_pos = 0;
+	c->batch_size = 1;
+	c->batch_lsn = 0;
+	c->last_stmt = NULL;
+	c->restart_key = NULL;
+	c->is_eof = false;
 	enum iterator_type iterator_type;
 	switch (type) {
 	case ITER_ALL:
@@ -10308,8 +12151,10 @@ vy_cursor_next(struct vy_cursor *c, struct tuple **result)
 	}
 
 	assert(c->key != NULL);
-	int rc = vy_read_iterator_next(&c->iterator, &vyresult);
-	if (rc)
+	if (def->iid > 0 && c->tx == &c->tx_autocommit)
+		return vy_cursor_next_batched(c, result);
+next:
+	if (vy_read_iterator_next(&c->iterator, &vyresult) != 0)
 		return -1;
 	c->n_reads++;
 	if (vy_tx_track(c->tx, index, vyresult ? vyresult : c->key,
@@ -10320,9 +12165,14 @@ vy_cursor_next(struct vy_cursor *c, struct tuple **result)
 	if (c->need_check_eq && vy_tuple_compare_with_key(vyresult, c->key,
 							  def) != 0)
 		return 0;
-	if (def->iid > 0 && vy_index_full_by_stmt(c->tx, index, vyresult,
-						  &vyresult))
-		return -1;
+	if (def->iid > 0) {
+		if (vy_index_full_by_stmt(c->tx, index, vyresult,
+					  &vyresult) != 0)
+			return -1;
+		/* Skip a stale entry of a space with deferred deletes. */
+		if (vyresult == NULL)
+			goto next;
+	}
 	*result = vyresult;
 	/**
 	 * If the index is not primary (def->iid != 0) then no
@@ -10332,13 +12182,18 @@ vy_cursor_next(struct vy_cursor *c, struct tuple **result)
 	 */
 	if (def->iid == 0)
 		tuple_ref(vyresult);
-	return *result != NULL ? 0 : -1;
+	return 0;
 }
 
 void
 vy_cursor_delete(struct vy_cursor *c)
 {
+	vy_cursor_drop_batch(c);
+	if (c->last_stmt != NULL)
+		tuple_unref(c->last_stmt);
 	vy_read_iterator_close(&c->iterator);
+	if (c->restart_key != NULL)
+		tuple_unref(c->restart_key);
 	struct vy_env *e = c->env;
 	if (c->tx != NULL) {
 		if (c->tx == &c->tx_autocommit) {
@@ -289,6 +289,27 @@ vy_cursor_delete(struct vy_cursor *cursor);
 int
 vy_cursor_next(struct vy_cursor *cursor, struct tuple **result);
 
+/*
+ * Run files
+ */
+
+/**
+ * Read the compression dictionary of a run from its .index
+ * file, see key_opts.compression_dictionary. Used by readers
+ * of .run files outside of the engine, which need it to decode
+ * the pages. The dictionary is malloc()ed, the caller must
+ * free() it.
+ *
+ * @param path path to the .index file of the run
+ * @param[out] dict the dictionary or NULL if the run has none
+ * @param[out] dict_size size of the dictionary
+ *
+ * @retval  0 success
+ * @retval -1 error (check diag)
+ */
+int
+vy_run_read_dictionary(const char *path, char **dict, size_t *dict_size);
+
 /*
  * Replication
  */
@@ -49,6 +49,7 @@
 #include "iproto_constants.h"
 #include "vinyl.h"
 #include "vy_stmt.h"
+#include "zstd.h"
 
 struct tuple_format_vtab vy_tuple_format_vtab = {
 	vy_tuple_delete,
@@ -65,7 +66,7 @@ vinyl_engine_get_env()
 VinylEngine::VinylEngine()
 	:Engine("vinyl", &vy_tuple_format_vtab)
 {
-	flags = 0;
+	flags = ENGINE_CAN_DEFER_DELETES;
 	env = NULL;
 }
 
@@ -234,6 +235,37 @@ VinylEngine::keydefCheck(struct space *space, struct key_def *key_def)
 		          key_def->name,
 		          space_name(space));
 	}
+	/*
+	 * Stale entries of a secondary index can't be told
+	 * from live ones without looking them up in the primary
+	 * index, which makes uniqueness checks impossible.
+	 */
+	if (space->def.opts.defer_deletes && key_def->iid > 0 &&
+	    key_def->opts.is_unique) {
+		tnt_raise(ClientError, ER_MODIFY_INDEX,
+			  key_def->name, space_name(space),
+			  "unique secondary index is not supported "
+			  "in a space with defer_deletes");
+	}
+	if (key_def->opts.bloom_prefix >= key_def->part_count) {
+		tnt_raise(ClientError, ER_MODIFY_INDEX,
+			  key_def->name, space_name(space),
+			  "bloom_prefix must be less than the number "
+			  "of key parts");
+	}
+	if (key_def->opts.compression_level > ZSTD_maxCLevel()) {
+		tnt_raise(ClientError, ER_MODIFY_INDEX,
+			  key_def->name, space_name(space),
+			  "compression_level exceeds the maximal "
+			  "zstd level");
+	}
+	if (key_def->opts.compression_dictionary >
+	    key_def->opts.page_size) {
+		tnt_raise(ClientError, ER_MODIFY_INDEX,
+			  key_def->name, space_name(space),
+			  "compression_dictionary must not exceed "
+			  "page_size");
+	}
 }
 
 void
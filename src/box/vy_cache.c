@@ -58,6 +58,9 @@ vy_cache_env_create(struct vy_cache_env *e, struct slab_cache *slab_cache,
 	mempool_create(&e->cache_entry_mempool, slab_cache,
 		       sizeof(struct vy_cache_entry));
 	e->cached_count = 0;
+	e->mem_used = 0;
+	e->evict_other = NULL;
+	e->evict_other_arg = NULL;
 }
 
 void
@@ -83,6 +86,7 @@ vy_cache_entry_new(struct vy_cache_env *env, struct vy_cache *cache,
 	rlist_add(&env->cache_lru, &entry->in_lru);
 	size_t use = sizeof(struct vy_cache_entry) + tuple_size(stmt);
 	vy_quota_force_use(&env->quota, use);
+	env->mem_used += use;
 	env->cached_count++;
 	return entry;
 }
@@ -93,6 +97,7 @@ vy_cache_entry_delete(struct vy_cache_env *env, struct vy_cache_entry *entry)
 	struct tuple *stmt = entry->stmt;
 	size_t put = sizeof(struct vy_cache_entry) + tuple_size(stmt);
 	env->cached_count--;
+	env->mem_used -= put;
 	vy_quota_release(&env->quota, put);
 	tuple_unref(stmt);
 	rlist_del(&entry->in_lru);
@@ -191,17 +196,32 @@ vy_cache_gc_step(struct vy_cache_env *env)
 	vy_cache_entry_delete(cache->env, entry);
 }
 
-static void
-vy_cache_gc(struct vy_cache_env *env)
+void
+vy_cache_env_gc(struct vy_cache_env *env, uint32_t max_steps)
 {
 	struct vy_quota *q = &env->quota;
-	for (uint32_t i = 0;
-	     vy_quota_is_exceeded(q) && i < VY_CACHE_CLEANUP_MAX_STEPS;
-	     i++) {
+	for (uint32_t i = 0; vy_quota_is_exceeded(q) && i < max_steps; i++) {
+		bool has_tuples = !rlist_empty(&env->cache_lru);
+		/*
+		 * Take from the cache which uses more memory, or
+		 * from the other one if it has nothing unused.
+		 */
+		if (env->evict_other != NULL &&
+		    (!has_tuples || env->mem_used < q->used - env->mem_used) &&
+		    env->evict_other(env->evict_other_arg))
+			continue;
+		if (!has_tuples)
+			break;
 		vy_cache_gc_step(env);
 	}
 }
 
+static void
+vy_cache_gc(struct vy_cache_env *env)
+{
+	vy_cache_env_gc(env, VY_CACHE_CLEANUP_MAX_STEPS);
+}
+
 void
 vy_cache_add(struct vy_cache *cache, struct tuple *stmt,
 	     struct tuple *prev_stmt, const struct tuple *key,
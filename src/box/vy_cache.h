@@ -109,6 +109,13 @@ vy_cache_tree_key_cmp(struct vy_cache_entry *a,
 #undef bps_tree_arg_t
 #undef BPS_TREE_NO_DEBUG
 
+/**
+ * Evict the oldest unused entry of a cache sharing the quota
+ * with the tuple cache. Return false if there's nothing to evict.
+ */
+typedef bool
+(*vy_cache_evict_f)(void *arg);
+
 /**
  * Environment of the cache
  */
@@ -121,6 +128,17 @@ struct vy_cache_env {
 	struct mempool cache_entry_mempool;
 	/** Number of cached tuples */
 	size_t cached_count;
+	/** Memory used by cached tuples */
+	size_t mem_used;
+	/**
+	 * Another cache sharing the quota, e.g. the page cache,
+	 * or NULL. When the quota is exceeded, entries are evicted
+	 * from the cache which uses more memory, so that neither
+	 * of the two crowds the other out.
+	 */
+	vy_cache_evict_f evict_other;
+	/** Argument of evict_other. */
+	void *evict_other_arg;
 };
 
 /**
@@ -140,6 +158,15 @@ vy_cache_env_create(struct vy_cache_env *env, struct slab_cache *slab_cache,
 void
 vy_cache_env_destroy(struct vy_cache_env *e);
 
+/**
+ * Evict the oldest entries of the tuple cache and the cache
+ * sharing its quota until the quota is met.
+ * @param env - the environment.
+ * @param max_steps - max number of entries to evict.
+ */
+void
+vy_cache_env_gc(struct vy_cache_env *env, uint32_t max_steps);
+
 /**
  * Tuple cache (of one particular index)
  */
@@ -330,6 +330,21 @@ vy_stmt_compare(const struct tuple *a, const struct tuple *b,
 	}
 }
 
+/**
+ * Compute the hint of a statement of any type.
+ * @sa tuple_hint(), key_hint().
+ */
+static inline hint_t
+vy_stmt_hint(const struct tuple *stmt, const struct key_def *key_def)
+{
+	if (vy_stmt_type(stmt) == IPROTO_SELECT) {
+		const char *key = tuple_data(stmt);
+		uint32_t part_count = mp_decode_array(&key);
+		return key_hint(key, part_count, key_def);
+	}
+	return tuple_hint(stmt, key_def);
+}
+
 /** @sa tuple_compare_with_raw_key. */
 static inline int
 vy_stmt_compare_with_raw_key(const struct tuple *stmt, const char *key,
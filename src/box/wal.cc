@@ -39,6 +39,7 @@
 #include "xrow.h"
 #include "cbus.h"
 #include "coeio.h"
+#include "small/ibuf.h"
 
 const char *wal_mode_STRS[] = { "none", "write", "fsync", NULL };
 
@@ -52,6 +53,73 @@ struct wal_thread {
 	struct cpipe wal_pipe;
 	/** Return pipe from 'wal' to tx' */
 	struct cpipe tx_pipe;
+	/**
+	 * Messages pushed to wal_pipe which haven't come
+	 * back to 'tx' yet, see wal_push(). Used in 'tx' only.
+	 */
+	int n_in_flight;
+};
+
+/*
+ * WAL encoder thread. Large batches of WAL requests pass
+ * through it on the way from 'tx' to 'wal' and get their rows
+ * encoded and compressed into xlog blocks, so the next batch
+ * is compressed while the previous one is being written and
+ * synced. Small batches go to 'wal' directly and are encoded
+ * there: the extra thread hop and the copy of the blocks cost
+ * more than the encoding itself.
+ */
+struct wal_encoder {
+	/** 'walenc' thread encoding the rows. */
+	struct cord cord;
+	/** A pipe from 'tx' thread to 'walenc' */
+	struct cpipe encoder_pipe;
+	/** A pipe from 'walenc' to 'wal' */
+	struct cpipe wal_pipe;
+	/**
+	 * Messages pushed to encoder_pipe which haven't come
+	 * back to 'tx' yet, see wal_push(). Used in 'tx' only.
+	 */
+	int n_in_flight;
+	/** A detached xlog, the encoding context. */
+	struct xlog xlog;
+	/** Blocks encoded by the xlog, moved to the batch. */
+	struct stailq blocks;
+};
+
+/**
+ * In-memory copy of the most recently written WAL rows.
+ * Relays read new rows from here rather than re-read and
+ * re-parse the xlog files which have just been written,
+ * see wal_tail_read().
+ *
+ * Rows are stored in a ring buffer one after another, each
+ * prefixed with struct wal_tail_row. Positions are byte offsets
+ * since the start of the WAL writer, so they only grow: the row
+ * at position pos is located at data[pos % size]. The oldest
+ * rows are evicted to make room for new ones.
+ */
+struct wal_tail {
+	/** Protects the tail from concurrent reads and writes. */
+	pthread_mutex_t mutex;
+	/** The ring buffer, NULL if the tail is disabled. */
+	char *data;
+	/** Size of the ring buffer. */
+	uint64_t size;
+	/** Position of the oldest row in the buffer. */
+	uint64_t begin;
+	/** Position following the last row in the buffer. */
+	uint64_t end;
+	/** WAL vclock preceding the oldest row in the buffer. */
+	struct vclock begin_vclock;
+};
+
+/** Header of a row stored in the WAL tail. */
+struct wal_tail_row {
+	/** Length of the encoded row which follows the header. */
+	uint32_t len;
+	uint32_t replica_id;
+	int64_t lsn;
 };
 
 /*
@@ -101,6 +169,8 @@ struct wal_writer
 	 * queue, until the tx thread has recovered.
 	 */
 	struct cmsg in_rollback;
+	/** True while in_rollback is on its way. */
+	bool is_in_rollback;
 	/**
 	 * WAL watchers, i.e. threads that should be alerted
 	 * whenever there are new records appended to the journal.
@@ -109,6 +179,8 @@ struct wal_writer
 	struct rlist watchers;
 	/** The lock protecting the watchers list. */
 	pthread_mutex_t watchers_mutex;
+	/** The last written rows, for relays. */
+	struct wal_tail tail;
 };
 
 struct wal_msg: public cmsg {
@@ -119,37 +191,125 @@ struct wal_msg: public cmsg {
 	 * be rolled back.
 	 */
 	struct stailq rollback;
+	/**
+	 * The rows of all requests encoded into a list of
+	 * struct xlog_block by the encoder thread. Empty if
+	 * the batch went to the WAL thread directly or
+	 * encoding failed: then the WAL thread encodes the
+	 * rows itself.
+	 */
+	struct stailq blocks;
 };
 
 static struct wal_thread wal_thread;
+static struct wal_encoder wal_encoder;
 static struct wal_writer wal_writer_singleton;
 
 struct wal_writer *wal = NULL;
 struct rmean *rmean_tx_wal_bus;
 
+static void
+wal_encode(struct cmsg *msg);
+
 static void
 wal_write_to_disk(struct cmsg *msg);
 
 static void
 tx_schedule_commit(struct cmsg *msg);
 
+/**
+ * The route of a batch through the encoder. A batch which
+ * goes to 'wal' directly starts at the second hop.
+ */
 static struct cmsg_hop wal_request_route[] = {
+	{wal_encode, &wal_encoder.wal_pipe},
 	{wal_write_to_disk, &wal_thread.tx_pipe},
 	{tx_schedule_commit, NULL},
 };
 
+/**
+ * Batches smaller than this go to 'wal' directly. It matches
+ * the size below which xlog doesn't compress the rows.
+ */
+enum { WAL_ENCODE_MIN = 2 * 1024 };
+
 static void
-wal_msg_create(struct wal_msg *batch)
+wal_msg_create(struct wal_msg *batch, bool encode)
 {
-	cmsg_init(batch, wal_request_route);
+	cmsg_init(batch, encode ? wal_request_route :
+			 wal_request_route + 1);
 	stailq_create(&batch->commit);
 	stailq_create(&batch->rollback);
+	stailq_create(&batch->blocks);
+}
+
+static void
+wal_msg_free_blocks(struct wal_msg *batch)
+{
+	struct xlog_block *block, *tmp;
+	stailq_foreach_entry_safe(block, tmp, &batch->blocks, in_blocks)
+		free(block);
+	stailq_create(&batch->blocks);
+}
+
+/**
+ * Pass a message from 'tx' on to 'wal' through the encoder
+ * thread, after the batches pushed before it.
+ */
+static void
+wal_encoder_pass(struct cmsg *msg)
+{
+	(void) msg;
 }
 
 static struct wal_msg *
 wal_msg(struct cmsg *msg)
 {
-	return msg->route == wal_request_route ? (struct wal_msg *) msg : NULL;
+	return msg->route == wal_request_route ||
+	       msg->route == wal_request_route + 1 ?
+	       (struct wal_msg *) msg : NULL;
+}
+
+/**
+ * Choose the way of a new message from 'tx' to 'wal'. Messages
+ * must reach 'wal' in the order they are pushed, so the way
+ * only changes when there are no messages on the other one.
+ *
+ * @param encode true if the message would better go through
+ *        the encoder
+ * @retval true the message goes through the encoder
+ */
+static bool
+wal_use_encoder(bool encode)
+{
+	if (wal_encoder.n_in_flight > 0)
+		return true;
+	if (wal_thread.n_in_flight > 0)
+		return false;
+	return encode;
+}
+
+/** Push a message from 'tx' to 'wal' the way it is routed. */
+static void
+wal_push(struct cmsg *msg)
+{
+	if (msg->route->pipe == &wal_encoder.wal_pipe) {
+		wal_encoder.n_in_flight++;
+		cpipe_push(&wal_encoder.encoder_pipe, msg);
+	} else {
+		wal_thread.n_in_flight++;
+		cpipe_push(&wal_thread.wal_pipe, msg);
+	}
+}
+
+/** Account a message pushed with wal_push() back in 'tx'. */
+static void
+wal_pop(struct cmsg *msg)
+{
+	if (msg->route->pipe == &wal_encoder.wal_pipe)
+		wal_encoder.n_in_flight--;
+	else
+		wal_thread.n_in_flight--;
 }
 
 /**
@@ -181,6 +341,7 @@ static void
 tx_schedule_commit(struct cmsg *msg)
 {
 	struct wal_msg *batch = (struct wal_msg *) msg;
+	wal_pop(batch);
 	/*
 	 * Move the rollback list to the writer first, since
 	 * wal_msg memory disappears after the first
@@ -212,6 +373,118 @@ tx_schedule_rollback(struct cmsg *msg)
 	stailq_create(&writer->rollback);
 }
 
+static void
+wal_tail_create(struct wal_tail *tail, uint64_t size,
+		const struct vclock *vclock)
+{
+	tt_pthread_mutex_init(&tail->mutex, NULL);
+	tail->data = NULL;
+	tail->size = 0;
+	if (size > 0) {
+		tail->data = (char *) malloc(size);
+		if (tail->data == NULL) {
+			say_warn("failed to allocate %llu bytes for "
+				 "WAL tail, relays will read xlog files",
+				 (unsigned long long) size);
+		} else {
+			tail->size = size;
+		}
+	}
+	tail->begin = tail->end = 0;
+	vclock_copy(&tail->begin_vclock, vclock);
+}
+
+static void
+wal_tail_destroy(struct wal_tail *tail)
+{
+	free(tail->data);
+	tt_pthread_mutex_destroy(&tail->mutex);
+}
+
+/** Copy data to the ring buffer, wrapping around its end. */
+static void
+wal_tail_put(struct wal_tail *tail, uint64_t pos, const void *src,
+	     size_t len)
+{
+	size_t offset = pos % tail->size;
+	size_t n = MIN(len, tail->size - offset);
+	memcpy(tail->data + offset, src, n);
+	memcpy(tail->data, (const char *) src + n, len - n);
+}
+
+/** Copy data from the ring buffer, wrapping around its end. */
+static void
+wal_tail_get(struct wal_tail *tail, uint64_t pos, void *dst, size_t len)
+{
+	size_t offset = pos % tail->size;
+	size_t n = MIN(len, tail->size - offset);
+	memcpy(dst, tail->data + offset, n);
+	memcpy((char *) dst + n, tail->data, len - n);
+}
+
+/**
+ * Forget all rows in the tail. Used when a row can't be
+ * added to it, so that readers don't skip it.
+ *
+ * A reader which has read everything holds a position equal
+ * to the current end. Move the tail past it, so that such a
+ * reader, as any other one, has to pass the vclock check in
+ * wal_tail_read() and falls back to xlog files for the rows
+ * which are not in the tail.
+ */
+static void
+wal_tail_reset(struct wal_tail *tail, const struct vclock *vclock)
+{
+	tail->begin = tail->end = tail->end + 1;
+	vclock_copy(&tail->begin_vclock, vclock);
+}
+
+/**
+ * Append a row to the tail, evicting the oldest rows if there
+ * isn't enough space. Called from the WAL thread with the
+ * tail mutex locked.
+ * @retval 0 on success
+ * @retval -1 the row can't be added, the tail must be reset
+ */
+static int
+wal_tail_append(struct wal_tail *tail, struct xrow_header *row)
+{
+	struct iovec iov[XROW_IOVMAX];
+	int iovcnt = xrow_header_encode(row, iov, 0);
+	if (iovcnt < 0) {
+		diag_clear(diag_get());
+		return -1;
+	}
+	struct wal_tail_row header;
+	header.len = 0;
+	for (int i = 0; i < iovcnt; i++)
+		header.len += iov[i].iov_len;
+	header.replica_id = row->replica_id;
+	header.lsn = row->lsn;
+	uint64_t len = sizeof(header) + header.len;
+	if (len > tail->size)
+		return -1;
+	while (tail->end + len - tail->begin > tail->size) {
+		struct wal_tail_row evicted;
+		wal_tail_get(tail, tail->begin, &evicted, sizeof(evicted));
+		if (evicted.lsn > vclock_get(&tail->begin_vclock,
+					     evicted.replica_id)) {
+			vclock_follow(&tail->begin_vclock,
+				      evicted.replica_id, evicted.lsn);
+		}
+		tail->begin += sizeof(evicted) + evicted.len;
+	}
+	uint64_t pos = tail->end;
+	wal_tail_put(tail, pos, &header, sizeof(header));
+	pos += sizeof(header);
+	for (int i = 0; i < iovcnt; i++) {
+		wal_tail_put(tail, pos, iov[i].iov_base, iov[i].iov_len);
+		pos += iov[i].iov_len;
+	}
+	tail->end = pos;
+	return 0;
+}
+
 /**
  * Initialize WAL writer context. Even though it's a singleton,
  * encapsulate the details just in case we may use
@@ -220,7 +493,8 @@ tx_schedule_rollback(struct cmsg *msg)
 static void
 wal_writer_create(struct wal_writer *writer, enum wal_mode wal_mode,
 		  const char *wal_dirname, const struct tt_uuid *instance_uuid,
-		  struct vclock *vclock, int64_t rows_per_wal)
+		  struct vclock *vclock, int64_t rows_per_wal,
+		  int64_t tail_size)
 {
 	writer->wal_mode = wal_mode;
 	writer->rows_per_wal = rows_per_wal;
@@ -232,6 +506,7 @@ wal_writer_create(struct wal_writer *writer, enum wal_mode wal_mode,
 
 	stailq_create(&writer->rollback);
 	cmsg_init(&writer->in_rollback, NULL);
+	writer->is_in_rollback = false;
 
 	/* Create and fill writer->vclock. */
 	vclock_create(&writer->vclock);
@@ -239,6 +514,8 @@ wal_writer_create(struct wal_writer *writer, enum wal_mode wal_mode,
 
 	tt_pthread_mutex_init(&writer->watchers_mutex, NULL);
 	rlist_create(&writer->watchers);
+
+	wal_tail_create(&writer->tail, tail_size, vclock);
 }
 
 /** Destroy a WAL writer structure. */
@@ -247,22 +524,32 @@ wal_writer_destroy(struct wal_writer *writer)
 {
 	xdir_destroy(&writer->wal_dir);
 	tt_pthread_mutex_destroy(&writer->watchers_mutex);
+	wal_tail_destroy(&writer->tail);
 }
 
 /** WAL thread routine. */
 static int
 wal_thread_f(va_list ap);
 
+/** WAL encoder thread routine. */
+static int
+wal_encoder_f(va_list ap);
+
 /** Start WAL thread and setup pipes to and from TX. */
 void
 wal_thread_start()
 {
 	if (cord_costart(&wal_thread.cord, "wal", wal_thread_f, NULL) != 0)
 		panic("failed to start WAL thread");
+	if (cord_costart(&wal_encoder.cord, "walenc",
+			 wal_encoder_f, NULL) != 0)
+		panic("failed to start WAL encoder thread");
 
-	/* Create a pipe to WAL thread. */
+	/* Create pipes to WAL thread, directly and through the encoder. */
 	cpipe_create(&wal_thread.wal_pipe, "wal");
 	cpipe_set_max_input(&wal_thread.wal_pipe, IOV_MAX);
+	cpipe_create(&wal_encoder.encoder_pipe, "walenc");
+	cpipe_set_max_input(&wal_encoder.encoder_pipe, IOV_MAX);
 }
 
 /**
@@ -275,14 +562,14 @@ wal_thread_start()
 void
 wal_init(enum wal_mode wal_mode, const char *wal_dirname,
 	 const struct tt_uuid *instance_uuid, struct vclock *vclock,
-	 int64_t rows_per_wal)
+	 int64_t rows_per_wal, int64_t tail_size)
 {
 	assert(rows_per_wal > 1);
 
 	struct wal_writer *writer = &wal_writer_singleton;
 
 	wal_writer_create(writer, wal_mode, wal_dirname, instance_uuid,
-			  vclock, rows_per_wal);
+			  vclock, rows_per_wal, tail_size);
 
 	wal = writer;
 }
@@ -294,6 +581,13 @@ wal_init(enum wal_mode wal_mode, const char *wal_dirname,
 void
 wal_thread_stop()
 {
+	/* Let the encoder pass all batches on before WAL stops. */
+	cbus_stop_loop(&wal_encoder.encoder_pipe);
+	if (cord_join(&wal_encoder.cord)) {
+		/* We can't recover from this in any reasonable way. */
+		panic_syserror("WAL encoder: thread join failed");
+	}
+
 	cbus_stop_loop(&wal_thread.wal_pipe);
 
 	if (cord_join(&wal_thread.cord)) {
@@ -342,6 +636,7 @@ void
 wal_checkpoint_done_f(struct cmsg *data)
 {
 	struct wal_checkpoint *msg = (struct wal_checkpoint *) data;
+	wal_pop(msg);
 	fiber_wakeup(msg->fiber);
 }
 
@@ -349,16 +644,18 @@ void
 wal_checkpoint(struct vclock *vclock, bool rotate)
 {
 	static struct cmsg_hop wal_checkpoint_route[] = {
+		{wal_encoder_pass, &wal_encoder.wal_pipe},
 		{wal_checkpoint_f, &wal_thread.tx_pipe},
 		{wal_checkpoint_done_f, NULL},
 	};
 	vclock_create(vclock);
 	struct wal_checkpoint msg;
-	cmsg_init(&msg, wal_checkpoint_route);
+	cmsg_init(&msg, wal_use_encoder(false) ? wal_checkpoint_route :
+			wal_checkpoint_route + 1);
 	msg.vclock = vclock;
 	msg.fiber = fiber();
 	msg.rotate = rotate;
-	cpipe_push(&wal_thread.wal_pipe, &msg);
+	wal_push(&msg);
 	fiber_set_cancellable(false);
 	fiber_yield();
 	fiber_set_cancellable(true);
@@ -387,6 +684,12 @@ wal_opt_rotate(struct wal_writer *writer)
 	 */
 	if (writer->is_active &&
 	    writer->current_wal.rows >= writer->rows_per_wal) {
+		/*
+		 * The next file is expected to be as large as
+		 * this one, preallocate it so that appends don't
+		 * have to allocate disk blocks.
+		 */
+		writer->wal_dir.prealloc_size = writer->current_wal.offset;
 		/*
 		 * We can not handle xlog_close()
 		 * failure in any reasonable way.
@@ -405,6 +708,8 @@ wal_opt_rotate(struct wal_writer *writer)
 		return -1;
 	}
 	writer->is_active = true;
+	/* Have the file for the next rotation ready in advance. */
+	xdir_prepare_spare(&writer->wal_dir);
 
 	return 0;
 }
@@ -420,39 +725,45 @@ wal_writer_end_rollback(struct cmsg *msg)
 {
 	(void) msg;
 	struct wal_writer *writer = wal;
-	cmsg_init(&writer->in_rollback, NULL);
+	writer->is_in_rollback = false;
 }
 
 static void
 wal_writer_begin_rollback(struct wal_writer *writer)
 {
-	static struct cmsg_hop rollback_route[4] = {
+	static struct cmsg_hop rollback_route[6] = {
 		/*
 		 * Step 1: clear the bus, so that it contains
 		 * no WAL write requests. This is achieved as a
 		 * side effect of an empty message travelling
-		 * through both bus pipes, while writer input
+		 * through all bus pipes, both through the
+		 * encoder and directly, while writer input
 		 * valve is closed by non-empty writer->rollback
 		 * list.
 		 */
-		{ wal_writer_clear_bus, &wal_thread.wal_pipe },
+		{ wal_writer_clear_bus, &wal_encoder.encoder_pipe },
+		{ wal_writer_clear_bus, &wal_encoder.wal_pipe },
 		{ wal_writer_clear_bus, &wal_thread.tx_pipe },
+		{ wal_writer_clear_bus, &wal_thread.wal_pipe },
 		/*
-		 * Step 2: writer->rollback queue contains all
-		 * messages which need to be rolled back,
-		 * perform the rollback.
+		 * Step 2: re-open the WAL for writing. The
+		 * input valve is still closed, so no request
+		 * can slip in before the rollback.
 		 */
-		{ tx_schedule_rollback, &wal_thread.wal_pipe },
+		{ wal_writer_end_rollback, &wal_thread.tx_pipe },
 		/*
-		 * Step 3: re-open the WAL for writing.
+		 * Step 3: writer->rollback queue contains all
+		 * messages which need to be rolled back,
+		 * perform the rollback and open the valve.
 		 */
-		{ wal_writer_end_rollback, NULL }
+		{ tx_schedule_rollback, NULL }
 	};
 
 	/*
 	 * Make sure the WAL writer rolls back
 	 * all input until rollback mode is off.
 	 */
+	writer->is_in_rollback = true;
 	cmsg_init(&writer->in_rollback, rollback_route);
 	cpipe_push(&wal_thread.tx_pipe, &writer->in_rollback);
 }
@@ -460,6 +771,75 @@ wal_writer_begin_rollback(struct wal_writer *writer)
 static void
 wal_notify_watchers(struct wal_writer *writer);
 
+/**
+ * Encode the rows of a batch into xlog blocks. Runs in the
+ * encoder thread. Same as wal_write_to_disk(), a request is
+ * never split between blocks, so that a failed write can be
+ * rolled back to the last fully written request.
+ */
+static void
+wal_encode(struct cmsg *msg)
+{
+	struct wal_msg *batch = (struct wal_msg *) msg;
+	struct xlog *l = &wal_encoder.xlog;
+	struct wal_request *req;
+	stailq_foreach_entry(req, &batch->commit, fifo) {
+		req->is_block_end = false;
+		xlog_tx_begin(l);
+		struct xrow_header **row = req->rows;
+		for (; row < req->rows + req->n_rows; row++) {
+			if (xlog_write_row(l, *row) < 0)
+				goto error;
+		}
+		ssize_t rc = xlog_tx_commit(l);
+		if (rc < 0)
+			goto error;
+		if (rc > 0)
+			req->is_block_end = true;
+	}
+	if (xlog_flush(l) < 0)
+		goto error;
+	stailq_concat(&batch->blocks, &wal_encoder.blocks);
+	return;
+error:
+	/*
+	 * Leave the batch to the WAL thread, which encodes it
+	 * itself and handles the error the usual way.
+	 */
+	xlog_tx_rollback(l);
+	diag_clear(diag_get());
+	stailq_concat(&batch->blocks, &wal_encoder.blocks);
+	wal_msg_free_blocks(batch);
+}
+
+/**
+ * Write the blocks encoded by the encoder thread.
+ * A request is written when the block it ends in is,
+ * the last block ends with the last request.
+ *
+ * @return the last written request or NULL
+ */
+static struct wal_request *
+wal_write_blocks(struct xlog *l, struct wal_msg *batch)
+{
+	struct wal_request *last_commit_req = NULL;
+	struct wal_request *req = stailq_first_entry(&batch->commit,
+						     struct wal_request, fifo);
+	struct xlog_block *block;
+	stailq_foreach_entry(block, &batch->blocks, in_blocks) {
+		if (xlog_write_block(l, block) < 0)
+			break;
+		for (; req != NULL; req = stailq_next_entry(req, fifo)) {
+			last_commit_req = req;
+			if (req->is_block_end) {
+				req = stailq_next_entry(req, fifo);
+				break;
+			}
+		}
+	}
+	return last_commit_req;
+}
+
 static void
 wal_write_to_disk(struct cmsg *msg)
 {
@@ -468,15 +848,17 @@ wal_write_to_disk(struct cmsg *msg)
 
 	ERROR_INJECT_ONCE(ERRINJ_WAL_DELAY, sleep(5));
 
-	if (writer->in_rollback.route != NULL) {
+	if (writer->is_in_rollback) {
 		/* We're rolling back a failed write. */
 		stailq_concat(&wal_msg->rollback, &wal_msg->commit);
+		wal_msg_free_blocks(wal_msg);
 		return;
 	}
 
 	/* Xlog is only rotated between queue processing  */
 	if (wal_opt_rotate(writer) != 0) {
 		stailq_concat(&wal_msg->rollback, &wal_msg->commit);
+		wal_msg_free_blocks(wal_msg);
 		return wal_writer_begin_rollback(writer);
 	}
 
@@ -507,6 +889,11 @@ wal_write_to_disk(struct cmsg *msg)
 	 * Iterate over requests (transactions)
 	 */
 	struct wal_request *req, *last_commit_req = NULL;
+	if (!stailq_empty(&wal_msg->blocks)) {
+		/* The rows have been encoded by the encoder thread. */
+		last_commit_req = wal_write_blocks(l, wal_msg);
+		goto done;
+	}
 	stailq_foreach_entry(req, &wal_msg->commit, fifo) {
 		/*
 		 * Iterate over request rows (tx statements)
@@ -552,23 +939,42 @@ done:
 	req = stailq_first_entry(&wal_msg->commit, struct wal_request, fifo);
 	struct wal_request *rollback_req = last_commit_req ?
 		stailq_next_entry(last_commit_req, fifo) : req;
+	struct wal_tail *tail = &writer->tail;
+	if (tail->data != NULL)
+		tt_pthread_mutex_lock(&tail->mutex);
 	/* Update status of the successfully committed requests. */
 	for (; req != rollback_req; req = stailq_next_entry(req, fifo)) {
 
-		/* Update internal vclock */
-		vclock_follow(&writer->vclock,
-			      req->rows[req->n_rows - 1]->replica_id,
-			      req->rows[req->n_rows - 1]->lsn);
+		/*
+		 * Update internal vclock. Rows of a request may
+		 * come from different replicas, e.g. a batch
+		 * applied from a master, so follow each of them.
+		 */
+		for (int i = 0; i < req->n_rows; i++) {
+			vclock_follow(&writer->vclock,
+				      req->rows[i]->replica_id,
+				      req->rows[i]->lsn);
+		}
 		/* Update row counter for wal_opt_rotate() */
 		l->rows += req->n_rows;
 		/* Mark request as successful for tx thread */
 		req->res = vclock_sum(&writer->vclock);
+		/* Make the rows available to relays */
+		for (int i = 0; tail->data != NULL && i < req->n_rows; i++) {
+			if (wal_tail_append(tail, req->rows[i]) != 0) {
+				wal_tail_reset(tail, &writer->vclock);
+				break;
+			}
+		}
 	}
+	if (tail->data != NULL)
+		tt_pthread_mutex_unlock(&tail->mutex);
 	if (rollback_req) {
 		/* Rollback unprocessed requests */
 		stailq_splice(&wal_msg->commit, &req->fifo, &wal_msg->rollback);
 		wal_writer_begin_rollback(writer);
 	}
+	wal_msg_free_blocks(wal_msg);
 	fiber_gc();
 	wal_notify_watchers(writer);
 }
@@ -601,6 +1007,42 @@ wal_thread_f(va_list ap)
 	return 0;
 }
 
+/** WAL encoder thread main loop. */
+static int
+wal_encoder_f(va_list ap)
+{
+	(void) ap;
+
+	stailq_create(&wal_encoder.blocks);
+	if (xlog_create_detached(&wal_encoder.xlog,
+				 &wal_encoder.blocks) != 0)
+		panic("failed to create WAL encoder");
+
+	struct cbus_endpoint endpoint;
+	cbus_endpoint_create(&endpoint, "walenc", fiber_schedule_cb,
+			     fiber());
+	cpipe_create(&wal_encoder.wal_pipe, "wal");
+
+	cbus_loop(&endpoint);
+
+	cpipe_destroy(&wal_encoder.wal_pipe);
+	xlog_close(&wal_encoder.xlog, false);
+	return 0;
+}
+
+/** The size of the rows of a request, without headers. */
+static size_t
+wal_request_size(struct wal_request *req)
+{
+	size_t size = 0;
+	for (int i = 0; i < req->n_rows; i++) {
+		struct xrow_header *row = req->rows[i];
+		for (int j = 0; j < row->bodycnt; j++)
+			size += row->body[j].iov_len;
+	}
+	return size;
+}
+
 /**
  * WAL writer main entry point: queue a single request
  * to be written to disk and wait until this task is completed.
@@ -629,26 +1071,30 @@ wal_write(struct wal_request *req)
 	req->res = -1;
 
 	struct wal_msg *batch;
-	if (!stailq_empty(&wal_thread.wal_pipe.input) &&
-	    (batch = wal_msg(stailq_first_entry(&wal_thread.wal_pipe.input,
-						struct cmsg, fifo)))) {
+	bool encode = wal_use_encoder(wal_request_size(req) >=
+				      WAL_ENCODE_MIN);
+	struct cpipe *pipe = encode ? &wal_encoder.encoder_pipe :
+			     &wal_thread.wal_pipe;
+	struct stailq *input = &pipe->input;
+	if (!stailq_empty(input) &&
+	    (batch = wal_msg(stailq_first_entry(input, struct cmsg, fifo)))) {
 
 		stailq_add_tail_entry(&batch->commit, req, fifo);
 	} else {
 		batch = (struct wal_msg *)
 			region_alloc_xc(&fiber()->gc,
 					sizeof(struct wal_msg));
-		wal_msg_create(batch);
+		wal_msg_create(batch, encode);
 		/*
 		 * Sic: first add a request, then push the batch,
 		 * since cpipe_push() may pass the batch to WAL
 		 * thread right away.
 		 */
 		stailq_add_tail_entry(&batch->commit, req, fifo);
-		cpipe_push(&wal_thread.wal_pipe, batch);
+		wal_push(batch);
 	}
-	wal_thread.wal_pipe.n_input += req->n_rows * XROW_IOVMAX;
-	cpipe_flush_input(&wal_thread.wal_pipe);
+	pipe->n_input += req->n_rows * XROW_IOVMAX;
+	cpipe_flush_input(pipe);
 	/**
 	 * It's not safe to spuriously wakeup this fiber
 	 * since in that case it will ignore a possible
@@ -689,6 +1135,62 @@ wal_clear_watcher(struct wal_watcher *watcher)
 	tt_pthread_mutex_unlock(&writer->watchers_mutex);
 }
 
+int
+wal_tail_read(struct wal_tail_cursor *cursor, const struct vclock *vclock,
+	      struct ibuf *buf, size_t max_size)
+{
+	struct wal_writer *writer = wal;
+	if (writer == NULL || writer->tail.data == NULL)
+		return -1;
+	struct wal_tail *tail = &writer->tail;
+	tt_pthread_mutex_lock(&tail->mutex);
+	if (cursor->pos < 0 || (uint64_t) cursor->pos < tail->begin) {
+		/*
+		 * Either the reader has just started or it has
+		 * fallen behind and the rows it needs were
+		 * evicted. The tail is of use only if the reader
+		 * has already seen everything that precedes it.
+		 */
+		int cmp = vclock_compare(&tail->begin_vclock, vclock);
+		if (cmp != 0 && cmp != -1) {
+			tt_pthread_mutex_unlock(&tail->mutex);
+			return -1;
+		}
+		cursor->pos = tail->begin;
+	}
+	uint64_t begin = cursor->pos;
+	uint64_t end = begin;
+	while (end < tail->end && end - begin < max_size) {
+		struct wal_tail_row header;
+		wal_tail_get(tail, end, &header, sizeof(header));
+		end += sizeof(header) + header.len;
+	}
+	if (end > begin) {
+		if (ibuf_reserve(buf, end - begin) == NULL) {
+			tt_pthread_mutex_unlock(&tail->mutex);
+			return -1;
+		}
+		wal_tail_get(tail, begin, buf->wpos, end - begin);
+		buf->wpos += end - begin;
+	}
+	cursor->pos = end;
+	tt_pthread_mutex_unlock(&tail->mutex);
+	return 0;
+}
+
+int
+wal_tail_decode_row(const char **pos, const char *end,
+		    struct xrow_header *row)
+{
+	struct wal_tail_row header;
+	assert((size_t)(end - *pos) >= sizeof(header));
+	memcpy(&header, *pos, sizeof(header));
+	*pos += sizeof(header);
+	assert((size_t)(end - *pos) >= header.len);
+	(void) end;
+	return xrow_header_decode(row, pos, *pos + header.len);
+}
+
 static void
 wal_notify_watchers(struct wal_writer *writer)
 {
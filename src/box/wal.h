@@ -37,6 +37,9 @@
 
 struct fiber;
 struct wal_writer;
+struct vclock;
+struct ibuf;
+struct xrow_header;
 
 enum wal_mode { WAL_NONE = 0, WAL_WRITE, WAL_FSYNC, WAL_MODE_MAX };
 
@@ -61,6 +64,11 @@ struct wal_request {
 	off_t start_offset;
 	/* Relative position of the end of request (used for rollback) */
 	off_t end_offset;
+	/*
+	 * Set by the WAL encoder thread if the request is the
+	 * last one in an encoded xlog block.
+	 */
+	bool is_block_end;
 	int n_rows;
 	struct xrow_header *rows[];
 };
@@ -71,10 +79,17 @@ wal_write(struct wal_request *req);
 void
 wal_thread_start();
 
+/**
+ * Initialize WAL writer.
+ *
+ * @param tail_size size of the in-memory copy of the last
+ *                  written rows, which relays read from,
+ *                  0 to disable it.
+ */
 void
 wal_init(enum wal_mode wal_mode, const char *wal_dirname,
 	 const struct tt_uuid *instance_uuid, struct vclock *vclock,
-	 int64_t rows_per_wal);
+	 int64_t rows_per_wal, int64_t tail_size);
 
 void
 wal_thread_stop();
@@ -100,6 +115,44 @@ wal_clear_watcher(struct wal_watcher *);
 void
 wal_atfork();
 
+/** Position of a reader in the in-memory WAL tail. */
+struct wal_tail_cursor {
+	/** Position of the next row to read, -1 if not known yet. */
+	int64_t pos;
+};
+
+static inline void
+wal_tail_cursor_create(struct wal_tail_cursor *cursor)
+{
+	cursor->pos = -1;
+}
+
+/**
+ * Copy the rows written to WAL after the cursor position from
+ * the in-memory WAL tail to @a buf. Copies at least one row, if
+ * there are any, and stops after @a max_size bytes. Use
+ * wal_tail_decode_row() to parse the rows. Rows which are
+ * already included in @a vclock may be returned too, it's up
+ * to the reader to skip them.
+ *
+ * @retval 0 success, the reader is up to date with the WAL
+ *           if nothing was copied
+ * @retval -1 the rows the reader needs are not in memory
+ *           (it's lagging too far behind or the tail is
+ *           disabled), read them from xlog files and retry
+ */
+int
+wal_tail_read(struct wal_tail_cursor *cursor, const struct vclock *vclock,
+	      struct ibuf *buf, size_t max_size);
+
+/**
+ * Decode a row copied by wal_tail_read() and advance @a pos
+ * to the next one.
+ */
+int
+wal_tail_decode_row(const char **pos, const char *end,
+		    struct xrow_header *row);
+
 extern "C" {
 #endif /* defined(__cplusplus) */
 
@@ -34,6 +34,7 @@
 #include <ctype.h>
 
 #include "fiber.h"
+#include "tt_pthread.h"
 #include "crc32.h"
 #include "fio.h"
 #include "third_party/tarantool_eio.h"
@@ -290,6 +291,45 @@ xlog_meta_parse(struct xlog_meta *meta, const char **data,
 /* sync snapshot every 16MB */
 #define SNAP_SYNC_INTERVAL	(1 << 24)
 
+/**
+ * Name of the spare file of a directory. It has a different
+ * extension than the logs, so xdir_scan() never picks it up.
+ */
+static const char *
+xdir_spare_filename(struct xdir *dir)
+{
+	static __thread char filename[PATH_MAX + 1];
+	snprintf(filename, PATH_MAX, "%s/spare%s%s", dir->dirname,
+		 dir->filename_ext, inprogress_suffix);
+	return filename;
+}
+
+/**
+ * Reserve disk space for a file without changing its size,
+ * so that appends don't have to allocate blocks. Appends
+ * still grow the file size, so fdatasync() still has to write
+ * the inode, but not the block allocation metadata. The file
+ * isn't zero-filled up to its full size because readers
+ * following the file, like relays and hot standby, would take
+ * the zeroes for a corrupt log. A no-op if the platform or
+ * the file system can't do it.
+ *
+ * @retval 0 success, -1 error, errno is set
+ */
+static int
+xlog_fallocate(int fd, off_t len)
+{
+#ifdef HAVE_FALLOCATE
+	if (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, len) != 0 &&
+	    errno != EOPNOTSUPP && errno != ENOSYS)
+		return -1;
+#else
+	(void) fd;
+	(void) len;
+#endif /* HAVE_FALLOCATE */
+	return 0;
+}
+
 void
 xdir_create(struct xdir *dir, const char *dirname,
 	    enum xdir_type type, const tt_uuid *instance_uuid)
@@ -331,12 +371,79 @@ vclockset_reset(vclockset_t *set)
 	}
 }
 
+/** States of a spare file. */
+enum xdir_spare_state {
+	/** The eio job creating the file is queued. */
+	XDIR_SPARE_QUEUED,
+	/** An eio thread is creating the file. */
+	XDIR_SPARE_RUNNING,
+	/** The job is over, see xdir_spare::error. */
+	XDIR_SPARE_DONE,
+	/** The directory gave up the job before it started. */
+	XDIR_SPARE_CANCELLED,
+};
+
+/**
+ * A spare file of a directory, created by an eio job. The
+ * directory owns it, unless it gives up the job before the
+ * job has started: then the job frees it.
+ */
+struct xdir_spare {
+	pthread_mutex_t mutex;
+	/** Signalled when the job is over. */
+	pthread_cond_t cond;
+	enum xdir_spare_state state;
+	/** Result of the job, 0 or errno. */
+	int error;
+	/** Disk space to reserve for the file. */
+	off_t size;
+	char filename[PATH_MAX + 1];
+};
+
+static void
+xdir_spare_delete(struct xdir_spare *spare)
+{
+	tt_pthread_cond_destroy(&spare->cond);
+	tt_pthread_mutex_destroy(&spare->mutex);
+	free(spare);
+}
+
+/**
+ * Give up the spare file of a directory. If its job is
+ * running, wait for it: the job takes a single fallocate().
+ * The thread which started the job may be gone and eio may
+ * be shut down, so the job doesn't report back via eio.
+ */
+static void
+xdir_cancel_spare(struct xdir *dir)
+{
+	struct xdir_spare *spare = dir->spare;
+	if (spare == NULL)
+		return;
+	dir->spare = NULL;
+	tt_pthread_mutex_lock(&spare->mutex);
+	if (spare->state == XDIR_SPARE_QUEUED) {
+		/* The job will free the spare when it runs. */
+		spare->state = XDIR_SPARE_CANCELLED;
+		tt_pthread_mutex_unlock(&spare->mutex);
+		return;
+	}
+	while (spare->state != XDIR_SPARE_DONE)
+		tt_pthread_cond_wait(&spare->cond, &spare->mutex);
+	tt_pthread_mutex_unlock(&spare->mutex);
+	/* Don't leave an unused spare file behind. */
+	if (spare->error == 0)
+		unlink(spare->filename);
+	xdir_spare_delete(spare);
+}
+
 /**
  * Destroy xdir object and free memory.
  */
 void
 xdir_destroy(struct xdir *dir)
 {
+	xdir_cancel_spare(dir);
 	/** Free vclock objects allocated in xdir_scan(). */
 	vclockset_reset(&dir->index);
 }
@@ -651,6 +758,7 @@ xlog_init(struct xlog *xlog)
 	xlog->sync_interval = SNAP_SYNC_INTERVAL;
 	xlog->sync_time = ev_time();
 	xlog->is_autocommit = true;
+	xlog->compression_level = XLOG_COMPRESSION_LEVEL;
 	obuf_create(&xlog->obuf, &cord()->slabc, XLOG_TX_AUTOCOMMIT_THRESHOLD);
 	obuf_create(&xlog->zbuf, &cord()->slabc, XLOG_TX_AUTOCOMMIT_THRESHOLD);
 	xlog->zctx = ZSTD_createCCtx();
@@ -659,6 +767,7 @@ xlog_init(struct xlog *xlog)
 			 "failed to create context");
 		return -1;
 	}
+	tt_pthread_mutex_init(&xlog->mutex, NULL);
 	return 0;
 }
 
@@ -668,12 +777,47 @@ xlog_destroy(struct xlog *xlog)
 	obuf_destroy(&xlog->obuf);
 	obuf_destroy(&xlog->zbuf);
 	ZSTD_freeCCtx(xlog->zctx);
+	tt_pthread_mutex_destroy(&xlog->mutex);
 	TRASH(xlog);
 }
 
-int
-xlog_create(struct xlog *xlog, const char *name,
-	    const struct xlog_meta *meta)
+/**
+ * Take the spare file of a directory if it's ready. Don't
+ * wait for the spare being created: a new file is created
+ * as usual then, and the spare is taken next time.
+ */
+static struct xdir_spare *
+xdir_take_spare(struct xdir *dir)
+{
+	struct xdir_spare *spare = dir->spare;
+	if (spare == NULL)
+		return NULL;
+	tt_pthread_mutex_lock(&spare->mutex);
+	bool is_done = spare->state == XDIR_SPARE_DONE;
+	tt_pthread_mutex_unlock(&spare->mutex);
+	if (!is_done)
+		return NULL;
+	dir->spare = NULL;
+	if (spare->error != 0) {
+		errno = spare->error;
+		say_syserror("%s: failed to create a spare file",
+			     spare->filename);
+		xdir_spare_delete(spare);
+		return NULL;
+	}
+	return spare;
+}
+
+/**
+ * Create a new log file. If spare is not NULL, it's the name
+ * of a pre-created empty file with spare_size bytes reserved,
+ * which is renamed instead of creating a new one. If the spare
+ * can't be renamed, a new file is created as usual.
+ */
+static int
+xlog_create_file(struct xlog *xlog, const char *name,
+		 const struct xlog_meta *meta, const char *spare,
+		 off_t spare_size)
 {
 	char meta_buf[XLOG_META_LEN_MAX];
 	int meta_len;
@@ -704,7 +848,29 @@ xlog_create(struct xlog *xlog, const char *name,
 	 * may think that this is a corrupt file and stop
 	 * replication.
 	 */
-	xlog->fd = open(xlog->filename, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (spare != NULL) {
+		/* rename(2) overwrites silently, emulate O_EXCL. */
+		if (access(xlog->filename, F_OK) == 0) {
+			errno = EEXIST;
+			diag_set(SystemError, "file '%s' already exists",
+				 xlog->filename);
+			goto err_open;
+		}
+		if (rename(spare, xlog->filename) != 0) {
+			say_syserror("can't rename %s to %s, "
+				     "creating a new file", spare,
+				     xlog->filename);
+			spare = NULL;
+		}
+	}
+	if (spare != NULL) {
+		xlog->fd = open(xlog->filename, O_RDWR);
+		if (xlog->fd >= 0)
+			xlog->allocated_size = spare_size;
+	} else {
+		xlog->fd = open(xlog->filename,
+				O_RDWR | O_CREAT | O_EXCL, 0644);
+	}
 	if (xlog->fd < 0) {
 		say_syserror("open, [%s]", name);
 		diag_set(SystemError, "failed to create file '%s'", name);
@@ -735,6 +901,13 @@ err:
 	return -1;
 }
 
+int
+xlog_create(struct xlog *xlog, const char *name,
+	    const struct xlog_meta *meta)
+{
+	return xlog_create_file(xlog, name, meta, NULL, 0);
+}
+
 int
 xlog_open(struct xlog *xlog, const char *name)
 {
@@ -802,6 +975,29 @@ err:
 	return -1;
 }
 
+int
+xlog_create_detached(struct xlog *xlog, struct stailq *blocks)
+{
+	if (xlog_init(xlog) != 0)
+		return -1;
+	xlog->fd = -1;
+	xlog->blocks = blocks;
+	return 0;
+}
+
+int
+xlog_create_child(struct xlog *xlog, struct xlog *parent)
+{
+	assert(parent->parent == NULL);
+	if (xlog_init(xlog) != 0)
+		return -1;
+	xlog->meta = parent->meta;
+	xlog->fd = parent->fd;
+	xlog->parent = parent;
+	snprintf(xlog->filename, PATH_MAX, "%s", parent->filename);
+	return 0;
+}
+
 /**
  * In case of error, writes a message to the error log
  * and sets errno.
@@ -827,8 +1023,26 @@ xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
 	meta.instance_uuid = *dir->instance_uuid;
 	vclock_copy(&meta.vclock, vclock);
 
-	if (xlog_create(xlog, filename, &meta) != 0)
+	/*
+	 * Take the spare file if there is one: it already has
+	 * the disk space reserved.
+	 */
+	struct xdir_spare *spare = xdir_take_spare(dir);
+	int rc = xlog_create_file(xlog, filename, &meta,
+				  spare != NULL ? spare->filename : NULL,
+				  spare != NULL ? spare->size : 0);
+	if (spare != NULL)
+		xdir_spare_delete(spare);
+	if (rc != 0)
 		return -1;
+	if (xlog->allocated_size == 0 && dir->prealloc_size > 0) {
+		/* Not fatal, the file will grow as it's written. */
+		if (xlog_fallocate(xlog->fd, dir->prealloc_size) == 0)
+			xlog->allocated_size = dir->prealloc_size;
+		else
+			say_syserror("%s: failed to preallocate",
+				     xlog->filename);
+	}
 
 	/* set sync interval from xdir settings */
 	xlog->sync_interval = dir->sync_interval;
@@ -847,14 +1061,81 @@ xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
 	return 0;
 }
 
+/** Create the spare file of a directory, runs in eio. */
+static void
+xdir_prepare_spare_f(eio_req *req)
+{
+	struct xdir_spare *spare = (struct xdir_spare *) req->data;
+	tt_pthread_mutex_lock(&spare->mutex);
+	if (spare->state == XDIR_SPARE_CANCELLED) {
+		/* The directory is gone, nobody needs the file. */
+		tt_pthread_mutex_unlock(&spare->mutex);
+		xdir_spare_delete(spare);
+		return;
+	}
+	spare->state = XDIR_SPARE_RUNNING;
+	tt_pthread_mutex_unlock(&spare->mutex);
+
+	int error = 0;
+	int fd = -1;
+	ERROR_INJECT(ERRINJ_XLOG_SPARE, {
+		error = ENOSPC;
+		goto done;
+	});
+	/* A spare left by a previous run is just reused. */
+	fd = open(spare->filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		error = errno;
+		goto done;
+	}
+	if (xlog_fallocate(fd, spare->size) != 0) {
+		error = errno;
+		unlink(spare->filename);
+	}
+	close(fd);
+done:
+	tt_pthread_mutex_lock(&spare->mutex);
+	spare->error = error;
+	spare->state = XDIR_SPARE_DONE;
+	tt_pthread_cond_signal(&spare->cond);
+	tt_pthread_mutex_unlock(&spare->mutex);
+}
+
+void
+xdir_prepare_spare(struct xdir *dir)
+{
+	if (dir->prealloc_size == 0 || dir->spare != NULL)
+		return;
+	struct xdir_spare *spare = (struct xdir_spare *)
+		malloc(sizeof(*spare));
+	if (spare == NULL) {
+		say_error("%s: failed to allocate a spare file",
+			  xdir_spare_filename(dir));
+		return;
+	}
+	tt_pthread_mutex_init(&spare->mutex, NULL);
+	tt_pthread_cond_init(&spare->cond, NULL);
+	spare->state = XDIR_SPARE_QUEUED;
+	spare->error = 0;
+	spare->size = dir->prealloc_size;
+	snprintf(spare->filename, sizeof(spare->filename), "%s",
+		 xdir_spare_filename(dir));
+	/* The job reports to the directory, not to eio. */
+	if (eio_custom(xdir_prepare_spare_f, 0, NULL, spare) == NULL) {
+		say_syserror("%s: failed to create a spare file",
+			     spare->filename);
+		xdir_spare_delete(spare);
+		return;
+	}
+	dir->spare = spare;
+}
+
 /**
- * Write a sequence of uncompressed xrow objects.
- *
- * @retval -1 error
- * @retval >= 0 the number of bytes written
+ * Prepare a block of uncompressed xrow objects for writing:
+ * populate the fixheader of the output buffer.
  */
-static off_t
-xlog_tx_write_plain(struct xlog *log)
+static void
+xlog_tx_encode_plain(struct xlog *log)
 {
 	/**
 	 * We created an obuf savepoint at start of xlog_tx,
@@ -891,36 +1172,35 @@ xlog_tx_write_plain(struct xlog *log)
 			data += padding - 1;
 		}
 	}
-
-	ERROR_INJECT(ERRINJ_WAL_WRITE_DISK, {
-		diag_set(ClientError, ER_INJECTION, "xlog write injection");
-		return -1;
-	});
-
-	ssize_t written = fio_writevn(log->fd, log->obuf.iov, log->obuf.pos + 1);
-	if (written < 0) {
-		diag_set(SystemError, "failed to write to '%s' file",
-			 log->filename);
-		return -1;
-	}
-	return obuf_size(&log->obuf);
 }
 
 /**
- * Write a compressed block of xrow objects.
+ * Compress a block of xrow objects into the compressed
+ * output buffer.
  * @retval -1  error
- * @retval >= 0 the number of bytes written
+ * @retval 0   success
  */
-static off_t
-xlog_tx_write_zstd(struct xlog *log)
+static int
+xlog_tx_encode_zstd(struct xlog *log)
 {
 	char *fixheader = (char *)obuf_alloc(&log->zbuf,
 					     XLOG_FIXHEADER_SIZE);
 
 	uint32_t crc32c = 0;
 	struct iovec *iov;
-	/* 3 is compression level. */
-	ZSTD_compressBegin(log->zctx, 3);
+	size_t rc;
+	if (log->zdict != NULL) {
+		rc = ZSTD_compressBegin_usingDict(log->zctx, log->zdict,
+						  log->zdict_size,
+						  log->compression_level);
+	} else {
+		rc = ZSTD_compressBegin(log->zctx, log->compression_level);
+	}
+	if (ZSTD_isError(rc)) {
+		diag_set(ClientError, ER_COMPRESSION, ZSTD_getErrorName(rc));
+		obuf_reset(&log->zbuf);
+		return -1;
+	}
 	size_t offset = XLOG_FIXHEADER_SIZE;
 	for (iov = log->obuf.iov; iov->iov_len; ++iov) {
 		/* Estimate max output buffer size. */
@@ -980,25 +1260,32 @@ xlog_tx_write_zstd(struct xlog *log)
 		}
 	}
 
+	return 0;
+error:
+	obuf_reset(&log->zbuf);
+	return -1;
+}
+
+/**
+ * Write an encoded block to the log file.
+ *
+ * @retval -1 error
+ * @retval >= 0 the number of bytes written
+ */
+static ssize_t
+xlog_tx_write_buf(struct xlog *log, struct iovec *iov, int iovcnt)
+{
 	ERROR_INJECT(ERRINJ_WAL_WRITE_DISK, {
 		diag_set(ClientError, ER_INJECTION, "xlog write injection");
-		obuf_reset(&log->zbuf);
-		goto error;
+		return -1;
 	});
-	ssize_t written;
-
-	written = fio_writevn(log->fd, log->zbuf.iov,
-			      log->zbuf.pos + 1);
+	ssize_t written = fio_writevn(log->fd, iov, iovcnt);
 	if (written < 0) {
 		diag_set(SystemError, "failed to write to '%s' file",
 			 log->filename);
-		goto error;
+		return -1;
 	}
-	obuf_reset(&log->zbuf);
 	return written;
-error:
-	obuf_reset(&log->zbuf);
-	return -1;
 }
 
 /* file syncing and posix_fadvise() should be rounded by a page boundary */
@@ -1007,23 +1294,14 @@ error:
 #define SYNC_ROUND_UP(size)	(SYNC_ROUND_DOWN(size + SYNC_MASK))
 
 /**
- * Writes xlog batch to file
+ * Appends an encoded xlog batch to the file of the log,
+ * syncs and throttles the file if necessary.
  */
 static ssize_t
-xlog_tx_write(struct xlog *log)
+xlog_tx_append(struct xlog *log, struct iovec *iov, int iovcnt)
 {
-	if (obuf_size(&log->obuf) == XLOG_FIXHEADER_SIZE)
-		return 0;
-	ssize_t written;
-
-	if (obuf_size(&log->obuf) >= XLOG_TX_COMPRESS_THRESHOLD) {
-		written = xlog_tx_write_zstd(log);
-	} else {
-		written = xlog_tx_write_plain(log);
-	}
+	ssize_t written = xlog_tx_write_buf(log, iov, iovcnt);
 	ERROR_INJECT(ERRINJ_WAL_WRITE, written = -1;);
-
-	obuf_reset(&log->obuf);
 	/*
 	 * Simplify recovery after a temporary write failure:
 	 * truncate the file to the best known good write
@@ -1075,6 +1353,85 @@ xlog_tx_write(struct xlog *log)
 	return written;
 }
 
+/**
+ * Move an encoded block of a detached log to a new
+ * struct xlog_block and queue it to log->blocks.
+ *
+ * @retval -1 error
+ * @retval >= 0 the size of the block
+ */
+static ssize_t
+xlog_tx_write_block(struct xlog *log, struct obuf *buf)
+{
+	size_t size = obuf_size(buf);
+	struct xlog_block *block =
+		(struct xlog_block *) malloc(sizeof(*block) + size);
+	if (block == NULL) {
+		diag_set(OutOfMemory, sizeof(*block) + size, "malloc",
+			 "struct xlog_block");
+		obuf_reset(&log->obuf);
+		obuf_reset(&log->zbuf);
+		return -1;
+	}
+	block->size = size;
+	char *pos = block->data;
+	for (int i = 0; i <= buf->pos; i++) {
+		memcpy(pos, buf->iov[i].iov_base, buf->iov[i].iov_len);
+		pos += buf->iov[i].iov_len;
+	}
+	assert(pos == block->data + size);
+	stailq_add_tail_entry(log->blocks, block, in_blocks);
+	obuf_reset(&log->obuf);
+	obuf_reset(&log->zbuf);
+	return size;
+}
+
+/**
+ * Writes xlog batch to file
+ */
+static ssize_t
+xlog_tx_write(struct xlog *log)
+{
+	if (obuf_size(&log->obuf) == XLOG_FIXHEADER_SIZE)
+		return 0;
+	struct obuf *buf;
+	/*
+	 * With a dictionary even small blocks compress well,
+	 * so the threshold only applies to plain compression.
+	 */
+	if (obuf_size(&log->obuf) < XLOG_TX_COMPRESS_THRESHOLD &&
+	    log->zdict == NULL) {
+		xlog_tx_encode_plain(log);
+		buf = &log->obuf;
+	} else if (xlog_tx_encode_zstd(log) == 0) {
+		buf = &log->zbuf;
+	} else {
+		obuf_reset(&log->obuf);
+		return -1;
+	}
+	if (log->blocks != NULL)
+		return xlog_tx_write_block(log, buf);
+	/*
+	 * The block is encoded without the lock, only
+	 * the write itself is serialized with children
+	 * sharing the file.
+	 */
+	struct xlog *file = log->parent != NULL ? log->parent : log;
+	tt_pthread_mutex_lock(&file->mutex);
+	ssize_t written = xlog_tx_append(file, buf->iov, buf->pos + 1);
+	tt_pthread_mutex_unlock(&file->mutex);
+	obuf_reset(&log->obuf);
+	obuf_reset(&log->zbuf);
+	/* Throttle outside the lock not to stall the siblings. */
+	if (written > 0 && file->io_limiter != NULL) {
+		double delay = io_limiter_write(file->io_limiter,
+						file->io_class, written);
+		if (delay > 0)
+			fiber_sleep(delay);
+	}
+	return written;
+}
+
 /*
  * Add a row to a log and possibly flush the log.
  *
@@ -1179,6 +1536,17 @@ xlog_flush(struct xlog *log)
 	return xlog_tx_write(log);
 }
 
+ssize_t
+xlog_write_block(struct xlog *log, const struct xlog_block *block)
+{
+	assert(log->parent == NULL && log->blocks == NULL);
+	struct iovec iov = { (void *) block->data, block->size };
+	tt_pthread_mutex_lock(&log->mutex);
+	ssize_t written = xlog_tx_append(log, &iov, 1);
+	tt_pthread_mutex_unlock(&log->mutex);
+	return written;
+}
+
 static int
 sync_cb(eio_req *req)
 {
@@ -1213,9 +1581,20 @@ xlog_sync(struct xlog *l)
 int
 xlog_close(struct xlog *l, bool reuse_fd)
 {
+	if (l->parent != NULL || l->blocks != NULL) {
+		/* The file is owned by the parent or there's none. */
+		xlog_destroy(l);
+		return 0;
+	}
 	int rc = fio_writen(l->fd, &eof_marker, sizeof(log_magic_t));
 	if (rc < 0)
 		say_syserror("%s: failed to write EOF marker", l->filename);
+	else
+		l->offset += sizeof(log_magic_t);
+	/* Release the reserved space the file hasn't used. */
+	if (l->allocated_size > l->offset &&
+	    ftruncate(l->fd, l->offset) != 0)
+		say_syserror("%s: failed to truncate", l->filename);
 
 	/*
 	 * Sync the file before closing, since
@@ -1426,7 +1805,8 @@ xlog_fixheader_decode(struct xlog_fixheader *fixheader,
 
 int
 xlog_tx_decode(const char *data, const char *data_end,
-	       char *rows, char *rows_end, ZSTD_DStream *zdctx)
+	       char *rows, char *rows_end, ZSTD_DStream *zdctx,
+	       const char *zdict, size_t zdict_size)
 {
 	/* Decode fixheader */
 	struct xlog_fixheader fixheader;
@@ -1461,7 +1841,16 @@ xlog_tx_decode(const char *data, const char *data_end,
 
 	/* Decompress zstd rows */
 	assert(fixheader.magic == zrow_marker);
-	ZSTD_initDStream(zdctx);
+	size_t init_rc;
+	if (zdict != NULL)
+		init_rc = ZSTD_initDStream_usingDict(zdctx, zdict, zdict_size);
+	else
+		init_rc = ZSTD_initDStream(zdctx);
+	if (ZSTD_isError(init_rc)) {
+		diag_set(ClientError, ER_DECOMPRESSION,
+			 ZSTD_getErrorName(init_rc));
+		return -1;
+	}
 	int rc = xlog_cursor_decompress(&rows, rows_end, &data, data_end,
 					zdctx);
 	if (rc < 0) {
@@ -1485,7 +1874,8 @@ xlog_tx_decode(const char *data, const char *data_end,
 ssize_t
 xlog_tx_cursor_create(struct xlog_tx_cursor *tx_cursor,
 		      const char **data, const char *data_end,
-		      ZSTD_DStream *zdctx)
+		      ZSTD_DStream *zdctx, const char *zdict,
+		      size_t zdict_size)
 {
 	const char *rpos = *data;
 	struct xlog_fixheader fixheader;
@@ -1522,7 +1912,17 @@ xlog_tx_cursor_create(struct xlog_tx_cursor *tx_cursor,
 	};
 
 	assert(fixheader.magic == zrow_marker);
-	ZSTD_initDStream(zdctx);
+	size_t init_rc;
+	if (zdict != NULL)
+		init_rc = ZSTD_initDStream_usingDict(zdctx, zdict, zdict_size);
+	else
+		init_rc = ZSTD_initDStream(zdctx);
+	if (ZSTD_isError(init_rc)) {
+		diag_set(ClientError, ER_DECOMPRESSION,
+			 ZSTD_getErrorName(init_rc));
+		ibuf_destroy(&tx_cursor->rows);
+		return -1;
+	}
 	int rc;
 	do {
 		if (ibuf_reserve(&tx_cursor->rows,
@@ -1617,7 +2017,9 @@ xlog_cursor_next_tx(struct xlog_cursor *i)
 	ssize_t to_load;
 	while ((to_load = xlog_tx_cursor_create(&i->tx_cursor,
 						(const char **)&i->rbuf.rpos,
-						i->rbuf.wpos, i->zdctx)) > 0) {
+						i->rbuf.wpos, i->zdctx,
+						i->zdict,
+						i->zdict_size)) > 0) {
 		/* not enough data in read buffer */
 		int rc = xlog_cursor_ensure(i, ibuf_used(&i->rbuf) + to_load);
 		if (rc < 0)
@@ -1801,6 +2203,7 @@ xlog_cursor_close(struct xlog_cursor *i, bool reuse_fd)
 	if (i->state == XLOG_CURSOR_TX)
 		xlog_tx_cursor_destroy(&i->tx_cursor);
 	ZSTD_freeDStream(i->zdctx);
+	free(i->zdict);
 	TRASH(i);
 	i->state = XLOG_CURSOR_CLOSED;
 }
@@ -33,14 +33,17 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <sys/stat.h>
+#include <pthread.h>
 #include "tt_uuid.h"
 #include "vclock.h"
+#include "io_limiter.h"
 
 #define ZSTD_STATIC_LINKING_ONLY
 #include "zstd.h"
 
 #include "small/ibuf.h"
 #include "small/obuf.h"
+#include "salad/stailq.h"
 
 struct iovec;
 struct xrow_header;
@@ -67,6 +70,11 @@ enum xdir_type { SNAP, XLOG };
  */
 enum log_suffix { NONE, INPROGRESS };
 
+/** zstd compression level of a new xlog. */
+enum { XLOG_COMPRESSION_LEVEL = 3 };
+
+struct xdir_spare;
+
 /**
  * A handle for a data directory with write ahead logs or snapshots.
  * Can be used to find the last log in the directory, scan
@@ -132,6 +140,16 @@ struct xdir {
 	 * corresponding file cache will be marked as free
 	 */
 	uint64_t sync_interval;
+	/**
+	 * How much disk space to reserve for a new file,
+	 * in bytes. 0 means files grow as they are written.
+	 */
+	off_t prealloc_size;
+	/**
+	 * The spare file, being created in an eio thread or
+	 * ready to become a new log. NULL if there is none.
+	 */
+	struct xdir_spare *spare;
 };
 
 /**
@@ -261,6 +279,11 @@ struct xlog {
 	bool is_autocommit;
 	/** The current offset in the log file, for writing. */
 	off_t offset;
+	/**
+	 * Disk space reserved for the file at creation, the
+	 * unused part of it is released at close.
+	 */
+	off_t allocated_size;
 	/**
 	 * Output buffer, works as row accumulator for
 	 * compression.
@@ -272,6 +295,16 @@ struct xlog {
 	 * Compressed output buffer
 	 */
 	struct obuf zbuf;
+	/** zstd compression level of the log blocks. */
+	int compression_level;
+	/**
+	 * Raw content zstd dictionary to compress blocks with
+	 * or NULL, owned by the caller. Blocks compressed with
+	 * a dictionary can only be decoded by xlog_tx_decode()
+	 * given the same dictionary.
+	 */
+	const char *zdict;
+	size_t zdict_size;
 	/**
 	 * Sync interval in bytes.
 	 * xlog file will be synced every sync_interval bytes,
@@ -293,8 +326,46 @@ struct xlog {
 	 * Write rate limit
 	 */
 	uint64_t rate_limit;
+	/**
+	 * Limiter of the bandwidth shared with other background
+	 * writers or NULL. In contrast to rate_limit, it limits
+	 * all logs using it together.
+	 */
+	struct io_limiter *io_limiter;
+	/** Class of writes to this log, used by io_limiter. */
+	enum io_class io_class;
 	/** Time when xlog wast synced last time */
 	double sync_time;
+	/**
+	 * The log this one appends its blocks to, or NULL if
+	 * the log owns its file. @sa xlog_create_child().
+	 */
+	struct xlog *parent;
+	/**
+	 * Serializes writes of child logs to the file
+	 * of this log.
+	 */
+	pthread_mutex_t mutex;
+	/**
+	 * The list of struct xlog_block the log queues encoded
+	 * blocks to, or NULL if the log writes them to a file.
+	 * @sa xlog_create_detached().
+	 */
+	struct stailq *blocks;
+};
+
+/**
+ * A block of rows encoded by a detached xlog, ready to be
+ * appended to a file with xlog_write_block(). Allocated with
+ * malloc(), so it may be freed by any thread with free().
+ */
+struct xlog_block {
+	/** Link in xlog->blocks. */
+	struct stailq_entry in_blocks;
+	/** Size of the block data. */
+	size_t size;
+	/** Fixheader followed by the plain or compressed rows. */
+	char data[0];
 };
 
 /**
@@ -315,6 +386,16 @@ int
 xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
 		 const struct vclock *vclock);
 
+/**
+ * Start creation of a spare file in the background, so that
+ * the next xdir_create_xlog() only has to rename it. The
+ * file gets dir->prealloc_size bytes of disk space reserved.
+ * Does nothing if preallocation is off or a spare file
+ * already exists or is being created.
+ */
+void
+xdir_prepare_spare(struct xdir *dir);
+
 /**
  * Create new xlog writer based on fd.
  * @param fd            file descriptor
@@ -340,6 +421,44 @@ xlog_create(struct xlog *xlog, const char *name,
 int
 xlog_open(struct xlog *xlog, const char *name);
 
+/**
+ * Create a child writer of an open xlog. The child has its
+ * own row buffer and compression context, but appends the
+ * blocks it produces to the file of the parent, so several
+ * threads may fill a single file at once (the order of rows
+ * written by different children is not defined). File offset,
+ * syncs and rate_limit of the parent are shared by all its
+ * children. Must be called from the thread using the child.
+ * The child is destroyed with xlog_close(), which does not
+ * write an EOF marker or touch the parent file.
+ *
+ * @param xlog          child xlog descriptor
+ * @param parent        the xlog to append to
+ *
+ * @retval 0 success
+ * @retval -1 error
+ */
+int
+xlog_create_child(struct xlog *xlog, struct xlog *parent);
+
+/**
+ * Create a detached xlog, which has no file: the blocks
+ * it encodes on xlog_tx_commit() and xlog_flush() are
+ * queued to @a blocks instead of being written. This allows
+ * to encode and compress rows in one thread and to write
+ * them with xlog_write_block() in another. Must be called
+ * from the thread using the log. The log is destroyed with
+ * xlog_close(), the blocks left in the list are not freed.
+ *
+ * @param xlog          xlog descriptor
+ * @param blocks        the list to queue blocks to
+ *
+ * @retval 0 success
+ * @retval -1 error
+ */
+int
+xlog_create_detached(struct xlog *xlog, struct stailq *blocks);
+
 /**
  * Rename xlog
  *
@@ -387,6 +506,16 @@ xlog_tx_rollback(struct xlog *log);
 ssize_t
 xlog_flush(struct xlog *log);
 
+/**
+ * Append a block encoded by a detached xlog to the file
+ * of the log.
+ *
+ * @retval -1 error, check diag
+ * @retval >= 0 the number of bytes written
+ */
+ssize_t
+xlog_write_block(struct xlog *log, const struct xlog_block *block);
+
 
 /**
  * Sync a log file. The exact action is defined
@@ -429,6 +558,8 @@ struct xlog_tx_cursor
  * Create xlog tx iterator from memory data.
  * *data will be adjusted to end of tx
  *
+ * @param zdict the dictionary the tx was compressed with or NULL
+ * @param zdict_size the size of @a zdict
  * @retval 0 for Ok
  * @retval -1 for error
  * @retval >0 how many additional bytes should be read to parse tx
@@ -436,7 +567,8 @@ struct xlog_tx_cursor
 ssize_t
 xlog_tx_cursor_create(struct xlog_tx_cursor *cursor,
 		      const char **data, const char *data_end,
-		      ZSTD_DStream *zdctx);
+		      ZSTD_DStream *zdctx, const char *zdict,
+		      size_t zdict_size);
 
 /**
  * Destroy xlog tx cursor and free all associated memory
@@ -462,13 +594,16 @@ xlog_tx_cursor_next_row(struct xlog_tx_cursor *tx_cursor, struct xrow_header *xr
  * @param data_end the end of @a data buffer
  * @param[out] rows a buffer to store decoded rows
  * @param[out] rows_end the end of @a rows buffer
+ * @param zdict the dictionary the tx was compressed with or NULL
+ * @param zdict_size the size of @a zdict
  * @retval  0 success
  * @retval -1 error, check diag
  */
 int
 xlog_tx_decode(const char *data, const char *data_end,
 	       char *rows, char *rows_end,
-	       ZSTD_DStream *zdctx);
+	       ZSTD_DStream *zdctx, const char *zdict,
+	       size_t zdict_size);
 
 /* }}} */
 
@@ -505,6 +640,13 @@ struct xlog_cursor
 	struct xlog_tx_cursor tx_cursor;
 	/** ZSTD context for decompression */
 	ZSTD_DStream *zdctx;
+	/**
+	 * The dictionary compressed blocks of the file are
+	 * decoded with or NULL, see xlog::zdict. Owned by the
+	 * cursor and freed on close.
+	 */
+	char *zdict;
+	size_t zdict_size;
 };
 
 /**
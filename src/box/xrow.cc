@@ -90,6 +90,9 @@ error:
 		case IPROTO_SCHEMA_ID:
 			header->schema_id = mp_decode_uint(pos);
 			break;
+		case IPROTO_STREAM_ID:
+			header->stream_id = mp_decode_uint(pos);
+			break;
 		default:
 			/* unknown header */
 			mp_next(pos);
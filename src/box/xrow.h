@@ -58,6 +58,8 @@ struct xrow_header {
 
 	int bodycnt;
 	uint32_t schema_id;
+	/** iproto stream of the request, 0 if none. */
+	uint64_t stream_id;
 	struct iovec body[XROW_BODY_IOVMAX];
 
 };
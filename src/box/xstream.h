@@ -38,15 +38,31 @@ struct xrow_header;
 struct xstream;
 
 typedef void (*xstream_write_f)(struct xstream *, struct xrow_header *);
+typedef void (*xstream_flush_f)(struct xstream *);
+typedef void (*xstream_abort_f)(struct xstream *);
 
 struct xstream {
 	xstream_write_f write;
+	/**
+	 * Optional. Called when the producer has no more rows
+	 * at hand, so that a stream which buffers rows can
+	 * push them out.
+	 */
+	xstream_flush_f flush;
+	/**
+	 * Optional. Called when the producer stops without
+	 * a flush, e.g. on error, so that a stream which
+	 * buffers rows can discard them.
+	 */
+	xstream_abort_f abort;
 };
 
 static inline void
 xstream_create(struct xstream *xstream, xstream_write_f write)
 {
 	xstream->write = write;
+	xstream->flush = NULL;
+	xstream->abort = NULL;
 }
 
 static inline void
@@ -55,4 +71,18 @@ xstream_write(struct xstream *stream, struct xrow_header *row)
 	return stream->write(stream, row);
 }
 
+static inline void
+xstream_flush(struct xstream *stream)
+{
+	if (stream->flush != NULL)
+		stream->flush(stream);
+}
+
+static inline void
+xstream_abort(struct xstream *stream)
+{
+	if (stream->abort != NULL)
+		stream->abort(stream);
+}
+
 #endif /* TARANTOOL_XSTREAM_H_INCLUDED */
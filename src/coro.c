@@ -34,7 +34,6 @@
 #include <unistd.h>
 #include <string.h>
 #include <sys/mman.h>
-#include "small/slab_cache.h"
 #include "third_party/valgrind/memcheck.h"
 #include "diag.h"
 #if ENABLE_ASAN
@@ -42,24 +41,44 @@
 #endif
 
 int
-tarantool_coro_create(struct tarantool_coro *coro,
-		      struct slab_cache *slabc,
-		      void (*f) (void *), void *data)
+tarantool_coro_create(struct tarantool_coro *coro, size_t stack_size,
+		      bool guard, void (*f) (void *), void *data)
 {
-	const int page = sysconf(_SC_PAGESIZE);
+	const size_t page = sysconf(_SC_PAGESIZE);
 
 	memset(coro, 0, sizeof(*coro));
 
-	/* TODO: guard pages */
-	coro->stack_size = page * 16 - slab_sizeof();
-	coro->stack = (char *) slab_get(slabc, coro->stack_size)
-					+ slab_sizeof();
-
-	if (coro->stack == NULL) {
-		diag_set(OutOfMemory, coro->stack_size + slab_sizeof(),
-			 "runtime arena", "coro stack");
+	/*
+	 * Map the stack separately from the rest of the runtime
+	 * memory and, if asked, protect the page right below it,
+	 * so that a stack overflow crashes the process instead
+	 * of silently corrupting adjacent memory. Pages are only
+	 * backed by physical memory when touched.
+	 *
+	 * A guard page costs an extra system call and splits the
+	 * mapping in two, and the number of mappings a process
+	 * may have is limited (vm.max_map_count on Linux), hence
+	 * guard pages are optional. Unguarded stacks are mapped
+	 * with the same protection, so the kernel merges them.
+	 */
+	size_t guard_size = guard ? page : 0;
+	stack_size = (stack_size + page - 1) / page * page;
+	size_t map_size = stack_size + guard_size;
+	char *map = (char *) mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+				  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (map == MAP_FAILED) {
+		diag_set(OutOfMemory, map_size, "mmap", "coro stack");
+		return -1;
+	}
+	/* The stack grows down, the guard page is at the bottom. */
+	if (guard_size > 0 && mprotect(map, guard_size, PROT_NONE) != 0) {
+		diag_set(SystemError, "failed to protect coro stack");
+		munmap(map, map_size);
 		return -1;
 	}
+	coro->stack = map + guard_size;
+	coro->stack_size = stack_size;
+	coro->guard_size = guard_size;
 
 	coro->stack_id = VALGRIND_STACK_REGISTER(coro->stack,
 						 (char *) coro->stack +
@@ -70,14 +89,14 @@ tarantool_coro_create(struct tarantool_coro *coro,
 }
 
 void
-tarantool_coro_destroy(struct tarantool_coro *coro, struct slab_cache *slabc)
+tarantool_coro_destroy(struct tarantool_coro *coro)
 {
 	if (coro->stack != NULL) {
 		VALGRIND_STACK_DEREGISTER(coro->stack_id);
 #if ENABLE_ASAN
 		ASAN_UNPOISON_MEMORY_REGION(coro->stack, coro->stack_size);
 #endif
-		slab_put(slabc, (struct slab *)
-			 ((char *) coro->stack - slab_sizeof()));
+		munmap((char *) coro->stack - coro->guard_size,
+		       coro->stack_size + coro->guard_size);
 	}
 }
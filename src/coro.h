@@ -31,6 +31,7 @@
  * SUCH DAMAGE.
  */
 #include <stddef.h> /* size_t */
+#include <stdbool.h>
 
 #include <third_party/coro/coro.h>
 
@@ -42,19 +43,22 @@ struct tarantool_coro {
 	coro_context ctx;
 	void *stack;
 	size_t stack_size;
+	/** Size of the guard page below the stack, 0 if none. */
+	size_t guard_size;
 	/** Valgrind stack id. */
 	unsigned int stack_id;
 };
 
-struct slab_cache;
-
+/**
+ * Create a coroutine with a stack of the given size, rounded
+ * up to the page size. If @guard is set, the stack is
+ * protected with a guard page.
+ */
 int
-tarantool_coro_create(struct tarantool_coro *ctx,
-		      struct slab_cache *cache,
-		      void (*f) (void *), void *data);
+tarantool_coro_create(struct tarantool_coro *ctx, size_t stack_size,
+		      bool guard, void (*f) (void *), void *data);
 void
-tarantool_coro_destroy(struct tarantool_coro *ctx,
-		       struct slab_cache *cache);
+tarantool_coro_destroy(struct tarantool_coro *ctx);
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
@@ -78,6 +78,11 @@ static struct cord main_cord;
 __thread struct cord *cord_ptr = NULL;
 pthread_t main_thread_id;
 
+/** Stack size of newly created fibers. */
+static size_t fiber_stack_size = FIBER_STACK_SIZE_DEFAULT;
+/** Whether stacks of newly created fibers have a guard page. */
+static bool fiber_stack_guard = true;
+
 static void
 update_last_stack_frame(struct fiber *fiber)
 {
@@ -617,6 +622,68 @@ fiber_set_key(struct fiber *fiber, enum fiber_key key, void *value);
 extern inline void *
 fiber_get_key(struct fiber *fiber, enum fiber_key key);
 
+void
+fiber_set_stack_size(size_t stack_size)
+{
+	assert(stack_size >= FIBER_STACK_SIZE_MIN);
+	fiber_stack_size = stack_size;
+}
+
+void
+fiber_set_stack_guard(bool guard)
+{
+	fiber_stack_guard = guard;
+}
+
+/**
+ * Allocate a fiber structure and its stack. The fiber
+ * is not linked to any cord list.
+ */
+static struct fiber *
+fiber_alloc(struct cord *cord)
+{
+	struct fiber *fiber = (struct fiber *)
+		mempool_alloc(&cord->fiber_mempool);
+	if (fiber == NULL) {
+		diag_set(OutOfMemory, sizeof(struct fiber),
+			 "fiber pool", "fiber");
+		return NULL;
+	}
+	memset(fiber, 0, sizeof(struct fiber));
+
+	if (tarantool_coro_create(&fiber->coro, fiber_stack_size,
+				  fiber_stack_guard, fiber_loop, NULL)) {
+		mempool_free(&cord->fiber_mempool, fiber);
+		return NULL;
+	}
+
+	region_create(&fiber->gc, &cord->slabc);
+
+	rlist_create(&fiber->state);
+	rlist_create(&fiber->wake);
+	diag_create(&fiber->diag);
+	fiber_reset(fiber);
+	return fiber;
+}
+
+int
+fiber_reserve(int count)
+{
+	struct cord *cord = cord();
+	struct fiber *fiber;
+	rlist_foreach_entry(fiber, &cord->dead, link) {
+		if (--count <= 0)
+			return 0;
+	}
+	for (; count > 0; count--) {
+		fiber = fiber_alloc(cord);
+		if (fiber == NULL)
+			return -1;
+		rlist_add_tail_entry(&cord->dead, fiber, link);
+	}
+	return 0;
+}
+
 /**
  * Create a new fiber.
  *
@@ -639,28 +706,9 @@ fiber_new(const char *name, fiber_func f)
 					  struct fiber, link);
 		rlist_move_entry(&cord->alive, fiber, link);
 	} else {
-		fiber = (struct fiber *)
-			mempool_alloc(&cord->fiber_mempool);
-		if (fiber == NULL) {
-			diag_set(OutOfMemory, sizeof(struct fiber),
-				 "fiber pool", "fiber");
-			return NULL;
-		}
-		memset(fiber, 0, sizeof(struct fiber));
-
-		if (tarantool_coro_create(&fiber->coro, &cord->slabc,
-					  fiber_loop, NULL)) {
-			mempool_free(&cord->fiber_mempool, fiber);
+		fiber = fiber_alloc(cord);
+		if (fiber == NULL)
 			return NULL;
-		}
-
-		region_create(&fiber->gc, &cord->slabc);
-
-		rlist_create(&fiber->state);
-		rlist_create(&fiber->wake);
-		diag_create(&fiber->diag);
-		fiber_reset(fiber);
-
 		rlist_add_entry(&cord->alive, fiber, link);
 	}
 
@@ -695,7 +743,7 @@ fiber_destroy(struct cord *cord, struct fiber *f)
 	trigger_destroy(&f->on_stop);
 	rlist_del(&f->state);
 	region_destroy(&f->gc);
-	tarantool_coro_destroy(&f->coro, &cord->slabc);
+	tarantool_coro_destroy(&f->coro);
 	diag_destroy(&f->diag);
 }
 
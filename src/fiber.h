@@ -423,6 +423,38 @@ cord_is_main();
 void
 fiber_init(int (*fiber_invoke)(fiber_func f, va_list ap));
 
+enum {
+	/** Minimal allowed fiber stack size. */
+	FIBER_STACK_SIZE_MIN = 16 * 1024,
+	/** Fiber stack size used unless configured otherwise. */
+	FIBER_STACK_SIZE_DEFAULT = 64 * 1024,
+};
+
+/**
+ * Set the stack size of fibers created from now on.
+ * Fibers already cached by cords keep their stacks.
+ */
+void
+fiber_set_stack_size(size_t stack_size);
+
+/**
+ * Set whether stacks of fibers created from now on are
+ * protected with a guard page. On by default.
+ */
+void
+fiber_set_stack_guard(bool guard);
+
+/**
+ * Make sure that at least @count fibers with allocated stacks
+ * are cached in the current cord, so that fiber_new() doesn't
+ * have to allocate memory for a burst of up to @count fibers.
+ *
+ * @retval  0 success
+ * @retval -1 out of memory, check diag
+ */
+int
+fiber_reserve(int count);
+
 void
 fiber_free(void);
 
@@ -154,6 +154,12 @@
  * struct bps_tree_iterator bps_tree_lower_bound(tree, key, exact);
  * struct bps_tree_iterator bps_tree_upper_bound(tree, key, exact);
  * size_t bps_tree_approxiamte_count(tree, key);
+ * // with BPS_TREE_CHILD_COUNTS only:
+ * struct bps_tree_iterator bps_tree_lower_bound_get_offset(tree, key, exact,
+ *                                                          offset);
+ * struct bps_tree_iterator bps_tree_upper_bound_get_offset(tree, key, exact,
+ *                                                          offset);
+ * struct bps_tree_iterator bps_tree_iterator_at(tree, offset);
  * bps_tree_elem_t *bps_tree_iterator_get_elem(tree, itr);
  * bool bps_tree_iterator_next(tree, itr);
  * bool bps_tree_iterator_prev(tree, itr);
@@ -279,6 +285,18 @@
  * #define BPS_BLOCK_LINEAR_SEARCH
  */
 
+/**
+ * A switch that makes the tree maintain the number of elements in
+ * every subtree. Each inner block stores the element count of every
+ * child next to its ID, which makes the position (offset) of an
+ * element and an element by its position available in logarithmic
+ * time, see bps_tree_lower_bound_get_offset, bps_tree_iterator_at.
+ * The price is a lower fan-out of inner blocks and an update of
+ * all blocks on the path to the root on every insertion and
+ * deletion. To turn it on,
+ * #define BPS_TREE_CHILD_COUNTS
+ */
+
 /**
  * A switch that enables collection of executions of different
  * branches of code. Used only for debug purposes, I hope you
@@ -358,6 +376,9 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_lower_bound _api_name(lower_bound)
 #define bps_tree_upper_bound _api_name(upper_bound)
 #define bps_tree_approximate_count _api_name(approximate_count)
+#define bps_tree_lower_bound_get_offset _api_name(lower_bound_get_offset)
+#define bps_tree_upper_bound_get_offset _api_name(upper_bound_get_offset)
+#define bps_tree_iterator_at _api_name(iterator_at)
 #define bps_tree_iterator_get_elem _api_name(iterator_get_elem)
 #define bps_tree_iterator_next _api_name(iterator_next)
 #define bps_tree_iterator_prev _api_name(iterator_prev)
@@ -397,6 +418,12 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_touch_leaf_path_max_elem _bps_tree(touch_leaf_path_max_elem)
 #define bps_tree_touch_path _bps_tree(touch_path_max_elem)
 #define bps_tree_process_replace _bps_tree(process_replace)
+#define bps_tree_subtree_count _bps_tree(subtree_count)
+#define bps_tree_set_child_count _bps_tree(set_child_count)
+#define bps_tree_update_leaf_count _bps_tree(update_leaf_count)
+#define bps_tree_update_inner_count _bps_tree(update_inner_count)
+#define bps_tree_update_leaf_counts _bps_tree(update_leaf_counts)
+#define bps_tree_update_inner_counts _bps_tree(update_inner_counts)
 #define bps_tree_debug_memmove _bps_tree(debug_memmove)
 #define bps_tree_insert_into_leaf _bps_tree(insert_into_leaf)
 #define bps_tree_insert_into_inner _bps_tree(insert_into_inner)
@@ -733,6 +760,54 @@ bps_tree_upper_bound(const struct bps_tree *tree, bps_tree_key_t key,
 static inline size_t
 bps_tree_approximate_count(const struct bps_tree *tree, bps_tree_key_t key);
 
+#ifdef BPS_TREE_CHILD_COUNTS
+
+/**
+ * @brief Same as bps_tree_lower_bound, but also calculates the offset
+ * of the found element, i.e. the number of elements that are less
+ * than the key. Requires BPS_TREE_CHILD_COUNTS.
+ * @param tree - pointer to a tree
+ * @param key - key that will be compared with elements
+ * @param exact - see bps_tree_lower_bound. Pass NULL if you don't need it.
+ * @param offset - receives the offset of the found element, or the size
+ *  of the tree if the returned iterator is invalid.
+ * @return - Lower-bound iterator. Invalid if all elements are less than key.
+ */
+static inline struct bps_tree_iterator
+bps_tree_lower_bound_get_offset(const struct bps_tree *tree,
+				bps_tree_key_t key, bool *exact,
+				size_t *offset);
+
+/**
+ * @brief Same as bps_tree_upper_bound, but also calculates the offset
+ * of the found element, i.e. the number of elements that are less
+ * than or equal to the key. Requires BPS_TREE_CHILD_COUNTS.
+ * @param tree - pointer to a tree
+ * @param key - key that will be compared with elements
+ * @param exact - see bps_tree_upper_bound. Pass NULL if you don't need it.
+ * @param offset - receives the offset of the found element, or the size
+ *  of the tree if the returned iterator is invalid.
+ * @return - Upper-bound iterator. Invalid if all elements are less or equal
+ *  than the key.
+ */
+static inline struct bps_tree_iterator
+bps_tree_upper_bound_get_offset(const struct bps_tree *tree,
+				bps_tree_key_t key, bool *exact,
+				size_t *offset);
+
+/**
+ * @brief Get an iterator to the element with the given offset, i.e.
+ * to the element that has exactly @a offset elements before it.
+ * Requires BPS_TREE_CHILD_COUNTS.
+ * @param tree - pointer to a tree
+ * @param offset - position of the element, counting from 0
+ * @return - Iterator to the element. Invalid if offset >= tree size.
+ */
+static inline struct bps_tree_iterator
+bps_tree_iterator_at(const struct bps_tree *tree, size_t offset);
+
+#endif /* BPS_TREE_CHILD_COUNTS */
+
 /**
  * @brief Get a pointer to the element pointed by iterator.
  *  If iterator is detected as broken, it is invalidated and NULL returned.
@@ -837,6 +912,23 @@ bps_tree_debug_check_internal_functions(bool assertme);
 /* Same as BPS_TREE_MEMMOVE but takes count of values instead of memory size */
 #define BPS_TREE_DATAMOVE(dst, src, num, dst_bck, src_bck) \
 	BPS_TREE_MEMMOVE(dst, src, (num) * sizeof((dst)[0]), dst_bck, src_bck)
+#ifdef BPS_TREE_CHILD_COUNTS
+/* Child counts of inner blocks follow the moves of child IDs */
+#define BPS_TREE_COUNTMOVE(dst, src, num) \
+	memmove(dst, src, (num) * sizeof((dst)[0]))
+#define BPS_TREE_COUNTSET(dst, count) ((dst) = (count))
+/* Size of a child reference in an inner block */
+#define BPS_TREE_INNER_CHILD_SIZE \
+	(sizeof(bps_tree_elem_t) + sizeof(bps_tree_block_id_t) + sizeof(size_t))
+/* Alignment of child counts may take up to that amount of bytes */
+#define BPS_TREE_INNER_PADDING sizeof(size_t)
+#else
+#define BPS_TREE_COUNTMOVE(dst, src, num) ((void)0)
+#define BPS_TREE_COUNTSET(dst, count) ((void)(count))
+#define BPS_TREE_INNER_CHILD_SIZE \
+	(sizeof(bps_tree_elem_t) + sizeof(bps_tree_block_id_t))
+#define BPS_TREE_INNER_PADDING 0
+#endif
 
 /**
  * Types of a block
@@ -866,8 +958,9 @@ enum bps_tree_max_sizes {
 		 - 2 * sizeof(bps_tree_block_id_t) )
 		/ sizeof(bps_tree_elem_t),
 	BPS_TREE_MAX_COUNT_IN_INNER =
-		(BPS_TREE_BLOCK_SIZE - sizeof(struct bps_block))
-		/ (sizeof(bps_tree_elem_t) + sizeof(bps_tree_block_id_t)),
+		(BPS_TREE_BLOCK_SIZE - sizeof(struct bps_block)
+		 - BPS_TREE_INNER_PADDING)
+		/ BPS_TREE_INNER_CHILD_SIZE,
 	BPS_TREE_MAX_DEPTH = 16
 };
 
@@ -913,6 +1006,10 @@ struct bps_inner {
 	bps_tree_elem_t elems[BPS_TREE_MAX_COUNT_IN_INNER - 1];
 	/* Corresponding child IDs */
 	bps_tree_block_id_t child_ids[BPS_TREE_MAX_COUNT_IN_INNER];
+#ifdef BPS_TREE_CHILD_COUNTS
+	/* Number of elements in the corresponding child subtrees */
+	size_t child_counts[BPS_TREE_MAX_COUNT_IN_INNER];
+#endif
 };
 
 /**
@@ -1123,6 +1220,8 @@ bps_tree_build(struct bps_tree *tree, bps_tree_elem_t *sorted_array,
 			}
 			parents[i]->child_ids[parents[i]->header.size] =
 				insert_id;
+			BPS_TREE_COUNTSET(parents[i]->child_counts[
+				parents[i]->header.size], 0);
 			if (new_id == (bps_tree_block_id_t)-1)
 				break;
 			if (i == depth - 2) {
@@ -1132,6 +1231,12 @@ bps_tree_build(struct bps_tree *tree, bps_tree_elem_t *sorted_array,
 			}
 		}
 
+#ifdef BPS_TREE_CHILD_COUNTS
+		/* The leaf belongs to the last child on every level */
+		for (bps_tree_block_id_t i = 0; i < depth - 1; i++)
+			parents[i]->child_counts[parents[i]->header.size] +=
+				leaf->header.size;
+#endif
 		bps_tree_elem_t insert_value = current[leaf->header.size - 1];
 		for (bps_tree_block_id_t i = 0; i < depth - 1; i++) {
 			parents[i]->header.size++;
@@ -1747,6 +1852,166 @@ bps_tree_approximate_count(const struct bps_tree *tree, bps_tree_key_t key)
 	return result;
 }
 
+#ifdef BPS_TREE_CHILD_COUNTS
+
+/**
+ * @brief Get an iterator to the first element that is greater
+ * than or equal to the key along with the offset of the element.
+ * @param tree - pointer to a tree
+ * @param key - key that will be compared with elements
+ * @param exact - pointer to a bool value, that will be set to true if
+ *  and element pointed by the iterator is equal to the key, false otherwise
+ *  Pass NULL if you don't need that info.
+ * @param offset - receives the number of elements before the found one
+ * @return - Lower-bound iterator. Invalid if all elements are less than key.
+ */
+static inline struct bps_tree_iterator
+bps_tree_lower_bound_get_offset(const struct bps_tree *tree,
+				bps_tree_key_t key, bool *exact,
+				size_t *offset)
+{
+	struct bps_tree_iterator res;
+	matras_head_read_view(&res.view);
+	bool local_result;
+	if (!exact)
+		exact = &local_result;
+	*exact = false;
+	*offset = 0;
+	if (tree->root_id == (bps_tree_block_id_t)(-1)) {
+		res.block_id = (bps_tree_block_id_t)(-1);
+		res.pos = 0;
+		return res;
+	}
+	struct bps_block *block = bps_tree_root(tree);
+	bps_tree_block_id_t block_id = tree->root_id;
+	for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+		struct bps_inner *inner = (struct bps_inner *)block;
+		bps_tree_pos_t pos;
+		pos = bps_tree_find_ins_point_key(tree, inner->elems,
+						  inner->header.size - 1,
+						  key, exact);
+		for (bps_tree_pos_t j = 0; j < pos; j++)
+			*offset += inner->child_counts[j];
+		block_id = inner->child_ids[pos];
+		block = bps_tree_restore_block(tree, block_id);
+	}
+
+	struct bps_leaf *leaf = (struct bps_leaf *)block;
+	bps_tree_pos_t pos;
+	pos = bps_tree_find_ins_point_key(tree, leaf->elems, leaf->header.size,
+					  key, exact);
+	*offset += pos;
+	if (pos >= leaf->header.size) {
+		res.block_id = leaf->next_id;
+		res.pos = 0;
+	} else {
+		res.block_id = block_id;
+		res.pos = pos;
+	}
+	return res;
+}
+
+/**
+ * @brief Get an iterator to the first element that is greater than
+ * the key along with the offset of the element.
+ * @param tree - pointer to a tree
+ * @param key - key that will be compared with elements
+ * @param exact - pointer to a bool value, that will be set to true if
+ *  and element pointed by the (!)previous iterator is equal to the key,
+ *  false otherwise. Pass NULL if you don't need that info.
+ * @param offset - receives the number of elements before the found one
+ * @return - Upper-bound iterator. Invalid if all elements are less or equal
+ *  than the key.
+ */
+static inline struct bps_tree_iterator
+bps_tree_upper_bound_get_offset(const struct bps_tree *tree,
+				bps_tree_key_t key, bool *exact,
+				size_t *offset)
+{
+	struct bps_tree_iterator res;
+	matras_head_read_view(&res.view);
+	bool local_result;
+	if (!exact)
+		exact = &local_result;
+	*exact = false;
+	*offset = 0;
+	bool exact_test;
+	if (tree->root_id == (bps_tree_block_id_t)(-1)) {
+		res.block_id = (bps_tree_block_id_t)(-1);
+		res.pos = 0;
+		return res;
+	}
+	struct bps_block *block = bps_tree_root(tree);
+	bps_tree_block_id_t block_id = tree->root_id;
+	for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+		struct bps_inner *inner = (struct bps_inner *)block;
+		bps_tree_pos_t pos;
+		pos = bps_tree_find_after_ins_point_key(tree, inner->elems,
+							inner->header.size - 1,
+							key, &exact_test);
+		if (exact_test)
+			*exact = true;
+		for (bps_tree_pos_t j = 0; j < pos; j++)
+			*offset += inner->child_counts[j];
+		block_id = inner->child_ids[pos];
+		block = bps_tree_restore_block(tree, block_id);
+	}
+
+	struct bps_leaf *leaf = (struct bps_leaf *)block;
+	bps_tree_pos_t pos;
+	pos = bps_tree_find_after_ins_point_key(tree, leaf->elems,
+						leaf->header.size,
+						key, &exact_test);
+	if (exact_test)
+		*exact = true;
+	*offset += pos;
+	if (pos >= leaf->header.size) {
+		res.block_id = leaf->next_id;
+		res.pos = 0;
+	} else {
+		res.block_id = block_id;
+		res.pos = pos;
+	}
+	return res;
+}
+
+/**
+ * @brief Get an iterator to the element with the given offset.
+ * @param tree - pointer to a tree
+ * @param offset - number of elements before the requested one
+ * @return - Iterator to the element. Invalid if offset >= tree size.
+ */
+static inline struct bps_tree_iterator
+bps_tree_iterator_at(const struct bps_tree *tree, size_t offset)
+{
+	struct bps_tree_iterator res;
+	matras_head_read_view(&res.view);
+	if (offset >= tree->size) {
+		res.block_id = (bps_tree_block_id_t)(-1);
+		res.pos = 0;
+		return res;
+	}
+	struct bps_block *block = bps_tree_root(tree);
+	bps_tree_block_id_t block_id = tree->root_id;
+	for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+		struct bps_inner *inner = (struct bps_inner *)block;
+		bps_tree_pos_t pos = 0;
+		while (offset >= inner->child_counts[pos]) {
+			offset -= inner->child_counts[pos];
+			pos++;
+			assert(pos < inner->header.size);
+		}
+		block_id = inner->child_ids[pos];
+		block = bps_tree_restore_block(tree, block_id);
+	}
+	assert(offset < (size_t)block->size);
+	res.block_id = block_id;
+	res.pos = (bps_tree_pos_t)offset;
+	return res;
+}
+
+#endif /* BPS_TREE_CHILD_COUNTS */
+
 /**
  * @brief Get a pointer to the element pointed by iterator.
  *  If iterator is detected as broken, it is invalidated and NULL returned.
@@ -2149,6 +2414,126 @@ bps_tree_process_replace(struct bps_tree *tree,
 	return true;
 }
 
+/**
+ * @brief Get number of elements in subtree of an inner block.
+ *  Always 0 without BPS_TREE_CHILD_COUNTS.
+ */
+static inline size_t
+bps_tree_subtree_count(struct bps_inner *inner)
+{
+	size_t count = 0;
+#ifdef BPS_TREE_CHILD_COUNTS
+	for (bps_tree_pos_t i = 0; i < inner->header.size; i++)
+		count += inner->child_counts[i];
+#else
+	(void)inner;
+#endif
+	return count;
+}
+
+#ifdef BPS_TREE_CHILD_COUNTS
+
+/**
+ * @brief Set the number of elements in a child subtree and propagate
+ *  the difference to all the parents up to the root.
+ */
+static inline void
+bps_tree_set_child_count(struct bps_tree *tree,
+			 struct bps_inner_path_elem *parent,
+			 bps_tree_pos_t pos, size_t count)
+{
+	parent->block = (struct bps_inner *)
+		bps_tree_touch_block(tree, parent->block_id);
+	/* Unsigned overflow makes it work for decrements too */
+	size_t diff = count - parent->block->child_counts[pos];
+	if (diff == 0)
+		return;
+	parent->block->child_counts[pos] = count;
+	for (; parent->parent; parent = parent->parent) {
+		struct bps_inner_path_elem *grand = parent->parent;
+		grand->block = (struct bps_inner *)
+			bps_tree_touch_block(tree, grand->block_id);
+		grand->block->child_counts[parent->pos_in_parent] += diff;
+	}
+}
+#endif
+
+/**
+ * @brief Store the current number of elements of a leaf in its parent
+ */
+static inline void
+bps_tree_update_leaf_count(struct bps_tree *tree,
+			   struct bps_leaf_path_elem *leaf_path_elem)
+{
+#ifdef BPS_TREE_CHILD_COUNTS
+	if (leaf_path_elem->parent)
+		bps_tree_set_child_count(tree, leaf_path_elem->parent,
+					 leaf_path_elem->pos_in_parent,
+					 leaf_path_elem->block->header.size);
+#else
+	(void)tree;
+	(void)leaf_path_elem;
+#endif
+}
+
+/**
+ * @brief Store the current number of elements in subtree of an inner
+ *  block in its parent
+ */
+static inline void
+bps_tree_update_inner_count(struct bps_tree *tree,
+			    struct bps_inner_path_elem *inner_path_elem)
+{
+#ifdef BPS_TREE_CHILD_COUNTS
+	if (inner_path_elem->parent)
+		bps_tree_set_child_count(tree, inner_path_elem->parent,
+			inner_path_elem->pos_in_parent,
+			bps_tree_subtree_count(inner_path_elem->block));
+#else
+	(void)tree;
+	(void)inner_path_elem;
+#endif
+}
+
+/**
+ * @brief Update element counts after elements were moved between a leaf
+ *  and its neighbours. Neighbours that were not collected have no parent
+ *  and are skipped. A new leaf must not be passed here: it is not linked
+ *  to the parent yet.
+ */
+static inline void
+bps_tree_update_leaf_counts(struct bps_tree *tree,
+			    struct bps_leaf_path_elem *leaf_path_elem,
+			    struct bps_leaf_path_elem *left_ext,
+			    struct bps_leaf_path_elem *right_ext,
+			    struct bps_leaf_path_elem *left_left_ext,
+			    struct bps_leaf_path_elem *right_right_ext)
+{
+	bps_tree_update_leaf_count(tree, leaf_path_elem);
+	bps_tree_update_leaf_count(tree, left_ext);
+	bps_tree_update_leaf_count(tree, right_ext);
+	bps_tree_update_leaf_count(tree, left_left_ext);
+	bps_tree_update_leaf_count(tree, right_right_ext);
+}
+
+/**
+ * @brief Same as bps_tree_update_leaf_counts, but for inner blocks.
+ */
+static inline void
+bps_tree_update_inner_counts(struct bps_tree *tree,
+			     struct bps_inner_path_elem *inner_path_elem,
+			     struct bps_inner_path_elem *left_ext,
+			     struct bps_inner_path_elem *right_ext,
+			     struct bps_inner_path_elem *left_left_ext,
+			     struct bps_inner_path_elem *right_right_ext)
+{
+	bps_tree_update_inner_count(tree, inner_path_elem);
+	bps_tree_update_inner_count(tree, left_ext);
+	bps_tree_update_inner_count(tree, right_ext);
+	bps_tree_update_inner_count(tree, left_left_ext);
+	bps_tree_update_inner_count(tree, right_right_ext);
+}
+
 #ifndef NDEBUG
 /**
  * @brief Debug memmove, checks for overflow
@@ -2284,7 +2669,7 @@ static inline void
 bps_tree_insert_into_inner(struct bps_tree *tree,
 			   struct bps_inner_path_elem *inner_path_elem,
 			   bps_tree_block_id_t block_id, bps_tree_pos_t pos,
-			   bps_tree_elem_t max_elem)
+			   bps_tree_elem_t max_elem, size_t block_count)
 {
 	/* exclusive behaviuor for debug checks */
 	if (tree->root_id != (bps_tree_block_id_t) -1)
@@ -2303,12 +2688,15 @@ bps_tree_insert_into_inner(struct bps_tree *tree,
 		BPS_TREE_DATAMOVE(inner->child_ids + pos + 1,
 				  inner->child_ids + pos,
 				  inner->header.size - pos, inner, inner);
+		BPS_TREE_COUNTMOVE(inner->child_counts + pos + 1,
+				   inner->child_counts + pos, inner->header.size - pos);
 	} else {
 		if (pos > 0)
 			inner->elems[pos - 1] = *inner_path_elem->max_elem_copy;
 		*inner_path_elem->max_elem_copy = max_elem;
 	}
 	inner->child_ids[pos] = block_id;
+	BPS_TREE_COUNTSET(inner->child_counts[pos], block_count);
 
 	inner->header.size++;
 }
@@ -2367,6 +2755,8 @@ bps_tree_delete_from_inner(struct bps_tree *tree,
 		BPS_TREE_DATAMOVE(inner->child_ids + pos,
 				  inner->child_ids + pos + 1,
 				  inner->header.size - 1 - pos, inner, inner);
+		BPS_TREE_COUNTMOVE(inner->child_counts + pos,
+				   inner->child_counts + pos + 1, inner->header.size - 1 - pos);
 	} else if (pos > 0) {
 		*inner_path_elem->max_elem_copy = inner->elems[pos - 1];
 	}
@@ -2438,8 +2828,12 @@ bps_tree_move_elems_to_right_inner(struct bps_tree *tree,
 
 	BPS_TREE_DATAMOVE(b->child_ids + num, b->child_ids,
 			  b->header.size, b, b);
+	BPS_TREE_COUNTMOVE(b->child_counts + num,
+			   b->child_counts, b->header.size);
 	BPS_TREE_DATAMOVE(b->child_ids, a->child_ids + a->header.size - num,
 			  num, b, a);
+	BPS_TREE_COUNTMOVE(b->child_counts,
+			   a->child_counts + a->header.size - num, num);
 
 	if (!move_to_empty)
 		BPS_TREE_DATAMOVE(b->elems + num, b->elems,
@@ -2518,8 +2912,12 @@ bps_tree_move_elems_to_left_inner(struct bps_tree *tree,
 
 	BPS_TREE_DATAMOVE(a->child_ids + a->header.size, b->child_ids,
 			  num, a, b);
+	BPS_TREE_COUNTMOVE(a->child_counts + a->header.size,
+			   b->child_counts, num);
 	BPS_TREE_DATAMOVE(b->child_ids, b->child_ids + num,
 			  b->header.size - num, b, b);
+	BPS_TREE_COUNTMOVE(b->child_counts,
+			   b->child_counts + num, b->header.size - num);
 
 	if (!move_to_empty)
 		a->elems[a->header.size - 1] =
@@ -2614,7 +3012,8 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 		struct bps_inner_path_elem *a_inner_path_elem,
 		struct bps_inner_path_elem *b_inner_path_elem,
 		bps_tree_pos_t num, bps_tree_block_id_t block_id,
-		bps_tree_pos_t pos, bps_tree_elem_t max_elem)
+		bps_tree_pos_t pos, bps_tree_elem_t max_elem,
+		size_t block_count)
 {
 	/* exclusive behaviuor for debug checks */
 	if (tree->root_id != (bps_tree_block_id_t) -1) {
@@ -2637,6 +3036,8 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 	if (!move_to_empty) {
 		BPS_TREE_DATAMOVE(b->child_ids + num, b->child_ids,
 				  b->header.size, b, b);
+		BPS_TREE_COUNTMOVE(b->child_counts + num,
+				   b->child_counts, b->header.size);
 		BPS_TREE_DATAMOVE(b->elems + num, b->elems,
 				  b->header.size - 1, b, b);
 	}
@@ -2647,9 +3048,14 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 		BPS_TREE_DATAMOVE(b->child_ids,
 				  a->child_ids + a->header.size - num,
 				  num, b, a);
+		BPS_TREE_COUNTMOVE(b->child_counts,
+				   a->child_counts + a->header.size - num, num);
 		BPS_TREE_DATAMOVE(a->child_ids + pos + 1, a->child_ids + pos,
 				  mid_part_size - num, a, a);
+		BPS_TREE_COUNTMOVE(a->child_counts + pos + 1,
+				   a->child_counts + pos, mid_part_size - num);
 		a->child_ids[pos] = block_id;
+		BPS_TREE_COUNTSET(a->child_counts[pos], block_count);
 
 		BPS_TREE_DATAMOVE(b->elems, a->elems + a->header.size - num,
 				  num - 1, b, a);
@@ -2669,9 +3075,14 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 		BPS_TREE_DATAMOVE(b->child_ids,
 				  a->child_ids + a->header.size - num,
 				  num, b, a);
+		BPS_TREE_COUNTMOVE(b->child_counts,
+				   a->child_counts + a->header.size - num, num);
 		BPS_TREE_DATAMOVE(a->child_ids + pos + 1, a->child_ids + pos,
 				  mid_part_size - num, a, a);
+		BPS_TREE_COUNTMOVE(a->child_counts + pos + 1,
+				   a->child_counts + pos, mid_part_size - num);
 		a->child_ids[pos] = block_id;
+		BPS_TREE_COUNTSET(a->child_counts[pos], block_count);
 
 		BPS_TREE_DATAMOVE(b->elems, a->elems + a->header.size - num,
 				  num - 1, b, a);
@@ -2688,9 +3099,14 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 		BPS_TREE_DATAMOVE(b->child_ids,
 				  a->child_ids + a->header.size - num + 1,
 				  new_pos, b, a);
+		BPS_TREE_COUNTMOVE(b->child_counts,
+				   a->child_counts + a->header.size - num + 1, new_pos);
 		b->child_ids[new_pos] = block_id;
+		BPS_TREE_COUNTSET(b->child_counts[new_pos], block_count);
 		BPS_TREE_DATAMOVE(b->child_ids + new_pos + 1,
 				  a->child_ids + pos, mid_part_size, b, a);
+		BPS_TREE_COUNTMOVE(b->child_counts + new_pos + 1,
+				   a->child_counts + pos, mid_part_size);
 
 		if (pos == a->header.size) {
 			/* +1 */
@@ -2812,7 +3228,7 @@ bps_tree_insert_and_move_elems_to_left_inner(struct bps_tree *tree,
 		struct bps_inner_path_elem *a_inner_path_elem,
 		struct bps_inner_path_elem *b_inner_path_elem, bps_tree_pos_t num,
 		bps_tree_block_id_t block_id, bps_tree_pos_t pos,
-		bps_tree_elem_t max_elem)
+		bps_tree_elem_t max_elem, size_t block_count)
 {
 	/* exclusive behaviuor for debug checks */
 	if (tree->root_id != (bps_tree_block_id_t) -1) {
@@ -2837,12 +3253,19 @@ bps_tree_insert_and_move_elems_to_left_inner(struct bps_tree *tree,
 		bps_tree_pos_t new_pos = pos - num; /* Can be 0 */
 		BPS_TREE_DATAMOVE(a->child_ids + a->header.size, b->child_ids,
 				  num, a, b);
+		BPS_TREE_COUNTMOVE(a->child_counts + a->header.size,
+				   b->child_counts, num);
 		BPS_TREE_DATAMOVE(b->child_ids, b->child_ids + num,
 				  new_pos, b, b);
+		BPS_TREE_COUNTMOVE(b->child_counts,
+				   b->child_counts + num, new_pos);
 		b->child_ids[new_pos] = block_id;
+		BPS_TREE_COUNTSET(b->child_counts[new_pos], block_count);
 		BPS_TREE_DATAMOVE(b->child_ids + new_pos + 1,
 				  b->child_ids + pos,
 				  b->header.size - pos, b, b);
+		BPS_TREE_COUNTMOVE(b->child_counts + new_pos + 1,
+				   b->child_counts + pos, b->header.size - pos);
 
 		if (!move_to_empty)
 			a->elems[a->header.size - 1] =
@@ -2878,12 +3301,21 @@ bps_tree_insert_and_move_elems_to_left_inner(struct bps_tree *tree,
 		bps_tree_pos_t new_pos = a->header.size + pos; /* Can be 0 */
 		BPS_TREE_DATAMOVE(a->child_ids + a->header.size,
 				  b->child_ids, pos, a, b);
+		BPS_TREE_COUNTMOVE(a->child_counts + a->header.size,
+				   b->child_counts, pos);
 		a->child_ids[new_pos] = block_id;
+		BPS_TREE_COUNTSET(a->child_counts[new_pos], block_count);
 		BPS_TREE_DATAMOVE(a->child_ids + new_pos + 1,
 				  b->child_ids + pos, num - 1 - pos, a, b);
-		if (!move_all)
+		BPS_TREE_COUNTMOVE(a->child_counts + new_pos + 1,
+				   b->child_counts + pos, num - 1 - pos);
+		if (!move_all) {
 			BPS_TREE_DATAMOVE(b->child_ids, b->child_ids + num - 1,
 					  b->header.size - num + 1, b, b);
+			BPS_TREE_COUNTMOVE(b->child_counts,
+					   b->child_counts + num - 1,
+					   b->header.size - num + 1);
+		}
 
 		if (!move_to_empty)
 			a->elems[a->header.size - 1] =
@@ -3121,7 +3553,7 @@ static int
 bps_tree_process_insert_inner(struct bps_tree *tree,
 			      struct bps_inner_path_elem *inner_path_elem,
 			      bps_tree_block_id_t block_id, bps_tree_pos_t pos,
-			      bps_tree_elem_t max_elem);
+			      bps_tree_elem_t max_elem, size_t block_count);
 
 /**
  * Basic inserted into leaf, dealing with spliting, merging and moving data
@@ -3134,6 +3566,7 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 {
 	if (bps_tree_leaf_free_size(leaf_path_elem->block)) {
 		bps_tree_insert_into_leaf(tree, leaf_path_elem, new_elem);
+		bps_tree_update_leaf_count(tree, leaf_path_elem);
 		BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0x0);
 		return 0;
 	}
@@ -3159,6 +3592,9 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_left_leaf(tree,
 					&left_ext, leaf_path_elem,
 					move_count, new_elem);
+			bps_tree_update_leaf_counts(tree, leaf_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0x1);
 			return 0;
 		} else if (bps_tree_leaf_free_size(right_ext.block) > 0) {
@@ -3167,6 +3603,9 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_right_leaf(tree,
 					leaf_path_elem, &right_ext,
 					move_count, new_elem);
+			bps_tree_update_leaf_counts(tree, leaf_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0x2);
 			return 0;
 		}
@@ -3177,6 +3616,9 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_left_leaf(tree,
 					&left_ext, leaf_path_elem,
 					move_count, new_elem);
+			bps_tree_update_leaf_counts(tree, leaf_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0x3);
 			return 0;
 		}
@@ -3193,6 +3635,9 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_left_leaf(tree,
 					&left_ext, leaf_path_elem,
 					move_count, new_elem);
+			bps_tree_update_leaf_counts(tree, leaf_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0x4);
 			return 0;
 		}
@@ -3203,6 +3648,9 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_right_leaf(tree,
 					leaf_path_elem, &right_ext,
 					move_count, new_elem);
+			bps_tree_update_leaf_counts(tree, leaf_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0x5);
 			return 0;
 		}
@@ -3219,6 +3667,9 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_right_leaf(tree,
 					leaf_path_elem, &right_ext,
 					move_count, new_elem);
+			bps_tree_update_leaf_counts(tree, leaf_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0x6);
 			return 0;
 		}
@@ -3436,6 +3887,10 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 		new_root->header.size = 2;
 		new_root->child_ids[0] = tree->root_id;
 		new_root->child_ids[1] = new_block_id;
+		BPS_TREE_COUNTSET(new_root->child_counts[0],
+				  leaf_path_elem->block->header.size);
+		BPS_TREE_COUNTSET(new_root->child_counts[1],
+				  new_path_elem.block->header.size);
 		new_root->elems[0] = tree->max_elem;
 		tree->root_id = new_root_id;
 		tree->max_elem = new_max_elem;
@@ -3445,10 +3900,12 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 		return 0;
 	}
 	assert(leaf_path_elem->parent);
+	bps_tree_update_leaf_counts(tree, leaf_path_elem, &left_ext, &right_ext,
+				    &left_left_ext, &right_right_ext);
 	BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0xD);
 	return bps_tree_process_insert_inner(tree, leaf_path_elem->parent,
 			new_block_id, new_path_elem.pos_in_parent,
-			new_max_elem);
+			new_max_elem, new_path_elem.block->header.size);
 }
 
 /**
@@ -3459,11 +3916,13 @@ static inline int
 bps_tree_process_insert_inner(struct bps_tree *tree,
 			      struct bps_inner_path_elem *inner_path_elem,
 			      bps_tree_block_id_t block_id,
-			      bps_tree_pos_t pos, bps_tree_elem_t max_elem)
+			      bps_tree_pos_t pos, bps_tree_elem_t max_elem,
+			      size_t block_count)
 {
 	if (bps_tree_inner_free_size(inner_path_elem->block)) {
 		bps_tree_insert_into_inner(tree, inner_path_elem,
-					   block_id, pos, max_elem);
+					   block_id, pos, max_elem, block_count);
+		bps_tree_update_inner_count(tree, inner_path_elem);
 		BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0x0);
 		return 0;
 	}
@@ -3486,7 +3945,10 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 				bps_tree_inner_free_size(left_ext.block) / 2;
 			bps_tree_insert_and_move_elems_to_left_inner(tree,
 					&left_ext, inner_path_elem, move_count,
-					block_id, pos, max_elem);
+					block_id, pos, max_elem, block_count);
+			bps_tree_update_inner_counts(tree, inner_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0x1);
 			return 0;
 		} else if (bps_tree_inner_free_size(right_ext.block) > 0) {
@@ -3494,7 +3956,10 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 				bps_tree_inner_free_size(right_ext.block) / 2;
 			bps_tree_insert_and_move_elems_to_right_inner(tree,
 					inner_path_elem, &right_ext,
-					move_count, block_id, pos, max_elem);
+					move_count, block_id, pos, max_elem, block_count);
+			bps_tree_update_inner_counts(tree, inner_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0x2);
 			return 0;
 		}
@@ -3504,7 +3969,10 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 				bps_tree_inner_free_size(left_ext.block) / 2;
 			bps_tree_insert_and_move_elems_to_left_inner(tree,
 					&left_ext, inner_path_elem,
-					move_count, block_id, pos, max_elem);
+					move_count, block_id, pos, max_elem, block_count);
+			bps_tree_update_inner_counts(tree, inner_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0x3);
 			return 0;
 		}
@@ -3520,7 +3988,10 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 			move_count = 1 + move_count / 2;
 			bps_tree_insert_and_move_elems_to_left_inner(tree,
 					&left_ext, inner_path_elem, move_count,
-					block_id, pos, max_elem);
+					block_id, pos, max_elem, block_count);
+			bps_tree_update_inner_counts(tree, inner_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0x4);
 			return 0;
 		}
@@ -3530,7 +4001,10 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 				bps_tree_inner_free_size(right_ext.block) / 2;
 			bps_tree_insert_and_move_elems_to_right_inner(tree,
 					inner_path_elem, &right_ext,
-					move_count, block_id, pos, max_elem);
+					move_count, block_id, pos, max_elem, block_count);
+			bps_tree_update_inner_counts(tree, inner_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0x5);
 			return 0;
 		}
@@ -3546,7 +4020,10 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 			move_count = 1 + move_count / 2;
 			bps_tree_insert_and_move_elems_to_right_inner(tree,
 					inner_path_elem, &right_ext,
-					move_count, block_id, pos, max_elem);
+					move_count, block_id, pos, max_elem, block_count);
+			bps_tree_update_inner_counts(tree, inner_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0x6);
 			return 0;
 		}
@@ -3586,7 +4063,7 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 
 		bps_tree_insert_and_move_elems_to_right_inner(tree,
 				inner_path_elem, &new_path_elem,
-				mc1, block_id, pos, max_elem);
+				mc1, block_id, pos, max_elem, block_count);
 		bps_tree_move_elems_to_right_inner(tree,
 				&left_ext, inner_path_elem, mc2);
 		bps_tree_move_elems_to_left_inner(tree,
@@ -3621,7 +4098,7 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 
 		bps_tree_insert_and_move_elems_to_right_inner(tree,
 				inner_path_elem, &new_path_elem,
-				mc1, block_id, pos, max_elem);
+				mc1, block_id, pos, max_elem, block_count);
 		bps_tree_move_elems_to_right_inner(tree,
 				&left_ext, inner_path_elem, mc2);
 		bps_tree_move_elems_to_right_inner(tree,
@@ -3655,7 +4132,7 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 
 		bps_tree_insert_and_move_elems_to_right_inner(tree,
 				inner_path_elem, &new_path_elem,
-				mc1, block_id, pos, max_elem);
+				mc1, block_id, pos, max_elem, block_count);
 		bps_tree_move_elems_to_left_inner(tree,
 				&new_path_elem, &right_ext, mc2);
 		bps_tree_move_elems_to_left_inner(tree,
@@ -3687,7 +4164,7 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 
 		bps_tree_insert_and_move_elems_to_right_inner(tree,
 				inner_path_elem, &new_path_elem,
-				mc1, block_id, pos, max_elem);
+				mc1, block_id, pos, max_elem, block_count);
 		bps_tree_move_elems_to_right_inner(tree,
 				&left_ext, inner_path_elem, mc2);
 
@@ -3716,7 +4193,7 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 
 		bps_tree_insert_and_move_elems_to_right_inner(tree,
 				inner_path_elem, &new_path_elem,
-				mc1, block_id, pos, max_elem);
+				mc1, block_id, pos, max_elem, block_count);
 		bps_tree_move_elems_to_left_inner(tree,
 				&new_path_elem, &right_ext, mc2);
 
@@ -3744,7 +4221,7 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 
 		bps_tree_insert_and_move_elems_to_right_inner(tree,
 				inner_path_elem, &new_path_elem,
-				mc1, block_id, pos, max_elem);
+				mc1, block_id, pos, max_elem, block_count);
 
 		bps_tree_block_id_t new_root_id = (bps_tree_block_id_t)(-1);
 		struct bps_inner *new_root =
@@ -3752,6 +4229,10 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 		new_root->header.size = 2;
 		new_root->child_ids[0] = tree->root_id;
 		new_root->child_ids[1] = new_block_id;
+		BPS_TREE_COUNTSET(new_root->child_counts[0],
+			bps_tree_subtree_count(inner_path_elem->block));
+		BPS_TREE_COUNTSET(new_root->child_counts[1],
+			bps_tree_subtree_count(new_path_elem.block));
 		new_root->elems[0] = tree->max_elem;
 		tree->root_id = new_root_id;
 		tree->max_elem = new_max_elem;
@@ -3760,10 +4241,13 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 		return 0;
 	}
 	assert(inner_path_elem->parent);
+	bps_tree_update_inner_counts(tree, inner_path_elem, &left_ext,
+				     &right_ext, &left_left_ext,
+				     &right_right_ext);
 	BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0xD);
 	return bps_tree_process_insert_inner(tree, inner_path_elem->parent,
 			new_block_id, new_path_elem.pos_in_parent,
-			new_max_elem);
+			new_max_elem, bps_tree_subtree_count(new_path_elem.block));
 }
 
 /**
@@ -3782,6 +4266,7 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 			     struct bps_leaf_path_elem *leaf_path_elem)
 {
 	bps_tree_delete_from_leaf(tree, leaf_path_elem);
+	bps_tree_update_leaf_count(tree, leaf_path_elem);
 
 	if (leaf_path_elem->block->header.size >=
 	    BPS_TREE_MAX_COUNT_IN_LEAF * 2 / 3) {
@@ -3810,6 +4295,9 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 				bps_tree_leaf_overmin_size(left_ext.block) / 2;
 			bps_tree_move_elems_to_right_leaf(tree, &left_ext,
 					leaf_path_elem, move_count);
+			bps_tree_update_leaf_counts(tree, leaf_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0x1);
 			return;
 		} else if (bps_tree_leaf_overmin_size(right_ext.block) > 0) {
@@ -3817,6 +4305,9 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 				bps_tree_leaf_overmin_size(right_ext.block) / 2;
 			bps_tree_move_elems_to_left_leaf(tree, leaf_path_elem,
 					&right_ext, move_count);
+			bps_tree_update_leaf_counts(tree, leaf_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0x2);
 			return;
 		}
@@ -3826,6 +4317,9 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 				bps_tree_leaf_overmin_size(left_ext.block) / 2;
 			bps_tree_move_elems_to_right_leaf(tree, &left_ext,
 					leaf_path_elem, move_count);
+			bps_tree_update_leaf_counts(tree, leaf_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0x3);
 			return;
 		}
@@ -3841,6 +4335,9 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 					leaf_path_elem, move_count1);
 			bps_tree_move_elems_to_right_leaf(tree, &left_left_ext,
 					&left_ext, move_count2);
+			bps_tree_update_leaf_counts(tree, leaf_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0x4);
 			return;
 		}
@@ -3851,6 +4348,9 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 				/ 2;
 			bps_tree_move_elems_to_left_leaf(tree, leaf_path_elem,
 					&right_ext, move_count);
+			bps_tree_update_leaf_counts(tree, leaf_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0x5);
 			return;
 		}
@@ -3866,6 +4366,9 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 					&right_ext, move_count1);
 			bps_tree_move_elems_to_left_leaf(tree, &right_ext,
 					&right_right_ext, move_count2);
+			bps_tree_update_leaf_counts(tree, leaf_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0x6);
 			return;
 		}
@@ -3937,6 +4440,8 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 	}
 
 	assert(leaf_path_elem->block->header.size == 0);
+	bps_tree_update_leaf_counts(tree, leaf_path_elem, &left_ext, &right_ext,
+				    &left_left_ext, &right_right_ext);
 
 	struct bps_leaf *leaf = (struct bps_leaf*)leaf_path_elem->block;
 	if (leaf->prev_id == (bps_tree_block_id_t)(-1)) {
@@ -3970,6 +4475,7 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 			      struct bps_inner_path_elem *inner_path_elem)
 {
 	bps_tree_delete_from_inner(tree, inner_path_elem);
+	bps_tree_update_inner_count(tree, inner_path_elem);
 
 	if (inner_path_elem->block->header.size >=
 	    BPS_TREE_MAX_COUNT_IN_INNER * 2 / 3) {
@@ -3997,6 +4503,9 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 				/ 2;
 			bps_tree_move_elems_to_right_inner(tree, &left_ext,
 					inner_path_elem, move_count);
+			bps_tree_update_inner_counts(tree, inner_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0x1);
 			return;
 		} else if (bps_tree_inner_overmin_size(right_ext.block) > 0) {
@@ -4006,6 +4515,9 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 			bps_tree_move_elems_to_left_inner(tree,
 					inner_path_elem, &right_ext,
 					move_count);
+			bps_tree_update_inner_counts(tree, inner_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0x2);
 			return;
 		}
@@ -4016,6 +4528,9 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 				/ 2;
 			bps_tree_move_elems_to_right_inner(tree, &left_ext,
 					inner_path_elem, move_count);
+			bps_tree_update_inner_counts(tree, inner_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0x3);
 			return;
 		}
@@ -4032,6 +4547,9 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 					inner_path_elem, move_count1);
 			bps_tree_move_elems_to_right_inner(tree,
 					&left_left_ext, &left_ext, move_count2);
+			bps_tree_update_inner_counts(tree, inner_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0x4);
 			return;
 		}
@@ -4043,6 +4561,9 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 			bps_tree_move_elems_to_left_inner(tree,
 					inner_path_elem, &right_ext,
 					move_count);
+			bps_tree_update_inner_counts(tree, inner_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0x5);
 			return;
 		}
@@ -4059,6 +4580,9 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 					&right_ext, move_count1);
 			bps_tree_move_elems_to_left_inner(tree, &right_ext,
 					&right_right_ext, move_count2);
+			bps_tree_update_inner_counts(tree, inner_path_elem,
+					&left_ext, &right_ext,
+					&left_left_ext, &right_right_ext);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0x6);
 			return;
 		}
@@ -4129,6 +4653,9 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 		return;
 	}
 	assert(inner_path_elem->block->header.size == 0);
+	bps_tree_update_inner_counts(tree, inner_path_elem, &left_ext,
+				     &right_ext, &left_left_ext,
+				     &right_right_ext);
 
 	bps_tree_dispose_inner(tree, inner_path_elem->block,
 			inner_path_elem->block_id);
@@ -4306,13 +4833,22 @@ bps_tree_debug_check_block(const struct bps_tree *tree, struct bps_block *block,
 				result |= 0x4000000;
 		}
 
-		for (bps_tree_pos_t i = 0; i < block->size; i++)
+		for (bps_tree_pos_t i = 0; i < block->size; i++) {
+			size_t child_count = *calc_count;
 			result |= bps_tree_debug_check_block(tree,
 				bps_tree_restore_block(tree,
 						       inner->child_ids[i]),
 				inner->child_ids[i], level - 1, calc_count,
 				expected_prev_id, expected_this_id,
 				check_fullness_next);
+			child_count = *calc_count - child_count;
+#ifdef BPS_TREE_CHILD_COUNTS
+			if (inner->child_counts[i] != child_count)
+				result |= 0x8000000;
+#else
+			(void)child_count;
+#endif
+		}
 		return result;
 	}
 }
@@ -5116,7 +5652,7 @@ bps_tree_debug_check_insert_into_inner(struct bps_tree *tree, bool assertme)
 
 			bps_tree_insert_into_inner(tree, &path_elem,
 				(bps_tree_block_id_t) j, (bps_tree_pos_t) j,
-				ins);
+				ins, 0);
 
 			for (unsigned int k = 0; k <= i; k++) {
 				if (bps_tree_debug_get_elem_inner(&path_elem, k)
@@ -5471,7 +6007,7 @@ bps_tree_debug_check_insert_and_move_to_right_inner(struct bps_tree *tree,
 						tree, &a_path_elem,
 						&b_path_elem,
 						(bps_tree_pos_t) u, ikk,
-						(bps_tree_pos_t) k, ins);
+						(bps_tree_pos_t) k, ins, 0);
 
 					if (a.header.size
 						!= (bps_tree_pos_t) (i - u + 1)) {
@@ -5598,7 +6134,7 @@ bps_tree_debug_check_insert_and_move_to_left_inner(struct bps_tree *tree,
 						tree, &a_path_elem,
 						&b_path_elem,
 						(bps_tree_pos_t) u, ikk,
-						(bps_tree_pos_t) k, ins);
+						(bps_tree_pos_t) k, ins, 0);
 
 					if (a.header.size
 						!= (bps_tree_pos_t) (i + u)) {
@@ -5688,6 +6224,10 @@ bps_tree_debug_check_internal_functions(bool assertme)
 
 #undef BPS_TREE_MEMMOVE
 #undef BPS_TREE_DATAMOVE
+#undef BPS_TREE_COUNTMOVE
+#undef BPS_TREE_COUNTSET
+#undef BPS_TREE_INNER_CHILD_SIZE
+#undef BPS_TREE_INNER_PADDING
 #undef BPS_TREE_BRANCH_TRACE
 
 /* {{{ Macros for custom naming of structs and functions */
@@ -5723,6 +6263,9 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_lower_bound
 #undef bps_tree_upper_bound
 #undef bps_tree_approximate_count
+#undef bps_tree_lower_bound_get_offset
+#undef bps_tree_upper_bound_get_offset
+#undef bps_tree_iterator_at
 #undef bps_tree_iterator_get_elem
 #undef bps_tree_iterator_next
 #undef bps_tree_iterator_prev
@@ -5761,6 +6304,12 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_touch_leaf_path_max_elem
 #undef bps_tree_touch_path
 #undef bps_tree_process_replace
+#undef bps_tree_subtree_count
+#undef bps_tree_set_child_count
+#undef bps_tree_update_leaf_count
+#undef bps_tree_update_inner_count
+#undef bps_tree_update_leaf_counts
+#undef bps_tree_update_inner_counts
 #undef bps_tree_debug_memmove
 #undef bps_tree_insert_into_leaf
 #undef bps_tree_insert_into_inner
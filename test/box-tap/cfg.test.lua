@@ -4,7 +4,7 @@ local tap = require('tap')
 local test = tap.test('cfg')
 local socket = require('socket')
 local fio = require('fio')
-test:plan(61)
+test:plan(67)
 
 --------------------------------------------------------------------------------
 -- Invalid values
@@ -28,6 +28,10 @@ invalid('rows_per_wal', -1)
 invalid('listen', '//!')
 invalid('log', ':')
 invalid('log', 'syslog:xxx=')
+invalid('fiber_stack_size', 1024)
+invalid('fiber_stack_size', 1024 * 1024 * 1024)
+invalid('fiber_stack_size', 'big')
+invalid('fiber_stack_guard', 'yes')
 
 test:is(type(box.cfg), 'function', 'box is not started')
 
@@ -318,5 +322,22 @@ os.exit(box.cfg.checkpoint_interval == 150
 ]]
 test:is(run_script(code), 0, "update checkpoint params")
 
+code = [[
+box.cfg{fiber_stack_size = 1024 * 1024, fiber_stack_guard = false}
+local fiber = require('fiber')
+local ch = fiber.channel(1)
+fiber.create(function() ch:put(true) end)
+os.exit(ch:get() and box.cfg.fiber_stack_size == 1024 * 1024
+      and box.cfg.fiber_stack_guard == false and 0 or 1)
+]]
+test:is(run_script(code), 0, "fiber stack params")
+
+code = [[
+box.cfg{}
+local ok = pcall(box.cfg, {fiber_stack_size = 128 * 1024})
+os.exit(not ok and box.cfg.fiber_stack_size == 64 * 1024 and 0 or 1)
+]]
+test:is(run_script(code), 0, "fiber_stack_size can't be changed dynamically")
+
 test:check()
 os.exit(0)
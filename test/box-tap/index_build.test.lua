@@ -0,0 +1,85 @@
+#!/usr/bin/env tarantool
+
+--
+-- Secondary keys of memtx spaces are built in several threads
+-- at the end of recovery.
+--
+local tap = require('tap')
+local fio = require('fio')
+local test = tap.test('index_build')
+test:plan(5)
+
+local tarantool_bin = arg[-1]
+local PANIC = 256
+local dir = fio.tempdir()
+local function run_script(code)
+    local script_path = fio.pathjoin(dir, 'script.lua')
+    local script = fio.open(script_path, {'O_CREAT', 'O_WRONLY', 'O_TRUNC'},
+        tonumber('0777', 8))
+    script:write(code)
+    script:write("\nos.exit(0)")
+    script:close()
+    local cmd = [[/bin/sh -c 'cd "%s" && "%s" ./script.lua 2> /dev/null']]
+    return os.execute(string.format(cmd, dir, tarantool_bin))
+end
+
+local code = [[
+box.cfg{ log = "tarantool.log" }
+local s = box.schema.space.create('test')
+s:create_index('pk')
+for i = 1, 4 do
+    s:create_index('sk' .. i, {unique = false, parts = {i + 1, 'unsigned'}})
+end
+box.begin()
+for i = 1, 10000 do
+    s:replace{i, i % 7, i % 11, i % 13, 10000 - i}
+end
+box.commit()
+box.snapshot()
+]]
+test:is(run_script(code), 0, 'create keys')
+
+-- a key fails to finish, the keys left are dropped with it
+code = [[
+box.error.injection.set('ERRINJ_MEMTX_BUILD', true)
+box.cfg{ log = "tarantool.log" }
+]]
+test:is(run_script(code), PANIC, 'build failure stops recovery')
+
+code = [[
+box.cfg{ log = "tarantool.log" }
+local s = box.space.test
+for i = 1, 4 do
+    if s.index['sk' .. i]:count() ~= 10000 then os.exit(1) end
+end
+local prev = -1
+for _, t in s.index.sk4:pairs() do
+    if t[5] < prev then os.exit(1) end
+    prev = t[5]
+end
+]]
+test:is(run_script(code), 0, 'recovery after a failed build')
+
+-- keys are the same after another snapshot and recovery
+code = [[
+box.cfg{ log = "tarantool.log" }
+box.space.test:replace{10001, 1, 1, 1, 0}
+box.snapshot()
+]]
+test:is(run_script(code), 0, 'snapshot after a failed build')
+
+code = [[
+box.cfg{ log = "tarantool.log" }
+local s = box.space.test
+if s.index.sk1:count(1) ~= 1430 then os.exit(1) end
+if s.index.sk4:min()[1] ~= 10000 then os.exit(1) end
+]]
+test:is(run_script(code), 0, 'keys are consistent')
+
+for _, file in pairs(fio.glob(fio.pathjoin(dir, '*'))) do
+    fio.unlink(file)
+end
+fio.rmdir(dir)
+
+test:check()
+os.exit(0)
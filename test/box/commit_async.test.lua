@@ -0,0 +1,52 @@
+test_run = require('test_run').new()
+
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+
+--
+-- Asynchronous commit mode is a property of the session.
+--
+box.session.commit_async()
+box.session.commit_async(1)
+box.session.commit_async(true)
+box.session.commit_async()
+
+-- changes are visible right after commit
+for i = 1, 10 do s:replace{i} end
+s:count()
+box.begin() for i = 11, 20 do s:replace{i} end box.commit()
+s:count()
+s:update({1}, {{'=', 2, 'x'}})
+s:delete{20}
+
+-- box.commit_wait() waits for the WAL write
+box.commit_wait()
+box.commit_wait()
+
+-- box.commit_wait() isn't allowed in a transaction
+box.begin() s:replace{21} ok, err = pcall(box.commit_wait) box.rollback()
+ok, tostring(err)
+s:get{21}
+
+-- transactions of vinyl spaces are committed synchronously
+v = box.schema.space.create('test_vinyl', {engine = 'vinyl'})
+_ = v:create_index('pk')
+v:replace{1}
+box.commit_wait()
+v:get{1}
+
+box.session.commit_async(false)
+box.session.commit_async()
+
+-- committed changes survive restart
+test_run:cmd('restart server default')
+s = box.space.test
+v = box.space.test_vinyl
+box.session.commit_async()
+s:count()
+s:get{1}
+s:get{20}
+v:get{1}
+
+s:drop()
+v:drop()
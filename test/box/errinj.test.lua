@@ -190,6 +190,43 @@ errinj.set("ERRINJ_WAL_WRITE", false)
 errinj.set("ERRINJ_WAL_WRITE_DISK", true)
 _ = space:insert{1, require'digest'.urandom(192 * 1024)}
 errinj.set("ERRINJ_WAL_WRITE_DISK", false)
+-- asynchronous commit: a failed write rolls back the transaction
+-- and everything queued after it, box.commit_wait() reports it
+box.session.commit_async(true)
+errinj.set("ERRINJ_WAL_WRITE", true)
+space:replace{1}
+space:replace{2}
+box.commit_wait()
+space:count()
+box.commit_wait()
+errinj.set("ERRINJ_WAL_WRITE", false)
+space:replace{3}
+box.commit_wait()
+space:select()
+box.session.commit_async(false)
+
+-- commit_async_max_bytes bounds the amount of unacknowledged commits
+fiber = require('fiber')
+test_run:cmd("setopt delimiter ';'")
+function replace_async(key)
+    box.session.commit_async(true)
+    space:replace{key}
+    done[key] = true
+end;
+test_run:cmd("setopt delimiter ''");
+done = {}
+errinj.set("ERRINJ_WAL_DELAY", true)
+_ = fiber.create(replace_async, 4)
+done[4]
+box.cfg{commit_async_max_bytes = 0}
+_ = fiber.create(replace_async, 5)
+done[5] == nil
+space:get{5}
+box.commit_wait()
+done[5]
+box.cfg{commit_async_max_bytes = 1024 * 1024}
+space:select()
+
 space:drop()
 
 errinj = nil
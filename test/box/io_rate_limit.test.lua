@@ -0,0 +1,32 @@
+test_run = require('test_run').new()
+fiber = require('fiber')
+digest = require('digest')
+
+--
+-- io_rate_limit limits the disk bandwidth of background writes:
+-- vinyl dump and compaction and memtx snapshot.
+--
+box.cfg.io_rate_limit
+box.cfg{io_rate_limit = -1}
+box.cfg{io_rate_limit = 'fast'}
+box.cfg.io_rate_limit
+
+-- the limit is applied at runtime
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+for i = 1, 3000 do s:replace{i, digest.urandom(1000)} end
+box.cfg{io_rate_limit = 1}
+box.cfg.io_rate_limit
+t = fiber.time()
+box.snapshot()
+fiber.time() - t > 1.5
+
+-- and can be lifted
+box.cfg{io_rate_limit = 0}
+box.cfg.io_rate_limit
+_ = s:replace{1, digest.urandom(1000)}
+t = fiber.time()
+box.snapshot()
+fiber.time() - t < 1.5
+
+s:drop()
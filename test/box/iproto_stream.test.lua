@@ -0,0 +1,158 @@
+test_run = require('test_run').new()
+msgpack = require('msgpack')
+socket = require('socket')
+LISTEN = require('uri').parse(box.cfg.listen)
+
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+box.schema.user.grant('guest', 'read,write', 'space', 'test')
+s2 = box.schema.space.create('test2')
+_ = s2:create_index('pk')
+
+--
+-- Stream transactions over a raw iproto connection.
+--
+test_run:cmd("setopt delimiter ';'")
+IPROTO_REQUEST_TYPE = 0x00;
+IPROTO_SYNC = 0x01;
+IPROTO_STREAM_ID = 0x0a;
+IPROTO_SPACE_ID = 0x10;
+IPROTO_TUPLE = 0x21;
+IPROTO_ERROR = 0x31;
+IPROTO_INSERT = 2;
+IPROTO_REPLACE = 3;
+IPROTO_BEGIN = 14;
+IPROTO_COMMIT = 15;
+IPROTO_ROLLBACK = 16;
+sync = 0;
+function request(sock, type, stream_id, body)
+    sync = sync + 1
+    local header = setmetatable({[IPROTO_REQUEST_TYPE] = type,
+        [IPROTO_SYNC] = sync, [IPROTO_STREAM_ID] = stream_id},
+        {__serialize = 'map'})
+    body = setmetatable(body or {}, {__serialize = 'map'})
+    local data = msgpack.encode(header) .. msgpack.encode(body)
+    sock:write(msgpack.encode(#data) .. data)
+    local len = msgpack.decode(sock:read(5))
+    data = sock:read(len)
+    local header, pos = msgpack.decode(data)
+    body = msgpack.decode(data, pos)
+    assert(header[IPROTO_SYNC] == sync)
+    if header[IPROTO_REQUEST_TYPE] == 0 then
+        return 'ok'
+    end
+    return body[IPROTO_ERROR]
+end;
+function replace(sock, stream_id, tuple, space_id)
+    return request(sock, IPROTO_REPLACE, stream_id,
+                   {[IPROTO_SPACE_ID] = space_id or s.id,
+                    [IPROTO_TUPLE] = tuple})
+end;
+function connect()
+    local sock = socket.tcp_connect(LISTEN.host, LISTEN.service)
+    assert(#sock:read(128) == 128)
+    return sock
+end;
+test_run:cmd("setopt delimiter ''");
+
+sock = connect()
+
+-- transaction control requests need a stream id
+request(sock, IPROTO_BEGIN)
+request(sock, IPROTO_COMMIT)
+request(sock, IPROTO_ROLLBACK)
+
+-- writes are applied on COMMIT
+request(sock, IPROTO_BEGIN, 1)
+replace(sock, 1, {1})
+replace(sock, 1, {2})
+s:select()
+request(sock, IPROTO_COMMIT, 1)
+s:select()
+
+-- ROLLBACK drops the writes
+request(sock, IPROTO_BEGIN, 1)
+replace(sock, 1, {3})
+request(sock, IPROTO_ROLLBACK, 1)
+s:get{3}
+
+-- COMMIT or ROLLBACK without BEGIN is a no-op
+request(sock, IPROTO_COMMIT, 1)
+request(sock, IPROTO_ROLLBACK, 1)
+
+-- a stream can't have two transactions at once
+request(sock, IPROTO_BEGIN, 1)
+request(sock, IPROTO_BEGIN, 1)
+request(sock, IPROTO_ROLLBACK, 1)
+
+-- streams are independent, requests without a stream id are not queued
+request(sock, IPROTO_BEGIN, 1)
+request(sock, IPROTO_BEGIN, 2)
+replace(sock, 1, {4})
+replace(sock, 2, {5})
+replace(sock, nil, {6})
+s:select()
+request(sock, IPROTO_ROLLBACK, 1)
+request(sock, IPROTO_COMMIT, 2)
+s:select()
+
+-- errors that depend on the data are returned by COMMIT,
+-- which rolls back the whole transaction
+request(sock, IPROTO_BEGIN, 1)
+replace(sock, 1, {7})
+request(sock, IPROTO_INSERT, 1, {[IPROTO_SPACE_ID] = s.id, [IPROTO_TUPLE] = {1}})
+request(sock, IPROTO_COMMIT, 1)
+s:get{7}
+
+-- the space, the access rights and the tuple are checked when
+-- a request is queued, an invalid request is not queued
+request(sock, IPROTO_BEGIN, 1)
+replace(sock, 1, {7})
+replace(sock, 1, {1}, 9999)
+replace(sock, 1, {1}, s2.id)
+replace(sock, 1, {'x'})
+request(sock, IPROTO_COMMIT, 1)
+s:get{7}
+s2:select()
+s:delete{7}
+
+-- the number of open streams is limited
+ok = 0
+for i = 1, 64 do if request(sock, IPROTO_BEGIN, i) == 'ok' then ok = ok + 1 end end
+ok
+request(sock, IPROTO_BEGIN, 65)
+ok = 0
+for i = 1, 64 do if request(sock, IPROTO_ROLLBACK, i) == 'ok' then ok = ok + 1 end end
+ok
+request(sock, IPROTO_BEGIN, 65)
+request(sock, IPROTO_ROLLBACK, 65)
+
+-- the size of a stream transaction is limited
+request(sock, IPROTO_BEGIN, 1)
+ok = 0
+for i = 1, 1000 do if replace(sock, 1, {i + 1000}) == 'ok' then ok = ok + 1 end end
+ok
+replace(sock, 1, {2001})
+replace(sock, 1, {2002})
+request(sock, IPROTO_COMMIT, 1)
+s:count()
+request(sock, IPROTO_BEGIN, 1)
+replace(sock, 1, {2001})
+request(sock, IPROTO_COMMIT, 1)
+s:count()
+
+-- open transactions are dropped on disconnect
+request(sock, IPROTO_BEGIN, 1)
+replace(sock, 1, {3001})
+sock:close()
+sock = connect()
+request(sock, IPROTO_COMMIT, 1)
+s:get{3001}
+request(sock, IPROTO_BEGIN, 1)
+replace(sock, 1, {3001})
+request(sock, IPROTO_COMMIT, 1)
+s:get{3001}
+sock:close()
+
+s:drop()
+s2:drop()
@@ -0,0 +1,14 @@
+#!/usr/bin/env tarantool
+os = require('os')
+
+box.cfg{
+    listen              = os.getenv("LISTEN"),
+    iproto_threads      = 4,
+    memtx_memory        = 107374182,
+    pid_file            = "tarantool.pid",
+}
+
+require('console').listen(os.getenv('ADMIN'))
+box.once('init', function()
+    box.schema.user.grant('guest', 'read,write,execute', 'universe')
+end)
@@ -0,0 +1,59 @@
+test_run = require('test_run').new()
+net_box = require('net.box')
+fiber = require('fiber')
+
+--
+-- Connections are accepted by the first network thread and
+-- served by all of them.
+--
+test_run:cmd("create server iproto_threads with script='box/iproto_threads.lua'")
+test_run:cmd("start server iproto_threads")
+test_run:cmd("switch iproto_threads")
+box.cfg.iproto_threads
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+test_run:cmd("switch default")
+
+uri = test_run:eval('iproto_threads', 'return box.cfg.listen')[1]
+conns = {}
+for i = 1, 16 do conns[i] = net_box.connect(uri) end
+ok = true
+for i = 1, 16 do ok = ok and conns[i]:ping() end
+ok
+ch = fiber.channel(16)
+test_run:cmd("setopt delimiter ';'")
+for i = 1, 16 do
+    fiber.create(function()
+        for j = 1, 100 do
+            conns[i].space.test:replace{i * 1000 + j}
+        end
+        ch:put(conns[i].space.test:get{i * 1000 + 100} ~= nil)
+    end)
+end;
+test_run:cmd("setopt delimiter ''");
+ok = true
+for i = 1, 16 do ok = ok and ch:get() end
+ok
+conns[1].space.test:count()
+for i = 1, 16 do conns[i]:close() end
+
+--
+-- Rebinding to another socket: the threads keep serving
+-- connections accepted on the new one.
+--
+new_uri = uri .. '.new'
+test_run:eval('iproto_threads', 'box.cfg{listen = "' .. new_uri .. '"}')
+conns = {}
+for i = 1, 8 do conns[i] = net_box.connect(new_uri) end
+ok = true
+for i = 1, 8 do ok = ok and conns[i]:ping() end
+ok
+for i = 1, 8 do ok = ok and conns[i].space.test:count() == 1600 end
+ok
+for i = 1, 8 do conns[i]:close() end
+c = net_box.connect(uri)
+c:ping()
+c:close()
+
+test_run:cmd("stop server iproto_threads")
+test_run:cmd("cleanup server iproto_threads")
@@ -0,0 +1,102 @@
+test_run = require('test_run').new()
+net_box = require('net.box')
+msgpack = require('msgpack')
+socket = require('socket')
+fiber = require('fiber')
+LISTEN = require('uri').parse(box.cfg.listen)
+
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+box.schema.user.grant('guest', 'read,write', 'space', 'test')
+function value(i) return string.rep(string.char(65 + i % 26), 1000) end
+for i = 1, 2000 do s:replace{i, value(i)} end
+
+--
+-- Tuples of a SELECT reply of 64KB and more are sent right
+-- from the tuple memory.
+--
+c = net_box.connect(box.cfg.listen)
+result = c.space.test:select()
+#result
+ok = true
+for i, t in ipairs(result) do ok = ok and t[1] == i and t[2] == value(i) end
+ok
+-- small replies go on along with large ones
+c.space.test:select{1}[1][1]
+#c.space.test:select({}, {limit = 60})
+#c.space.test:select({}, {limit = 70})
+c:close()
+
+--
+-- A slow reader: the replies are written by parts, while the
+-- tuples sent are replaced and a smaller reply is queued
+-- between two large ones.
+--
+test_run:cmd("setopt delimiter ';'")
+IPROTO_REQUEST_TYPE = 0x00;
+IPROTO_SYNC = 0x01;
+IPROTO_SPACE_ID = 0x10;
+IPROTO_LIMIT = 0x12;
+IPROTO_KEY = 0x20;
+IPROTO_DATA = 0x30;
+IPROTO_SELECT = 1;
+function send_select(sock, sync, key)
+    local header = {[IPROTO_REQUEST_TYPE] = IPROTO_SELECT,
+                    [IPROTO_SYNC] = sync}
+    local body = {[IPROTO_SPACE_ID] = s.id, [IPROTO_LIMIT] = 0xFFFFFFFF,
+                  [IPROTO_KEY] = key}
+    local data = msgpack.encode(header) .. msgpack.encode(body)
+    sock:write(msgpack.encode(#data) .. data)
+end;
+function read_slowly(sock)
+    local len = msgpack.decode(sock:read(5))
+    local chunks = {}
+    local left = len
+    while left > 0 do
+        local chunk = sock:read(math.min(left, 4096))
+        table.insert(chunks, chunk)
+        left = left - #chunk
+        fiber.sleep(0.001)
+    end
+    local data = table.concat(chunks)
+    local header, pos = msgpack.decode(data)
+    local body = msgpack.decode(data, pos)
+    return header[IPROTO_SYNC], body[IPROTO_DATA]
+end;
+function check(data, count)
+    if #data ~= count then return false end
+    for i, t in ipairs(data) do
+        if t[1] ~= i or t[2] ~= value(i) then return false end
+    end
+    return true
+end;
+test_run:cmd("setopt delimiter ''");
+
+sock = socket.tcp_connect(LISTEN.host, LISTEN.service)
+#sock:read(128)
+send_select(sock, 1, {})
+send_select(sock, 2, {1})
+send_select(sock, 3, {})
+fiber.sleep(0.1)
+for i = 1, 2000 do s:replace{i, 'new'} end
+sync, data = read_slowly(sock)
+sync, check(data, 2000)
+sync, data = read_slowly(sock)
+sync, check(data, 1)
+sync, data = read_slowly(sock)
+sync, check(data, 2000)
+-- the connection is still usable
+send_select(sock, 4, {2000})
+sync, data = read_slowly(sock)
+sync, data[1][2]
+
+-- a connection closed in the middle of a reply
+send_select(sock, 5, {})
+send_select(sock, 6, {})
+fiber.sleep(0.1)
+sock:close()
+c = net_box.connect(box.cfg.listen)
+c.space.test:count()
+c:close()
+
+s:drop()
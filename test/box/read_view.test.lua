@@ -0,0 +1,32 @@
+fiber = require('fiber')
+digest = require('digest')
+
+--
+-- Tuples deleted while a checkpoint is in progress are kept
+-- until the snapshot is written, and only those the snapshot
+-- can see.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+for i = 1, 2000 do s:replace{i, digest.urandom(1000)} end
+
+-- make the snapshot slow
+box.cfg{io_rate_limit = 1}
+ch = fiber.channel(1)
+_ = fiber.create(function() ch:put(box.snapshot()) end)
+used = box.slab.info().items_used
+
+-- tuples created after the read view was opened are freed at once
+for i = 3001, 4000 do s:replace{i, digest.urandom(1000)} s:delete{i} end
+box.slab.info().items_used - used < 100 * 1024
+
+-- tuples visible to the read view are kept
+for i = 1, 2000 do s:delete{i} end
+used - box.slab.info().items_used < 100 * 1024
+
+-- and freed once the snapshot is written
+ch:get()
+used - box.slab.info().items_used > 1000 * 1000
+
+box.cfg{io_rate_limit = 0}
+s:drop()
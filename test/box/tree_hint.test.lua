@@ -0,0 +1,72 @@
+#!/usr/bin/env tarantool
+
+test_run = require('test_run').new()
+
+--
+-- Tree index elements store key hints, compared before
+-- tuples. Check that lookups and range scans are not
+-- affected by keys with equal hints.
+--
+
+-- integer keys, both negative and positive
+s = box.schema.space.create('test')
+_ = s:create_index('pk', {parts = {1, 'integer'}})
+for k = -100, 100 do s:replace{k * 1000000000000} end
+-- adjacent positive keys share a hint
+for k = 1, 10 do s:replace{k} end
+found = 0
+for k = -100, 100 do if s:get{k * 1000000000000} ~= nil then found = found + 1 end end
+found
+found = 0
+for k = 1, 10 do if s:get{k} ~= nil then found = found + 1 end end
+found
+s:get{-1}
+s:get{11}
+#s:select({0}, {iterator = 'GE'})
+#s:select({0}, {iterator = 'LT'})
+#s:select({5}, {iterator = 'GT'})
+#s:select({5}, {iterator = 'LE'})
+s:drop()
+
+-- string keys with a long common prefix
+s = box.schema.space.create('test')
+_ = s:create_index('pk', {parts = {1, 'string'}})
+prefix = string.rep('x', 16)
+for k = 1, 200 do s:replace{prefix .. string.format('%05d', k)} end
+s:replace{'xxxxxxxx'}
+s:replace{'xxxxxxx'}
+found = 0
+for k = 1, 200 do if s:get{prefix .. string.format('%05d', k)} ~= nil then found = found + 1 end end
+found
+s:get{'xxxxxxxx'}
+s:get{'xxxxxxx'}
+s:get{prefix}
+s:get{prefix .. '00000'}
+#s:select({prefix .. '00100'}, {iterator = 'GT'})
+#s:select({prefix .. '00100'}, {iterator = 'LE'})
+#s:select({prefix}, {iterator = 'GE'})
+s:drop()
+
+-- multipart keys: the hint covers the first part only
+s = box.schema.space.create('test')
+_ = s:create_index('pk', {parts = {1, 'unsigned', 2, 'string'}})
+for k = 1, 100 do s:replace{k % 3, tostring(k)} end
+#s:select({0})
+#s:select({1})
+#s:select({2})
+s:get{1, '1'}
+s:get{1, '2'}
+s:drop()
+
+-- non-unique secondary key
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+_ = s:create_index('sk', {parts = {2, 'integer'}, unique = false})
+for k = 1, 100 do s:replace{k, k % 5 - 2} end
+#s.index.sk:select({-2})
+#s.index.sk:select({0}, {iterator = 'GT'})
+s:delete{5}
+#s.index.sk:select({0})
+s.index.sk:min()[2]
+s.index.sk:max()[2]
+s:drop()
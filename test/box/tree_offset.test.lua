@@ -0,0 +1,104 @@
+test_run = require('test_run').new()
+
+--
+-- TREE index count() and select() with an offset find their
+-- results by positions in the tree instead of iterating.
+--
+s = box.schema.space.create('test')
+pk = s:create_index('pk')
+sk = s:create_index('sk', {unique = false, parts = {2, 'unsigned'}})
+mk = s:create_index('mk', {unique = false, parts = {2, 'unsigned', 3, 'unsigned'}})
+for i = 1, 200 do s:insert{i, i % 10, i % 7} end
+
+sk:count{5}
+pk:count({100}, {iterator = 'GT'})
+mk:count({5, 3}, {iterator = 'LE'})
+sk:select({5}, {offset = 19})
+sk:select({5}, {offset = 20})
+pk:select({}, {iterator = 'REQ', offset = 197})
+
+test_run:cmd("setopt delimiter ';'")
+iterators = {'EQ', 'REQ', 'GE', 'GT', 'LE', 'LT'};
+offsets = {0, 1, 5, 19, 20, 21, 250};
+function check(index, keys)
+    local errors = {}
+    for _, key in ipairs(keys) do
+        for _, it in ipairs(iterators) do
+            local all = index:select(key, {iterator = it})
+            local count = index:count(key, {iterator = it})
+            if count ~= #all then
+                table.insert(errors, {'count', key, it, count, #all})
+            end
+            for _, offset in ipairs(offsets) do
+                local res = index:select(key, {iterator = it,
+                                               offset = offset, limit = 3})
+                for i = 1, 3 do
+                    local a, b = res[i], all[offset + i]
+                    if (a == nil) ~= (b == nil) or
+                       (a ~= nil and a[1] ~= b[1]) then
+                        table.insert(errors, {'offset', key, it, offset})
+                        break
+                    end
+                end
+            end
+        end
+    end
+    return errors
+end;
+test_run:cmd("setopt delimiter ''");
+
+pk_keys = {{}, {0}, {1}, {100}, {200}, {201}}
+sk_keys = {{}, {0}, {5}, {9}, {10}}
+mk_keys = {{}, {5}, {5, 3}, {5, 6}, {9, 0}}
+check(pk, pk_keys)
+check(sk, sk_keys)
+check(mk, mk_keys)
+
+-- subtree counts are kept up to date on delete
+for i = 1, 200, 3 do s:delete{i} end
+s:count()
+sk:count{5}
+check(pk, pk_keys)
+check(sk, sk_keys)
+check(mk, mk_keys)
+
+-- and filled in when the index is built on recovery
+box.snapshot()
+test_run:cmd('restart server default')
+s = box.space.test
+test_run:cmd("setopt delimiter ';'")
+iterators = {'EQ', 'REQ', 'GE', 'GT', 'LE', 'LT'};
+offsets = {0, 1, 5, 19, 20, 21, 250};
+function check(index, keys)
+    local errors = {}
+    for _, key in ipairs(keys) do
+        for _, it in ipairs(iterators) do
+            local all = index:select(key, {iterator = it})
+            local count = index:count(key, {iterator = it})
+            if count ~= #all then
+                table.insert(errors, {'count', key, it, count, #all})
+            end
+            for _, offset in ipairs(offsets) do
+                local res = index:select(key, {iterator = it,
+                                               offset = offset, limit = 3})
+                for i = 1, 3 do
+                    local a, b = res[i], all[offset + i]
+                    if (a == nil) ~= (b == nil) or
+                       (a ~= nil and a[1] ~= b[1]) then
+                        table.insert(errors, {'offset', key, it, offset})
+                        break
+                    end
+                end
+            end
+        end
+    end
+    return errors
+end;
+test_run:cmd("setopt delimiter ''");
+s:count()
+s.index.sk:count{5}
+check(s.index.pk, {{}, {0}, {1}, {100}, {200}, {201}})
+check(s.index.sk, {{}, {0}, {5}, {9}, {10}})
+check(s.index.mk, {{}, {5}, {5, 3}, {5, 6}, {9, 0}})
+
+s:drop()
@@ -76,6 +76,21 @@ wait_repl(50)
 test_run:cmd("switch default")
 box.space.test.index[0]:count()
 
+-- A batch of rows the applier has been applying when it lost
+-- the connection must be rolled back. The applier must apply
+-- the rows again after reconnect.
+test_run:cmd("switch replica")
+errinj = box.error.injection
+errinj.set("ERRINJ_APPLIER_READ", true)
+test_run:cmd("switch default")
+test_f(51, true)
+test_run:cmd("switch replica")
+while s.index[0]:count() < 60 do fiber.sleep(0.01) end
+s.index[0]:count()
+s:get{51} ~= nil
+errinj.info().ERRINJ_APPLIER_READ.state
+
+test_run:cmd("switch default")
 test_run:cmd("stop server replica")
 test_run:cmd("cleanup server replica")
 box.space.test:drop()
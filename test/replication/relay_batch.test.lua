@@ -0,0 +1,46 @@
+test_run = require('test_run').new()
+engine = test_run:get_cfg('engine')
+
+box.schema.user.grant('guest', 'replication')
+s = box.schema.space.create('test', {engine = engine})
+_ = s:create_index('primary')
+
+--
+-- The relay sends WAL rows in batches. A replica must get all
+-- rows when batches fill up, and a lone row as soon as there
+-- is nothing more to read.
+--
+pad = string.rep('x', 200)
+
+-- rows written since the last checkpoint are sent on final join
+for i = 1, 1000 do s:replace{i, pad} end
+test_run:cmd("create server replica with rpl_master=default, script='replication/replica.lua'")
+test_run:cmd("start server replica")
+test_run:cmd("switch replica")
+box.space.test:count()
+
+-- rows written while the replica is down are sent on subscribe
+test_run:cmd("switch default")
+test_run:cmd("stop server replica")
+for i = 1001, 2000 do s:replace{i, pad} end
+test_run:cmd("start server replica")
+test_run:cmd("switch replica")
+fiber = require('fiber')
+while box.space.test:count() < 2000 do fiber.sleep(0.01) end
+sum = 0
+for _, t in box.space.test:pairs() do sum = sum + t[1] end
+sum
+
+-- a single row isn't held back in the batch
+test_run:cmd("switch default")
+_ = s:replace{2001, pad}
+test_run:cmd("switch replica")
+while box.space.test:get{2001} == nil do fiber.sleep(0.01) end
+box.space.test:get{2001}[2] == string.rep('x', 200)
+
+-- cleanup
+test_run:cmd("switch default")
+test_run:cmd("stop server replica")
+test_run:cmd("cleanup server replica")
+s:drop()
+box.schema.user.revoke('guest', 'replication')
@@ -0,0 +1,9 @@
+#!/usr/bin/env tarantool
+os = require('os')
+box.cfg({
+    listen              = os.getenv("LISTEN"),
+    memtx_memory        = 107374182,
+    wal_tail_size       = 4096,
+})
+
+require('console').listen(os.getenv('ADMIN'))
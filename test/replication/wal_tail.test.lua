@@ -0,0 +1,40 @@
+--
+-- A row which doesn't fit in the in-memory WAL tail must not
+-- be skipped by relays which have caught up with the tail.
+--
+env = require('test_run')
+test_run = env.new()
+engine = test_run:get_cfg('engine')
+
+test_run:cmd("create server wal_tail with script='replication/wal_tail.lua'")
+test_run:cmd("start server wal_tail")
+test_run:cmd("switch wal_tail")
+box.schema.user.grant('guest', 'replication')
+s = box.schema.space.create('test', {engine = engine})
+_ = s:create_index('primary')
+for i = 1, 10 do s:insert{i, 'small'} end
+
+test_run:cmd("create server replica with rpl_master=wal_tail, script='replication/replica.lua'")
+test_run:cmd("start server replica")
+test_run:cmd("switch replica")
+fiber = require('fiber')
+s = box.space.test
+while s.index[0]:count() < 10 do fiber.sleep(0.01) end
+
+-- The relay is up to date with the tail now.
+test_run:cmd("switch wal_tail")
+box.cfg.wal_tail_size
+_ = s:insert{11, string.rep('x', 8192)}
+for i = 12, 20 do s:insert{i, 'small'} end
+
+test_run:cmd("switch replica")
+while s.index[0]:count() < 20 do fiber.sleep(0.01) end
+s:get{11}[2] == string.rep('x', 8192)
+s:get{20}
+box.info.replication[1].status
+
+test_run:cmd("switch default")
+test_run:cmd("stop server replica")
+test_run:cmd("cleanup server replica")
+test_run:cmd("stop server wal_tail")
+test_run:cmd("cleanup server wal_tail")
@@ -70,6 +70,26 @@ compare(type_t a, type_t b);
 #define bps_tree_key_t uint32_t
 #define bps_tree_arg_t int
 #include "salad/bps_tree.h"
+#undef BPS_TREE_NAME
+#undef BPS_TREE_BLOCK_SIZE
+#undef BPS_TREE_EXTENT_SIZE
+#undef BPS_TREE_COMPARE
+#undef BPS_TREE_COMPARE_KEY
+#undef bps_tree_elem_t
+#undef bps_tree_key_t
+#undef bps_tree_arg_t
+
+/* tree for offset test */
+#define BPS_TREE_NAME offs
+#define BPS_TREE_BLOCK_SIZE 128 /* value is to low specially for tests */
+#define BPS_TREE_EXTENT_SIZE 2048 /* value is to low specially for tests */
+#define BPS_TREE_COMPARE(a, b, arg) ((a) < (b) ? -1 : (a) > (b) ? 1 : 0)
+#define BPS_TREE_COMPARE_KEY(a, b, arg) (((a) >> 32) < (b) ? -1 : ((a) >> 32) > (b) ? 1 : 0)
+#define bps_tree_elem_t uint64_t
+#define bps_tree_key_t uint32_t
+#define bps_tree_arg_t int
+#define BPS_TREE_CHILD_COUNTS
+#include "salad/bps_tree.h"
 
 static int
 node_comp(const void *p1, const void *p2, void* unused)
@@ -755,6 +775,100 @@ approximate_count()
 	footer();
 }
 
+static void
+offset_check_tree(offs *tree, const uint64_t *sorted, size_t count,
+		  uint32_t max_key, int *err_count)
+{
+	if (offs_debug_check(tree)) {
+		(*err_count)++;
+		return;
+	}
+	size_t lo = 0, hi = 0;
+	for (uint32_t key = 0; key <= max_key; key++) {
+		while (lo < count && (sorted[lo] >> 32) < key)
+			lo++;
+		hi = lo;
+		while (hi < count && (sorted[hi] >> 32) == key)
+			hi++;
+		size_t offset;
+		offs_iterator itr = offs_lower_bound_get_offset(tree, key,
+								NULL, &offset);
+		if (offset != lo)
+			(*err_count)++;
+		if (offs_iterator_is_invalid(&itr) != (lo == count))
+			(*err_count)++;
+		offs_upper_bound_get_offset(tree, key, NULL, &offset);
+		if (offset != hi)
+			(*err_count)++;
+	}
+	for (size_t i = 0; i <= count; i++) {
+		offs_iterator itr = offs_iterator_at(tree, i);
+		uint64_t *elem = offs_iterator_get_elem(tree, &itr);
+		if (i == count ? elem != NULL : elem == NULL || *elem != sorted[i])
+			(*err_count)++;
+	}
+}
+
+static void
+offset_test()
+{
+	header();
+	srand(0);
+
+	const uint32_t max_key = 200;
+	const size_t arr_size = 3000;
+	uint64_t arr[arr_size];
+	for (size_t i = 0; i < arr_size; i++)
+		arr[i] = ((uint64_t)(rand() % max_key) << 32) | i;
+
+	offs tree;
+	offs_create(&tree, 0, extent_alloc, extent_free, &extents_count);
+	int err_count = 0;
+	uint64_t sorted[arr_size];
+	size_t count = 0;
+	for (size_t i = 0; i < arr_size; i++) {
+		offs_insert(&tree, arr[i], NULL);
+		size_t j = count++;
+		for (; j > 0 && sorted[j - 1] > arr[i]; j--)
+			sorted[j] = sorted[j - 1];
+		sorted[j] = arr[i];
+		if (i % 97 == 0)
+			offset_check_tree(&tree, sorted, count, max_key,
+					  &err_count);
+	}
+	offset_check_tree(&tree, sorted, count, max_key, &err_count);
+	while (count > 0) {
+		size_t j = rand() % count;
+		offs_delete(&tree, sorted[j]);
+		count--;
+		for (; j < count; j++)
+			sorted[j] = sorted[j + 1];
+		if (count % 97 == 0)
+			offset_check_tree(&tree, sorted, count, max_key,
+					  &err_count);
+	}
+	offs_destroy(&tree);
+
+	for (size_t i = 0; i < arr_size; i += 111) {
+		offs_create(&tree, 0, extent_alloc, extent_free,
+			    &extents_count);
+		for (size_t j = 0; j < i; j++)
+			sorted[j] = ((uint64_t)(j / 3) << 32) | j;
+		if (offs_build(&tree, sorted, i))
+			fail("building failed", "true");
+		offset_check_tree(&tree, sorted, i, max_key, &err_count);
+		offs_destroy(&tree);
+	}
+
+	int res = offs_debug_check_internal_functions(false);
+	if (res)
+		printf("self test returned error %d\n", res);
+
+	printf("Error count: %d\n", err_count);
+
+	footer();
+}
+
 int
 main(void)
 {
@@ -766,6 +880,7 @@ main(void)
 	printing_test();
 	white_box_test();
 	approximate_count();
+	offset_test();
 	if (extents_count != 0)
 		fail("memory leak!", "true");
 }
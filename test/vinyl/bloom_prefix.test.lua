@@ -0,0 +1,75 @@
+#!/usr/bin/env tarantool
+
+test_run = require('test_run').new()
+
+--
+-- Index option bloom_prefix.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+s:create_index('pk', {bloom_prefix = -1, parts = {1, 'unsigned', 2, 'unsigned'}})
+s:create_index('pk', {bloom_prefix = 2, parts = {1, 'unsigned', 2, 'unsigned'}})
+s:create_index('pk', {bloom_prefix = 1})
+i = s:create_index('pk', {bloom_prefix = 1, parts = {1, 'unsigned', 2, 'unsigned'}})
+box.space._index:get{s.id, 0}[5].bloom_prefix
+
+-- the same data without a prefix filter to compare with
+p = box.schema.space.create('test_plain', {engine = 'vinyl'})
+_ = p:create_index('pk', {parts = {1, 'unsigned', 2, 'unsigned'}})
+
+reflects = 0
+function cur_reflects() return box.info.vinyl().performance["iterator"].run.bloom_reflect_count end
+function new_reflects() local o = reflects reflects = cur_reflects() return reflects - o end
+seeks = 0
+function cur_seeks() return box.info.vinyl().performance["iterator"].run.lookup_count end
+function new_seeks() local o = seeks seeks = cur_seeks() return seeks - o end
+
+for i = 1,1000 do for j = 1,3 do s:replace{i, j} p:replace{i, j} end end
+box.snapshot()
+_ = new_reflects()
+_ = new_seeks()
+
+-- prefix lookups of present keys always read the run
+for i = 1,1000 do s:select{i} end
+new_reflects() == 0
+new_seeks() >= 1000
+
+-- prefix lookups of absent keys skip it
+for i = 1001,2000 do s:select{i} end
+new_reflects() > 980
+new_seeks() < 20
+
+-- without bloom_prefix only full keys are filtered
+for i = 1001,2000 do p:select{i} end
+new_reflects() == 0
+for i = 1001,2000 do p:select{i, 1} end
+new_reflects() > 980
+
+-- range lookups are never filtered
+s:select({1001}, {iterator = 'GE'})
+new_reflects() == 0
+
+test_run:cmd('restart server default')
+
+s = box.space.test
+reflects = 0
+function cur_reflects() return box.info.vinyl().performance["iterator"].run.bloom_reflect_count end
+function new_reflects() local o = reflects reflects = cur_reflects() return reflects - o end
+seeks = 0
+function cur_seeks() return box.info.vinyl().performance["iterator"].run.lookup_count end
+function new_seeks() local o = seeks seeks = cur_seeks() return seeks - o end
+
+_ = new_reflects()
+_ = new_seeks()
+
+for i = 1,1000 do s:select{i} end
+new_reflects() == 0
+new_seeks() >= 1000
+
+for i = 1001,2000 do s:select{i} end
+new_reflects() > 980
+new_seeks() < 20
+
+#s:select{500}
+
+s:drop()
+box.space.test_plain:drop()
@@ -313,3 +313,18 @@ i1:min()
 i1:max()
 
 s:drop()
+
+--
+-- Cached tuples and run pages share the vinyl_cache quota,
+-- neither of them may crowd the other out.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk')
+for i = 1, 1000 do s:replace{i, string.rep('x', 100)} end
+box.snapshot()
+for i = 1, 1000 do s:get{i} end
+perf = box.info.vinyl().performance
+perf.cache.count > 0
+perf.page_cache.count > 0
+perf.cache.used < 2 * box.cfg.vinyl_cache
+s:drop()
@@ -0,0 +1,68 @@
+test_run = require('test_run').new()
+fiber = require('fiber')
+
+--
+-- Index options compaction and compaction_window.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+s:create_index('pk', {compaction = 'universal'})
+s:create_index('pk', {compaction = 'tiered', compaction_window = 0})
+s:create_index('pk', {compaction = 10})
+_ = s:create_index('pk', {compaction = 'TIME_WINDOW', compaction_window = 3600})
+box.space._index:get{s.id, 0}[5].compaction
+box.space._index:get{s.id, 0}[5].compaction_window
+s:drop()
+
+function vyinfo(space) return box.info.vinyl().db[space.id .. '/0'] end
+
+test_run:cmd("setopt delimiter ';'")
+function dump(space, count)
+    for i = 1, count do
+        space:replace{i}
+        box.snapshot()
+    end
+end;
+test_run:cmd("setopt delimiter ''");
+
+--
+-- Tiered: runs of the same size form a tier, which is
+-- compacted once it has more than run_count_per_level runs.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {compaction = 'tiered', run_count_per_level = 2})
+dump(s, 2)
+vyinfo(s).run_count
+dump(s, 1)
+while vyinfo(s).run_count > 1 do fiber.sleep(0.01) end
+vyinfo(s).run_count
+s:select()
+s:drop()
+
+--
+-- Time window: runs of the current window are compacted like
+-- tiered ones.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {compaction = 'time_window', run_count_per_level = 2})
+dump(s, 3)
+while vyinfo(s).run_count > 1 do fiber.sleep(0.01) end
+vyinfo(s).run_count
+s:select()
+s:drop()
+
+--
+-- Time window: runs of past windows are never rewritten.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {compaction = 'time_window', compaction_window = 1, run_count_per_level = 2})
+test_run:cmd("setopt delimiter ';'")
+for i = 1, 3 do
+    s:replace{i}
+    box.snapshot()
+    fiber.sleep(1.1)
+end;
+test_run:cmd("setopt delimiter ''");
+fiber.sleep(0.1)
+vyinfo(s).run_count
+s:select()
+s:drop()
@@ -0,0 +1,85 @@
+test_run = require('test_run').new()
+
+--
+-- Index options compression_level and compression_dictionary.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+s:create_index('pk', {compression_level = 0})
+s:create_index('pk', {compression_level = 100})
+s:create_index('pk', {compression_dictionary = -1})
+s:create_index('pk', {page_size = 1024, compression_dictionary = 2048})
+d = s:create_index('pk', {page_size = 1024, compression_dictionary = 512, compression_level = 9})
+opts = box.space._index:get{s.id, 0}[5]
+opts.compression_dictionary
+opts.compression_level
+
+-- runs written without a dictionary, like by older versions,
+-- sit next to the ones written with it
+p = box.schema.space.create('test_plain', {engine = 'vinyl'})
+_ = p:create_index('pk', {page_size = 1024})
+
+function value(i) return string.rep('abcdefgh', 8) .. i end
+for i = 1, 1000 do s:replace{i, value(i)} p:replace{i, value(i)} end
+box.snapshot()
+
+function vyinfo(space) return box.info.vinyl().db[space.id .. '/0'] end
+vyinfo(s).page_count > 10
+vyinfo(s).size < vyinfo(p).size
+
+test_run:cmd("setopt delimiter ';'")
+function check(space)
+    local count = 0
+    for _, t in space:pairs() do
+        if t[2] == value(t[1]) then count = count + 1 end
+    end
+    return count
+end;
+test_run:cmd("setopt delimiter ''");
+check(s)
+check(p)
+s:get{500}[2] == value(500)
+s:select({990}, {iterator = 'GT'})[1][1]
+
+-- the dictionary is loaded with the run on recovery
+test_run:cmd('restart server default')
+s = box.space.test
+p = box.space.test_plain
+function value(i) return string.rep('abcdefgh', 8) .. i end
+test_run:cmd("setopt delimiter ';'")
+function check(space)
+    local count = 0
+    for _, t in space:pairs() do
+        if t[2] == value(t[1]) then count = count + 1 end
+    end
+    return count
+end;
+test_run:cmd("setopt delimiter ''");
+box.space._index:get{s.id, 0}[5].compression_dictionary
+check(s)
+check(p)
+s:get{1}[2] == value(1)
+s:get{1000}[2] == value(1000)
+
+-- xlog readers load the dictionary of a .run from its .index
+xlog = require('xlog')
+fio = require('fio')
+function run_files(space, suffix) return fio.glob(fio.pathjoin(box.cfg.vinyl_dir, tostring(space.id), '0', '*.' .. suffix)) end
+#run_files(s, 'run')
+test_run:cmd("setopt delimiter ';'")
+function check_file(path)
+    local count = 0
+    for _, row in xlog.pairs(path) do
+        local t = row.BODY.tuple
+        if t[2] == value(t[1]) then count = count + 1 end
+    end
+    return count
+end;
+test_run:cmd("setopt delimiter ''");
+check_file(run_files(s, 'run')[1])
+check_file(run_files(p, 'run')[1])
+count = 0
+for _, row in xlog.pairs(run_files(s, 'index')[1]) do count = count + 1 end
+count > 10
+
+s:drop()
+p:drop()
@@ -0,0 +1,63 @@
+test_run = require('test_run').new()
+fiber = require('fiber')
+
+--
+-- An autocommit cursor over a secondary index looks up rows
+-- in the primary index in batches. Rows read ahead must not
+-- be returned if the space changes during the iteration.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk')
+sk = s:create_index('sk', {parts = {2, 'unsigned'}})
+function fill() for i = 1, 100 do s:replace{i, i} end box.snapshot() end
+fill()
+
+-- rows deleted ahead of the cursor are skipped
+res = {}
+for _, t in sk:pairs() do table.insert(res, t[1]) s:delete{t[1] + 1} end
+#res
+res[1], res[2], res[50]
+s:count()
+
+-- rows replaced ahead of the cursor are returned new
+fill()
+res = {}
+for _, t in sk:pairs() do table.insert(res, t[3] or 'old') if t[1] < 100 then s:replace{t[1] + 1, t[2] + 1, 'new'} end end
+#res
+res[1], res[2], res[100]
+count = 0
+for i = 1, 100 do if res[i] == 'new' then count = count + 1 end end
+count
+
+-- changes made by another fiber between next() calls
+fill()
+gen, param, state = sk:pairs()
+for i = 1, 9 do state, t = gen(param, state) end
+t
+f = fiber.create(function() s:delete{12} s:replace{11, 11, 'new'} end)
+while f:status() ~= 'dead' do fiber.sleep(0.01) end
+state, t = gen(param, state)
+t
+state, t = gen(param, state)
+t
+state, t = gen(param, state)
+t
+gen, param, state = nil
+
+s:drop()
+
+-- the cursor stops at the end of an EQ key after a change
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk')
+sk = s:create_index('sk', {unique = false, parts = {2, 'unsigned'}})
+for i = 1, 100 do s:replace{i, i % 2} end
+box.snapshot()
+res = {}
+for _, t in sk:pairs({0}) do table.insert(res, t[1]) s:delete{t[1] + 2} end
+#res
+res[1], res[2], res[#res]
+count = 0
+for _, k in ipairs(res) do if k % 2 ~= 0 then count = count + 1 end end
+count
+
+s:drop()
@@ -0,0 +1,56 @@
+test_run = require('test_run').new()
+fiber = require('fiber')
+
+--
+-- Space option defer_deletes: REPLACE and DELETE don't read the
+-- old tuple, keys of overwritten tuples stay in secondary indexes
+-- and are skipped on read.
+--
+
+-- only vinyl supports the option
+box.schema.space.create('test', {engine = 'memtx', defer_deletes = true})
+s = box.schema.space.create('test', {engine = 'vinyl', defer_deletes = true})
+box.space._space:get(s.id)[6].defer_deletes
+pk = s:create_index('pk', {run_count_per_level = 2})
+-- unique secondary indexes are not supported
+s:create_index('sk', {parts = {2, 'unsigned'}})
+sk = s:create_index('sk', {parts = {2, 'unsigned'}, unique = false, run_count_per_level = 2})
+-- the option can't be switched on a space with indexes
+box.space._space:update(s.id, {{'=', 6, {defer_deletes = false}}})
+
+function vyinfo(index) return box.info.vinyl().db[s.id .. '/' .. index.id] end
+
+for i = 1, 10 do s:replace{i, i} end
+for i = 1, 10, 2 do s:replace{i, i + 100} end
+s:delete{2}
+s:delete{4}
+
+-- overwritten and deleted tuples are not visible through the
+-- secondary index, both in memory and on disk
+sk:select()
+sk:select{1}
+sk:select{2}
+sk:select{101}
+box.snapshot()
+sk:select()
+sk:select{1}
+sk:select{2}
+sk:select{101}
+pk:select()
+
+-- stale entries are still skipped once runs are compacted
+s:replace{6, 200}
+s:delete{8}
+box.snapshot()
+s:replace{10, 1}
+box.snapshot()
+while vyinfo(sk).run_count > 1 do fiber.sleep(0.01) end
+while vyinfo(pk).run_count > 1 do fiber.sleep(0.01) end
+sk:select()
+sk:select{1}
+sk:select{6}
+sk:select{8}
+sk:select({100}, {iterator = 'GE', limit = 2})
+sk:select({200}, {iterator = 'LE', limit = 2})
+
+s:drop()
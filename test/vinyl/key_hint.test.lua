@@ -0,0 +1,119 @@
+#!/usr/bin/env tarantool
+
+test_run = require('test_run').new()
+
+--
+-- Binary search in a run page compares key hints before
+-- decoding statements. Check that lookups and range scans
+-- are not affected by keys with equal hints.
+--
+
+-- integer keys, both negative and positive
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {parts = {1, 'integer'}, page_size = 256})
+for k = -100, 100 do s:replace{k * 1000000000000} end
+-- adjacent positive keys share a hint
+for k = 1, 10 do s:replace{k} end
+box.snapshot()
+found = 0
+for k = -100, 100 do if s:get{k * 1000000000000} ~= nil then found = found + 1 end end
+found
+found = 0
+for k = 1, 10 do if s:get{k} ~= nil then found = found + 1 end end
+found
+s:get{-1}
+s:get{11}
+#s:select({0}, {iterator = 'GE'})
+#s:select({0}, {iterator = 'LT'})
+#s:select({5}, {iterator = 'GT'})
+#s:select({5}, {iterator = 'LE'})
+s:drop()
+
+-- non-negative integer keys may come encoded as MP_INT
+ffi = require('ffi')
+ffi.cdef[[int box_replace(uint32_t space_id, const char *tuple, const char *tuple_end, box_tuple_t **result);]]
+test_run:cmd("setopt delimiter ';'")
+function replace_mp_int(space_id, k)
+    local data = string.char(0x91, 0xd3, 0, 0, 0, 0, 0, 0, 0, k)
+    local p = ffi.cast('const char *', data)
+    return ffi.C.box_replace(space_id, p, p + #data, nil)
+end;
+test_run:cmd("setopt delimiter ''");
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {parts = {1, 'integer'}, page_size = 64})
+for k = 1, 100 do if k % 2 == 0 then replace_mp_int(s.id, k) else s:replace{k} end end
+for k = -10, -1 do s:replace{k} end
+box.snapshot()
+found = 0
+for k = -10, 100 do if s:get{k} ~= nil then found = found + 1 end end
+found
+s:get{50}
+s:get{51}
+#s:select({50}, {iterator = 'GE'})
+#s:select({50}, {iterator = 'LT'})
+s:drop()
+
+-- lookups with MP_INT-encoded keys around zero and at the edges
+test_run:cmd("setopt delimiter ';'")
+function get_mp_int(space_id, k)
+    local fill = k < 0 and 0xff or 0
+    local key = string.char(0x91, 0xd3, fill, fill, fill, fill,
+                            fill, fill, fill, k % 256)
+    local p = ffi.cast('const char *', key)
+    local result = ffi.new('box_tuple_t *[1]')
+    if ffi.C.box_index_get(space_id, 0, p, p + #key, result) ~= 0 then
+        error(box.error.last())
+    end
+    return result[0] ~= nil
+end;
+test_run:cmd("setopt delimiter ''");
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {parts = {1, 'integer'}, page_size = 64})
+for k = -100, 100 do s:replace{k} end
+_ = s:replace{-9223372036854775808LL}
+_ = s:replace{18446744073709551615ULL}
+box.snapshot()
+found = 0
+for k = -100, 100 do if get_mp_int(s.id, k) then found = found + 1 end end
+found
+get_mp_int(s.id, -101)
+get_mp_int(s.id, 101)
+s:get{-9223372036854775808LL}
+s:get{18446744073709551615ULL}
+#s:select({-1}, {iterator = 'GE'})
+#s:select({0}, {iterator = 'LT'})
+s:select({-2}, {iterator = 'GT', limit = 3})
+s:select({1}, {iterator = 'LT', limit = 3})
+s:drop()
+
+-- string keys with a long common prefix
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {parts = {1, 'string'}, page_size = 256})
+prefix = string.rep('x', 16)
+for k = 1, 200 do s:replace{prefix .. string.format('%05d', k)} end
+s:replace{'xxxxxxxx'}
+s:replace{'xxxxxxx'}
+box.snapshot()
+found = 0
+for k = 1, 200 do if s:get{prefix .. string.format('%05d', k)} ~= nil then found = found + 1 end end
+found
+s:get{'xxxxxxxx'}
+s:get{'xxxxxxx'}
+s:get{prefix}
+s:get{prefix .. '00000'}
+#s:select({prefix .. '00100'}, {iterator = 'GT'})
+#s:select({prefix .. '00100'}, {iterator = 'LE'})
+#s:select({prefix}, {iterator = 'GE'})
+s:drop()
+
+-- multipart keys: the hint covers the first part only
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {parts = {1, 'unsigned', 2, 'string'}, page_size = 256})
+for k = 1, 100 do s:replace{k % 3, tostring(k)} end
+box.snapshot()
+#s:select({0})
+#s:select({1})
+#s:select({2})
+s:get{1, '1'}
+s:get{1, '2'}
+s:drop()
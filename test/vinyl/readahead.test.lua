@@ -0,0 +1,74 @@
+test_run = require('test_run').new()
+
+test_run:cmd('create server readahead with script="vinyl/vinyl_readahead.lua"')
+test_run:cmd('start server readahead')
+test_run:cmd('switch readahead')
+
+fiber = require('fiber')
+
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk')
+pad = string.rep('x', 100)
+for i = 1, 5000 do s:replace{i, pad} end
+box.snapshot()
+
+--
+-- Pages read ahead by all run iterators together may take up
+-- to 1/16 of the vinyl_cache quota.
+--
+budget = box.cfg.vinyl_cache / 16
+max_readahead = 0
+test_run:cmd("setopt delimiter ';'")
+function scan(iterator)
+    local count = 0
+    local step = iterator == 'GE' and 1 or -1
+    local next = iterator == 'GE' and 1 or 5000
+    for _, t in s:pairs({}, {iterator = iterator}) do
+        if t[1] ~= next then
+            error(string.format('expected %d, got %d', next, t[1]))
+        end
+        next = next + step
+        count = count + 1
+        if count % 10 == 0 then
+            local readahead = box.info.vinyl().performance.page_cache.readahead
+            max_readahead = math.max(max_readahead, readahead)
+        end
+    end
+    return count
+end;
+test_run:cmd("setopt delimiter ''");
+
+-- Sequential scans read pages ahead.
+scan('GE')
+scan('LE')
+max_readahead > 0
+max_readahead <= budget
+
+-- Concurrent scans share the budget.
+max_readahead = 0
+ch = fiber.channel(4)
+for i = 1, 4 do fiber.create(function() ch:put(scan(i % 2 == 0 and 'GE' or 'LE')) end) end
+result = {}
+for i = 1, 4 do table.insert(result, ch:get()) end
+result
+max_readahead > 0
+max_readahead <= budget
+
+--
+-- Stopping the server finishes reads ahead in progress,
+-- the data survives the restart.
+--
+for i = 1, 4 do fiber.create(function() while true do scan('GE') end end) end
+fiber.sleep(0.01)
+test_run:cmd('switch default')
+test_run:cmd('stop server readahead')
+test_run:cmd('start server readahead')
+test_run:cmd('switch readahead')
+
+s = box.space.test
+s:count()
+s:drop()
+
+test_run:cmd('switch default')
+test_run:cmd('stop server readahead')
+test_run:cmd('cleanup server readahead')
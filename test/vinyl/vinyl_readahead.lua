@@ -0,0 +1,12 @@
+#!/usr/bin/env tarantool
+
+box.cfg {
+    listen            = os.getenv("LISTEN"),
+    memtx_memory      = 512 * 1024 * 1024,
+    vinyl_memory = 512 * 1024 * 1024;
+    vinyl_range_size = 1024 * 1024;
+    vinyl_page_size = 1024;
+    vinyl_cache = 256 * 1024; -- 16kB for read-ahead
+}
+
+require('console').listen(os.getenv('ADMIN'))
@@ -311,3 +311,53 @@ pk:get{2}
 pk:get{3}
 
 space:drop()
+
+--
+-- Compaction of many runs with overlapping keys: the write
+-- iterator merges all the runs at once.
+--
+fiber = require('fiber')
+space = box.schema.space.create('test', {engine = 'vinyl'})
+pk = space:create_index('primary', {compaction = 'tiered', run_count_per_level = 20, range_size = 1024 * 1024})
+function run_count() return box.info.vinyl().db[space.id..'/0'].run_count end
+model = {}
+test_run:cmd("setopt delimiter ';'")
+function dump(r)
+    for k = 1, 50 do
+        local op = (k + r) % 4
+        if op == 0 then
+            space:replace{k, r}
+            model[k] = r
+        elseif op == 1 then
+            space:delete{k}
+            model[k] = nil
+        elseif op == 2 then
+            space:upsert({k, r}, {{'+', 2, 1}})
+            model[k] = model[k] ~= nil and model[k] + 1 or r
+        end
+    end
+    box.snapshot()
+end;
+function check()
+    local result = space:select()
+    local count = 0
+    for k, v in pairs(model) do count = count + 1 end
+    if #result ~= count then
+        return false
+    end
+    for _, t in ipairs(result) do
+        if model[t[1]] ~= t[2] then
+            return false
+        end
+    end
+    return true
+end;
+test_run:cmd("setopt delimiter ''");
+for r = 1, 20 do dump(r) end
+run_count()
+check()
+dump(21)
+while run_count() > 1 do fiber.sleep(0.01) end
+run_count()
+check()
+space:drop()
@@ -0,0 +1,29 @@
+env = require('test_run').new()
+
+(pcall(box.cfg, {memtx_snap_threads = 0}))
+box.cfg.memtx_snap_threads
+box.cfg{memtx_snap_threads = 4}
+box.cfg.memtx_snap_threads
+
+-- spaces of different sizes are spread among writer threads
+for i = 1, 8 do s = box.schema.space.create('snap' .. i) s:create_index('pk') s:create_index('sk', {parts = {2, 'unsigned'}}) end
+for i = 1, 8 do box.begin() for j = 1, i * 1000 do box.space['snap' .. i]:insert{j, i * j} end box.commit() end
+box.snapshot()
+env:cmd('restart server default')
+
+box.cfg.memtx_snap_threads
+res = {}
+for i = 1, 8 do s = box.space['snap' .. i] table.insert(res, {s:count(), s.index.sk:max()[2]}) end
+res
+
+-- rows of all writer threads are numbered without repeats
+fio = require('fio')
+xlog = require('xlog').pairs
+snaps = fio.glob(fio.pathjoin(box.cfg.memtx_dir, '*.snap'))
+lsns, dups, count, max = {}, 0, 0, 0
+for _, row in xlog(snaps[#snaps]) do local lsn = row.HEADER.lsn if lsns[lsn] then dups = dups + 1 end lsns[lsn] = true count = count + 1 max = math.max(max, lsn) end
+dups
+max == count
+count > 36000
+
+for i = 1, 8 do box.space['snap' .. i]:drop() end
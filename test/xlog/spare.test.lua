@@ -0,0 +1,60 @@
+--
+-- After a WAL file reaches rows_per_wal, a spare file with
+-- disk space reserved is created in the background, and the
+-- next rotation turns it into the new WAL file.
+--
+test_run = require('test_run').new()
+test_run:cmd('restart server default with cleanup=1')
+fio = require('fio')
+fiber = require('fiber')
+errinj = box.error.injection
+spare = fio.pathjoin(box.cfg.wal_dir, 'spare.xlog.inprogress')
+test_run:cmd("setopt delimiter ';'")
+function wait_spare()
+    while fio.stat(spare) == nil do fiber.sleep(0.01) end
+    -- let the space reservation complete
+    fiber.sleep(0.1)
+    return fio.stat(spare).inode
+end;
+function last_xlog()
+    local files = fio.glob(fio.pathjoin(box.cfg.wal_dir, '*.xlog'))
+    table.sort(files)
+    return files[#files]
+end;
+test_run:cmd("setopt delimiter ''");
+
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+for i = 1, 20 do s:replace{i} end
+inode = wait_spare()
+-- one more rotation, the spare becomes the new WAL file
+for i = 21, 30 do s:replace{i} end
+fio.stat(last_xlog()).inode == inode
+-- and a new spare is created
+wait_spare() ~= inode
+
+--
+-- If the spare file can't be created, the next WAL file is
+-- created at rotation as usual.
+--
+errinj.set('ERRINJ_XLOG_SPARE', true)
+for i = 31, 40 do s:replace{i} end
+fiber.sleep(0.1)
+fio.stat(spare) == nil
+xlog = last_xlog()
+for i = 41, 50 do s:replace{i} end
+last_xlog() ~= xlog
+fio.stat(spare) == nil
+errinj.set('ERRINJ_XLOG_SPARE', false)
+for i = 51, 60 do s:replace{i} end
+inode = wait_spare()
+for i = 61, 70 do s:replace{i} end
+fio.stat(last_xlog()).inode == inode
+s:count()
+
+-- the logs are intact
+test_run:cmd('restart server default')
+s = box.space.test
+s:count()
+s:drop()
+test_run:cmd('restart server default with cleanup=1')
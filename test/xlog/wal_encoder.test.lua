@@ -0,0 +1,62 @@
+--
+-- Large transactions are encoded in the 'walenc' thread on
+-- their way to WAL, small ones go to WAL directly. A failed
+-- write rolls back the requests queued on both ways.
+--
+test_run = require('test_run').new()
+fiber = require('fiber')
+errinj = box.error.injection
+
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+stat = box.schema.space.create('stat')
+_ = stat:create_index('pk')
+
+stop = false
+committed = 0
+failed = 0
+ch = fiber.channel(20)
+test_run:cmd("setopt delimiter ';'")
+function writer(id, size)
+    local i = 0
+    while not stop do
+        i = i + 1
+        local tuple = {id * 1000000 + i, string.rep('x', size)}
+        if pcall(s.replace, s, tuple) then
+            committed = committed + 1
+        else
+            failed = failed + 1
+        end
+    end
+    ch:put(true)
+end;
+test_run:cmd("setopt delimiter ''");
+for id = 1, 20 do fiber.create(writer, id, id % 2 == 0 and 10 or 10000) end
+fiber.sleep(0.1)
+errinj.set('ERRINJ_WAL_WRITE', true)
+fiber.sleep(0.1)
+errinj.set('ERRINJ_WAL_WRITE', false)
+fiber.sleep(0.1)
+stop = true
+for id = 1, 20 do ch:get() end
+failed > 0
+committed > 0
+s:count() == committed
+
+-- both ways work after the rollback
+s:replace{1, 'small'}[2]
+#s:replace{2, string.rep('x', 10000)}[2]
+_ = stat:replace{1, committed + 2}
+box.snapshot()
+
+-- the encoder is stopped on shutdown, the writes survive it
+_ = stat:replace{2, s:count()}
+test_run:cmd('restart server default')
+s = box.space.test
+stat = box.space.stat
+s:count() == stat:get{1}[2]
+s:count() == stat:get{2}[2]
+s:get{1}[2]
+
+s:drop()
+stat:drop()